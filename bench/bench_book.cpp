@@ -0,0 +1,460 @@
+// OrderBook micro-benchmarks.
+//
+// Every benchmark runs against a book of N resting orders spread evenly over
+// kLevelsPerSide price levels per side (queue length N / (2*kLevelsPerSide)), for
+// N = 1k .. 10M. Mutating benchmarks time a batch of operations, then restore the
+// book with timing paused so the next batch sees the same size.
+// Mutating benchmarks and the CLX5 replay also report perf_event counters per
+// operation (cycles, instructions, cache and branch misses; software counters where
+// the PMU is not accessible).
+//
+//   ./bench_book                                   # all, JSON -> bench_book.json
+//   ./bench_book --benchmark_filter=Cancel         # subset
+//   ./bench_book --benchmark_out=abc123.json       # name the result per commit
+//   python scripts/bench_compare.py old.json new.json
+#include <benchmark/benchmark.h>
+#include "engine/order_book.hpp"
+#include "common/shm_book.hpp"
+#include "perf_scope.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+using namespace engine;
+
+namespace {
+
+constexpr int      kLevelsPerSide = 50;
+constexpr int      kLevels        = 2 * kLevelsPerSide;
+constexpr int64_t  kMid           = 64830000000;
+constexpr int64_t  kTick          = 10000000;
+constexpr int32_t  kQty           = 1 << 30;   // partial trades never empty an order
+
+int64_t level_px(int j) {
+  // levels [0, kLevelsPerSide) are bids going down, the rest asks going up
+  return j < kLevelsPerSide ? kMid - (j + 1) * kTick : kMid + (j - kLevelsPerSide + 1) * kTick;
+}
+Side level_side(int j) { return j < kLevelsPerSide ? Side::Bid : Side::Ask; }
+
+MboEvent add_ev(uint64_t id, int j) {
+  MboEvent e{};
+  e.kind = EventKind::Add;
+  e.side = level_side(j);
+  e.order_id = id;
+  e.price = level_px(j);
+  e.qty = kQty;
+  return e;
+}
+
+MboEvent cancel_ev(uint64_t id) {
+  MboEvent e{};
+  e.kind = EventKind::Cancel;
+  e.order_id = id;
+  return e;
+}
+
+MboEvent modify_ev(uint64_t id, int64_t px, int32_t qty) {
+  MboEvent e{};
+  e.kind = EventKind::Modify;
+  e.order_id = id;
+  e.new_price = px;
+  e.new_qty = qty;
+  return e;
+}
+
+MboEvent trade_ev(uint64_t id, int32_t qty) {
+  MboEvent e{};
+  e.kind = EventKind::Trade;
+  e.order_id = id;
+  e.qty = qty;
+  return e;
+}
+
+// A populated book plus a mirror of every queue, so benchmarks can pick the
+// order at a given queue position without asking the book.
+struct Populated {
+  size_t n = 0;
+  OrderBook book;
+  std::vector<std::deque<uint64_t>> queues;
+  uint64_t next_id = 1;
+
+  explicit Populated(size_t orders) : n(orders), queues(kLevels) {
+    for (size_t i = 0; i < orders; ++i) {
+      int j = static_cast<int>(i % kLevels);
+      book.on_event(add_ev(next_id, j));
+      queues[j].push_back(next_id++);
+    }
+  }
+};
+
+// Building 10M orders takes seconds; keep the last book around. Benchmarks leave it
+// with the same orders per level (queue order may rotate).
+Populated& book_of(size_t n) {
+  static std::unique_ptr<Populated> cached;
+  if (!cached || cached->n != n) {
+    cached.reset();
+    cached = std::make_unique<Populated>(n);
+  }
+  return *cached;
+}
+
+enum Pos { Head = 0, Middle = 1, Tail = 2 };
+
+size_t pick(const std::deque<uint64_t>& q, int pos) {
+  if (pos == Head) return 0;
+  if (pos == Tail) return q.size() - 1;
+  return q.size() / 2;
+}
+
+void set_items(benchmark::State& state, size_t per_iter, PerfScope* perf = nullptr) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * per_iter));
+  if (perf) perf->report(state, static_cast<double>(state.iterations() * per_iter));
+  state.counters["orders"] = static_cast<double>(state.range(0));
+}
+
+void BM_Add(benchmark::State& state) {
+  Populated& p = book_of(state.range(0));
+  constexpr size_t kBatch = 256;
+  std::vector<MboEvent> adds(kBatch), undo(kBatch);
+  for (size_t i = 0; i < kBatch; ++i) {
+    uint64_t id = p.next_id + i;
+    adds[i] = add_ev(id, static_cast<int>(i % kLevels));
+    undo[i] = cancel_ev(id);
+  }
+  PerfScope perf;
+  for (auto _ : state) {
+    for (auto& e : adds) p.book.on_event(e);
+    state.PauseTiming();
+    perf.pause();
+    for (auto& e : undo) p.book.on_event(e);
+    perf.resume();
+    state.ResumeTiming();
+  }
+  set_items(state, kBatch, &perf);
+}
+
+// One cancel per level per batch; the cancelled orders are re-added at the tail.
+void BM_Cancel(benchmark::State& state) {
+  Populated& p = book_of(state.range(0));
+  const int pos = static_cast<int>(state.range(1));
+  std::vector<size_t> idx(kLevels);
+  std::vector<MboEvent> cancels(kLevels);
+  auto prepare = [&] {
+    for (int j = 0; j < kLevels; ++j) {
+      idx[j] = pick(p.queues[j], pos);
+      cancels[j] = cancel_ev(p.queues[j][idx[j]]);
+    }
+  };
+  prepare();
+  PerfScope perf;
+  for (auto _ : state) {
+    for (auto& e : cancels) p.book.on_event(e);
+    state.PauseTiming();
+    perf.pause();
+    for (int j = 0; j < kLevels; ++j) {
+      auto& q = p.queues[j];
+      uint64_t id = q[idx[j]];
+      q.erase(q.begin() + static_cast<std::ptrdiff_t>(idx[j]));
+      q.push_back(id);
+      p.book.on_event(add_ev(id, j));
+    }
+    prepare();
+    perf.resume();
+    state.ResumeTiming();
+  }
+  set_items(state, kLevels, &perf);
+}
+
+// Modify the middle order of every level; range(1) = 1 moves it one level away
+// (loses priority), 0 only changes its size.
+void BM_Modify(benchmark::State& state) {
+  Populated& p = book_of(state.range(0));
+  const bool reprice = state.range(1) != 0;
+  std::vector<size_t> idx(kLevels);
+  std::vector<MboEvent> mods(kLevels), undo(kLevels);
+  int32_t qty = kQty;
+  auto prepare = [&] {
+    --qty;
+    for (int j = 0; j < kLevels; ++j) {
+      idx[j] = pick(p.queues[j], Middle);
+      uint64_t id = p.queues[j][idx[j]];
+      int to = j;
+      if (reprice) {
+        // deeper on the same side; the deepest level moves one step in
+        bool deepest = (j == kLevelsPerSide - 1) || (j == kLevels - 1);
+        to = deepest ? j - 1 : j + 1;
+      }
+      mods[j] = modify_ev(id, level_px(to), qty);
+      undo[j] = modify_ev(id, level_px(j), kQty);
+    }
+  };
+  prepare();
+  PerfScope perf;
+  for (auto _ : state) {
+    for (auto& e : mods) p.book.on_event(e);
+    state.PauseTiming();
+    perf.pause();
+    if (reprice) {
+      for (int j = 0; j < kLevels; ++j) {
+        p.book.on_event(undo[j]);
+        auto& q = p.queues[j];
+        uint64_t id = q[idx[j]];
+        q.erase(q.begin() + static_cast<std::ptrdiff_t>(idx[j]));
+        q.push_back(id);
+      }
+    }
+    prepare();
+    perf.resume();
+    state.ResumeTiming();
+  }
+  set_items(state, kLevels, &perf);
+}
+
+// Trade against the head of every level; range(1) = 0 partial fill, 1 full fill
+// (the filled order is re-added at the tail).
+void BM_Trade(benchmark::State& state) {
+  Populated& p = book_of(state.range(0));
+  const bool full = state.range(1) != 0;
+  std::vector<MboEvent> trades(kLevels);
+  auto prepare = [&] {
+    for (int j = 0; j < kLevels; ++j)
+      trades[j] = trade_ev(p.queues[j].front(), full ? kQty : 1);
+  };
+  prepare();
+  PerfScope perf;
+  for (auto _ : state) {
+    for (auto& e : trades) p.book.on_event(e);
+    state.PauseTiming();
+    perf.pause();
+    if (full) {
+      for (int j = 0; j < kLevels; ++j) {
+        auto& q = p.queues[j];
+        uint64_t id = q.front();
+        q.pop_front();
+        q.push_back(id);
+        p.book.on_event(add_ev(id, j));
+      }
+      prepare();
+    }
+    perf.resume();
+    state.ResumeTiming();
+  }
+  set_items(state, kLevels, &perf);
+}
+
+void BM_Clear(benchmark::State& state) {
+  const size_t n = static_cast<size_t>(state.range(0));
+  MboEvent clr{};
+  clr.kind = EventKind::Clear;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::optional<OrderBook> book(std::in_place);
+    for (size_t i = 0; i < n; ++i) book->on_event(add_ev(i + 1, static_cast<int>(i % kLevels)));
+    state.ResumeTiming();
+    book->on_event(clr);
+    benchmark::ClobberMemory();
+    state.PauseTiming();
+    book.reset();
+    state.ResumeTiming();
+  }
+  set_items(state, 1);
+}
+
+void BM_SnapshotTopN(benchmark::State& state) {
+  Populated& p = book_of(state.range(0));
+  const size_t depth = static_cast<size_t>(state.range(1));
+  for (auto _ : state) {
+    BookSnapshot s = p.book.snapshot_top_n(depth);
+    benchmark::DoNotOptimize(s);
+  }
+  set_items(state, 1);
+}
+
+void BM_SnapshotFull(benchmark::State& state) {
+  Populated& p = book_of(state.range(0));
+  for (auto _ : state) {
+    BookSnapshot s = p.book.snapshot_full();
+    benchmark::DoNotOptimize(s);
+  }
+  set_items(state, 1);
+}
+
+// --- shared-memory top-of-book (ENGINE_SHM_BOOK): writer and reader sides ---
+
+std::string shm_bench_name() { return "/bench_book_" + std::to_string(::getpid()); }
+
+void BM_ShmPublish(benchmark::State& state) {
+  Populated& p = book_of(state.range(0));
+  shm::BookWriter w(shm_bench_name(), 10);
+  LevelView lv[shm::kBookMaxDepth];
+  for (auto _ : state) {
+    size_t nb = p.book.top_levels(Side::Bid, lv, w.depth());
+    shm::BookData& d = w.begin();
+    for (size_t i = 0; i < nb; ++i) d.bids[i] = {lv[i].price, lv[i].total_qty, lv[i].orders, 0};
+    size_t na = p.book.top_levels(Side::Ask, lv, w.depth());
+    for (size_t i = 0; i < na; ++i) d.asks[i] = {lv[i].price, lv[i].total_qty, lv[i].orders, 0};
+    d.bid_count = static_cast<uint32_t>(nb);
+    d.ask_count = static_cast<uint32_t>(na);
+    w.end();
+  }
+  set_items(state, 1);
+}
+
+void BM_ShmRead(benchmark::State& state) {
+  shm::BookWriter w(shm_bench_name(), static_cast<uint32_t>(state.range(0)));
+  shm::BookData& d = w.begin();
+  d.bid_count = d.ask_count = w.depth();
+  w.end();
+  shm::BookReader r(shm_bench_name());
+  shm::BookData out;
+  for (auto _ : state) {
+    bool ok = r.read(out);
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ShmReadTop(benchmark::State& state) {
+  shm::BookWriter w(shm_bench_name(), 10);
+  w.begin();
+  w.end();
+  shm::BookReader r(shm_bench_name());
+  shm::BookLevel bid, ask;
+  uint64_t version;
+  for (auto _ : state) {
+    bool ok = r.read_top(bid, ask, version);
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(bid);
+    benchmark::DoNotOptimize(ask);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// --- CLX5 replay: file parsed up front, only OrderBook::on_event is timed ---
+
+template <class T>
+bool num(std::string_view f, T& out) {
+  auto r = std::from_chars(f.data(), f.data() + f.size(), out);
+  return r.ec == std::errc{};
+}
+
+bool parse_line(std::string_view line, MboEvent& ev) {
+  if (!line.empty() && line[0] == '@') {
+    size_t c = line.find(',');
+    if (c == std::string_view::npos) return false;
+    line.remove_prefix(c + 1);
+  }
+  std::string_view f[6];
+  size_t nf = 0;
+  while (nf < 6) {
+    size_t c = line.find(',');
+    f[nf++] = line.substr(0, c);
+    if (c == std::string_view::npos) break;
+    line.remove_prefix(c + 1);
+  }
+  ev = MboEvent{};
+  if (f[0] == "ADD" && nf >= 6) {
+    ev.kind = EventKind::Add;
+    ev.side = (f[2] == "B") ? Side::Bid : Side::Ask;
+    return num(f[1], ev.ts_ns) && num(f[3], ev.order_id) && num(f[4], ev.price) && num(f[5], ev.qty);
+  }
+  if (f[0] == "MOD" && nf >= 5) {
+    ev.kind = EventKind::Modify;
+    return num(f[1], ev.ts_ns) && num(f[2], ev.order_id) && num(f[3], ev.new_price) && num(f[4], ev.new_qty);
+  }
+  if (f[0] == "CXL" && nf >= 3) {
+    ev.kind = EventKind::Cancel;
+    return num(f[1], ev.ts_ns) && num(f[2], ev.order_id);
+  }
+  if (f[0] == "TRD" && nf >= 4) {
+    ev.kind = EventKind::Trade;
+    return num(f[1], ev.ts_ns) && num(f[2], ev.order_id) && num(f[3], ev.qty);
+  }
+  if (f[0] == "CLR" && nf >= 2) {
+    ev.kind = EventKind::Clear;
+    return num(f[1], ev.ts_ns);
+  }
+  return false;
+}
+
+void BM_ReplayCLX5(benchmark::State& state) {
+  const char* env = std::getenv("BENCH_CLX5");
+  std::string path = env ? env : BENCH_DATA_DIR "/CLX5_lines.txt";
+  std::ifstream in(path);
+  if (!in) {
+    state.SkipWithError(("cannot open " + path).c_str());
+    return;
+  }
+  std::vector<MboEvent> events;
+  std::string line;
+  MboEvent ev;
+  while (std::getline(in, line)) {
+    if (parse_line(line, ev)) events.push_back(ev);
+  }
+
+  PerfScope perf;
+  for (auto _ : state) {
+    auto book = std::make_unique<OrderBook>();
+    for (const auto& e : events) book->on_event(e);
+    benchmark::DoNotOptimize(*book);
+    state.PauseTiming();
+    perf.pause();
+    book.reset();   // teardown is not part of the replay
+    perf.resume();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+  perf.report(state, static_cast<double>(state.iterations() * events.size()));
+  state.counters["events"] = static_cast<double>(events.size());
+}
+
+void sizes(benchmark::internal::Benchmark* b) { b->RangeMultiplier(10)->Range(1000, 10000000); }
+
+void sizes_x(benchmark::internal::Benchmark* b, std::initializer_list<int64_t> xs) {
+  for (int64_t n = 1000; n <= 10000000; n *= 10)
+    for (int64_t x : xs) b->Args({n, x});
+}
+
+} // namespace
+
+BENCHMARK(BM_Add)->Apply(sizes);
+BENCHMARK(BM_Cancel)->ArgNames({"orders", "pos"})->Apply([](auto* b) { sizes_x(b, {Head, Middle, Tail}); });
+BENCHMARK(BM_Modify)->ArgNames({"orders", "reprice"})->Apply([](auto* b) { sizes_x(b, {0, 1}); });
+BENCHMARK(BM_Trade)->ArgNames({"orders", "full"})->Apply([](auto* b) { sizes_x(b, {0, 1}); });
+BENCHMARK(BM_Clear)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SnapshotTopN)->ArgNames({"orders", "n"})->Apply([](auto* b) { sizes_x(b, {1, 5, 20}); });
+BENCHMARK(BM_SnapshotFull)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ShmPublish)->Apply(sizes);
+BENCHMARK(BM_ShmRead)->ArgName("depth")->Arg(1)->Arg(10)->Arg(32);
+BENCHMARK(BM_ShmReadTop);
+BENCHMARK(BM_ReplayCLX5)->Unit(benchmark::kMillisecond);
+
+// Same as BENCHMARK_MAIN(), but results also go to bench_book.json unless an
+// explicit --benchmark_out is given, so every run leaves a comparable file behind.
+int main(int argc, char** argv) {
+  std::vector<char*> args(argv, argv + argc);
+  bool has_out = false;
+  for (int i = 1; i < argc; ++i) has_out |= std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+  char out_arg[] = "--benchmark_out=bench_book.json";
+  char fmt_arg[] = "--benchmark_out_format=json";
+  if (!has_out) {
+    args.push_back(out_arg);
+    args.push_back(fmt_arg);
+  }
+  int n = static_cast<int>(args.size());
+  benchmark::Initialize(&n, args.data());
+  if (benchmark::ReportUnrecognizedArguments(n, args.data())) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
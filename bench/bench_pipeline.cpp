@@ -0,0 +1,311 @@
+// In-process engine pipeline benchmark: no sockets, no streamer.
+//
+// A feed is loaded into memory once and pushed through the engine's own code:
+//   Frame     LineFramer over a MemorySource (64KB chunks, like recv)
+//   Parse     parse_send_stamp + parse_event over pre-framed lines
+//   Apply     OrderBook::on_event over pre-parsed events
+//   Analytics Apply plus BookAnalytics::on_event (ENGINE_ANALYTICS) after each event
+//   TradeTape Apply plus TradeTape::on_event (ENGINE_TRADES) after each event
+//   Pipeline  EngineApp::consume(MemorySource): framing + parsing + apply + latency
+//             histograms, with CSV metrics off (metrics:0) or on (metrics:1)
+// Each benchmark also reports perf_event counters per event (bench/perf_scope.hpp).
+// After the run a per-stage ns/event breakdown is printed; the remainder of the
+// pipeline after frame+parse+apply is the per-event bookkeeping (clocks, book
+// lock, latency histograms).
+//
+// Feeds: feed:0 = CLX5 (or $BENCH_FEED), feed:1 = 500k synthetic MBO events.
+// Every line carries an '@<wall_ns>,' stamp as the streamer would send it.
+#include <benchmark/benchmark.h>
+#include "engine/engine.hpp"
+#include "engine/framer.hpp"
+#include "engine/parser.hpp"
+#include "common/mbo_gen.hpp"
+#include "perf_scope.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace engine;
+
+namespace {
+
+struct Feed {
+  std::string name;
+  std::string bytes;                 // stamped lines, '\n'-terminated
+  std::vector<std::string> lines;    // framed
+  std::vector<MboEvent> events;      // parsed
+  std::string error;
+};
+
+std::string stamp_lines(const std::string& raw) {
+  const std::string stamp = "@" + std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count()) + ",";
+  std::string out;
+  out.reserve(raw.size() + raw.size() / 16);
+  size_t pos = 0;
+  while (pos < raw.size()) {
+    size_t nl = raw.find('\n', pos);
+    size_t end = (nl == std::string::npos) ? raw.size() : nl;
+    out += stamp;
+    out.append(raw, pos, end - pos);
+    out.push_back('\n');
+    pos = end + 1;
+  }
+  return out;
+}
+
+Feed make_feed(int which) {
+  Feed f;
+  std::string raw;
+  if (which == 0) {
+    const char* env = std::getenv("BENCH_FEED");
+    std::string path = env ? env : BENCH_DATA_DIR "/CLX5_lines.txt";
+    f.name = path;
+    try {
+      raw = load_file(path);
+    } catch (const std::exception& e) {
+      f.error = e.what();
+      return f;
+    }
+  } else {
+    f.name = "synthetic";
+    synth::MboGenerator gen(synth::GenConfig::parse("orders=10000,depth=50,seed=3,events=500000"));
+    std::vector<char> buf(1 << 20);
+    size_t lines = 0, n;
+    while ((n = gen.fill(buf.data(), buf.size(), lines)) > 0) raw.append(buf.data(), n);
+  }
+  f.bytes = stamp_lines(raw);
+
+  LineFramer framer;
+  framer.feed(f.bytes.data(), f.bytes.size(), [&](const std::string& l) { f.lines.push_back(l); });
+  MboEvent ev;
+  uint64_t send_ns;
+  for (auto& l : f.lines) {
+    if (parse_event(l, parse_send_stamp(l, send_ns), ev)) f.events.push_back(ev);
+  }
+  return f;
+}
+
+const Feed& feed(int which) {
+  static std::map<int, Feed> feeds;
+  auto it = feeds.find(which);
+  if (it == feeds.end()) it = feeds.emplace(which, make_feed(which)).first;
+  return it->second;
+}
+
+// per-iteration event count; the breakdown divides time by it
+void finish(benchmark::State& state, const Feed& f, PerfScope& perf) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * f.lines.size()));
+  perf.report(state, static_cast<double>(state.iterations() * f.lines.size()));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * f.bytes.size()));
+  state.counters["events"] = static_cast<double>(f.lines.size());
+}
+
+#define FEED_OR_SKIP(state)                                  \
+  const Feed& f = feed(static_cast<int>((state).range(0)));  \
+  if (!f.error.empty()) {                                    \
+    (state).SkipWithError(f.error.c_str());                  \
+    return;                                                  \
+  }
+
+void BM_Frame(benchmark::State& state) {
+  FEED_OR_SKIP(state);
+  std::vector<char> chunk(64 * 1024);
+  PerfScope perf;
+  for (auto _ : state) {
+    MemorySource src(f.bytes);
+    LineFramer framer;
+    size_t n, bytes = 0;
+    while ((n = src.read(chunk.data(), chunk.size())) != 0) {
+      framer.feed(chunk.data(), n, [&](const std::string& l) { bytes += l.size(); });
+    }
+    benchmark::DoNotOptimize(bytes);
+  }
+  finish(state, f, perf);
+}
+
+void BM_Parse(benchmark::State& state) {
+  FEED_OR_SKIP(state);
+  MboEvent ev;
+  uint64_t send_ns;
+  PerfScope perf;
+  for (auto _ : state) {
+    for (const auto& l : f.lines) {
+      bool ok = parse_event(l, parse_send_stamp(l, send_ns), ev);
+      benchmark::DoNotOptimize(ok);
+      benchmark::DoNotOptimize(ev);
+    }
+  }
+  finish(state, f, perf);
+}
+
+void BM_Apply(benchmark::State& state) {
+  FEED_OR_SKIP(state);
+  PerfScope perf;
+  for (auto _ : state) {
+    auto book = std::make_unique<OrderBook>();
+    for (const auto& e : f.events) book->on_event(e);
+    benchmark::DoNotOptimize(*book);
+    state.PauseTiming();
+    perf.pause();
+    book.reset();
+    perf.resume();
+    state.ResumeTiming();
+  }
+  finish(state, f, perf);
+}
+
+void BM_Analytics(benchmark::State& state) {
+  FEED_OR_SKIP(state);
+  PerfScope perf;
+  for (auto _ : state) {
+    auto book = std::make_unique<OrderBook>();
+    BookAnalytics an;
+    for (const auto& e : f.events) {
+      book->on_event(e);
+      an.on_event(*book, e);
+    }
+    benchmark::DoNotOptimize(an);
+    state.PauseTiming();
+    perf.pause();
+    book.reset();
+    perf.resume();
+    state.ResumeTiming();
+  }
+  finish(state, f, perf);
+}
+
+void BM_TradeTape(benchmark::State& state) {
+  FEED_OR_SKIP(state);
+  PerfScope perf;
+  for (auto _ : state) {
+    state.PauseTiming();
+    perf.pause();
+    auto tape = std::make_unique<TradeTape>();
+    perf.resume();
+    state.ResumeTiming();
+    auto book = std::make_unique<OrderBook>();
+    for (const auto& e : f.events) {
+      book->on_event(e);
+      tape->on_event(*book, e);
+    }
+    benchmark::DoNotOptimize(tape->prints());
+    state.PauseTiming();
+    perf.pause();
+    book.reset();
+    tape.reset();
+    perf.resume();
+    state.ResumeTiming();
+  }
+  finish(state, f, perf);
+}
+
+void BM_Pipeline(benchmark::State& state) {
+  FEED_OR_SKIP(state);
+  const bool metrics = state.range(1) != 0;
+  const std::string csv = "bench_pipeline_metrics.csv";
+  PerfScope perf;
+  for (auto _ : state) {
+    state.PauseTiming();
+    perf.pause();
+    auto app = std::make_unique<EngineApp>();
+    if (metrics) app->enable_csv_metrics(csv, 1000);
+    MemorySource src(f.bytes);
+    perf.resume();
+    state.ResumeTiming();
+
+    size_t lines = app->consume(src);
+    benchmark::DoNotOptimize(lines);
+
+    state.PauseTiming();
+    perf.pause();
+    app.reset();
+    perf.resume();
+    state.ResumeTiming();
+  }
+  if (metrics) std::remove(csv.c_str());
+  finish(state, f, perf);
+}
+
+// Console output plus a per-stage ns/event table at the end.
+class StageReporter : public benchmark::ConsoleReporter {
+public:
+  void ReportRuns(const std::vector<Run>& runs) override {
+    ConsoleReporter::ReportRuns(runs);
+    for (const auto& r : runs) {
+      auto ev = r.counters.find("events");
+      if (r.error_occurred || ev == r.counters.end() || r.iterations == 0) continue;
+      ns_per_event_[r.benchmark_name()] = r.real_accumulated_time * 1e9 / (double(r.iterations) * ev->second);
+    }
+  }
+
+  void Finalize() override {
+    ConsoleReporter::Finalize();
+    for (int feed_id : {0, 1}) {
+      auto get = [&](const std::string& name) {
+        auto it = ns_per_event_.find(name + "/feed:" + std::to_string(feed_id));
+        if (it == ns_per_event_.end()) it = ns_per_event_.find(name + "/feed:" + std::to_string(feed_id) + "/metrics:0");
+        return it == ns_per_event_.end() ? -1.0 : it->second;
+      };
+      double frame = get("BM_Frame"), parse = get("BM_Parse"), apply = get("BM_Apply");
+      double off = get("BM_Pipeline");
+      auto on_it = ns_per_event_.find("BM_Pipeline/feed:" + std::to_string(feed_id) + "/metrics:1");
+      double on = on_it == ns_per_event_.end() ? -1.0 : on_it->second;
+      if (frame < 0 || parse < 0 || apply < 0 || off < 0) continue;
+
+      std::printf("\nstage breakdown, feed:%d (%s)\n", feed_id, feed(feed_id).name.c_str());
+      std::printf("  %-26s %10.1f ns/event\n", "frame", frame);
+      std::printf("  %-26s %10.1f ns/event\n", "parse", parse);
+      std::printf("  %-26s %10.1f ns/event\n", "apply", apply);
+      if (double an = get("BM_Analytics"); an > 0) {
+        std::printf("  %-26s %10.1f ns/event  (not in the totals)\n", "analytics, on top of apply", an - apply);
+      }
+      if (double tt = get("BM_TradeTape"); tt > 0) {
+        std::printf("  %-26s %10.1f ns/event  (not in the totals)\n", "trade tape, on top of apply", tt - apply);
+      }
+      std::printf("  %-26s %10.1f ns/event\n", "clocks, lock, histograms", off - frame - parse - apply);
+      std::printf("  %-26s %10.1f ns/event  %12.0f events/s\n", "total, metrics off", off, 1e9 / off);
+      if (on > 0) {
+        std::printf("  %-26s %10.1f ns/event  %12.0f events/s\n", "total, metrics on", on, 1e9 / on);
+      }
+    }
+  }
+
+private:
+  std::map<std::string, double> ns_per_event_;
+};
+
+} // namespace
+
+BENCHMARK(BM_Frame)->ArgName("feed")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Parse)->ArgName("feed")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Apply)->ArgName("feed")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Analytics)->ArgName("feed")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TradeTape)->ArgName("feed")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Pipeline)->ArgNames({"feed", "metrics"})->ArgsProduct({{0, 1}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// Results also go to bench_pipeline.json unless --benchmark_out is given.
+int main(int argc, char** argv) {
+  std::vector<char*> args(argv, argv + argc);
+  bool has_out = false;
+  for (int i = 1; i < argc; ++i) has_out |= std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+  char out_arg[] = "--benchmark_out=bench_pipeline.json";
+  char fmt_arg[] = "--benchmark_out_format=json";
+  if (!has_out) {
+    args.push_back(out_arg);
+    args.push_back(fmt_arg);
+  }
+  int n = static_cast<int>(args.size());
+  benchmark::Initialize(&n, args.data());
+  if (benchmark::ReportUnrecognizedArguments(n, args.data())) return 1;
+  StageReporter reporter;
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+  benchmark::Shutdown();
+  return 0;
+}
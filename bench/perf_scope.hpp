@@ -0,0 +1,38 @@
+// perf_event counters over a benchmark's timed region (common/perf_counters.hpp).
+//
+// Construct right before the `for (auto _ : state)` loop, bracket untimed work with
+// pause()/resume() inside PauseTiming()/ResumeTiming() (keeps the ioctls off the
+// clock), and call report() with the number of operations done. Adds one counter
+// per event, per operation: cycles, instructions, l1d_misses, llc_misses,
+// branch_misses and ipc — or task_clock_ns, page_faults, context_switches where
+// there is no PMU access.
+#pragma once
+#include <benchmark/benchmark.h>
+#include "common/perf_counters.hpp"
+
+#include <cstdint>
+#include <string>
+
+class PerfScope {
+public:
+  PerfScope() { group_.open(); }
+
+  void pause() { group_.disable(); }
+  void resume() { group_.enable(); }
+
+  void report(benchmark::State& state, double ops) {
+    uint64_t v[metrics::PerfGroup::kMax];
+    if (ops <= 0 || !group_.read(v)) return;
+    double cycles = 0, instructions = 0;
+    for (int i = 0; i < group_.size(); ++i) {
+      std::string name = group_.name(i);
+      state.counters[name] = static_cast<double>(v[i]) / ops;
+      if (name == "cycles") cycles = static_cast<double>(v[i]);
+      if (name == "instructions") instructions = static_cast<double>(v[i]);
+    }
+    if (cycles > 0) state.counters["ipc"] = instructions / cycles;
+  }
+
+private:
+  metrics::PerfGroup group_;
+};
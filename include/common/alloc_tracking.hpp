@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+// Allocation tracking (instrumentation builds only).
+//
+// Linking src/common/alloc_tracking.cpp replaces the global operator new/delete
+// family with counting versions. The CMake option ENGINE_ALLOC_TRACKING does that for
+// the engine and defines ENGINE_ALLOC_TRACKING so /stats reports the counts; normal
+// builds keep the default allocator and pay nothing.
+//
+// Counters are per thread (one fixed slot per thread, written only by its owner) so
+// recording never takes a lock and never allocates. Plain malloc() calls from C
+// code are not counted; every C++ container goes through operator new.
+namespace alloc_tracking
+{
+
+    static constexpr int kSizeBuckets = 32;    // bucket b: sizes in (2^(b-1), 2^b]
+
+    struct ThreadStats
+    {
+        uint64_t tid    = 0;
+        uint64_t allocs = 0;
+        uint64_t frees  = 0;
+        uint64_t bytes  = 0;                    // requested bytes, sum over allocs
+        uint64_t by_size[kSizeBuckets] = {};    // allocation count per size bucket
+    };
+
+    // Counters of the calling thread.
+    ThreadStats this_thread();
+
+    // Counters of every thread that has allocated so far (up to kMaxThreads);
+    // returns the number written to out.
+    static constexpr int kMaxThreads = 64;
+    int all_threads(ThreadStats* out, int cap);
+
+    // Call-site sampling: record the caller of every n-th allocation (0 = off).
+    // Also settable at startup with ENGINE_ALLOC_SAMPLE=<n>.
+    void set_sample_every(uint32_t n);
+
+    // Per-thread table and the hottest sampled call sites as text (/stats format).
+    void dump(std::ostream& os, int top_sites = 10);
+
+} // namespace alloc_tracking
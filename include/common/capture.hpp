@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Raw feed capture: every chunk the engine reads, with its receive timestamp.
+//
+// File layout: a sequence of blocks, each starting on a 4096-byte boundary:
+//   BlockHeader (32 bytes) | payload (stored_len bytes) | zero padding
+// The payload, after decompression, is a run of records:
+//   RecordHeader (16 bytes) | len bytes exactly as received
+namespace capture
+{
+
+    enum class Codec : uint16_t { None = 0, Zstd = 1 };
+
+    static constexpr uint32_t kBlockMagic = 0x424C4143;   // "CALB"
+    static constexpr size_t   kAlign      = 4096;
+
+    struct BlockHeader
+    {
+        uint32_t magic;
+        uint16_t codec;
+        uint16_t reserved;
+        uint32_t raw_len;      // payload bytes before compression
+        uint32_t stored_len;   // payload bytes in the file
+        uint64_t records;
+        uint64_t first_ns;
+    };
+    static_assert(sizeof(BlockHeader) == 32);
+
+    struct RecordHeader
+    {
+        uint64_t recv_ns;      // wall clock, ns since epoch
+        uint32_t len;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(RecordHeader) == 16);
+
+    // True when this build can write and read the codec.
+    bool codec_available(Codec c);
+    Codec parse_codec(const std::string& name);   // "none" / "zstd"; throws std::invalid_argument
+
+    // Appends records into preallocated page-aligned blocks; a background thread
+    // writes full blocks with pwrite (O_DIRECT where the filesystem allows it),
+    // compressing them first if asked. append() only copies: when every block is
+    // waiting for the disk the record is dropped and counted rather than blocking.
+    // append()/flush() are for one thread; the constructor throws std::runtime_error
+    // when the file cannot be created.
+    class Writer
+    {
+    public:
+        explicit Writer(const std::string& path, Codec codec = Codec::None,
+                        size_t block_bytes = 4 << 20, int blocks = 4);
+        ~Writer();
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        bool append(uint64_t recv_ns, const void* data, size_t n);
+
+        // Hand the partly filled block to the writer thread (e.g. at disconnect).
+        void flush();
+
+        // Flush, write everything out and close the file.
+        void close();
+
+        uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+        uint64_t bytes_written() const { return written_.load(std::memory_order_relaxed); }
+        bool direct_io() const { return direct_; }
+
+    private:
+        struct Block
+        {
+            char*    data = nullptr;   // block_bytes, kAlign-aligned; BlockHeader first
+            size_t   used = 0;
+            uint64_t records = 0;
+            uint64_t first_ns = 0;
+        };
+
+        // single-producer single-consumer ring of block indices
+        struct IndexRing
+        {
+            std::vector<int> slots;
+            std::atomic<uint32_t> head{0};   // next push
+            std::atomic<uint32_t> tail{0};   // next pop
+            bool push(int v);
+            bool pop(int& v);
+        };
+
+        bool next_block();
+        void write_loop();
+        void write_block(Block& b);
+
+        std::string path_;
+        Codec  codec_;
+        size_t block_bytes_;
+        int    fd_ = -1;
+        bool   direct_ = false;
+        uint64_t offset_ = 0;           // writer thread only
+
+        std::vector<Block> blocks_;
+        int cur_ = -1;                  // block being filled (producer only)
+        IndexRing free_;
+        IndexRing full_;
+        char* scratch_ = nullptr;       // compression output (writer thread)
+        size_t scratch_cap_ = 0;
+
+        std::atomic<uint32_t> wake_{0};
+        std::atomic<bool> stop_{false};
+        std::atomic<uint64_t> records_{0};
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<uint64_t> written_{0};
+        std::thread thread_;
+        bool closed_ = false;
+    };
+
+    // Sequential reader; the constructor throws std::runtime_error if the file is
+    // missing or does not start with a capture block.
+    class Reader
+    {
+    public:
+        explicit Reader(const std::string& path);
+
+        // Next record; false at end of file (or at a torn final block).
+        bool next(uint64_t& recv_ns, std::string& data);
+
+    private:
+        bool load_block();
+
+        std::ifstream in_;
+        std::string payload_;
+        size_t pos_ = 0;
+    };
+
+    // Whether the file starts with a capture block.
+    bool is_capture(const std::string& path);
+
+} // namespace capture
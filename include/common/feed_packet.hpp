@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Sequenced datagrams for the udp:// feed (streamer -> engine over multicast).
+//
+// Each datagram is a PacketHeader followed by `count` complete protocol lines, each
+// ending in '\n'. seq numbers lines, not packets: a packet carries lines
+// [seq, seq + count), so the receiver can tell exactly how many lines a gap lost.
+// A session starts at seq 1 and ends with a packet whose count is kEndOfSession
+// (sent a few times, since any one copy can be lost). Host byte order: the feed
+// never leaves the host.
+namespace feed
+{
+
+    constexpr uint32_t kPacketMagic   = 0x50444655;   // "UFDP"
+    constexpr uint16_t kEndOfSession  = 0xFFFF;
+    constexpr size_t   kMaxPacketBytes = 1472;        // UDP payload of one 1500-byte Ethernet frame
+
+    struct PacketHeader
+    {
+        uint32_t magic;
+        uint16_t count;      // lines in the packet, or kEndOfSession
+        uint16_t reserved;
+        uint64_t seq;        // number of the first line in the packet
+    };
+    static_assert(sizeof(PacketHeader) == 16, "PacketHeader is a wire format");
+
+    constexpr size_t kMaxPayloadBytes = kMaxPacketBytes - sizeof(PacketHeader);
+
+    // Header of a received datagram; false if it is not a feed packet.
+    inline bool read_header(const void* pkt, size_t len, PacketHeader& h)
+    {
+        if (len < sizeof(PacketHeader)) return false;
+        std::memcpy(&h, pkt, sizeof(h));
+        return h.magic == kPacketMagic;
+    }
+
+    // Receiver-side sequence check. A packet that continues where the last one
+    // ended is in order; one that starts further on leaves a gap of lost lines; one
+    // whose lines were all seen already is late (a duplicate or reordered copy) and
+    // must not be applied; one that starts before the expected seq but runs past it
+    // overlaps, and only its lines from the expected seq on are new.
+    //
+    // A sender that restarts without its end-of-session packet (a crash) starts
+    // over at seq 1, so a packet at seq 1 once the session is more than
+    // kRestartWindow lines along begins a new session instead of being dropped as
+    // late. So does any packet that starts more than kRestartWindow lines before
+    // the expected seq: reordering never moves a packet back that far. Closer to
+    // the start, seq 1 is just the first packet arriving after later ones, and is
+    // late like any other. check() leaves the state alone on a restart; the caller
+    // ends the session, reset()s and checks the packet again as the new session's
+    // first.
+    struct SeqTracker
+    {
+        enum class Result { InOrder, Gap, Late, Overlap, Restart };
+
+        static constexpr uint64_t kRestartWindow = 256;   // lines
+
+        uint64_t next = 1;   // first line not seen yet
+
+        // lost: lines skipped over (Gap); skip: leading lines already seen (Overlap).
+        Result check(uint64_t seq, uint32_t count, uint64_t& lost, uint32_t& skip)
+        {
+            lost = 0;
+            skip = 0;
+            if (started() && ((seq == 1 && next > kRestartWindow) || seq + kRestartWindow < next))
+                return Result::Restart;
+            if (seq + count <= next) return Result::Late;
+            if (seq < next)
+            {
+                skip = static_cast<uint32_t>(next - seq);
+                next = seq + count;
+                return Result::Overlap;
+            }
+            Result r = Result::InOrder;
+            if (seq > next)
+            {
+                lost = seq - next;
+                r = Result::Gap;
+            }
+            next = seq + count;
+            return r;
+        }
+
+        bool started() const { return next != 1; }
+        void reset() { next = 1; }
+    };
+
+    // Offset in payload after its first n lines (the payload's size if it has fewer).
+    inline size_t skip_lines(const char* payload, size_t len, uint32_t n)
+    {
+        size_t pos = 0;
+        for (; n > 0 && pos < len; --n)
+        {
+            const void* nl = std::memchr(payload + pos, '\n', len - pos);
+            if (!nl) return len;
+            pos = static_cast<size_t>(static_cast<const char*>(nl) - payload) + 1;
+        }
+        return pos;
+    }
+
+} // namespace feed
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace metrics
+{
+
+    // Bucket layout of a log-linear (HDR) histogram over [1, highest].
+    //
+    // Values are grouped into power-of-two buckets, each split into the same number of
+    // linear sub-buckets, so every recorded value is kept to within 10^-digits of its
+    // true value. 1ns..10s at 2 significant digits needs 3584 counters: 28KB at 64
+    // bits, the width a recorder that lives as long as the process needs (2^32 samples
+    // is about an hour at 1M events/s), or 14KB at 32 bits for short-lived epochs.
+    struct HdrLayout
+    {
+        uint64_t highest;
+        int      digits;
+        int      sub_half_mag;    // log2(sub_bucket_count / 2)
+        uint64_t sub_half;        // sub_bucket_count / 2
+        uint64_t sub_mask;        // sub_bucket_count - 1
+        int      bucket_count;
+        size_t   counts_len;
+
+        HdrLayout(uint64_t highest_value, int significant_digits);
+
+        size_t index_of(uint64_t v) const
+        {
+            if (v > highest) v = highest;
+            int bucket = 63 - sub_half_mag - __builtin_clzll(v | sub_mask);
+            uint64_t sub = v >> bucket;
+            return (size_t(bucket + 1) << sub_half_mag) + size_t(sub - sub_half);
+        }
+
+        uint64_t lowest_at(size_t index) const;
+        uint64_t highest_at(size_t index) const;    // highest value equivalent to lowest_at
+    };
+
+    // Plain histogram: owned by one thread, or a snapshot for readers.
+    class HdrHistogram
+    {
+    public:
+        explicit HdrHistogram(uint64_t highest = 10'000'000'000ULL, int digits = 2);
+
+        void record(uint64_t v)
+        {
+            ++counts_[layout_.index_of(v)];
+            ++total_;
+            sum_ += v;
+            if (v > max_) max_ = v;
+        }
+
+        // Add every count of `other` (same layout required; throws std::invalid_argument).
+        void merge(const HdrHistogram& other);
+        void reset();
+
+        uint64_t count() const { return total_; }
+        uint64_t max() const { return max_; }
+        double   mean() const { return total_ ? double(sum_) / double(total_) : 0.0; }
+
+        // Smallest recorded-value bound v such that at least q of all samples are <= v
+        // (q in [0,1]); capped at max(). 0 when empty.
+        uint64_t value_at_quantile(double q) const;
+
+        const HdrLayout& layout() const { return layout_; }
+        size_t memory_bytes() const { return counts_.size() * sizeof(uint64_t); }
+
+    private:
+        template <class> friend class BasicHdrRecorder;
+        HdrLayout layout_;
+        std::vector<uint64_t> counts_;
+        uint64_t total_ = 0;
+        uint64_t sum_   = 0;
+        uint64_t max_   = 0;
+    };
+
+    // Histogram written by exactly one thread and read by others.
+    //
+    // The writer updates with relaxed load + store (plain moves on x86, no locked
+    // instructions); readers take a snapshot() into an HdrHistogram. A snapshot taken
+    // while recording is in flight may miss the newest samples but is never torn.
+    // Count is the per-counter width: uint32_t halves the footprint for a recorder
+    // that is reset before any one counter can reach 2^32 (instantiated for uint32_t
+    // and uint64_t).
+    template <class Count>
+    class BasicHdrRecorder
+    {
+    public:
+        explicit BasicHdrRecorder(uint64_t highest = 10'000'000'000ULL, int digits = 2);
+
+        void record(uint64_t v)
+        {
+            bump(counts_[layout_.index_of(v)], Count(1));
+            bump(sum_, v);
+            if (v > max_.load(std::memory_order_relaxed)) max_.store(v, std::memory_order_relaxed);
+            // total last: a reader never sees more samples than counts
+            total_.store(total_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        uint64_t count() const { return total_.load(std::memory_order_acquire); }
+        size_t memory_bytes() const { return counts_.size() * sizeof(Count); }
+
+        // Writer only: zero everything (readers racing with it must discard their copy).
+        void reset();
+
+        // Reader: add the current counts into `out` (same layout required).
+        void merge_into(HdrHistogram& out) const;
+
+        void snapshot(HdrHistogram& out) const;
+        HdrHistogram snapshot() const;
+
+    private:
+        template <class T>
+        static void bump(std::atomic<T>& c, T v)
+        {
+            c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+
+        HdrLayout layout_;
+        std::vector<std::atomic<Count>> counts_;
+        std::atomic<uint64_t> total_{0};
+        std::atomic<uint64_t> sum_{0};
+        std::atomic<uint64_t> max_{0};
+    };
+
+    using HdrRecorder = BasicHdrRecorder<uint64_t>;
+
+} // namespace metrics
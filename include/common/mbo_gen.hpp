@@ -0,0 +1,157 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace synth
+{
+
+    // Synthetic MBO feed generator.
+    //
+    // Produces valid, self-consistent streams in the engine's line protocol:
+    //  - CXL/MOD/TRD only ever reference live orders, fills never exceed the resting qty
+    //  - bids rest strictly below the mid, asks strictly above (the book never crosses);
+    //    a mid move first trades out the touch level on its side, then steps
+    //  - identical config + seed => byte-identical stream
+    //
+    // The line protocol has no instrument field, so instruments are kept apart by
+    // disjoint order-id ranges and price bands (instrument i, counted from
+    // first_instrument: ids (i+1)<<40.., prices base_price + i*instrument_spacing ticks).
+    struct GenConfig
+    {
+        uint64_t seed        = 1;
+        uint32_t instruments = 1;
+        uint32_t first_instrument = 0;     // offsets ids/price bands so streams can coexist
+        uint64_t live_orders = 10000;      // target live orders per instrument
+        uint32_t depth       = 50;         // price levels per side around the mid
+        double   volatility  = 0.001;      // per-event probability that the mid starts a one-tick move;
+                                           // deep touch queues take longer to trade through
+        double   level_decay = 0.85;       // P(level k from touch) ~ decay^k  => queue-length profile
+        uint32_t max_qty     = 10;         // order size uniform in [1, max_qty]
+
+        // event mix once the book is at its target size (relative weights)
+        double add_weight    = 45;
+        double cancel_weight = 35;
+        double modify_weight = 10;
+        double trade_weight  = 10;
+        double modify_price_prob = 0.3;    // share of MODs that change price (lose priority)
+
+        int64_t  base_price  = 64830000000; // CLX5-like prices in 1e-9 units
+        int64_t  tick        = 10000000;
+        int64_t  instrument_spacing = 1000000; // ticks between instrument price bands
+        uint64_t ts_start_ns = 1758742200000000000ULL;
+        uint64_t ts_step_ns  = 1000;       // mean feed-time gap between events
+        uint64_t events      = 0;          // stop after this many events (0 = unbounded)
+
+        // "orders=1e6,depth=50,vol=0.001,add=45,cxl=35,mod=10,trd=10,seed=7,events=1e7"
+        // (an optional "gen:" prefix is accepted). Throws std::invalid_argument.
+        static GenConfig parse(std::string_view spec);
+    };
+
+    struct GenEvent
+    {
+        char     kind;        // 'A' add, 'M' modify, 'C' cancel, 'T' trade
+        char     side;        // 'B' / 'A'
+        uint32_t instrument;
+        int32_t  qty;         // add qty, modify new qty, trade fill qty
+        uint64_t ts_ns;
+        uint64_t order_id;
+        int64_t  price;       // add price, modify new price, trade resting price (base_price + ticks*tick)
+    };
+
+    class MboGenerator
+    {
+    public:
+        static constexpr size_t kMaxLineLen = 96;
+
+        explicit MboGenerator(const GenConfig& cfg);
+
+        // Next event; false once cfg.events have been produced.
+        bool next(GenEvent& ev);
+
+        // Next event formatted as one protocol line incl. '\n' into out[kMaxLineLen];
+        // returns the length, 0 at end of stream.
+        size_t next_line(char* out);
+
+        // Fill buf with whole lines; returns bytes written and adds to `lines`.
+        size_t fill(char* buf, size_t cap, size_t& lines);
+
+        static size_t format_line(const GenEvent& ev, char* out);
+
+        uint64_t produced() const { return produced_; }
+        uint64_t live_orders() const;
+        const GenConfig& config() const { return cfg_; }
+
+    private:
+        struct Order
+        {
+            uint64_t id;
+            int64_t  px;        // in ticks
+            int32_t  qty;
+            uint32_t level_pos; // index inside its level bucket
+            char     side;
+            uint8_t  id_len;
+            char     id_txt[18];  // decimal id, formatted once at add time
+        };
+
+        struct Instrument
+        {
+            int64_t  mid = 0;                         // in ticks; bids < mid < asks
+            int      move_dir = 0;                    // +1/-1 while trading through the touch
+            uint64_t next_id = 0;
+            char     next_id_txt[20];
+            uint8_t  next_id_len = 0;
+            std::vector<Order> orders;                // live orders, swap-remove
+            std::vector<std::vector<uint32_t>> bids;  // price ring -> order slots
+            std::vector<std::vector<uint32_t>> asks;
+        };
+
+        struct PriceText
+        {
+            int64_t px;
+            uint8_t len;
+            char    txt[23];
+        };
+        static constexpr size_t kPxCache = 1024;   // direct-mapped (2^10), prices cluster near the mid
+        static constexpr int    kLevelLutBits = 12;
+        static constexpr size_t kLevelLut = size_t(1) << kLevelLutBits;
+
+        GenConfig cfg_;
+        uint64_t  rng_[4];
+        uint64_t  ts_ns_;
+        char      ts_txt_[24];             // decimal text of ts_ns_, kept in step with it
+        uint8_t   ts_len_ = 0;
+        char      id_txt_[24];             // id text of the event just produced
+        uint8_t   id_len_ = 0;
+        std::vector<PriceText> px_cache_;
+        uint64_t  produced_ = 0;
+        uint64_t  ring_mask_;
+        double    mix_[4];                 // cumulative add/cancel/modify/trade
+        std::vector<uint32_t> level_lut_;  // distance-from-touch inverse CDF
+        std::vector<Instrument> inst_;
+
+        uint64_t rand();
+        uint64_t below(uint64_t n);        // uniform in [0, n)
+        double   rand01();
+        uint32_t pick_level();
+
+        std::vector<uint32_t>& bucket(Instrument& in, char side, int64_t px);
+        void link(Instrument& in, uint32_t slot);
+        void unlink(Instrument& in, uint32_t slot);
+        void remove(Instrument& in, uint32_t slot);
+
+        void gen_add(uint32_t i, GenEvent& ev);
+        void gen_cancel(uint32_t i, GenEvent& ev);
+        void gen_modify(uint32_t i, GenEvent& ev);
+        void gen_trade(uint32_t i, GenEvent& ev);
+        static void decimal_add(char* txt, uint8_t& len, uint64_t value, uint64_t dt);
+        void  emit_id(const Order& o);
+        char* put_price(char* p, int64_t px);
+
+        int64_t find_at(Instrument& in, char side, int64_t px);
+        void step_mid(Instrument& in);
+    };
+
+} // namespace synth
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// MBP-10: the best 10 price levels per side, as published by the engine on a TCP
+// port (ENGINE_MBP_PORT) to any number of subscribers. This header is the whole
+// client library (see mbp_subscriber_app).
+//
+// The stream is a sequence of messages, each a MsgHeader followed by `count`
+// Entry records. An entry sets one level slot (side, index 0..9, best first); qty 0
+// means the slot is empty (the side has fewer levels). A Snapshot sets all 20
+// slots; an Update only the slots that changed. Every subscriber starts with a
+// Snapshot. Updates are numbered: an update's seq is one more than the previous
+// message's, and a Snapshot carries the seq of the last update it includes.
+//
+// A subscriber that cannot keep up is conflated: the updates it has no room for
+// are dropped and it gets a Snapshot of the then-current book once it drains, so
+// it never sees a sequence gap, only a Snapshot. Host byte order: the feed is for
+// processes on the same host.
+namespace mbp
+{
+
+    constexpr uint32_t kMagic = 0x3031424D;   // "MB10"
+    constexpr uint32_t kDepth = 10;
+
+    enum class MsgType : uint8_t { Snapshot = 1, Update = 2 };
+
+    struct MsgHeader
+    {
+        uint32_t magic;
+        uint16_t length;       // bytes, header included
+        uint8_t  type;         // MsgType
+        uint8_t  count;        // entries that follow
+        uint64_t seq;
+        uint64_t ts_ns;        // feed ts of the event that produced this book
+        uint64_t publish_ns;   // engine wall clock when the book thread published it
+    };
+    static_assert(sizeof(MsgHeader) == 32, "MsgHeader is a wire format");
+
+    struct Entry
+    {
+        uint8_t  side;         // 0 bid, 1 ask
+        uint8_t  index;        // 0 = best
+        uint16_t reserved;
+        uint32_t orders;
+        int64_t  price;        // ticks
+        int64_t  qty;          // 0: slot empty
+    };
+    static_assert(sizeof(Entry) == 24, "Entry is a wire format");
+
+    constexpr size_t kMaxMsgBytes = sizeof(MsgHeader) + 2 * kDepth * sizeof(Entry);
+
+    struct Level
+    {
+        int64_t  price;
+        int64_t  qty;
+        uint32_t orders;
+    };
+
+    // A subscriber's copy of the book, rebuilt from the messages.
+    struct Book
+    {
+        Level    levels[2][kDepth] = {};   // [side][index]
+        uint64_t seq = 0;
+        bool     synced = false;           // a Snapshot has been applied
+
+        // Apply one message; false if it is malformed or an update out of sequence
+        // (the book is then unsynced until the next Snapshot).
+        bool apply(const MsgHeader& h, const Entry* entries)
+        {
+            if (h.type == static_cast<uint8_t>(MsgType::Update))
+            {
+                if (!synced || h.seq != seq + 1)
+                {
+                    synced = false;
+                    return false;
+                }
+            }
+            else if (h.type != static_cast<uint8_t>(MsgType::Snapshot))
+            {
+                return false;
+            }
+            for (uint32_t i = 0; i < h.count; ++i)
+            {
+                const Entry& e = entries[i];
+                if (e.side > 1 || e.index >= kDepth) return false;
+                levels[e.side][e.index] = e.qty ? Level{e.price, e.qty, e.orders} : Level{};
+            }
+            seq = h.seq;
+            synced = true;
+            return true;
+        }
+
+        uint32_t levels_on(int side) const
+        {
+            uint32_t n = 0;
+            while (n < kDepth && levels[side][n].qty) ++n;
+            return n;
+        }
+    };
+
+    // Splits received bytes into messages. Feed it whatever recv() returned, then
+    // call next() until it returns false.
+    class Reader
+    {
+    public:
+        void append(const void* data, size_t n)
+        {
+            if (pos_ > 0 && pos_ == buf_.size())
+            {
+                buf_.clear();
+                pos_ = 0;
+            }
+            buf_.append(static_cast<const char*>(data), n);
+        }
+
+        // The next complete message; entries stays valid until the next call.
+        // Sets bad() on a corrupt stream.
+        bool next(MsgHeader& h, const Entry*& entries)
+        {
+            if (bad_ || buf_.size() - pos_ < sizeof(MsgHeader)) return false;
+            std::memcpy(&h, buf_.data() + pos_, sizeof(h));
+            if (h.magic != kMagic || h.length != sizeof(MsgHeader) + h.count * sizeof(Entry) || h.length > kMaxMsgBytes)
+            {
+                bad_ = true;
+                return false;
+            }
+            if (buf_.size() - pos_ < h.length) return false;
+            // copied out so the entries are aligned whatever their offset in buf_
+            std::memcpy(entries_, buf_.data() + pos_ + sizeof(h), h.count * sizeof(Entry));
+            entries = entries_;
+            pos_ += h.length;
+            if (pos_ > (1u << 16) && pos_ * 2 > buf_.size())
+            {
+                buf_.erase(0, pos_);
+                pos_ = 0;
+            }
+            return true;
+        }
+
+        bool bad() const { return bad_; }
+
+    private:
+        std::string buf_;
+        size_t pos_ = 0;
+        bool bad_ = false;
+        Entry entries_[2 * kDepth];
+    };
+
+} // namespace mbp
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace metrics
+{
+
+    // Per-thread shard selection for the sharded metric types below.
+    //
+    // Each thread gets a fixed shard on first use. The first kShards - 1 threads own
+    // theirs outright and update it with a relaxed load + store (plain moves on x86);
+    // any further threads share the last shard and pay for a fetch_add.
+    static constexpr int kShards = 16;
+
+    int this_shard();
+
+    inline void shard_add(std::atomic<uint64_t>& c, uint64_t v, int shard)
+    {
+        if (shard < kShards - 1) c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        else c.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    // Monotonic counter; the value is the sum over shards, taken at scrape time.
+    class Counter
+    {
+    public:
+        void inc(uint64_t v = 1)
+        {
+            int s = this_shard();
+            shard_add(shards_[s].v, v, s);
+        }
+        uint64_t value() const;
+
+    private:
+        struct alignas(64) Shard { std::atomic<uint64_t> v{0}; };
+        Shard shards_[kShards];
+    };
+
+    // Histogram with fixed upper bounds (Prometheus style, cumulative on output).
+    // Bounds are in recorded units (ns for latencies) and exported in seconds when
+    // the registry is given a scale.
+    class Histogram
+    {
+    public:
+        explicit Histogram(std::vector<uint64_t> bounds);
+
+        void record(uint64_t v)
+        {
+            size_t b = 0;
+            while (b < bounds_.size() && v > bounds_[b]) ++b;   // typical values hit early
+            int s = this_shard();
+            Shard& sh = *shards_[s];
+            shard_add(sh.counts[b], 1, s);
+            shard_add(sh.sum, v, s);
+        }
+
+        const std::vector<uint64_t>& bounds() const { return bounds_; }
+
+        // Per-bucket (non-cumulative) counts, the overflow bucket last, and the sum.
+        void collect(std::vector<uint64_t>& counts, uint64_t& sum) const;
+
+    private:
+        struct alignas(64) Shard
+        {
+            explicit Shard(size_t n) : counts(n) {}
+            std::vector<std::atomic<uint64_t>> counts;
+            std::atomic<uint64_t> sum{0};
+        };
+        std::vector<uint64_t> bounds_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+    };
+
+    // 250ns .. 1s, roughly 1-2.5-5 per decade.
+    std::vector<uint64_t> latency_bounds_ns();
+
+    // Named metrics rendered in Prometheus text exposition format (version 0.0.4).
+    //
+    // Registration takes a lock and returns a reference that stays valid for the
+    // registry's lifetime; updates through it are lock-free. Gauges are callbacks
+    // evaluated at scrape time. Metrics sharing a name form one family and must be
+    // registered with the same type; `labels` is the inner part of {...}, e.g.
+    // kind="add".
+    class Registry
+    {
+    public:
+        Counter&   counter(const std::string& name, const std::string& help, const std::string& labels = "");
+        Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels,
+                             std::vector<uint64_t> bounds, double scale = 1.0);
+        void       gauge(const std::string& name, const std::string& help, const std::string& labels,
+                         std::function<double()> read);
+
+        // Whole exposition, families in registration order.
+        void write(std::ostream& os) const;
+
+    private:
+        enum class Type { Counter, Gauge, Histogram };
+        struct Metric
+        {
+            std::string labels;
+            std::unique_ptr<Counter>   counter;
+            std::unique_ptr<Histogram> histogram;
+            std::function<double()>    gauge;
+            double scale = 1.0;    // histogram bounds and sum are multiplied by it on output
+        };
+        struct Family
+        {
+            std::string name;
+            std::string help;
+            Type type;
+            std::deque<Metric> metrics;   // deque: references stay valid as it grows
+        };
+
+        Metric& add(const std::string& name, const std::string& help, Type type, const std::string& labels);
+
+        mutable std::mutex mtx_;
+        std::vector<std::unique_ptr<Family>> families_;
+    };
+
+} // namespace metrics
@@ -8,6 +8,42 @@
 namespace net
 {
 
+    // Where the streamer -> engine feed goes, written as a URI:
+    //   tcp://host:port    TCP (a bare "port" means tcp on the default host)
+    //   unix:///path       AF_UNIX SOCK_STREAM socket file
+    //   unix:///path?seqpacket
+    //                      AF_UNIX SOCK_SEQPACKET: every send is one record
+    //   shm://name         shared-memory SPSC byte ring (see common/shm_ring.hpp)
+    //   udp://group:port[?iface=addr]
+    //                      IPv4 multicast of sequenced packets (see common/feed_packet.hpp),
+    //                      on the interface with address iface (default 127.0.0.1)
+    struct Endpoint
+    {
+        enum class Kind { Tcp, Unix, UnixSeqpacket, Shm, Udp };
+        Kind kind = Kind::Tcp;
+        std::string host;   // Tcp: host; Udp: multicast group
+        std::string port;   // Tcp, Udp
+        std::string path;   // Unix*: socket file; Shm: segment name ("/name")
+        std::string iface;  // Udp: local interface address
+
+        // Throws std::invalid_argument for an unknown scheme or a malformed URI.
+        static Endpoint parse(std::string_view uri, std::string_view default_host);
+        std::string str() const;
+        // Byte-stream sockets: Tcp and Unix*
+        bool is_stream() const { return kind != Kind::Shm && kind != Kind::Udp; }
+    };
+
+    // Stream endpoints only (Tcp/Unix*); a unix listener replaces a stale socket file.
+    int  listen_endpoint(const Endpoint& ep, int backlog = 128);
+    int  connect_endpoint(const Endpoint& ep);
+
+    // Udp endpoints. The receiver is bound to group:port and joined on iface, with
+    // a receive buffer of rcvbuf_bytes (the kernel may clamp it). The sender is
+    // connected to group:port, sends out of iface with TTL 0 (never leaves the host)
+    // and loops packets back to local receivers. Both are non-blocking.
+    int  open_multicast_recv(const Endpoint& ep, int rcvbuf_bytes = 8 << 20);
+    int  open_multicast_send(const Endpoint& ep);
+
     int  listen_tcp(std::string_view host, std::string_view port, int backlog = 128);
     int  accept_one(int listen_fd);
     int  connect_tcp(std::string_view host, std::string_view port);
@@ -19,6 +55,11 @@ namespace net
 
     bool wait_readable(int fd, int timeout_ms);
     bool wait_writable(int fd, int timeout_ms);
+    // Bit i set for each fds[i] that is readable (n <= 32); 0 on timeout.
+    uint32_t wait_readable_any(const int* fds, int n, int timeout_ms);
+
+    // Bytes received by the kernel but not yet read (SIOCINQ / FIONREAD); 0 on error.
+    size_t unread_bytes(int fd);
 
 
     // Returns total bytes sent/received; may be less than sum of iov lens.
@@ -28,8 +69,12 @@ namespace net
 
     // (Linux only): batch syscalls for lower syscall overhead
     // Returns number of datagrams processed, not bytes (0 => EAGAIN/timeout)
+    // Up to kStackBatch messages per call need no heap allocation.
+    // On stream sockets the last message counted may have gone out only partially;
+    // pass sent_lens to get the bytes actually sent per message.
+    constexpr int kStackBatch = 64;
     int recvmmsg_batch(int fd, void** bufs, size_t* lens, int count);
-    int sendmmsg_batch(int fd, const void** bufs, const size_t* lens, int count);
+    int sendmmsg_batch(int fd, const void** bufs, const size_t* lens, int count, size_t* sent_lens = nullptr);
 
     // (Linux only): enable kernel zero-copy for large sends (MSG_ZEROCOPY)
     void enable_zerocopy(int fd, bool on);
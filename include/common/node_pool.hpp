@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mem
+{
+
+    // Recycles single-node allocations (hash map and tree nodes) through per-size
+    // free lists carved from 64 KB slabs, so a container that keeps inserting and
+    // erasing stops calling operator new once it has reached its peak size: the
+    // steady state costs one slab per ~2000 new nodes and nothing per erase/insert.
+    // Slabs go back to the system only when the pool is destroyed. One owner thread;
+    // neither copyable nor movable, since containers hold a pointer to it.
+    class NodePool
+    {
+    public:
+        static constexpr size_t kGrain     = alignof(std::max_align_t);
+        static constexpr size_t kMaxNode   = 256;
+        static constexpr size_t kSlabBytes = 64 * 1024;
+
+        NodePool() = default;
+        NodePool(const NodePool&) = delete;
+        NodePool& operator=(const NodePool&) = delete;
+
+        void* get(size_t bytes)
+        {
+            const size_t c = size_class(bytes);
+            if (Free* f = free_[c])
+            {
+                free_[c] = f->next;
+                return f;
+            }
+            const size_t sz = c * kGrain;
+            if (left_ < sz)
+            {
+                slabs_.push_back(std::make_unique<Slab>());
+                cur_ = slabs_.back()->bytes;
+                left_ = kSlabBytes;
+            }
+            void* p = cur_;
+            cur_ += sz;
+            left_ -= sz;
+            return p;
+        }
+
+        void put(void* p, size_t bytes)
+        {
+            const size_t c = size_class(bytes);
+            Free* f = static_cast<Free*>(p);
+            f->next = free_[c];
+            free_[c] = f;
+        }
+
+        size_t slabs() const { return slabs_.size(); }
+
+    private:
+        struct Free { Free* next; };
+        struct Slab { alignas(kGrain) char bytes[kSlabBytes]; };
+
+        static size_t size_class(size_t bytes) { return (bytes + kGrain - 1) / kGrain; }
+
+        Free* free_[kMaxNode / kGrain + 1] = {};
+        std::vector<std::unique_ptr<Slab>> slabs_;
+        char*  cur_ = nullptr;
+        size_t left_ = 0;
+    };
+
+    // Allocator for node-based containers: one-element allocations of a small type
+    // (the nodes) come from a NodePool, arrays (hash buckets) from operator new.
+    template <class T>
+    struct PoolAllocator
+    {
+        using value_type = T;
+
+        NodePool* pool;
+
+        explicit PoolAllocator(NodePool& p) noexcept : pool(&p) {}
+        template <class U>
+        PoolAllocator(const PoolAllocator<U>& o) noexcept : pool(o.pool) {}
+
+        T* allocate(size_t n)
+        {
+            if (pooled(n)) return static_cast<T*>(pool->get(sizeof(T)));
+            return std::allocator<T>{}.allocate(n);
+        }
+
+        void deallocate(T* p, size_t n) noexcept
+        {
+            if (pooled(n)) pool->put(p, sizeof(T));
+            else std::allocator<T>{}.deallocate(p, n);
+        }
+
+        template <class U>
+        bool operator==(const PoolAllocator<U>& o) const noexcept { return pool == o.pool; }
+        template <class U>
+        bool operator!=(const PoolAllocator<U>& o) const noexcept { return pool != o.pool; }
+
+    private:
+        static constexpr bool pooled(size_t n)
+        {
+            return n == 1 && sizeof(T) <= NodePool::kMaxNode && alignof(T) <= NodePool::kGrain;
+        }
+    };
+
+} // namespace mem
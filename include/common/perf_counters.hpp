@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace metrics
+{
+
+    // A perf_event_open counter group on the calling thread (Linux).
+    //
+    // open() asks for the hardware set — cycles, instructions, L1D read misses, LLC
+    // read misses, branch misses, user space only — and keeps whichever of them the
+    // PMU grants. When none can be opened (no PMU in VMs/containers, or
+    // perf_event_paranoid too strict) it falls back to software counters: task clock,
+    // page faults and context switches. read() is one read(2) of the whole group,
+    // scaled for multiplexing, so it belongs around batches rather than single events.
+    class PerfGroup
+    {
+    public:
+        static constexpr int kMax = 5;
+        enum class Source : uint8_t { None, Hardware, Software };
+
+        PerfGroup() = default;
+        ~PerfGroup();
+        PerfGroup(const PerfGroup&) = delete;
+        PerfGroup& operator=(const PerfGroup&) = delete;
+
+        // Opens and starts counting; prefer_software skips the hardware attempt.
+        Source open(bool prefer_software = false);
+        void   close();
+
+        Source source() const { return source_.load(std::memory_order_acquire); }
+        int    size() const { return n_; }
+        const char* name(int i) const { return names_[i]; }
+
+        // Current totals, size() entries; false when not open or the read failed.
+        bool read(uint64_t* out) const;
+
+        // Stop/restart counting for the whole group (e.g. around untimed work).
+        void disable();
+        void enable();
+
+        static const char* source_name(Source s);
+
+    private:
+        int fds_[kMax] = {-1, -1, -1, -1, -1};
+        const char* names_[kMax] = {};
+        int n_ = 0;
+        std::atomic<Source> source_{Source::None};
+    };
+
+} // namespace metrics
@@ -0,0 +1,202 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Top-of-book published by the engine into a named POSIX shared-memory segment
+// (ENGINE_SHM_BOOK=/name), for strategy processes on the same host.
+//
+// One writer, any number of readers, seqlock protocol: the writer makes seq odd,
+// writes the payload, makes seq even again; a reader copies the payload between two
+// reads of seq and retries if they differ or are odd. Readers only ever load, so
+// they never touch a cache line the writer has to wait for. This header is the
+// whole client library (no link dependency).
+namespace shm
+{
+
+    static constexpr uint32_t kBookMagic    = 0x4B4F4F42;   // "BOOK"
+    static constexpr uint32_t kBookLayout   = 1;
+    static constexpr uint32_t kBookMaxDepth = 32;
+
+    struct BookLevel
+    {
+        int64_t  price;
+        int64_t  qty;
+        uint32_t orders;
+        uint32_t reserved;
+    };
+
+    // Everything a reader copies out; the levels beyond depth are not written.
+    struct BookData
+    {
+        uint64_t version;      // +1 per publish
+        uint64_t ts_ns;        // feed ts of the event that last changed these levels
+        uint64_t publish_ns;   // writer wall clock at publish
+        uint32_t bid_count;
+        uint32_t ask_count;
+        BookLevel bids[kBookMaxDepth];   // best first
+        BookLevel asks[kBookMaxDepth];
+    };
+
+    struct BookSegment
+    {
+        // written once at creation
+        uint32_t magic;
+        uint32_t layout;
+        uint32_t depth;        // levels per side the writer fills (<= kBookMaxDepth)
+        uint32_t reserved;
+
+        alignas(64) std::atomic<uint64_t> seq;   // odd while the writer is inside
+        alignas(64) BookData data;
+    };
+
+    // Writer side (the engine). Creates or resizes the segment; throws
+    // std::runtime_error on failure. The segment is unlinked on destruction.
+    class BookWriter
+    {
+    public:
+        BookWriter(const std::string& name, uint32_t depth) : name_(name)
+        {
+            int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0) throw std::runtime_error("shm_open " + name + ": " + std::strerror(errno));
+            if (::ftruncate(fd, sizeof(BookSegment)) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("ftruncate " + name + ": " + std::strerror(errno));
+            }
+            void* p = ::mmap(nullptr, sizeof(BookSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) throw std::runtime_error("mmap " + name + ": " + std::strerror(errno));
+            seg_ = static_cast<BookSegment*>(p);
+            std::memset(static_cast<void*>(seg_), 0, sizeof(BookSegment));
+            seg_->layout = kBookLayout;
+            seg_->depth = depth < kBookMaxDepth ? depth : kBookMaxDepth;
+            seg_->seq.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            seg_->magic = kBookMagic;   // readers check this last
+        }
+
+        ~BookWriter()
+        {
+            if (seg_) ::munmap(seg_, sizeof(BookSegment));
+            ::shm_unlink(name_.c_str());
+        }
+
+        BookWriter(const BookWriter&) = delete;
+        BookWriter& operator=(const BookWriter&) = delete;
+
+        uint32_t depth() const { return seg_->depth; }
+
+        // Payload to fill between begin() and end(); single writer thread.
+        BookData& begin()
+        {
+            uint64_t s = seg_->seq.load(std::memory_order_relaxed);
+            seg_->seq.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            return seg_->data;
+        }
+
+        void end()
+        {
+            ++seg_->data.version;
+            seg_->seq.store(seg_->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        std::string name_;
+        BookSegment* seg_ = nullptr;
+    };
+
+    // Reader side. Maps the segment read-only; throws std::runtime_error when it
+    // does not exist (engine not running with ENGINE_SHM_BOOK) or is not a book.
+    class BookReader
+    {
+    public:
+        explicit BookReader(const std::string& name)
+        {
+            int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0) throw std::runtime_error("shm_open " + name + ": " + std::strerror(errno));
+            struct stat st{};
+            if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(BookSegment))
+            {
+                ::close(fd);
+                throw std::runtime_error(name + " is not a book segment");
+            }
+            void* p = ::mmap(nullptr, sizeof(BookSegment), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) throw std::runtime_error("mmap " + name + ": " + std::strerror(errno));
+            seg_ = static_cast<const BookSegment*>(p);
+            if (seg_->magic != kBookMagic || seg_->layout != kBookLayout)
+            {
+                ::munmap(const_cast<BookSegment*>(seg_), sizeof(BookSegment));
+                throw std::runtime_error(name + " is not a book segment");
+            }
+        }
+
+        ~BookReader() { ::munmap(const_cast<BookSegment*>(seg_), sizeof(BookSegment)); }
+
+        BookReader(const BookReader&) = delete;
+        BookReader& operator=(const BookReader&) = delete;
+
+        uint32_t depth() const { return seg_->depth; }
+
+        // Sequence number of the last complete publish (cheap "anything new?" check).
+        uint64_t seq() const { return seg_->seq.load(std::memory_order_acquire) & ~uint64_t(1); }
+
+        // Consistent copy of the book; false if the writer kept it busy for max_tries.
+        bool read(BookData& out, int max_tries = 1000) const
+        {
+            for (int i = 0; i < max_tries; ++i)
+            {
+                uint64_t s0 = seg_->seq.load(std::memory_order_acquire);
+                if (s0 & 1) continue;
+                copy(out);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seg_->seq.load(std::memory_order_relaxed) == s0) return true;
+            }
+            return false;
+        }
+
+        // Only the best level of each side: fewer bytes copied.
+        bool read_top(BookLevel& bid, BookLevel& ask, uint64_t& version, int max_tries = 1000) const
+        {
+            for (int i = 0; i < max_tries; ++i)
+            {
+                uint64_t s0 = seg_->seq.load(std::memory_order_acquire);
+                if (s0 & 1) continue;
+                const BookData& d = seg_->data;
+                version = d.version;
+                bid = d.bid_count ? d.bids[0] : BookLevel{};
+                ask = d.ask_count ? d.asks[0] : BookLevel{};
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seg_->seq.load(std::memory_order_relaxed) == s0) return true;
+            }
+            return false;
+        }
+
+    private:
+        void copy(BookData& out) const
+        {
+            const BookData& d = seg_->data;
+            out.version = d.version;
+            out.ts_ns = d.ts_ns;
+            out.publish_ns = d.publish_ns;
+            // counts may be garbage mid-write; clamp, the seq check discards the copy
+            out.bid_count = d.bid_count < kBookMaxDepth ? d.bid_count : kBookMaxDepth;
+            out.ask_count = d.ask_count < kBookMaxDepth ? d.ask_count : kBookMaxDepth;
+            std::memcpy(out.bids, d.bids, out.bid_count * sizeof(BookLevel));
+            std::memcpy(out.asks, d.asks, out.ask_count * sizeof(BookLevel));
+        }
+
+        const BookSegment* seg_ = nullptr;
+    };
+
+} // namespace shm
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Single-producer single-consumer byte ring in POSIX shared memory: the shm://
+// transport between streamer and engine on one host.
+//
+// The engine creates the segment and owns it; one producer at a time attaches,
+// streams bytes and closes, after which the engine resets the ring for the next.
+// head/tail are free-running byte counters on separate cache lines. A side that
+// finds the ring empty (consumer) or full (producer) spins briefly, then sleeps on
+// a futex; the other side only issues the wake syscall when a sleeper is flagged.
+namespace shm
+{
+
+    class ByteRing
+    {
+    public:
+        static constexpr size_t kNoData = SIZE_MAX;
+        enum class Mode { Create, Attach };
+
+        // Create: make (or recreate) the segment with `capacity` bytes (rounded up
+        // to a power of two); it is unlinked again on destruction.
+        // Attach: open an existing segment as its producer; throws std::runtime_error
+        // if it does not exist or another producer is attached.
+        ByteRing(const std::string& name, Mode mode, size_t capacity = 4 << 20);
+        ~ByteRing();
+
+        ByteRing(const ByteRing&) = delete;
+        ByteRing& operator=(const ByteRing&) = delete;
+
+        // Spin iterations before sleeping on an empty/full ring (0 = sleep at once).
+        void set_spin(uint32_t iters) { spin_ = iters; }
+
+        // --- producer ---
+        // Copy all n bytes in, waiting for space as needed.
+        void write(const void* data, size_t n);
+        // End of stream: the consumer drains what is left, then sees 0 from read().
+        void close();
+
+        // --- consumer ---
+        // Wait up to timeout_ms for a producer; true once one is attached.
+        bool wait_producer(int timeout_ms);
+        // Up to cap bytes; 0 at end of stream (producer closed or died, ring drained),
+        // kNoData when nothing arrived within timeout_ms.
+        size_t read(void* buf, size_t cap, int timeout_ms);
+        // Bytes written but not read yet.
+        size_t readable() const;
+        // Make the ring ready for the next producer (after read() returned 0).
+        void reset();
+
+        const std::string& name() const { return name_; }
+        size_t capacity() const;
+
+    private:
+        struct Header;
+        static size_t data_offset();   // ring bytes start on the page after the header
+
+        std::string name_;
+        bool owner_;
+        Header* hdr_ = nullptr;
+        char* data_ = nullptr;
+        size_t map_size_ = 0;
+        uint32_t spin_ = 2000;
+    };
+
+} // namespace shm
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define METRICS_HAVE_TSC 1
+#endif
+
+namespace metrics
+{
+
+    // Cheap timestamps for per-event tracing.
+    //
+    // On x86 with an invariant TSC, now() is rdtscp (waits for earlier instructions to
+    // finish, so a stamp taken after a stage includes all of it) and ticks are
+    // converted with a factor calibrated against CLOCK_MONOTONIC at startup. Elsewhere,
+    // or with ENGINE_TSC=0 in the environment, ticks are clock_gettime nanoseconds.
+    class TscClock
+    {
+    public:
+        static uint64_t now()
+        {
+#ifdef METRICS_HAVE_TSC
+            if (use_tsc_)
+            {
+                unsigned aux;
+                return __rdtscp(&aux);
+            }
+#endif
+            return mono_ns();
+        }
+
+        // Tick delta -> nanoseconds.
+        static uint64_t to_ns(uint64_t ticks)
+        {
+            return static_cast<uint64_t>((static_cast<unsigned __int128>(ticks) * ns_mult_) >> 32);
+        }
+
+        static bool using_tsc() { return use_tsc_; }
+        static double ticks_per_ns() { return 4294967296.0 / double(ns_mult_); }
+
+        // Run once before use (also done by a static initializer); ~20ms when the TSC is used.
+        static void calibrate();
+
+    private:
+        static uint64_t mono_ns();
+
+        static bool     use_tsc_;
+        static uint64_t ns_mult_;   // ns per tick in 32.32 fixed point
+    };
+
+} // namespace metrics
@@ -0,0 +1,68 @@
+#pragma once
+#include "common/hdr_histogram.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace metrics
+{
+
+    // Rolling-window latency/throughput on top of HdrRecorder.
+    //
+    // The writer records into the current 1s epoch and the current 10s epoch; epochs
+    // live in small rings and are recycled (reset) by the writer itself when time has
+    // moved past them, so recording never locks. Readers merge complete epochs:
+    //   window(1)  = the last complete second
+    //   window(10) = the last 10 complete seconds
+    //   window(60) = the last 6 complete 10s epochs (so it trails by up to 10s)
+    // An epoch being recycled while a reader copies it is detected by its id
+    // (seqlock style) and skipped. Epochs count in 32 bits (14KB each instead of
+    // 28KB, 252KB for all 18): a 10s epoch would need 429M events/s to overflow.
+    class WindowedHistogram
+    {
+    public:
+        static constexpr uint64_t kMaxWindowSec = 60;
+
+        explicit WindowedHistogram(uint64_t highest = 10'000'000'000ULL, int digits = 2);
+
+        // Single writer. now_ns: a monotonic clock shared with readers.
+        void record(uint64_t v, uint64_t now_ns)
+        {
+            uint64_t sec = now_ns / 1'000'000'000ULL;
+            current(sec_, kSecEpochs, sec).rec->record(v);
+            current(ten_, kTenEpochs, sec / 10).rec->record(v);
+        }
+
+        // Merge of the complete epochs covering the last `seconds` (1..60, rounded to
+        // what the rings hold); `covered_sec` receives the span actually merged.
+        HdrHistogram window(uint64_t seconds, uint64_t now_ns, uint64_t* covered_sec = nullptr) const;
+
+    private:
+        static constexpr size_t   kSecEpochs = 11;   // 10 complete seconds + the current one
+        static constexpr size_t   kTenEpochs = 7;    // 6 complete 10s epochs + the current one
+        static constexpr uint64_t kRecycling = UINT64_MAX;
+
+        using EpochRecorder = BasicHdrRecorder<uint32_t>;
+
+        struct Epoch
+        {
+            std::atomic<uint64_t> id{kRecycling};   // second (or 10s) number it holds
+            std::unique_ptr<EpochRecorder> rec;
+        };
+
+        Epoch& current(std::unique_ptr<Epoch[]>& ring, size_t n, uint64_t id)
+        {
+            Epoch& e = ring[id % n];
+            if (e.id.load(std::memory_order_relaxed) != id) recycle(e, id);
+            return e;
+        }
+        static void recycle(Epoch& e, uint64_t id);
+        static bool merge_epoch(const Epoch& e, uint64_t id, HdrHistogram& out);
+
+        uint64_t highest_;
+        int      digits_;
+        std::unique_ptr<Epoch[]> sec_;
+        std::unique_ptr<Epoch[]> ten_;
+    };
+
+} // namespace metrics
@@ -0,0 +1,100 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include <cstdint>
+
+namespace engine
+{
+
+    // Microstructure analytics kept up to date event by event from what the book
+    // reports about each event (OrderBook::last_effect), never from a fresh snapshot
+    // and never by looking an order up again:
+    //
+    //  - best bid/ask, microprice, top-of-book and top-`depth` size imbalance
+    //  - order flow imbalance (Cont, Kukanov, Stoikov): the signed size change at
+    //    the best bid and ask, summed per event
+    //  - trade volume, count and VWAP, adds/cancels/modifies and the cancel-to-add
+    //    ratio, all-time and over the last 1s, 10s and 60s of feed time
+    //
+    // Per event: a few compares and one bucket update. The best levels and the
+    // top-`depth` sums follow the event's level delta; the book is read only when a
+    // best level goes away (one level) or a level inside the top `depth` is added or
+    // removed (depth levels of that side). Not thread safe: the engine feeds and
+    // reads it under the book lock.
+    class BookAnalytics
+    {
+    public:
+        static constexpr uint32_t kMaxDepth = 20;
+        static constexpr int      kWindows = 3;
+        static constexpr uint64_t kWindowSeconds[kWindows] = {1, 10, 60};
+
+        struct Options
+        {
+            uint32_t depth = 5;   // levels per side in imbalance_depth (1..kMaxDepth)
+        };
+
+        struct Flow
+        {
+            int64_t  volume = 0;     // traded qty
+            uint64_t trades = 0;
+            double   notional = 0;   // sum of price * qty, for the VWAP
+            int64_t  ofi = 0;
+            uint64_t adds = 0;
+            uint64_t cancels = 0;
+            uint64_t modifies = 0;
+
+            Flow& operator+=(const Flow& o);
+            double vwap() const;            // NaN without trades
+            double cancel_to_add() const;   // NaN without adds
+        };
+
+        struct Snapshot
+        {
+            uint64_t ts_ns = 0;             // feed ts of the last event
+            uint64_t events = 0;
+            uint32_t depth = 0;
+            int64_t  bid_px = 0, bid_qty = 0;   // qty 0: the side is empty
+            int64_t  ask_px = 0, ask_qty = 0;
+            int64_t  bid_depth_qty = 0, ask_depth_qty = 0;
+            double   microprice = 0;        // NaN unless both sides have a level
+            double   imbalance = 0;         // (bid - ask) / (bid + ask) at the best level
+            double   imbalance_depth = 0;   // the same over the top `depth` levels
+            Flow     total;
+            Flow     window[kWindows];      // kWindowSeconds, ending at ts_ns
+        };
+
+        BookAnalytics() : BookAnalytics(Options{}) {}
+        explicit BookAnalytics(Options opt);
+
+        // After book.on_event(ev).
+        void on_event(const OrderBook& book, const MboEvent& ev);
+
+        // Forget all flow and take the book as it is now (at start, and after the
+        // book was replaced, e.g. by a checkpoint restore).
+        void reset(const OrderBook& book);
+
+        Snapshot snapshot() const;
+
+    private:
+        struct Bucket
+        {
+            uint64_t sec = UINT64_MAX;   // feed second it holds
+            Flow     flow;
+        };
+        static constexpr uint64_t kBuckets = 64;   // > the longest window
+
+        Options  opt_;
+        LevelView bid_{}, ask_{};   // best levels after the last event (qty 0: none)
+        int64_t  depth_qty_[2] = {};
+        int64_t  depth_last_px_[2] = {};   // the depth-th level's price, as of the last walk
+        uint32_t depth_levels_[2] = {};    // levels in the top `depth` (< depth: all of them)
+        Flow     total_;
+        Bucket   buckets_[kBuckets];
+        uint64_t sec_ = 0;          // latest feed second seen
+        uint64_t ts_ns_ = 0;
+        uint64_t events_ = 0;
+
+        Flow& bucket(uint64_t ts_ns);
+        void walk_depth(const OrderBook& book, Side s);
+    };
+
+} // namespace engine
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace shm { class ByteRing; }
+
+namespace engine
+{
+
+    // Where the engine loop gets its raw feed bytes from. The live path reads a
+    // socket; offline replays and benchmarks read a file loaded into memory.
+    class ByteSource
+    {
+    public:
+        static constexpr size_t kNoData = SIZE_MAX;
+
+        virtual ~ByteSource() = default;
+
+        // Copy up to cap bytes into buf. Returns the byte count, 0 at end of stream,
+        // or kNoData when nothing is available yet (caller just retries).
+        virtual size_t read(char* buf, size_t cap) = 0;
+
+        // Bytes that could be read right now without waiting (0 if unknown).
+        virtual size_t unread() const { return 0; }
+    };
+
+    // Non-blocking TCP socket (not owned).
+    class SocketSource : public ByteSource
+    {
+    public:
+        explicit SocketSource(int fd, int poll_timeout_ms = 1000) : fd_(fd), timeout_ms_(poll_timeout_ms) {}
+        size_t read(char* buf, size_t cap) override;
+        size_t unread() const override;   // kernel receive queue (SIOCINQ)
+
+    private:
+        int fd_;
+        int timeout_ms_;
+    };
+
+    // Consumer end of a shm:// byte ring (not owned).
+    class ShmSource : public ByteSource
+    {
+    public:
+        explicit ShmSource(shm::ByteRing& ring, int poll_timeout_ms = 1000) : ring_(ring), timeout_ms_(poll_timeout_ms) {}
+        size_t read(char* buf, size_t cap) override;
+        size_t unread() const override;
+
+    private:
+        shm::ByteRing& ring_;
+        int timeout_ms_;
+    };
+
+    // A byte buffer handed out in chunks of at most `chunk` bytes, like recv() would.
+    class MemorySource : public ByteSource
+    {
+    public:
+        explicit MemorySource(std::string data, size_t chunk = 64 * 1024)
+            : data_(std::move(data)), chunk_(chunk ? chunk : 1) {}
+
+        size_t read(char* buf, size_t cap) override;
+        size_t unread() const override { return data_.size() - pos_; }
+        void rewind() { pos_ = 0; }
+        const std::string& data() const { return data_; }
+
+    private:
+        std::string data_;
+        size_t chunk_;
+        size_t pos_ = 0;
+    };
+
+    // Whole file into memory; throws std::runtime_error if it cannot be read.
+    std::string load_file(const std::string& path);
+
+} // namespace engine
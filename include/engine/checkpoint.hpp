@@ -0,0 +1,130 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include "common/node_pool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace engine
+{
+
+    // Where a checkpoint sits in the feed: the book holds exactly the lines before
+    // feed_offset, so a replay of the same file resumes there.
+    struct CheckpointInfo
+    {
+        uint64_t feed_offset = 0;   // bytes of feed consumed, at a line boundary
+        uint64_t lines = 0;         // lines consumed up to feed_offset
+        uint64_t last_ts_ns = 0;    // feed timestamp of the last applied event
+        uint64_t written_ns = 0;    // wall clock when the state was taken
+        uint64_t orders = 0;
+        uint64_t bid_levels = 0;
+        uint64_t ask_levels = 0;
+    };
+
+    // File layout: CheckpointHeader, then `orders` OrderBook::RestingOrder records.
+    struct CheckpointHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        CheckpointInfo info;
+        uint64_t checksum;          // FNV-1a over the order records
+    };
+
+    static constexpr uint32_t kCheckpointMagic   = 0x50434B42;   // "BKCP"
+    static constexpr uint16_t kCheckpointVersion = 1;
+
+    // Header for orders + info (orders count and checksum filled in).
+    CheckpointHeader checkpoint_header(const std::vector<OrderBook::RestingOrder>& orders, const CheckpointInfo& info);
+
+    // Verify an in-memory checkpoint image (header + records, exactly size bytes)
+    // and rebuild book from it. Throws std::runtime_error when it is not valid.
+    CheckpointInfo restore_checkpoint_image(const char* data, size_t size, OrderBook& book);
+
+    // Write orders + info to path via a temporary file and rename(), so a crash
+    // mid-write leaves the previous checkpoint intact. Throws std::runtime_error.
+    void write_checkpoint(const std::string& path, const std::vector<OrderBook::RestingOrder>& orders,
+                          const CheckpointInfo& info);
+
+    // mmap the file, verify it and rebuild book from it in one pass. Throws
+    // std::runtime_error for a missing, truncated or corrupt file.
+    CheckpointInfo load_checkpoint(const std::string& path, OrderBook& book);
+
+    // Periodic checkpoints off the ingest thread, copied incrementally.
+    //
+    // The Checkpointer keeps its own copy of the book, level by level. note() after
+    // every applied event remembers the levels that event changed; submit() re-copies
+    // just those levels (no I/O, no order lookups) and hands the copy to a background
+    // thread, which flattens and writes it. The ingest thread's pause is therefore
+    // proportional to the orders on levels changed since the last checkpoint, not to
+    // the book: a quiet book tail costs nothing, but a checkpoint after churn on every
+    // level still copies everything, and so does the first one and the first one
+    // after a Clear or resync(). The price is a second copy of the book in memory
+    // (24 bytes per resting order) and a hash insert per changed level per event.
+    // A submit while the previous write is still running is skipped and counted; the
+    // noted levels carry over to the next one.
+    class Checkpointer
+    {
+    public:
+        explicit Checkpointer(std::string path);
+        ~Checkpointer();
+
+        Checkpointer(const Checkpointer&) = delete;
+        Checkpointer& operator=(const Checkpointer&) = delete;
+
+        // Ingest thread, after each book.on_event(): remember the levels it changed.
+        void note(const OrderBook& book);
+        // The book was replaced without note()s (a restore): copy all of it next time.
+        void resync() { full_ = true; }
+
+        // Caller must hold whatever keeps book consistent for the copy, and must have
+        // note()d every event since the previous submit. wait = block until the
+        // previous write is done instead of skipping (end of a feed).
+        bool submit(const OrderBook& book, const CheckpointInfo& info, bool wait = false);
+
+        const std::string& path() const { return path_; }
+        uint64_t written() const { return written_.load(std::memory_order_acquire); }
+        uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+        // how long the last / longest submit() held the caller, and how many orders
+        // the last one copied
+        uint64_t pause_ns() const { return pause_ns_.load(std::memory_order_relaxed); }
+        uint64_t pause_max_ns() const { return pause_max_ns_.load(std::memory_order_relaxed); }
+        uint64_t copied() const { return copied_.load(std::memory_order_relaxed); }
+
+    private:
+        using Orders = std::vector<OrderBook::RestingOrder>;
+        using Prices = std::unordered_set<int64_t, std::hash<int64_t>, std::equal_to<int64_t>,
+                                          mem::PoolAllocator<int64_t>>;
+
+        size_t copy_all(const OrderBook& book);
+        template <typename Levels>
+        size_t copy_levels(const OrderBook& book, Side s, Levels& levels, Prices& dirty);
+        void write_loop();
+
+        std::string path_;
+        // the copy: owned by the ingest thread, by the writer while busy_
+        std::map<int64_t, Orders, std::greater<int64_t>> bids_;
+        std::map<int64_t, Orders, std::less<int64_t>>    asks_;
+        CheckpointInfo info_;
+        Orders buf_;                                 // writer only: the flattened copy
+        // levels changed since the copy was last brought up to date (ingest thread)
+        mem::NodePool dirty_pool_;
+        Prices dirty_bids_{Prices::allocator_type{dirty_pool_}};
+        Prices dirty_asks_{Prices::allocator_type{dirty_pool_}};
+        bool   full_ = true;
+        std::atomic<uint32_t> busy_{0};              // 1 = the copy handed to the writer
+        std::atomic<bool> stop_{false};
+        std::atomic<uint64_t> written_{0};
+        std::atomic<uint64_t> skipped_{0};
+        std::atomic<uint64_t> pause_ns_{0};
+        std::atomic<uint64_t> pause_max_ns_{0};
+        std::atomic<uint64_t> copied_{0};
+        std::thread thread_;
+    };
+
+} // namespace engine
@@ -1,5 +1,26 @@
 #pragma once
 #include "engine/order_book.hpp"
+#include "engine/byte_source.hpp"
+#include "engine/udp_source.hpp"
+#include "engine/feed_arbiter.hpp"
+#include "engine/lag_monitor.hpp"
+#include "common/net.hpp"
+#include "common/hdr_histogram.hpp"
+#include "common/windowed_histogram.hpp"
+#include "common/metrics_registry.hpp"
+#include "common/perf_counters.hpp"
+#include "engine/stage_trace.hpp"
+#include "engine/flight_recorder.hpp"
+#include "common/capture.hpp"
+#include "common/shm_book.hpp"
+#include "engine/checkpoint.hpp"
+#include "engine/time_index.hpp"
+#include "engine/response_cache.hpp"
+#include "engine/push_server.hpp"
+#include "engine/mbp_publisher.hpp"
+#include "engine/analytics.hpp"
+#include "engine/trade_tape.hpp"
+#include <climits>
 #include <string>
 #include <mutex>
 #include <fstream>
@@ -12,7 +33,8 @@
 namespace engine
 {
 
-    // Engine: reads newline-delimited frames from a TCP socket and applies to the book.
+    // Engine: reads newline-delimited frames from a byte source (TCP socket or an
+    // in-memory file) and applies to the book.
     //
     //  ADD,<ts_ns>,<side>,<order_id>,<price_ticks>,<qty>
     //  MOD,<ts_ns>,<order_id>,<new_price_ticks>,<new_qty>
@@ -24,10 +46,75 @@ namespace engine
     class EngineApp
     {
     public:
+        EngineApp();
+
         int run(const std::string& host, const std::string& port, size_t top_n);
+        // Serve feeds arriving on any transport (tcp://, unix://, shm://, udp://; see net::Endpoint).
+        int run(const net::Endpoint& ep, size_t top_n);
+        // Serve one sequenced stream received twice, on udp:// feeds a and b, applying
+        // each line from whichever copy arrives first (see FeedArbiter).
+        int run_arbitrated(const net::Endpoint& a, const net::Endpoint& b, size_t top_n,
+                           const FeedArbiter::Options& opt = {});
+
+        // Offline: load a line file into memory and push it through the same
+        // framing/parse/apply/metrics path as a live connection.
+        int replay(const std::string& path, size_t top_n);
+
+        // Frame, parse and apply everything the source yields until it ends;
+        // returns the number of lines seen.
+        size_t consume(ByteSource& src);
+
         void enable_csv_metrics(const std::string& path, size_t every);
         static void run_http_server(EngineApp* self, int port);
         void enable_json_snapshots(const std::string& path);
+        // Start writing flight-recorder dumps to dir (on /debug/flight, and whenever
+        // parse->apply latency exceeds threshold_ns; 0 = on request only).
+        void enable_flight_recorder(const std::string& dir, uint64_t threshold_ns);
+        // Log a [lag_alert] line when the feed lag (see dump_lag_stats) exceeds
+        // threshold_ns; at most one per second while it stays above.
+        void set_lag_alert(uint64_t threshold_ns) { lag_alert_ns_.store(threshold_ns, std::memory_order_relaxed); }
+        // Partial-line bytes the framer held after the last chunk (framer_buffered_bytes).
+        uint64_t framer_buffered_bytes() const { return lag_framer_bytes_.load(std::memory_order_relaxed); }
+
+        // Count PMU events (or software events where there is no PMU access) on the
+        // ingest thread around each received chunk; /stats reports per-event averages.
+        void enable_perf_counters(bool prefer_software = false);
+
+        // Record every received chunk, as read and with its wall-clock receive time,
+        // to a capture file (see capture::Writer); streamer_app replays it with cap:<path>.
+        void enable_capture(const std::string& path, capture::Codec codec = capture::Codec::None);
+
+        // Checkpoint the book to path every `every_lines` feed lines (and when a feed
+        // ends). restore_checkpoint() loads one before run()/replay(); replay() then
+        // skips the part of the file the checkpoint already covers.
+        void enable_checkpoints(const std::string& path, uint64_t every_lines);
+        CheckpointInfo restore_checkpoint(const std::string& path);
+
+        // Serve /book/at?ts= from a recorded feed file, using (building if missing
+        // or stale) its <feed>.tidx time index.
+        void enable_history(const std::string& feed_path, const TimeIndex::Options& opt = {});
+
+        // Publish the top `depth` levels per side to POSIX shared memory `name` after
+        // every applied event (seqlock; read with shm::BookReader).
+        void enable_shm_book(const std::string& name, uint32_t depth);
+
+        // Stream /stream/top and /stream/spread as server-sent events on port, at most
+        // max_hz events per second per subscriber (see PushServer).
+        void enable_push(const std::string& port, int max_hz);
+
+        // Publish MBP-10 (top 10 levels per side, binary, sequenced) on a TCP port
+        // whenever they change (see MbpPublisher).
+        void enable_mbp(const std::string& port, const MbpPublisher::Options& opt = {});
+
+        // Keep microstructure analytics (microprice, imbalance, OFI, windowed VWAP and
+        // cancel/add counts; see BookAnalytics) as events are applied. Served at
+        // /analytics and appended to the CSV metrics.
+        void enable_analytics(const BookAnalytics::Options& opt = {});
+
+        // Keep a tape of recent prints and OHLCV bars from TRD events (see TradeTape),
+        // served at /trades and /bars. With bars_csv, closed bars are also appended to
+        // that file by the throughput thread.
+        void enable_trades(const TradeTape::Options& opt = {}, const std::string& bars_csv = "");
     private:
 
         OrderBook book_;
@@ -49,19 +136,128 @@ namespace engine
         std::atomic<bool> thr_stop_{false};
         std::atomic<uint64_t> applied_since_tick_{0};
 
-        // latency histogram (µs)
-        static constexpr int LAT_BIN_US = 1;     // 1 µs bins
-        static constexpr int LAT_BINS   = 5000;  // cover 0..5 ms; last bin = overflow
-        std::atomic<uint64_t> lat_bins_[LAT_BINS + 1]{};
-        std::atomic<uint64_t> lat_samples_{0};
-        std::atomic<uint64_t> lat_sum_us_{0};   // sum of latencies for mean
+        // latency histograms (ns, HDR log-linear, 2 significant digits, 1ns..10s);
+        // written only by the ingest thread, /stats reads snapshots
+        metrics::HdrRecorder lat_ns_;   // parse -> apply (steady clock)
+        metrics::HdrRecorder e2e_ns_;   // streamer send -> apply (wall clock)
+
+        // the same two over rolling windows (last 1s/10s/60s), keyed by steady-clock apply time
+        metrics::WindowedHistogram lat_win_;
+        metrics::WindowedHistogram e2e_win_;
+        std::atomic<uint64_t> first_apply_ns_{0};   // for the all-time events/s
+
+        // Prometheus metrics (/metrics); handles point into registry_ and are set up
+        // by the constructor
+        metrics::Registry   registry_;
+        metrics::Counter*   events_by_kind_[5] = {};   // indexed by EventKind
+        metrics::Counter*   parse_errors_ = nullptr;
+        metrics::Counter*   bytes_received_ = nullptr;
+        metrics::Histogram* lat_prom_ = nullptr;
+        metrics::Histogram* e2e_prom_ = nullptr;
+
+        // consumer lag, sampled by the ingest thread once per received chunk
+        std::atomic<uint64_t> lag_kernel_bytes_{0};    // still queued in the socket
+        std::atomic<uint64_t> lag_framer_bytes_{0};    // partial line held by the framer
+        std::atomic<uint64_t> lag_pending_events_{0};  // unread + framer bytes / avg line size
+        std::atomic<uint64_t> lag_feed_ns_{0};         // (wall - feed ts) above its minimum
+        std::atomic<uint64_t> lag_feed_hwm_ns_{0};
+        std::atomic<uint64_t> lag_alert_ns_{0};
+        LagMonitor lag_;                                // ingest thread only
+        uint64_t last_ts_ns_ = 0;                       // feed ts of the last applied event
+        void sample_lag(size_t kernel_bytes, size_t framer_bytes, size_t chunk_bytes, size_t chunk_lines);
+        void dump_lag_stats(std::ostream& os);
+
+        // perf_event counters of the ingest thread, opened by the first consume()
+        enum class PerfState : uint8_t { Off, Wanted, WantedSoftware, Open };
+        metrics::PerfGroup    perf_;
+        std::atomic<PerfState> perf_state_{PerfState::Off};
+        std::atomic<uint64_t> perf_totals_[metrics::PerfGroup::kMax] = {};
+        std::atomic<uint64_t> perf_events_{0};
+        void dump_perf_stats(std::ostream& os);
+
+        // last events with timings, dumped on latency spikes (always recording)
+        FlightRecorder flight_;
+
+        // feed position across consume() calls (file offset for a replay) and the
+        // periodic checkpoints taken at it; ingest thread only
+        uint64_t feed_pos_ = 0;
+        uint64_t feed_lines_ = 0;
+        uint64_t ckpt_every_ = 0;
+        uint64_t ckpt_next_ = 0;
+        std::unique_ptr<Checkpointer> ckpt_;
+        void take_checkpoint(size_t partial_bytes, bool wait);
+        void feed_progress(size_t bytes, size_t lines, size_t partial_bytes)
+        {
+            feed_pos_ += bytes;
+            feed_lines_ += lines;
+            if (ckpt_ && feed_lines_ >= ckpt_next_) take_checkpoint(partial_bytes, false);
+        }
+        void dump_checkpoint_stats(std::ostream& os);
+
+        // shared-memory top-of-book for co-located readers; ingest thread only
+        std::unique_ptr<shm::BookWriter> shm_book_;
+        LevelView shm_levels_[shm::kBookMaxDepth];
+        void publish_shm_book(uint64_t ts_ns);
+
+        // book version and the /book/top and /spread bodies rendered at it
+        ResponseCache views_;
+        std::string render_top(size_t n, uint64_t& version);
+        std::string render_spread(uint64_t& version);
+        void dump_view_stats(std::ostream& os);
+
+        // SSE subscribers, fed from views_ by the push thread
+        std::unique_ptr<PushServer> push_;
+        void dump_push_stats(std::ostream& os);
+
+        // MBP-10 subscribers; the ingest thread hands it the top levels when they change
+        std::unique_ptr<MbpPublisher> mbp_;
+        void dump_mbp_stats(std::ostream& os);
+
+        // analytics fed by the ingest thread under mtx_, read under it by /analytics
+        std::unique_ptr<BookAnalytics> analytics_;
+        std::string render_analytics();
+
+        // trade tape fed by the ingest thread; readers go through its seqlocks, not mtx_
+        std::unique_ptr<TradeTape> tape_;
+        std::string bars_csv_path_;
+        std::ofstream bars_csv_;                       // throughput thread
+        std::vector<uint64_t> bars_written_;           // closed bars written, per interval
+        std::atomic<uint64_t> bars_csv_rows_{0};
+        std::atomic<uint64_t> bars_csv_lost_{0};       // overwritten before they were written
+        void write_closed_bars();
+        std::string render_trades(size_t n);
+        std::string render_bars(size_t interval, size_t n);
+        void dump_trades_stats(std::ostream& os);
+
+        // recorded feed for point-in-time queries (/book/at)
+        std::unique_ptr<TimeIndex> history_;
+
+        // udp:// ingest (set up by run() before the HTTP thread starts)
+        int udp_fd_ = -1;
+        std::unique_ptr<UdpSource> udp_;
+        void dump_udp_stats(std::ostream& os);
+
+        // A/B udp:// ingest (set up by run_arbitrated() before the HTTP thread starts)
+        int ab_fds_[2] = {-1, -1};
+        std::unique_ptr<FeedArbiter> ab_;
+        void dump_ab_stats(std::ostream& os);
+
+        // raw feed capture, appended to by the ingest thread
+        std::unique_ptr<capture::Writer> capture_;
+        void dump_capture_stats(std::ostream& os);
+
+#ifdef ENGINE_STAGE_TRACING
+        StageTracer stages_;
+        uint64_t    line_tsc_ = 0;    // TscClock stamp the next line's Frame stage starts from
+#endif
 
-        // E2E latency (producer→consumer) histogram in µs
-        static constexpr int E2E_BIN_US = 1;     // 1 µs bins
-        static constexpr int E2E_BINS   = 100000; // cover 0..100 ms; last bin overflow
-        std::atomic<uint64_t> e2e_bins_[E2E_BINS + 1]{};
-        std::atomic<uint64_t> e2e_samples_{0};
-        std::atomic<uint64_t> e2e_sum_us_{0};
+#ifdef ENGINE_ALLOC_TRACKING
+        // allocation counts of the ingest thread since its first consume()
+        std::atomic<uint64_t> alloc_tid_{0};
+        std::atomic<uint64_t> alloc_base_allocs_{0};
+        std::atomic<uint64_t> alloc_base_bytes_{0};
+        void dump_alloc_stats(std::ostream& os);
+#endif
 
         // JSON writers
         std::ofstream json_snapshots_;   // JSON snapshots file
@@ -70,7 +266,6 @@ namespace engine
         void write_snapshot_json(std::int64_t ts_ns);
 
         // helpers
-        void record_e2e_latency_us(uint64_t us);
         void handle_line(const std::string& line);
         void print_snapshot(size_t top_n);
         BookSnapshot snapshot_top_n_locked(size_t n);
@@ -83,7 +278,6 @@ namespace engine
         static uint64_t now_ns();
 
         // latency helpers
-        void record_latency_us(uint64_t us);
         void dump_latency_stats(std::ostream& os);
     };
 
@@ -0,0 +1,106 @@
+#pragma once
+#include "engine/udp_source.hpp"
+#include "common/hdr_histogram.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace engine
+{
+
+    // A/B arbitration of two udp:// feeds carrying the same sequenced stream (the
+    // same feed on two lines, or two streamers replaying the same input). Every line
+    // is applied exactly once, from whichever copy arrives first, in sequence order.
+    //
+    //  - A sliding bitmap over the last kWindow sequence numbers (an anti-replay
+    //    window) marks the lines seen, so the second copy of a line costs one bit test.
+    //  - A line that arrives ahead of a hole is held until either side fills the hole.
+    //    If neither does within gap_timeout_us, or the window would overflow, the
+    //    missing lines are declared lost and the held ones are released.
+    //  - Either side may stall or die; the other keeps the stream going.
+    //
+    // The session ends (read() returns 0) once every side that sent data has sent
+    // its end marker, or one has and the feed then stays silent for a poll timeout.
+    // It also ends when a side restarts without its end marker: its lines go more than
+    // feed::SeqTracker::kRestartWindow behind what that side had sent, or back to seq 1
+    // once it had sent more than that (before, seq 1 is a reordered first packet and
+    // is arbitrated like any other). A side still in the old session when it ends (silent, or not restarted
+    // yet) is stale: its lines are dropped until it restarts or sends its end marker,
+    // so a stalled side that resumes never replays old lines into the new session.
+    class FeedArbiter : public ByteSource
+    {
+    public:
+        static constexpr uint64_t kWindow = 8192;   // lines; a power of two
+
+        struct Options
+        {
+            uint64_t gap_timeout_us = 1000;
+            int poll_timeout_ms = 1000;
+        };
+
+        // Counters for /stats; written by the reading thread only.
+        struct Stats
+        {
+            std::atomic<uint64_t> wins[2] = {};       // lines applied from side A / B
+            std::atomic<uint64_t> packets[2] = {};
+            std::atomic<uint64_t> syscalls[2] = {};
+            std::atomic<uint64_t> last_packet_ns[2] = {};   // steady clock
+            std::atomic<uint64_t> duplicates{0};      // second copies dropped
+            std::atomic<uint64_t> late{0};            // copies of lines already declared lost
+            std::atomic<uint64_t> lines_lost{0};      // missing from both sides
+            std::atomic<uint64_t> gaps{0};
+            std::atomic<uint64_t> bad{0};
+            std::atomic<uint64_t> sessions{0};
+            std::atomic<uint64_t> restarts{0};        // sessions ended by a side starting over
+            std::atomic<uint64_t> stale{0};           // lines dropped from a side still in an old session
+            metrics::HdrRecorder  arrival_delta_ns;   // second copy's arrival - first copy's
+        };
+
+        // Sockets are not owned (see net::open_multicast_recv).
+        FeedArbiter(int fd_a, int fd_b, Options opt);
+        FeedArbiter(int fd_a, int fd_b) : FeedArbiter(fd_a, fd_b, Options{}) {}
+
+        size_t read(char* buf, size_t cap) override;
+        size_t unread() const override;
+
+        const Stats& stats() const { return stats_; }
+
+    private:
+        int fds_[2];
+        Options opt_;
+        DatagramBatch batch_[2];
+        Stats stats_;
+
+        // sequence state of the current session
+        uint64_t next_ = 1;            // next line to apply
+        uint64_t hi_ = 0;              // highest line seen
+        uint64_t gap_since_ns_ = 0;    // when next_ became a hole (0: no hole)
+        uint64_t end_seq_ = 0;         // from the end markers: one past the last line
+        bool active_[2] = {};          // side sent data this session
+        bool ended_[2] = {};           // side sent its end marker
+        bool stale_[2] = {};           // side is still sending an earlier session
+        uint64_t side_next_[2] = {1, 1};   // one past the highest line the side sent
+        int restart_side_ = -1;        // side whose restart ends the session (-1: none)
+        bool end_pending_ = false;
+
+        std::vector<uint64_t> seen_;        // kWindow bits, line s at bit s % kWindow
+        std::vector<uint64_t> first_ns_;    // arrival time of the first copy, by s % kWindow
+        std::vector<std::string> held_;     // lines waiting behind a hole, by s % kWindow
+
+        std::string out_;                   // lines released, not handed out yet
+        size_t out_pos_ = 0;
+
+        bool seen(uint64_t s) const { return seen_[(s % kWindow) / 64] >> (s % 64) & 1; }
+        void mark(uint64_t s);
+        void drain(int side, uint64_t now);
+        bool on_packet(int side, const char* pkt, size_t len, uint64_t now);
+        bool restarted(int side, uint64_t seq) const;
+        void on_line(int side, uint64_t s, const char* data, size_t len, uint64_t now);
+        void release_held(uint64_t now);
+        void skip_to(uint64_t s, uint64_t now);
+        bool session_over(bool idle) const;
+        void end_session();
+    };
+
+} // namespace engine
@@ -0,0 +1,111 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include "engine/stage_trace.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace engine
+{
+
+    // Always-on record of the last N applied events, for explaining latency spikes.
+    //
+    // The ingest thread writes one Record per event into an overwrite ring: a slot
+    // sequence number is cleared, the record copied in and the sequence republished
+    // (no locks, no allocation, a few stores); with stage tracing built in, each record
+    // also carries its per-stage times. When an event's parse->apply latency
+    // crosses the threshold, or a dump is requested (/debug/flight), the ring is
+    // frozen — recording pauses — and a background thread copies it out, unfreezes,
+    // and writes the copy to <dir>/flight_<n>.csv. Automatic dumps are at least
+    // `cooldown` apart so a burst of slow events produces one file.
+    class FlightRecorder
+    {
+    public:
+        static constexpr int kFirstStage = static_cast<int>(Stage::Frame);
+        static constexpr int kStages     = static_cast<int>(Stage::Publish) - kFirstStage + 1;
+
+        struct Record
+        {
+            MboEvent ev;
+            uint64_t recv_ns;       // steady clock, line received (after the send stamp)
+            uint64_t apply_ns;      // steady clock, applied to the book
+            uint64_t e2e_ns;        // streamer send -> apply (0 without a send stamp)
+            uint32_t book_orders;   // resting orders after this event
+            uint32_t book_levels;   // bid + ask levels after this event
+            // TscClock ns of Stage::Frame .. Stage::Publish for this event; all 0
+            // unless the engine is built with ENGINE_STAGE_TRACING
+            uint32_t stage_ns[kStages];
+        };
+
+        explicit FlightRecorder(size_t capacity = 4096);   // rounded up to a power of two
+        ~FlightRecorder();
+
+        FlightRecorder(const FlightRecorder&) = delete;
+        FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+        // Single writer (the ingest thread).
+        void record(const Record& r)
+        {
+            if (frozen_.load(std::memory_order_relaxed)) return;
+            uint64_t h = head_.load(std::memory_order_relaxed);
+            Slot& s = ring_[h & mask_];
+            s.seq.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            s.rec = r;
+            s.seq.store(h + 1, std::memory_order_release);
+            head_.store(h + 1, std::memory_order_release);
+
+            uint64_t threshold = threshold_ns_.load(std::memory_order_relaxed);
+            if (threshold != 0 && r.apply_ns - r.recv_ns > threshold) on_spike(r.apply_ns - r.recv_ns);
+        }
+
+        // Start the dump thread: files go to dir, threshold_ns = 0 dumps only on request.
+        void start(const std::string& dir, uint64_t threshold_ns, uint64_t cooldown_ns = 1'000'000'000ULL);
+        bool started() const { return dumper_.joinable(); }
+
+        // Ask for a dump; returns the file it will be written to, or "" when the
+        // recorder is not started or a dump is still in progress.
+        std::string request_dump(const std::string& reason);
+
+        // Records currently in the ring, oldest first (any thread; slots being
+        // overwritten during the copy are left out).
+        std::vector<Record> snapshot() const;
+
+        size_t   capacity() const { return mask_ + 1; }
+        uint64_t recorded() const { return head_.load(std::memory_order_acquire); }
+        uint64_t dumps() const { return dumps_done_.load(std::memory_order_acquire); }
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint64_t> seq{0};   // index + 1 of the record held, 0 while written
+            Record rec{};
+        };
+
+        void on_spike(uint64_t lat_ns);
+        bool freeze(const char* reason, uint64_t lat_ns, std::string* path);
+        void dump_loop();
+
+        std::unique_ptr<Slot[]> ring_;
+        size_t mask_;
+        std::atomic<uint64_t> head_{0};
+        std::atomic<bool>     frozen_{false};
+        std::atomic<uint64_t> threshold_ns_{0};
+
+        // dump thread
+        std::string dir_;
+        uint64_t    cooldown_ns_ = 0;
+        uint64_t    last_spike_ns_ = 0;          // ingest thread only
+        char        reason_[64] = {};            // set by whoever froze the ring
+        uint64_t    reason_lat_ns_ = 0;
+        std::atomic<uint32_t> pending_{0};       // 1 = dump requested, 2 = stop
+        std::atomic<bool>     stop_{false};
+        std::atomic<uint64_t> dumps_started_{0};
+        std::atomic<uint64_t> dumps_done_{0};
+        std::thread dumper_;
+    };
+
+} // namespace engine
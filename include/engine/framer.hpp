@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace engine
+{
+
+    // Splits a byte stream into '\n'-terminated lines. Bytes after the last newline
+    // are kept until the next feed() completes the line.
+    class LineFramer
+    {
+    public:
+        LineFramer()
+        {
+            buf_.reserve(1 << 20);
+            line_.reserve(4096);
+        }
+
+        // Calls on_line(const std::string&) for every complete line (without '\n').
+        template <class OnLine>
+        size_t feed(const char* data, size_t n, OnLine&& on_line)
+        {
+            buf_.append(data, data + n);
+
+            size_t lines = 0;
+            size_t pos = 0;
+            while (true)
+            {
+                auto nl = buf_.find('\n', pos);
+                if (nl == std::string::npos)
+                {
+                    buf_.erase(0, pos);
+                    break;
+                }
+                line_.assign(buf_.data() + pos, nl - pos);
+                pos = nl + 1;
+                on_line(line_);
+                ++lines;
+            }
+            return lines;
+        }
+
+        size_t pending() const { return buf_.size(); }
+        void reset() { buf_.clear(); }
+
+    private:
+        std::string buf_;
+        std::string line_;
+    };
+
+} // namespace engine
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace engine
+{
+
+    // Consumer lag estimates, fed by the ingest thread once per received chunk,
+    // after the chunk's lines were applied:
+    //
+    //  - pending events: what is still unread in the kernel plus the framer's
+    //    carried-over bytes, at the average line size seen so far (the chunk just
+    //    applied is no longer pending, so a caught-up consumer reads 0)
+    //  - feed lag: wall - feed ts above its minimum (the minimum is the constant
+    //    offset of a replay, or the network delay of a live feed)
+    //  - whether to raise an alert: the lag is above the threshold, at most once
+    //    per second
+    class LagMonitor
+    {
+    public:
+        struct Sample
+        {
+            uint64_t pending_events = 0;
+            uint64_t feed_lag_ns = 0;
+            bool     alert = false;
+        };
+
+        // last_ts_ns 0: nothing applied yet (no feed lag); alert_ns 0: no alerts.
+        Sample on_chunk(size_t chunk_bytes, size_t chunk_lines, size_t kernel_bytes, size_t framer_bytes,
+                        uint64_t wall_ns, uint64_t last_ts_ns, uint64_t alert_ns)
+        {
+            bytes_ += chunk_bytes;
+            lines_ += chunk_lines;
+
+            Sample s;
+            s.pending_events = pending_events(kernel_bytes, framer_bytes);
+            if (last_ts_ns == 0) return s;
+            const int64_t offset = static_cast<int64_t>(wall_ns - last_ts_ns);
+            if (offset < offset_min_) offset_min_ = offset;
+            s.feed_lag_ns = static_cast<uint64_t>(offset - offset_min_);
+            if (alert_ns != 0 && s.feed_lag_ns > alert_ns && wall_ns - last_alert_ns_ >= 1'000'000'000ULL)
+            {
+                last_alert_ns_ = wall_ns;
+                s.alert = true;
+            }
+            return s;
+        }
+
+        // Whole lines in kernel_bytes + framer_bytes at the average line size so far.
+        uint64_t pending_events(size_t kernel_bytes, size_t framer_bytes) const
+        {
+            return lines_ ? (kernel_bytes + framer_bytes) * lines_ / bytes_ : 0;
+        }
+
+    private:
+        uint64_t bytes_ = 0;              // received so far
+        uint64_t lines_ = 0;              // framed out of them
+        int64_t  offset_min_ = INT64_MAX;
+        uint64_t last_alert_ns_ = 0;
+    };
+
+} // namespace engine
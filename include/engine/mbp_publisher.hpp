@@ -0,0 +1,134 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include "common/mbp_feed.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace engine
+{
+
+    // MBP-10 over TCP (see common/mbp_feed.hpp for the wire format).
+    //
+    // The book thread calls publish() when OrderBook::top_changed(kDepth): it copies
+    // the 20 levels into an SPSC ring of images and, only if the publisher thread is
+    // asleep, wakes it through an eventfd. If the ring is full it overwrites a single
+    // "latest" slot (seqlock) instead, so the newest book always gets out. It never
+    // touches a socket, so no subscriber can slow it down. The publisher thread
+    // diffs consecutive images into
+    // Update messages (encoded once) and appends them to each subscriber's
+    // non-blocking send buffer. Slow consumers:
+    //
+    //  1. conflate: an update that does not fit in a subscriber's buffer
+    //     (max_buffer_bytes) is dropped for it, as are the ones after, until the
+    //     buffer drains below half; it then gets a Snapshot of the current book;
+    //  2. disconnect: a subscriber whose socket takes no bytes for slow_ms while
+    //     it has some pending (or is conflated) is closed.
+    class MbpPublisher
+    {
+    public:
+        static constexpr uint32_t kDepth = mbp::kDepth;
+
+        struct Options
+        {
+            size_t max_buffer_bytes = 256 << 10;   // per subscriber
+            int    sndbuf_bytes = 0;               // SO_SNDBUF of subscriber sockets (0: kernel default)
+            int    slow_ms = 5000;
+            size_t max_subscribers = 64;
+            size_t ring_images = 4096;             // rounded up to a power of two
+        };
+
+        struct Stats
+        {
+            std::atomic<uint64_t> published{0};         // images from the book thread
+            std::atomic<uint64_t> overruns{0};          // ring full: went to the latest slot
+            std::atomic<uint64_t> updates{0};           // Update messages built
+            std::atomic<uint64_t> snapshots{0};         // Snapshots sent
+            std::atomic<uint64_t> conflated{0};         // updates dropped for a slow subscriber
+            std::atomic<uint64_t> slow_disconnects{0};
+            std::atomic<uint64_t> subscribers{0};
+            std::atomic<uint64_t> accepted{0};
+            std::atomic<uint64_t> bytes{0};
+        };
+
+        MbpPublisher() = default;
+        ~MbpPublisher() { stop(); }
+
+        MbpPublisher(const MbpPublisher&) = delete;
+        MbpPublisher& operator=(const MbpPublisher&) = delete;
+
+        // Listen on host:port (port "0" picks one) and start the publisher thread.
+        // Throws if the port cannot be bound.
+        void start(const std::string& host, const std::string& port, Options opt);
+        void start(const std::string& host, const std::string& port) { start(host, port, Options{}); }
+        void stop();
+
+        // Book thread only: the best kDepth levels of book, for the feed event at ts_ns.
+        void publish(const OrderBook& book, uint64_t ts_ns);
+
+        uint16_t port() const { return port_; }
+        const Stats& stats() const { return stats_; }
+
+    private:
+        struct Image
+        {
+            uint64_t   n;                   // publish() call number
+            uint64_t   ts_ns;
+            uint64_t   publish_ns;
+            mbp::Level levels[2][kDepth];   // qty 0: empty
+        };
+
+        struct Subscriber
+        {
+            int fd = -1;
+            std::string out;                 // encoded messages not sent yet
+            size_t out_pos = 0;
+            bool need_snapshot = true;       // new, or conflated
+            bool conflated = false;
+            uint64_t stalled_since_ns = 0;   // has data to send, and the socket took none since
+        };
+
+        // image ring: written by the book thread, read by the publisher thread
+        std::unique_ptr<Image[]> ring_;
+        size_t mask_ = 0;
+        alignas(64) std::atomic<uint64_t> head_{0};
+        alignas(64) std::atomic<uint64_t> tail_{0};
+        std::atomic<uint32_t> sleeping_{0};
+        int wake_fd_ = -1;
+        LevelView scratch_[kDepth];       // book thread
+        uint64_t published_ = 0;           // book thread
+
+        // used while the ring is full (overflow_ set), until the publisher takes it
+        alignas(64) std::atomic<uint64_t> latest_seq_{0};   // odd while written
+        std::atomic<bool> overflow_{false};
+        Image latest_{};
+
+        // publisher thread
+        Options opt_;
+        int listen_fd_ = -1;
+        uint16_t port_ = 0;
+        Image cur_{};                      // the book the subscribers have been sent
+        uint64_t cur_n_ = 0;
+        uint64_t seq_ = 0;
+        std::string msg_;                  // the update being fanned out
+        std::vector<Subscriber> subs_;
+        std::atomic<bool> stop_{false};
+        std::thread thread_;
+        Stats stats_;
+
+        void loop();
+        void fill(Image& img, const OrderBook& book, uint64_t ts_ns);
+        bool pending() const;
+        size_t drain(uint64_t now);
+        void fan_out(const Image& img, uint64_t now);
+        bool encode_update(const Image& img);
+        void encode_snapshot(std::string& out) const;
+        bool flush(Subscriber& s, uint64_t now);
+        void service(uint64_t now);
+        void accept_all();
+    };
+
+} // namespace engine
@@ -1,8 +1,10 @@
 #pragma once
+#include "common/node_pool.hpp"
 #include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <map>
+#include <span>
 #include <deque>
 #include <vector>
 
@@ -53,23 +55,123 @@ namespace engine
     class OrderBook
     {
     public:
+        // One resting order as stored in a checkpoint (fixed 24-byte layout).
+        struct RestingOrder
+        {
+            uint64_t id;
+            int64_t  price;
+            int32_t  qty;
+            Side     side;
+            uint8_t  pad[3];
+        };
+        static_assert(sizeof(RestingOrder) == 24);
+
         void on_event(const MboEvent& ev);
         BookSnapshot snapshot_top_n(size_t n) const;
         BookSnapshot snapshot_full() const;
 
+        // Best n levels of one side into out (no allocation); returns how many.
+        size_t top_levels(Side s, LevelView* out, size_t n) const;
+
+        // Whether the last on_event() changed any of the best `depth` levels of either
+        // side (price, size or order count; a Clear changes all of them). Reads only
+        // the levels that event touched, plus a walk to the depth-th level of their side.
+        bool top_changed(size_t depth) const;
+
+        // What the last on_event() did, as found by the book's own order lookup (a
+        // cancel, modify or trade names only the order id), so consumers need no
+        // second one. A reused Add id that cancels the old order reports the Add.
+        struct Effect
+        {
+            EventKind kind = EventKind::Clear;
+            bool      applied = false;   // false: an unknown order id, nothing changed
+            Side      side = Side::Bid;
+            int64_t   price = 0;         // Modify: the new price; Trade: the resting order's
+            int32_t   qty = 0;           // Add: added, Cancel: removed, Trade: filled, Modify: new qty
+            int64_t   old_price = 0;     // Modify only
+            int32_t   old_qty = 0;       // Modify only
+            // Which levels changed, so a consumer can keep per-level sums without
+            // reading the book: Size, Added and Removed are about the level at
+            // (side, price) alone, whose size changed by level_delta.
+            enum class Levels : uint8_t
+            {
+                Size,      // an existing level that is still there
+                Added,     // a new level
+                Removed,   // a level that is gone
+                Several    // two levels (a reused Add id, a repriced Modify), or a Clear
+            };
+            Levels    levels = Levels::Several;
+            int64_t   level_delta = 0;
+        };
+        const Effect& last_effect() const { return effect_; }
+
+        // The levels the last on_event() changed (at most three; gone ones included),
+        // for consumers that mirror the book level by level. A Clear lists none and
+        // reports cleared(): every level changed.
+        struct LevelRef { Side side; int64_t price; };
+        std::span<const LevelRef> touched_levels() const { return {touched_, n_touched_}; }
+        bool cleared() const { return cleared_; }
+
+        size_t order_count() const { return orders_.size(); }
+        size_t level_count(Side s) const { return s == Side::Bid ? bids_.size() : asks_.size(); }
+
+        // Every resting order: bids best to worst, then asks best to worst, each
+        // level in queue (FIFO) order. Appends to out.
+        void export_orders(std::vector<RestingOrder>& out) const;
+        // The orders of one level, in queue order (none if it is not in the book).
+        void export_level(Side s, int64_t price, std::vector<RestingOrder>& out) const;
+
+        // Replace the book with orders in export_orders() order; queue priority
+        // within each level is the order given.
+        void restore(const RestingOrder* orders, size_t n);
+
     private:
         struct Order { int64_t price; int32_t qty; Side side; };
 
-        // price -> queue of order_ids (FIFO)
-        std::map<int64_t, std::deque<uint64_t>, std::greater<int64_t>> bids_;
-        std::map<int64_t, std::deque<uint64_t>, std::less<int64_t>>    asks_;
+        // A queued order carries its entry in orders_ (unordered_map nodes never
+        // move), so a walk over the levels reads qty and side without a lookup.
+        struct Queued
+        {
+            uint64_t     id;
+            const Order* order;
+        };
+
+        // one price level: FIFO queue of orders plus its running total size
+        struct Level
+        {
+            std::deque<Queued> queue;
+            int64_t qty = 0;
+        };
+        using BidLevels = std::map<int64_t, Level, std::greater<int64_t>>;
+        using AskLevels = std::map<int64_t, Level, std::less<int64_t>>;
+
+        BidLevels bids_;
+        AskLevels asks_;
+
+        // order_id -> Order (for O(1) cancel/modify). Its nodes come from node_pool_,
+        // so the add/cancel churn of a book at its working size does not allocate.
+        using OrderAlloc = mem::PoolAllocator<std::pair<const uint64_t, Order>>;
+        mem::NodePool node_pool_;
+        std::unordered_map<uint64_t, Order, std::hash<uint64_t>, std::equal_to<uint64_t>, OrderAlloc>
+            orders_{OrderAlloc{node_pool_}};
 
-        // order_id -> Order (for O(1) cancel/modify)
-        std::unordered_map<uint64_t, Order> orders_;
+        // levels the last on_event() touched: an event changes at most three
+        // (a reused id at a new price: cancel + join; a modify: leave + join)
+        Effect   effect_;
+        LevelRef touched_[3] = {};
+        uint8_t n_touched_ = 0;
+        bool    cleared_ = false;
+        void touch(Side s, int64_t px)
+        {
+            for (uint8_t i = 0; i < n_touched_; ++i)
+                if (touched_[i].side == s && touched_[i].price == px) return;
+            if (n_touched_ < 3) touched_[n_touched_++] = {s, px};
+            else cleared_ = true;   // cannot happen; be conservative
+        }
 
-        static std::map<int64_t, std::deque<uint64_t>, std::greater<int64_t>>& side_map(Side s, const OrderBook* self);
-        static std::map<int64_t, std::deque<uint64_t>, std::greater<int64_t>>& bids_map(const OrderBook* self);
-        static std::map<int64_t, std::deque<uint64_t>, std::less<int64_t>>& asks_map(const OrderBook* self);
+        static BidLevels& side_map(Side s, const OrderBook* self);
+        static BidLevels& bids_map(const OrderBook* self);
+        static AskLevels& asks_map(const OrderBook* self);
 
         void add_order(uint64_t id, Side s, int64_t px, int32_t qty);
         void cancel_order(uint64_t id);
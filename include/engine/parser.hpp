@@ -0,0 +1,19 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace engine
+{
+
+    // Optional end-to-end stamp "@<send_wall_ns>," in front of a line. Returns the
+    // offset of the protocol text and sets send_wall_ns (0 when absent or malformed).
+    size_t parse_send_stamp(std::string_view line, uint64_t& send_wall_ns);
+
+    // One protocol line (see EngineApp) starting at `start`. Returns false for
+    // unknown or malformed lines, which the engine ignores. Fields are parsed in
+    // place with from_chars; nothing is copied or allocated.
+    bool parse_event(std::string_view line, size_t start, MboEvent& ev);
+
+} // namespace engine
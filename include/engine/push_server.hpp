@@ -0,0 +1,101 @@
+#pragma once
+#include "engine/response_cache.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace engine
+{
+
+    // Server-sent events of the book, for subscribers that want every change
+    // rather than a poll:
+    //
+    //   GET /stream/top?n=5[&max_hz=20]    event: top     data: <the /book/top?n= body>
+    //   GET /stream/spread[?max_hz=20]     event: spread  data: <the /spread body>
+    //
+    // Each event's id is the book version it shows. The ingest thread does not know
+    // this server exists: it only bumps the ResponseCache version. One push thread
+    // samples that version at each subscriber's max rate and, when it moved, sends
+    // the body from the shared cache (rendered once per version, whatever the number
+    // of subscribers) unless it is the body the subscriber has already: a change
+    // below its n levels sends nothing. Updates are conflated per subscriber: a client
+    // gets the latest state as soon as it is due and its socket has taken the previous
+    // event, never a queue, so a slow reader costs one pending event and skips the
+    // states in between.
+    class PushServer
+    {
+    public:
+        struct Options
+        {
+            int    max_hz = 100;              // cap on ?max_hz=; also the default
+            size_t max_subscribers = 256;
+            int    heartbeat_ms = 15'000;     // comment line on an idle stream
+        };
+
+        // Renders the body for n levels (n = 0: the spread) and the version it shows;
+        // called only on a cache miss.
+        using Render = std::function<std::string(size_t n, uint64_t& version)>;
+
+        struct Stats
+        {
+            std::atomic<uint64_t> subscribers{0};   // streaming now
+            std::atomic<uint64_t> accepted{0};
+            std::atomic<uint64_t> rejected{0};      // bad request or too many subscribers
+            std::atomic<uint64_t> events{0};
+            std::atomic<uint64_t> bytes{0};
+            std::atomic<uint64_t> conflated{0};     // changed bodies a subscriber never saw
+        };
+
+        PushServer(ResponseCache& views, Render render) : views_(views), render_(std::move(render)) {}
+        ~PushServer() { stop(); }
+
+        PushServer(const PushServer&) = delete;
+        PushServer& operator=(const PushServer&) = delete;
+
+        // Listen on host:port (port "0" picks one) and start the push thread.
+        // Throws if the port cannot be bound.
+        void start(const std::string& host, const std::string& port, Options opt);
+        void start(const std::string& host, const std::string& port) { start(host, port, Options{}); }
+        void stop();
+
+        uint16_t port() const { return port_; }
+        const Stats& stats() const { return stats_; }
+
+    private:
+        struct Subscriber
+        {
+            int fd = -1;
+            bool streaming = false;     // request parsed, headers sent
+            std::string request;        // until the blank line
+            size_t slot = 0;            // ResponseCache slot
+            uint64_t interval_ns = 0;
+            uint64_t next_due_ns = 0;
+            uint64_t last_write_ns = 0;
+            uint64_t version = UINT64_MAX;   // last version looked at
+            ResponseCache::Body body;   // last body sent
+            uint64_t changes = 0;       // the slot's change count for it
+            std::string out;            // the pending event, at most one
+            size_t out_pos = 0;
+        };
+
+        void loop();
+        bool on_readable(Subscriber& s);
+        bool start_stream(Subscriber& s);
+        bool flush(Subscriber& s, uint64_t now);
+        void publish(Subscriber& s, uint64_t now);
+
+        ResponseCache& views_;
+        Render render_;
+        Options opt_;
+        int listen_fd_ = -1;
+        uint16_t port_ = 0;
+        std::vector<Subscriber> subs_;   // push thread only
+        std::atomic<bool> stop_{false};
+        std::thread thread_;
+        Stats stats_;
+    };
+
+} // namespace engine
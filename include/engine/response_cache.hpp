@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace engine
+{
+
+    // Versioned, pre-rendered HTTP bodies for the book endpoints (/book/top, /spread).
+    //
+    // The ingest thread bumps the book version with every event that changes the
+    // levels the slots serve, the best kSlots - 1 per side (under the book lock), and
+    // never renders anything. Deeper views (rendered uncached) go by a second
+    // version that moves with every change. A request renders a body only if its
+    // slot holds an older version; every other request for the same slot and version
+    // gets the same immutable string. The version doubles as the ETag, so a client
+    // that already has the current body is answered from one atomic load, and
+    // long-polling clients sleep in wait_newer() until the book changes. Versions
+    // start over with every process, so the ETag also carries a boot epoch: a tag
+    // from before a restart never matches a body rendered after it.
+    class ResponseCache
+    {
+    public:
+        static constexpr size_t kSlots = 65;   // slot 0: /spread, slot n: /book/top?n=n
+
+        using Body = std::shared_ptr<const std::string>;
+
+        struct Stats
+        {
+            std::atomic<uint64_t> hits{0};           // served a body rendered earlier
+            std::atomic<uint64_t> renders{0};
+            std::atomic<uint64_t> not_modified{0};   // 304s
+            std::atomic<uint64_t> long_polls{0};     // requests that had to wait
+            std::atomic<uint64_t> poll_timeouts{0};
+        };
+
+        // Ingest thread, under the book lock: the book changed; top: within the served
+        // levels, else only deep views see it. Returns the new version.
+        uint64_t bump(bool top = true)
+        {
+            deep_version_.fetch_add(1, std::memory_order_seq_cst);
+            if (!top) return version_.load(std::memory_order_relaxed);
+            return version_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        }
+
+        // Ingest thread, after releasing the book lock: wake long-polls, if any.
+        void notify()
+        {
+            if (waiters_.load(std::memory_order_seq_cst) == 0) return;
+            {
+                std::lock_guard<std::mutex> lg(wait_mtx_);
+            }
+            wait_cv_.notify_all();
+        }
+
+        // deep: the version of views deeper than the slots.
+        uint64_t version(bool deep = false) const
+        {
+            return (deep ? deep_version_ : version_).load(std::memory_order_acquire);
+        }
+
+        // Block until version(deep) > since or timeout_ms passes; returns version(deep).
+        uint64_t wait_newer(uint64_t since, int timeout_ms, bool deep = false);
+
+        // Body for `slot` at the current version (or a newer one). On a miss, calls
+        // render(version) -> std::string, which must read the book and the version
+        // it renders under the book lock; concurrent misses on a slot render once.
+        // A render with the same text as the slot's last body keeps that Body, so an
+        // unchanged view has the same pointer; *changes (if given) counts the renders
+        // whose text did change.
+        template <class Render>
+        Body get(size_t slot, Render&& render, uint64_t& version, uint64_t* changes = nullptr)
+        {
+            Slot& s = slots_[slot];
+            const uint64_t want = this->version();
+            std::lock_guard<std::mutex> lg(s.mtx);
+            if (s.body && s.version >= want)
+            {
+                stats_.hits.fetch_add(1, std::memory_order_relaxed);
+                version = s.version;
+                if (changes) *changes = s.changes;
+                return s.body;
+            }
+            uint64_t v = 0;
+            std::string body = render(v);
+            if (!s.body || *s.body != body)
+            {
+                s.body = std::make_shared<const std::string>(std::move(body));
+                ++s.changes;
+            }
+            s.version = v;
+            stats_.renders.fetch_add(1, std::memory_order_relaxed);
+            version = v;
+            if (changes) *changes = s.changes;
+            return s.body;
+        }
+
+        // ETag for a version, "<boot epoch>-<version>", and whether an If-None-Match
+        // value matches it (both parts).
+        static std::string etag(uint64_t version);
+        static bool etag_matches(const std::string& if_none_match, uint64_t version);
+        // wall clock (ns) at process start
+        static uint64_t boot_epoch();
+
+        Stats& stats() { return stats_; }
+        const Stats& stats() const { return stats_; }
+
+    private:
+        struct Slot
+        {
+            std::mutex mtx;
+            uint64_t version = 0;
+            Body body;
+            uint64_t changes = 0;   // renders that changed the text
+        };
+
+        alignas(64) std::atomic<uint64_t> version_{0};
+        std::atomic<uint64_t> deep_version_{0};
+        alignas(64) std::atomic<uint32_t> waiters_{0};
+        std::mutex wait_mtx_;
+        std::condition_variable wait_cv_;
+        Slot slots_[kSlots];
+        Stats stats_;
+    };
+
+} // namespace engine
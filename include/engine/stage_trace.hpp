@@ -0,0 +1,70 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include "common/hdr_histogram.hpp"
+#include "common/tsc_clock.hpp"
+#include <memory>
+#include <ostream>
+
+// Per-stage event tracing (compile-time switch).
+//
+// Built with ENGINE_STAGE_TRACING (CMake option of the same name) the ingest path
+// stamps every event with TscClock between stages and records the deltas into
+// per-stage x EventKind histograms, served at /stats/stages. Without it the
+// STAGE_* macros expand to nothing.
+//   STAGE_STAMP(t)   declare t = now
+//   STAGE_VAR(t)     declare t for a later STAGE_MARK(t) in an inner scope
+#ifdef ENGINE_STAGE_TRACING
+  #define STAGE_STAMP(var) const uint64_t var = ::metrics::TscClock::now()
+  #define STAGE_VAR(var)   uint64_t var = 0
+  #define STAGE_MARK(var)  var = ::metrics::TscClock::now()
+  #define STAGE_RECORD(tracer, stage, kind, from, to) (tracer).record((stage), (kind), (to) - (from))
+#else
+  #define STAGE_STAMP(var) ((void)0)
+  #define STAGE_VAR(var)   ((void)0)
+  #define STAGE_MARK(var)  ((void)0)
+  #define STAGE_RECORD(tracer, stage, kind, from, to) ((void)0)
+#endif
+
+namespace engine
+{
+
+    enum class Stage : uint8_t
+    {
+        Recv,     // ByteSource::read() that returned a chunk (per chunk, not per event)
+        Frame,    // previous line published (or chunk received, for its first line) -> line framed
+        Parse,    // stamp + protocol fields -> MboEvent
+        Lock,     // waiting for the book mutex
+        Apply,    // OrderBook::on_event
+        Publish,  // everything after apply: snapshots, latency histograms, CSV metrics
+        Total,    // start of Frame -> publish done
+        Count
+    };
+
+    const char* stage_name(Stage s);
+
+    class StageTracer
+    {
+    public:
+        static constexpr int kStages = static_cast<int>(Stage::Count);
+        static constexpr int kKinds  = 5;   // EventKind values
+
+        StageTracer();
+
+        // Single writer (the ingest thread).
+        void record(Stage s, EventKind k, uint64_t ticks)
+        {
+            hist_[static_cast<int>(s) * kKinds + static_cast<int>(k)]->record(metrics::TscClock::to_ns(ticks));
+        }
+
+        // Stage::Recv has no event kind: one sample per chunk, dumped as kind=CHUNK.
+        void record_recv(uint64_t ticks) { recv_->record(metrics::TscClock::to_ns(ticks)); }
+
+        // One line per stage x kind with samples, plus an all-kinds line per stage.
+        void dump(std::ostream& os) const;
+
+    private:
+        std::unique_ptr<metrics::HdrRecorder> hist_[kStages * kKinds];
+        std::unique_ptr<metrics::HdrRecorder> recv_;
+    };
+
+} // namespace engine
@@ -0,0 +1,78 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace engine
+{
+
+    // Point-in-time book queries over a recorded feed file ("what did the book look
+    // like at 14:30:00.123456?").
+    //
+    // build() replays the feed once and writes a sidecar index: book checkpoints
+    // (the checkpoint.hpp image format) every `every_events` events and/or every
+    // `every_ns` of feed time, plus a table of (feed ts, feed offset) per checkpoint.
+    // book_at() restores the last checkpoint at or before the requested time and
+    // replays only the lines after it, so a query costs at most one interval of
+    // replay however long the file is. Both files are mmapped read-only.
+    class TimeIndex
+    {
+    public:
+        struct Options
+        {
+            uint64_t every_events = 100'000;   // 0 = by time only
+            uint64_t every_ns = 0;             // feed time between checkpoints, 0 = by count only
+        };
+
+        struct Entry
+        {
+            uint64_t ts_ns;          // feed ts of the last event in the checkpoint (0 for the start)
+            uint64_t feed_offset;    // first byte after it, at a line boundary
+            uint64_t lines;
+            uint64_t image_offset;   // checkpoint image in the index file
+            uint64_t image_size;
+        };
+
+        struct Result
+        {
+            uint64_t as_of_ts_ns = 0;   // ts of the last event applied (0: none yet)
+            uint64_t lines = 0;         // feed lines the book reflects
+            uint64_t replayed = 0;      // lines replayed after the checkpoint
+        };
+
+        static std::string default_index_path(const std::string& feed_path) { return feed_path + ".tidx"; }
+
+        // Throws std::runtime_error when the feed cannot be read or the index written.
+        static void build(const std::string& feed_path, const std::string& index_path, const Options& opt);
+
+        // Throws std::runtime_error when either file is missing, the index is corrupt,
+        // or it was built for a different feed (size or fingerprint of the first and
+        // last 64 KB differ).
+        TimeIndex(const std::string& feed_path, const std::string& index_path);
+        ~TimeIndex();
+
+        TimeIndex(const TimeIndex&) = delete;
+        TimeIndex& operator=(const TimeIndex&) = delete;
+
+        // Fill book with the state after the last event whose ts <= ts_ns (feed
+        // timestamps are taken as non-decreasing). Safe to call from several threads.
+        Result book_at(uint64_t ts_ns, OrderBook& book) const;
+
+        const std::vector<Entry>& entries() const { return entries_; }
+        const std::string& feed_path() const { return feed_path_; }
+
+    private:
+        struct Mapping
+        {
+            const char* data = nullptr;
+            size_t size = 0;
+        };
+
+        std::string feed_path_;
+        Mapping feed_;
+        Mapping index_;
+        std::vector<Entry> entries_;
+    };
+
+} // namespace engine
@@ -0,0 +1,174 @@
+#pragma once
+#include "engine/order_book.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace engine
+{
+
+    // Overwriting ring with one writer and any number of readers, none of which
+    // ever blocks the writer. Item i lives in slot i & mask; the slot's version is
+    // 2i+1 while the writer is inside it and 2i+2 once it holds item i, so a reader
+    // copies the item between two loads of the version and knows whether it got
+    // item i whole (seqlock per slot). T must be trivially copyable.
+    template <typename T>
+    class SeqRing
+    {
+    public:
+        explicit SeqRing(size_t capacity)
+        {
+            size_t cap = 1;
+            while (cap < capacity) cap <<= 1;
+            slots_ = std::make_unique<Slot[]>(cap);
+            mask_ = cap - 1;
+        }
+
+        size_t capacity() const { return mask_ + 1; }
+
+        // items pushed so far; items [count - capacity, count) may still be read
+        uint64_t count() const { return count_.load(std::memory_order_acquire); }
+
+        // writer only
+        void push(const T& v)
+        {
+            const uint64_t i = count_.load(std::memory_order_relaxed);
+            Slot& s = slots_[i & mask_];
+            s.version.store(2 * i + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            s.value = v;
+            s.version.store(2 * i + 2, std::memory_order_release);
+            count_.store(i + 1, std::memory_order_release);
+        }
+
+        // false if item i was not pushed yet or has been (or is being) overwritten
+        bool read(uint64_t i, T& out) const
+        {
+            const Slot& s = slots_[i & mask_];
+            const uint64_t v = s.version.load(std::memory_order_acquire);
+            if (v != 2 * i + 2) return false;
+            out = s.value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return s.version.load(std::memory_order_relaxed) == v;
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint64_t> version{0};
+            T value{};
+        };
+        std::unique_ptr<Slot[]> slots_;
+        size_t mask_ = 0;
+        alignas(64) std::atomic<uint64_t> count_{0};
+    };
+
+    // Trade tape and OHLCV bars built from TRD events.
+    //
+    // The ingest thread calls on_event() after every book.on_event(): an applied
+    // Trade becomes a Print (the resting order's price and the filled qty; the
+    // aggressor is the other side) in a SeqRing of recent prints, and goes into the
+    // open bar of every interval. Bars are aligned to multiples of the interval in
+    // feed time; a bar closes when an event at or past its end arrives, and is
+    // pushed to that interval's SeqRing of closed bars. Intervals without a print
+    // have no bar. Events older than the newest one seen count at the newest time.
+    //
+    // Everything readers need is published through seqlocks (the rings, and one
+    // slot per interval for the open bar), so HTTP handlers and the CSV writer read
+    // it from any thread without taking the book lock.
+    class TradeTape
+    {
+    public:
+        static constexpr size_t kMaxIntervals = 8;
+
+        struct Options
+        {
+            size_t prints = 4096;                                          // recent prints kept
+            std::vector<uint64_t> intervals_ns = {1'000'000'000, 60'000'000'000};
+            size_t bars = 1024;                                            // closed bars kept per interval
+        };
+
+        struct Print
+        {
+            uint64_t ts_ns = 0;
+            int64_t  price = 0;
+            int64_t  qty = 0;
+            uint64_t order_id = 0;        // the resting order
+            Side     aggressor = Side::Bid;   // Bid: a buyer lifted the offer
+        };
+
+        struct Bar
+        {
+            uint64_t start_ns = 0;
+            int64_t  open = 0, high = 0, low = 0, close = 0;
+            int64_t  volume = 0;
+            uint64_t trades = 0;
+            double   notional = 0;        // sum of price * qty
+
+            double vwap() const { return volume > 0 ? notional / static_cast<double>(volume) : NAN; }
+        };
+
+        TradeTape() : TradeTape(Options{}) {}
+        explicit TradeTape(Options opt);
+
+        TradeTape(const TradeTape&) = delete;
+        TradeTape& operator=(const TradeTape&) = delete;
+
+        // "250ms", "1s", "5m", "1h" (a bare number is seconds) to ns; 0 if malformed
+        // or too long for a uint64_t of ns.
+        static uint64_t parse_interval(const std::string& s);
+        // The reverse, in the largest unit that divides ns evenly.
+        static std::string interval_name(uint64_t ns);
+
+        // Ingest thread only, after book.on_event(ev).
+        void on_event(const OrderBook& book, const MboEvent& ev);
+
+        // --- any thread ---
+
+        uint64_t prints() const { return prints_.count(); }
+
+        // The last n prints, newest first; fewer if they were overwritten meanwhile.
+        size_t recent(size_t n, std::vector<Print>& out) const;
+
+        size_t intervals() const { return series_.size(); }
+        uint64_t interval_ns(size_t i) const { return series_[i]->ns; }
+
+        // Closed bars of interval i are numbered from 0 in the order they closed.
+        uint64_t closed_bars(size_t i) const { return series_[i]->closed.count(); }
+        size_t bar_capacity() const { return series_.empty() ? 0 : series_[0]->closed.capacity(); }
+        bool closed_bar(size_t i, uint64_t k, Bar& out) const { return series_[i]->closed.read(k, out); }
+
+        // The last n closed bars of interval i, oldest first.
+        size_t bars(size_t i, size_t n, std::vector<Bar>& out) const;
+
+        // The bar of interval i still taking prints; false if there is none.
+        bool open_bar(size_t i, Bar& out) const;
+
+    private:
+        struct Series
+        {
+            explicit Series(uint64_t ns_, size_t bars) : ns(ns_), closed(bars) {}
+
+            const uint64_t ns;
+            SeqRing<Bar> closed;
+
+            // the open bar: written by the ingest thread, published under `version`
+            alignas(64) std::atomic<uint64_t> version{0};   // odd while written
+            Bar open{};                                     // trades 0: none
+        };
+
+        SeqRing<Print> prints_;
+        std::vector<std::unique_ptr<Series>> series_;
+
+        // ingest thread
+        uint64_t now_ns_ = 0;              // newest feed ts seen
+        uint64_t next_close_ns_ = UINT64_MAX;
+
+        void publish_open(Series& s, const Bar& b);
+        void close_due();
+    };
+
+} // namespace engine
@@ -0,0 +1,75 @@
+#pragma once
+#include "engine/byte_source.hpp"
+#include "common/feed_packet.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace engine
+{
+
+    // Single-writer counter update for the UDP readers' stats (readers load relaxed).
+    inline void bump(std::atomic<uint64_t>& c, uint64_t n = 1)
+    {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // kBatch preallocated datagram slots, filled by one recvmmsg and consumed in order.
+    struct DatagramBatch
+    {
+        static constexpr int    kBatch     = 64;
+        static constexpr size_t kSlotBytes = 2048;
+
+        std::vector<char> slots;
+        void*  ptrs[kBatch];
+        size_t lens[kBatch];
+        int count = 0;   // datagrams received
+        int next = 0;    // first one not consumed yet
+
+        DatagramBatch();
+        // Receive what is queued without waiting; returns the datagram count (0: none).
+        int receive(int fd);
+        bool done() const { return next >= count; }
+        size_t pending_payload() const;   // payload bytes of the unconsumed datagrams
+    };
+
+    // Sequenced udp:// packets (common/feed_packet.hpp) from a joined multicast
+    // socket (not owned). Each wakeup receives up to DatagramBatch::kBatch datagrams
+    // with one recvmmsg into preallocated slots; read() then hands out the payloads
+    // of the in-order packets back to back (whole lines). Late packets are dropped,
+    // gaps are counted, and a sender restart (seq back at the start) begins a new
+    // session. read() returns 0 at an end-of-session packet.
+    class UdpSource : public ByteSource
+    {
+    public:
+        // Counters for /stats; written by the reading thread only.
+        struct Stats
+        {
+            std::atomic<uint64_t> syscalls{0};    // recvmmsg calls that returned packets
+            std::atomic<uint64_t> packets{0};
+            std::atomic<uint64_t> lines_lost{0};  // lines skipped over by sequence gaps
+            std::atomic<uint64_t> gaps{0};
+            std::atomic<uint64_t> late{0};        // duplicate / reordered packets dropped
+            std::atomic<uint64_t> overlaps{0};    // packets partly seen: only their new lines applied
+            std::atomic<uint64_t> bad{0};         // not a feed packet
+            std::atomic<uint64_t> sessions{0};    // sessions ended (end-of-session packet or restart)
+            std::atomic<uint64_t> restarts{0};    // new sessions without an end-of-session packet
+        };
+
+        explicit UdpSource(int fd, int poll_timeout_ms = 1000) : fd_(fd), timeout_ms_(poll_timeout_ms) {}
+        size_t read(char* buf, size_t cap) override;
+        size_t unread() const override;   // received but not handed out, plus the next queued datagram
+
+        const Stats& stats() const { return stats_; }
+
+    private:
+        int fd_;
+        int timeout_ms_;
+        DatagramBatch batch_;
+        bool end_pending_ = false;
+        feed::SeqTracker seq_;
+        Stats stats_;
+    };
+
+} // namespace engine
@@ -1,15 +1,80 @@
 #pragma once
+#include "common/net.hpp"
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 
 namespace streamer
 {
 
+    // How N connections split the input:
+    //  Same     - every connection replays the whole input
+    //  Slice    - connection i replays the lines that start in the i-th 1/N of the
+    //             file's bytes (it seeks there; nothing is read twice)
+    //  Generate - independent generator streams (gen:<spec> input), each with its own
+    //             seed and disjoint order ids / price bands
+    enum class FanoutMode { Same, Slice, Generate };
+
+    struct FanoutOptions
+    {
+        size_t connections = 1;
+        FanoutMode mode = FanoutMode::Same;
+        std::vector<size_t> lines_per_sec{ 100000 }; // per connection; the last entry repeats
+        uint64_t delay_us = 0;                       // udp:// only: hold every burst this long (a slow line)
+    };
+
+    // Replay of an engine feed capture (cap:<file>[,speed=x][,restamp=0|1]) over
+    // one connection: chunks are sent exactly as captured, spaced by their original
+    // receive gaps divided by speed (speed=0: as fast as possible). With restamp the
+    // "@<send_ns>," prefix of each line is rewritten to the time it is re-sent, so
+    // the engine's e2e latency measures this run rather than the recorded one.
+    struct CaptureReplayOptions
+    {
+        std::string path;
+        double speed = 1.0;
+        bool restamp = true;
+
+        static bool is_spec(const std::string& input) { return input.rfind("cap:", 0) == 0; }
+        static CaptureReplayOptions parse(const std::string& spec);   // throws std::invalid_argument
+
+        // When the chunk received at recv_ns is sent, in ns after the first one
+        // (received at first_ns) was.
+        uint64_t send_offset_ns(uint64_t recv_ns, uint64_t first_ns) const;
+    };
+
+    // Rewrites the "@<digits>," prefix at the start of each line to "@<now_ns>,".
+    // Captured chunks cut lines anywhere, so the state carries across calls.
+    struct Restamper
+    {
+        bool at_line_start = true;
+        bool in_stamp = false;
+
+        void run(const char* in, size_t n, uint64_t now_ns, std::string& out);
+    };
+
+    struct ConnStats
+    {
+        size_t lines = 0;
+        double secs  = 0;
+    };
+
     // Step1:- For now, read a text file containing our simple line protocol and stream to engine.
     // Step2:- I'll replace the source with a DBN reader.
     class Streamer
     {
     public:
         int run(const std::string& host, const std::string& port, const std::string& input_file, size_t lines_per_sec);
+
+        // N connections from N threads, each rate-limited on its own; reports
+        // per-connection and aggregate achieved rates.
+        int run_fanout(const std::string& host, const std::string& port, const std::string& input, const FanoutOptions& opt);
+        // Same over any transport (tcp://, unix://, shm://, udp://); shm:// and udp://
+        // take one connection.
+        int run_fanout(const net::Endpoint& ep, const std::string& input, const FanoutOptions& opt);
+
+        int replay_capture(const std::string& host, const std::string& port, const CaptureReplayOptions& opt);
+        int replay_capture(const net::Endpoint& ep, const CaptureReplayOptions& opt);
     };
 
 } // namespace streamer
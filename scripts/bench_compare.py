@@ -0,0 +1,55 @@
+"""Compare two Google Benchmark JSON files (e.g. bench_book.json from two commits).
+
+Prints per-benchmark time and throughput for both runs and the relative change;
+rows that got slower by more than --threshold percent are flagged.
+
+usage:
+  python scripts/bench_compare.py base.json new.json [--threshold 5]
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    out = {}
+    for b in data.get("benchmarks", []):
+        # with --benchmark_repetitions keep the mean only
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "mean":
+            continue
+        name = b.get("run_name", b["name"])
+        out[name] = b
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("base")
+    ap.add_argument("new")
+    ap.add_argument("--threshold", type=float, default=5.0,
+                    help="flag regressions above this many percent")
+    args = ap.parse_args()
+
+    base, new = load(args.base), load(args.new)
+    regressions = 0
+    print(f"{'benchmark':<48} {'base':>12} {'new':>12} {'unit':>4} {'change':>8}")
+    for name, b in base.items():
+        n = new.get(name)
+        if n is None:
+            continue
+        t0, t1 = b["real_time"], n["real_time"]
+        change = (t1 - t0) / t0 * 100.0 if t0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  <-- slower"
+            regressions += 1
+        print(f"{name:<48} {t0:>12.1f} {t1:>12.1f} {b.get('time_unit', ''):>4} {change:>+7.1f}%{flag}")
+    for name in new.keys() - base.keys():
+        print(f"{name:<48} {'-':>12} {new[name]['real_time']:>12.1f} (new)")
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
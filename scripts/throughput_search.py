@@ -0,0 +1,224 @@
+"""Closed-loop max-sustainable-throughput search.
+
+Runs engine_app + streamer_app locally, ramps the replay rate step by step and
+reads the engine's latency histograms from /stats after every step. The highest
+rate at which both internal and E2E p99 stay under the SLO is reported, together
+with the full throughput/latency curve (JSON, optionally CSV).
+
+Every step uses a fresh engine process so that each point on the curve is
+computed from its own histogram and an empty book.
+
+usage:
+  python scripts/throughput_search.py --engine build/bin/engine_app \
+      --streamer build/bin/streamer_app --input data/CLX5_lines.txt \
+      --start 50000 --step 50000 --max 2000000 \
+      --slo-internal-us 20 --slo-e2e-us 20000 --out curve.json
+"""
+import argparse
+import csv
+import json
+import re
+import subprocess
+import sys
+import time
+import urllib.request
+from pathlib import Path
+
+STATS_LINE = re.compile(r"^\[(?P<tag>[^\]]+)\]\s*(?P<body>.*)$")
+KV = re.compile(r"([A-Za-z0-9_.]+)=([-0-9.]+)")
+
+
+def parse_stats(text):
+    """Parse /stats text into {tag: {key: float}}; values are converted to µs."""
+    out = {}
+    for raw in text.splitlines():
+        m = STATS_LINE.match(raw.strip())
+        if not m:
+            continue
+        tag = m.group("tag")
+        scale = 1e-3 if tag.startswith("latency_ns") else 1.0
+        vals = {}
+        for k, v in KV.findall(m.group("body")):
+            f = float(v)
+            vals[k] = f if k in ("samples", "bin") else f * scale
+        out[tag] = vals
+    return out
+
+
+def find_latency(stats, kind):
+    # "internal" / "e2e" - match regardless of the unit suffix in the tag
+    for tag, vals in stats.items():
+        if tag.startswith("latency") and tag.endswith(kind):
+            return vals
+    return {}
+
+
+def http_get(port, path, timeout=1.0):
+    with urllib.request.urlopen(f"http://127.0.0.1:{port}{path}", timeout=timeout) as r:
+        return r.read().decode("utf-8", "replace")
+
+
+def wait_http(port, timeout_s):
+    deadline = time.time() + timeout_s
+    while time.time() < deadline:
+        try:
+            http_get(port, "/health", timeout=0.2)
+            return True
+        except Exception:
+            time.sleep(0.05)
+    return False
+
+
+def wait_drained(port, expect, timeout_s):
+    """Poll /stats until the engine has applied `expect` events or stops moving."""
+    deadline = time.time() + timeout_s
+    last, last_change = -1, time.time()
+    stats = {}
+    while time.time() < deadline:
+        stats = parse_stats(http_get(port, "/stats"))
+        n = int(find_latency(stats, "internal").get("samples", 0))
+        if n >= expect:
+            break
+        if n != last:
+            last, last_change = n, time.time()
+        elif time.time() - last_change > 1.0:
+            break
+        time.sleep(0.05)
+    return stats
+
+
+def run_step(args, rate):
+    eng = subprocess.Popen(
+        [args.engine, args.port, "5"],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        if not wait_http(args.http_port, 5.0):
+            raise RuntimeError("engine did not come up")
+        t0 = time.time()
+        st = subprocess.run(
+            [args.streamer, args.port, args.input, str(rate)],
+            capture_output=True, text=True, timeout=args.step_timeout)
+        elapsed = time.time() - t0
+        m = re.search(r"lines sent: (\d+)", st.stdout)
+        sent = int(m.group(1)) if m else 0
+        m = re.search(r"\((\d+) lines/sec\)", st.stdout)
+        achieved = int(m.group(1)) if m else int(sent / elapsed) if elapsed > 0 else 0
+
+        stats = wait_drained(args.http_port, sent, args.step_timeout)
+        internal = find_latency(stats, "internal")
+        e2e = find_latency(stats, "e2e")
+        row = {
+            "target_rate": rate,
+            "achieved_rate": achieved,
+            "lines_sent": sent,
+            "samples": int(internal.get("samples", 0)),
+        }
+        for name, vals in (("internal", internal), ("e2e", e2e)):
+            for q in ("mean", "p50", "p95", "p99", "p99.9", "max"):
+                if q in vals:
+                    row[f"{name}_{q}_us"] = vals[q]
+        row["pass"] = (
+            sent > 0
+            and row["samples"] >= sent
+            and row.get("internal_p99_us", float("inf")) <= args.slo_internal_us
+            and row.get("e2e_p99_us", float("inf")) <= args.slo_e2e_us
+            and achieved >= rate * args.min_achieved
+        )
+        return row
+    finally:
+        eng.terminate()
+        try:
+            eng.wait(timeout=2.0)
+        except subprocess.TimeoutExpired:
+            eng.kill()
+            eng.wait()
+
+
+def print_row(row):
+    print(f"rate={row['target_rate']:>9} achieved={row['achieved_rate']:>9}"
+          f" int_p99={row.get('internal_p99_us', -1):>9.2f}us"
+          f" e2e_p99={row.get('e2e_p99_us', -1):>10.1f}us"
+          f" -> {'PASS' if row['pass'] else 'FAIL'}", flush=True)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--engine", default="build/bin/engine_app")
+    ap.add_argument("--streamer", default="build/bin/streamer_app")
+    ap.add_argument("--input", default="data/CLX5_lines.txt")
+    ap.add_argument("--port", default="9001")
+    ap.add_argument("--http-port", type=int, default=18081)
+    ap.add_argument("--start", type=int, default=50000)
+    ap.add_argument("--step", type=int, default=50000)
+    ap.add_argument("--max", type=int, default=2000000)
+    ap.add_argument("--refine", type=int, default=3,
+                    help="bisection steps between last PASS and first FAIL")
+    ap.add_argument("--fail-streak", type=int, default=2,
+                    help="stop ramping after this many consecutive FAILs")
+    ap.add_argument("--slo-internal-us", type=float, default=20.0)
+    ap.add_argument("--slo-e2e-us", type=float, default=20000.0)
+    ap.add_argument("--min-achieved", type=float, default=0.9,
+                    help="fraction of the target rate the streamer must reach")
+    ap.add_argument("--step-timeout", type=float, default=120.0)
+    ap.add_argument("--out", default="throughput_curve.json")
+    ap.add_argument("--csv", default=None)
+    args = ap.parse_args()
+
+    for p in (args.engine, args.streamer, args.input):
+        if not Path(p).exists():
+            print(f"ERROR: not found: {p}")
+            sys.exit(1)
+
+    curve = []
+    best, first_fail, streak = None, None, 0
+    rate = args.start
+    while rate <= args.max and streak < args.fail_streak:
+        row = run_step(args, rate)
+        curve.append(row)
+        print_row(row)
+        if row["pass"]:
+            streak = 0
+            if first_fail is None:
+                best = rate
+        else:
+            streak += 1
+            if first_fail is None:
+                first_fail = rate
+        rate += args.step
+
+    # bisect between the last passing rate and the first failing one
+    lo, hi = best, first_fail
+    for _ in range(args.refine if lo is not None and hi is not None else 0):
+        mid = (lo + hi) // 2
+        if mid in (lo, hi):
+            break
+        row = run_step(args, mid)
+        curve.append(row)
+        print_row(row)
+        if row["pass"]:
+            lo = mid
+        else:
+            hi = mid
+    if lo is not None:
+        best = lo
+
+    curve.sort(key=lambda r: r["target_rate"])
+    result = {
+        "input": args.input,
+        "slo": {"internal_p99_us": args.slo_internal_us, "e2e_p99_us": args.slo_e2e_us},
+        "max_sustainable_rate": best,
+        "curve": curve,
+    }
+    Path(args.out).write_text(json.dumps(result, indent=2))
+    if args.csv:
+        keys = sorted({k for r in curve for k in r}, key=lambda k: (k != "target_rate", k))
+        with open(args.csv, "w", newline="") as f:
+            w = csv.DictWriter(f, fieldnames=keys)
+            w.writeheader()
+            w.writerows(curve)
+
+    print(f"max sustainable rate: {best} lines/sec -> {args.out}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,286 @@
+#include "common/alloc_tracking.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+  #include <dlfcn.h>
+  #include <cxxabi.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace
+{
+
+    using alloc_tracking::kMaxThreads;
+    using alloc_tracking::kSizeBuckets;
+
+    // One per thread; only the owning thread writes, /stats reads with relaxed loads.
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> tid{0};
+        std::atomic<uint64_t> allocs{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> by_size[kSizeBuckets]{};
+    };
+
+    Slot g_slots[kMaxThreads];
+    Slot g_overflow;                       // threads beyond kMaxThreads share this one
+    std::atomic<int> g_used{0};
+
+    thread_local Slot*    tl_slot = nullptr;
+    thread_local uint32_t tl_sample_countdown = 0;
+
+    // call-site sampling: open-addressed table of return addresses
+    constexpr size_t kSites = 1024;
+    struct Site
+    {
+        std::atomic<uintptr_t> addr{0};
+        std::atomic<uint64_t>  count{0};
+    };
+    Site g_sites[kSites];
+    std::atomic<uint32_t> g_sample_every{0};
+
+    struct EnvInit
+    {
+        EnvInit()
+        {
+            if (const char* s = std::getenv("ENGINE_ALLOC_SAMPLE"))
+                g_sample_every.store(static_cast<uint32_t>(std::strtoul(s, nullptr, 10)), std::memory_order_relaxed);
+        }
+    } g_env_init;
+
+    uint64_t os_tid()
+    {
+        #ifdef __linux__
+        return static_cast<uint64_t>(::syscall(SYS_gettid));
+        #else
+        return 0;
+        #endif
+    }
+
+    Slot* slot()
+    {
+        if (tl_slot) return tl_slot;
+        int i = g_used.fetch_add(1, std::memory_order_relaxed);
+        tl_slot = (i < kMaxThreads) ? &g_slots[i] : &g_overflow;
+        tl_slot->tid.store(os_tid(), std::memory_order_relaxed);
+        return tl_slot;
+    }
+
+    inline void bump(std::atomic<uint64_t>& c, uint64_t v)
+    {
+        // single writer per slot: a plain load+store is enough (the overflow slot
+        // is shared and may lose counts, which only matters past kMaxThreads)
+        c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    inline int size_bucket(size_t n)
+    {
+        if (n <= 1) return 0;
+        int b = 64 - __builtin_clzll(static_cast<unsigned long long>(n - 1));
+        return b < kSizeBuckets ? b : kSizeBuckets - 1;
+    }
+
+    void sample_site(uintptr_t addr)
+    {
+        size_t h = (addr * 0x9E3779B97F4A7C15ull) >> 54;   // 10 bits
+        for (size_t probe = 0; probe < kSites; ++probe)
+        {
+            Site& s = g_sites[(h + probe) & (kSites - 1)];
+            uintptr_t cur = s.addr.load(std::memory_order_relaxed);
+            if (cur == 0 && s.addr.compare_exchange_strong(cur, addr, std::memory_order_relaxed))
+                cur = addr;
+            if (cur == addr)
+            {
+                s.count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    inline void on_alloc(size_t n, void* caller)
+    {
+        Slot* s = slot();
+        bump(s->allocs, 1);
+        bump(s->bytes, n);
+        bump(s->by_size[size_bucket(n)], 1);
+
+        uint32_t every = g_sample_every.load(std::memory_order_relaxed);
+        if (every != 0 && ++tl_sample_countdown >= every)
+        {
+            tl_sample_countdown = 0;
+            sample_site(reinterpret_cast<uintptr_t>(caller));
+        }
+    }
+
+    inline void on_free(void* p)
+    {
+        if (p) bump(slot()->frees, 1);
+    }
+
+    void* counted_new(size_t n, void* caller)
+    {
+        on_alloc(n, caller);
+        for (;;)
+        {
+            if (void* p = std::malloc(n ? n : 1)) return p;
+            std::new_handler h = std::get_new_handler();
+            if (!h) throw std::bad_alloc();
+            h();
+        }
+    }
+
+    void* counted_new_aligned(size_t n, std::align_val_t al, void* caller)
+    {
+        on_alloc(n, caller);
+        size_t a = static_cast<size_t>(al);
+        size_t rounded = (n + a - 1) / a * a;   // aligned_alloc wants a multiple
+        for (;;)
+        {
+            if (void* p = std::aligned_alloc(a, rounded ? rounded : a)) return p;
+            std::new_handler h = std::get_new_handler();
+            if (!h) throw std::bad_alloc();
+            h();
+        }
+    }
+
+    void counted_delete(void* p)
+    {
+        on_free(p);
+        std::free(p);
+    }
+
+    alloc_tracking::ThreadStats read(const Slot& s)
+    {
+        alloc_tracking::ThreadStats t;
+        t.tid    = s.tid.load(std::memory_order_relaxed);
+        t.allocs = s.allocs.load(std::memory_order_relaxed);
+        t.frees  = s.frees.load(std::memory_order_relaxed);
+        t.bytes  = s.bytes.load(std::memory_order_relaxed);
+        for (int b = 0; b < kSizeBuckets; ++b) t.by_size[b] = s.by_size[b].load(std::memory_order_relaxed);
+        return t;
+    }
+
+} // namespace
+
+namespace alloc_tracking
+{
+
+    ThreadStats this_thread() { return read(*slot()); }
+
+    int all_threads(ThreadStats* out, int cap)
+    {
+        int n = std::min({g_used.load(std::memory_order_relaxed), kMaxThreads, cap});
+        for (int i = 0; i < n; ++i) out[i] = read(g_slots[i]);
+        return n;
+    }
+
+    void set_sample_every(uint32_t n) { g_sample_every.store(n, std::memory_order_relaxed); }
+
+    void dump(std::ostream& os, int top_sites)
+    {
+        ThreadStats ts[kMaxThreads];
+        int n = all_threads(ts, kMaxThreads);
+        for (int i = 0; i < n; ++i)
+        {
+            os << "[alloc_thread] tid=" << ts[i].tid
+               << " allocs=" << ts[i].allocs
+               << " frees="  << ts[i].frees
+               << " bytes="  << ts[i].bytes
+               << " live="   << (int64_t)(ts[i].allocs - ts[i].frees) << "\n";
+        }
+
+        // size profile over all threads, only non-empty buckets
+        uint64_t by_size[kSizeBuckets] = {};
+        for (int i = 0; i < n; ++i)
+            for (int b = 0; b < kSizeBuckets; ++b) by_size[b] += ts[i].by_size[b];
+        os << "[alloc_sizes]";
+        for (int b = 0; b < kSizeBuckets; ++b)
+            if (by_size[b]) os << " <=" << (uint64_t(1) << b) << ":" << by_size[b];
+        os << "\n";
+
+        uint32_t every = g_sample_every.load(std::memory_order_relaxed);
+        if (every == 0 || top_sites <= 0) return;
+
+        std::vector<std::pair<uint64_t, uintptr_t>> sites;
+        for (auto& s : g_sites)
+        {
+            uintptr_t a = s.addr.load(std::memory_order_relaxed);
+            if (a) sites.emplace_back(s.count.load(std::memory_order_relaxed), a);
+        }
+        std::sort(sites.rbegin(), sites.rend());
+        if (sites.size() > (size_t)top_sites) sites.resize(top_sites);
+        for (auto& [count, addr] : sites)
+        {
+            os << "[alloc_site] samples=" << count << " est_allocs=" << count * every;
+            #ifdef __linux__
+            Dl_info info{};
+            if (::dladdr(reinterpret_cast<void*>(addr), &info) && info.dli_fname)
+            {
+                // offset inside the module: addr2line -f -C -e <module> <offset>
+                os << " module=" << info.dli_fname << " offset=0x" << std::hex
+                   << (addr - reinterpret_cast<uintptr_t>(info.dli_fbase)) << std::dec;
+                if (info.dli_sname)
+                {
+                    int status = 0;
+                    char* dem = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                    os << " fn=" << (status == 0 && dem ? dem : info.dli_sname);
+                    std::free(dem);
+                }
+            }
+            else
+            #endif
+            {
+                os << " addr=0x" << std::hex << addr << std::dec;
+            }
+            os << "\n";
+        }
+    }
+
+} // namespace alloc_tracking
+
+// ---- global operator new/delete replacements ----
+
+void* operator new(size_t n)   { return counted_new(n, __builtin_return_address(0)); }
+void* operator new[](size_t n) { return counted_new(n, __builtin_return_address(0)); }
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept
+{
+    try { return counted_new(n, __builtin_return_address(0)); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t n, const std::nothrow_t&) noexcept
+{
+    try { return counted_new(n, __builtin_return_address(0)); } catch (...) { return nullptr; }
+}
+
+void* operator new(size_t n, std::align_val_t al)   { return counted_new_aligned(n, al, __builtin_return_address(0)); }
+void* operator new[](size_t n, std::align_val_t al) { return counted_new_aligned(n, al, __builtin_return_address(0)); }
+
+void* operator new(size_t n, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    try { return counted_new_aligned(n, al, __builtin_return_address(0)); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t n, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    try { return counted_new_aligned(n, al, __builtin_return_address(0)); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept                                  { counted_delete(p); }
+void operator delete[](void* p) noexcept                                { counted_delete(p); }
+void operator delete(void* p, size_t) noexcept                          { counted_delete(p); }
+void operator delete[](void* p, size_t) noexcept                        { counted_delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept           { counted_delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept         { counted_delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept                { counted_delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept              { counted_delete(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept        { counted_delete(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept      { counted_delete(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept   { counted_delete(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { counted_delete(p); }
@@ -0,0 +1,303 @@
+#include "common/capture.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef ENGINE_CAPTURE_ZSTD
+  #include <zstd.h>
+#endif
+
+namespace capture
+{
+
+    static size_t round_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+    bool codec_available(Codec c)
+    {
+#ifdef ENGINE_CAPTURE_ZSTD
+        return c == Codec::None || c == Codec::Zstd;
+#else
+        return c == Codec::None;
+#endif
+    }
+
+    Codec parse_codec(const std::string& name)
+    {
+        Codec c;
+        if (name.empty() || name == "none") c = Codec::None;
+        else if (name == "zstd")            c = Codec::Zstd;
+        else throw std::invalid_argument("unknown capture codec: " + name);
+        if (!codec_available(c))
+            throw std::invalid_argument("capture codec " + name + " not built in (configure with -DENGINE_CAPTURE_ZSTD=ON)");
+        return c;
+    }
+
+    // ---- Writer ----
+
+    bool Writer::IndexRing::push(int v)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == slots.size()) return false;
+        slots[h % slots.size()] = v;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Writer::IndexRing::pop(int& v)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        v = slots[t % slots.size()];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    Writer::Writer(const std::string& path, Codec codec, size_t block_bytes, int blocks)
+        : path_(path), codec_(codec), block_bytes_(round_up(std::max(block_bytes, 2 * kAlign), kAlign))
+    {
+        if (!codec_available(codec)) throw std::invalid_argument("capture codec not built in");
+
+#ifdef O_DIRECT
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        direct_ = fd_ >= 0;
+#endif
+        if (fd_ < 0) fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);   // e.g. tmpfs
+        if (fd_ < 0) throw std::runtime_error("cannot create capture file " + path + ": " + std::strerror(errno));
+
+        blocks = std::max(blocks, 2);
+        blocks_.resize(blocks);
+        free_.slots.resize(blocks);
+        full_.slots.resize(blocks);
+        for (int i = 0; i < blocks; ++i)
+        {
+            blocks_[i].data = static_cast<char*>(std::aligned_alloc(kAlign, block_bytes_));
+            if (!blocks_[i].data) throw std::bad_alloc();
+            std::memset(blocks_[i].data, 0, block_bytes_);   // fault the pages in now, not on the hot path
+            if (i > 0) free_.push(i);
+        }
+        cur_ = 0;
+        blocks_[0].used = sizeof(BlockHeader);
+
+#ifdef ENGINE_CAPTURE_ZSTD
+        if (codec_ == Codec::Zstd)
+        {
+            scratch_cap_ = round_up(sizeof(BlockHeader) + ZSTD_compressBound(block_bytes_), kAlign);
+            scratch_ = static_cast<char*>(std::aligned_alloc(kAlign, scratch_cap_));
+            if (!scratch_) throw std::bad_alloc();
+        }
+#endif
+        thread_ = std::thread([this] { write_loop(); });
+    }
+
+    Writer::~Writer()
+    {
+        close();
+        for (auto& b : blocks_) std::free(b.data);
+        std::free(scratch_);
+    }
+
+    bool Writer::next_block()
+    {
+        int idx;
+        if (!free_.pop(idx)) return false;
+        Block& b = blocks_[idx];
+        b.used = sizeof(BlockHeader);
+        b.records = 0;
+        cur_ = idx;
+        return true;
+    }
+
+    bool Writer::append(uint64_t recv_ns, const void* data, size_t n)
+    {
+        const size_t need = sizeof(RecordHeader) + n;
+        if (closed_ || need > block_bytes_ - sizeof(BlockHeader) || (cur_ < 0 && !next_block()))
+        {
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        if (blocks_[cur_].used + need > block_bytes_)
+        {
+            flush();
+            if (!next_block())
+            {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        Block& b = blocks_[cur_];
+        if (b.records == 0) b.first_ns = recv_ns;
+        RecordHeader h{recv_ns, static_cast<uint32_t>(n), 0};
+        std::memcpy(b.data + b.used, &h, sizeof(h));
+        std::memcpy(b.data + b.used + sizeof(h), data, n);
+        b.used += need;
+        ++b.records;
+        records_.store(records_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Writer::flush()
+    {
+        if (cur_ < 0 || blocks_[cur_].records == 0) return;
+        full_.push(cur_);   // never full: it has a slot per block
+        cur_ = -1;
+        wake_.fetch_add(1, std::memory_order_release);
+        wake_.notify_one();
+    }
+
+    void Writer::close()
+    {
+        if (closed_) return;
+        flush();
+        closed_ = true;
+        stop_.store(true, std::memory_order_release);
+        wake_.fetch_add(1, std::memory_order_release);
+        wake_.notify_one();
+        if (thread_.joinable()) thread_.join();
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    void Writer::write_loop()
+    {
+        for (;;)
+        {
+            uint32_t w = wake_.load(std::memory_order_acquire);
+            int idx;
+            while (full_.pop(idx))
+            {
+                write_block(blocks_[idx]);
+                free_.push(idx);
+            }
+            if (stop_.load(std::memory_order_acquire))
+            {
+                while (full_.pop(idx)) write_block(blocks_[idx]);
+                return;
+            }
+            wake_.wait(w, std::memory_order_acquire);
+        }
+    }
+
+    void Writer::write_block(Block& b)
+    {
+        BlockHeader h{};
+        h.magic = kBlockMagic;
+        h.codec = static_cast<uint16_t>(Codec::None);
+        h.raw_len = static_cast<uint32_t>(b.used - sizeof(BlockHeader));
+        h.stored_len = h.raw_len;
+        h.records = b.records;
+        h.first_ns = b.first_ns;
+
+        char* out = b.data;
+#ifdef ENGINE_CAPTURE_ZSTD
+        if (codec_ == Codec::Zstd)
+        {
+            size_t z = ZSTD_compress(scratch_ + sizeof(BlockHeader), scratch_cap_ - sizeof(BlockHeader),
+                                     b.data + sizeof(BlockHeader), h.raw_len, 1);
+            if (!ZSTD_isError(z) && z < h.raw_len)   // incompressible blocks stay raw
+            {
+                h.codec = static_cast<uint16_t>(Codec::Zstd);
+                h.stored_len = static_cast<uint32_t>(z);
+                out = scratch_;
+            }
+        }
+#endif
+        std::memcpy(out, &h, sizeof(h));
+        size_t len = sizeof(BlockHeader) + h.stored_len;
+        size_t padded = round_up(len, kAlign);
+        std::memset(out + len, 0, padded - len);
+
+        size_t done = 0;
+        while (done < padded)
+        {
+            ssize_t r = ::pwrite(fd_, out + done, padded - done, static_cast<off_t>(offset_ + done));
+            if (r > 0)
+            {
+                done += static_cast<size_t>(r);
+                continue;
+            }
+            if (r < 0 && errno == EINTR) continue;
+#ifdef O_DIRECT
+            if (r < 0 && errno == EINVAL && direct_)
+            {
+                // the filesystem accepted O_DIRECT at open but not for this write
+                ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) & ~O_DIRECT);
+                direct_ = false;
+                continue;
+            }
+#endif
+            std::cerr << "[capture] write to " << path_ << " failed: " << std::strerror(errno) << "\n";
+            dropped_.fetch_add(b.records, std::memory_order_relaxed);
+            return;
+        }
+        offset_ += padded;
+        written_.fetch_add(padded, std::memory_order_relaxed);
+    }
+
+    // ---- Reader ----
+
+    bool is_capture(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        uint32_t magic = 0;
+        return in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && magic == kBlockMagic;
+    }
+
+    Reader::Reader(const std::string& path) : in_(path, std::ios::binary)
+    {
+        if (!in_) throw std::runtime_error("cannot open " + path);
+        if (!is_capture(path)) throw std::runtime_error(path + " is not a capture file");
+    }
+
+    bool Reader::load_block()
+    {
+        BlockHeader h;
+        if (!in_.read(reinterpret_cast<char*>(&h), sizeof(h)) || h.magic != kBlockMagic) return false;
+        std::string stored(h.stored_len, '\0');
+        if (!in_.read(stored.data(), h.stored_len)) return false;
+        in_.seekg(static_cast<std::streamoff>(round_up(sizeof(h) + h.stored_len, kAlign) - sizeof(h) - h.stored_len),
+                  std::ios::cur);
+
+        if (h.codec == static_cast<uint16_t>(Codec::None))
+        {
+            payload_ = std::move(stored);
+        }
+#ifdef ENGINE_CAPTURE_ZSTD
+        else if (h.codec == static_cast<uint16_t>(Codec::Zstd))
+        {
+            payload_.assign(h.raw_len, '\0');
+            size_t z = ZSTD_decompress(payload_.data(), h.raw_len, stored.data(), stored.size());
+            if (ZSTD_isError(z) || z != h.raw_len) throw std::runtime_error("corrupt zstd capture block");
+        }
+#endif
+        else
+        {
+            throw std::runtime_error("capture block codec " + std::to_string(h.codec) + " not supported by this build");
+        }
+        pos_ = 0;
+        return true;
+    }
+
+    bool Reader::next(uint64_t& recv_ns, std::string& data)
+    {
+        while (pos_ >= payload_.size())
+        {
+            if (!load_block()) return false;
+        }
+        RecordHeader h;
+        if (pos_ + sizeof(h) > payload_.size()) return false;
+        std::memcpy(&h, payload_.data() + pos_, sizeof(h));
+        if (pos_ + sizeof(h) + h.len > payload_.size()) return false;
+        recv_ns = h.recv_ns;
+        data.assign(payload_.data() + pos_ + sizeof(h), h.len);
+        pos_ += sizeof(h) + h.len;
+        return true;
+    }
+
+} // namespace capture
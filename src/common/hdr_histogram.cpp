@@ -0,0 +1,159 @@
+#include "common/hdr_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace metrics
+{
+
+    HdrLayout::HdrLayout(uint64_t highest_value, int significant_digits)
+        : highest(highest_value), digits(significant_digits)
+    {
+        if (digits < 1 || digits > 5) throw std::invalid_argument("HdrLayout: digits must be in [1,5]");
+        if (highest < 2) throw std::invalid_argument("HdrLayout: highest must be >= 2");
+
+        // single-unit resolution up to 2*10^digits
+        double largest_single_unit = 2.0 * std::pow(10.0, digits);
+        int sub_count_mag = static_cast<int>(std::ceil(std::log2(largest_single_unit)));
+        sub_half_mag = sub_count_mag - 1;
+        sub_half = uint64_t(1) << sub_half_mag;
+        sub_mask = (uint64_t(1) << sub_count_mag) - 1;
+
+        // buckets until sub_bucket_count << (n - 1) exceeds highest
+        uint64_t smallest_untrackable = uint64_t(1) << sub_count_mag;
+        bucket_count = 1;
+        while (smallest_untrackable <= highest)
+        {
+            if (smallest_untrackable > (UINT64_MAX >> 1))
+            {
+                ++bucket_count;
+                break;
+            }
+            smallest_untrackable <<= 1;
+            ++bucket_count;
+        }
+        counts_len = size_t(bucket_count + 1) * sub_half;
+    }
+
+    uint64_t HdrLayout::lowest_at(size_t index) const
+    {
+        int bucket = static_cast<int>(index >> sub_half_mag) - 1;
+        uint64_t sub = (index & (sub_half - 1)) + sub_half;
+        if (bucket < 0)
+        {
+            sub -= sub_half;
+            bucket = 0;
+        }
+        return sub << bucket;
+    }
+
+    uint64_t HdrLayout::highest_at(size_t index) const
+    {
+        int bucket = std::max(0, static_cast<int>(index >> sub_half_mag) - 1);
+        return lowest_at(index) + (uint64_t(1) << bucket) - 1;
+    }
+
+    // ---- HdrHistogram ----
+
+    HdrHistogram::HdrHistogram(uint64_t highest, int digits)
+        : layout_(highest, digits), counts_(layout_.counts_len, 0)
+    {
+    }
+
+    void HdrHistogram::merge(const HdrHistogram& other)
+    {
+        if (other.layout_.highest != layout_.highest || other.layout_.digits != layout_.digits)
+            throw std::invalid_argument("HdrHistogram::merge: layouts differ");
+        for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        sum_   += other.sum_;
+        max_    = std::max(max_, other.max_);
+    }
+
+    void HdrHistogram::reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = sum_ = max_ = 0;
+    }
+
+    uint64_t HdrHistogram::value_at_quantile(double q) const
+    {
+        if (total_ == 0) return 0;
+        q = std::clamp(q, 0.0, 1.0);
+        uint64_t need = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * double(total_))));
+        uint64_t acc = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            acc += counts_[i];
+            if (acc >= need) return std::min(layout_.highest_at(i), max_);
+        }
+        return max_;
+    }
+
+    // ---- HdrRecorder ----
+
+    template <class Count>
+    BasicHdrRecorder<Count>::BasicHdrRecorder(uint64_t highest, int digits)
+        : layout_(highest, digits), counts_(layout_.counts_len)
+    {
+    }
+
+    template <class Count>
+    void BasicHdrRecorder<Count>::snapshot(HdrHistogram& out) const
+    {
+        if (out.layout_.highest != layout_.highest || out.layout_.digits != layout_.digits)
+            out = HdrHistogram(layout_.highest, layout_.digits);
+
+        // samples up to the acquired total are all visible in the counts; newer ones may
+        // be too, so the copy's total is whatever the counts add up to
+        (void)total_.load(std::memory_order_acquire);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            out.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+            seen += out.counts_[i];
+        }
+        out.total_ = seen;
+        out.sum_   = sum_.load(std::memory_order_relaxed);
+        out.max_   = max_.load(std::memory_order_relaxed);
+    }
+
+    template <class Count>
+    void BasicHdrRecorder<Count>::reset()
+    {
+        for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+        total_.store(0, std::memory_order_release);
+    }
+
+    template <class Count>
+    void BasicHdrRecorder<Count>::merge_into(HdrHistogram& out) const
+    {
+        if (out.layout_.highest != layout_.highest || out.layout_.digits != layout_.digits)
+            throw std::invalid_argument("HdrRecorder::merge_into: layouts differ");
+        (void)total_.load(std::memory_order_acquire);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            uint64_t c = counts_[i].load(std::memory_order_relaxed);
+            out.counts_[i] += c;
+            seen += c;
+        }
+        out.total_ += seen;
+        out.sum_   += sum_.load(std::memory_order_relaxed);
+        out.max_    = std::max(out.max_, max_.load(std::memory_order_relaxed));
+    }
+
+    template <class Count>
+    HdrHistogram BasicHdrRecorder<Count>::snapshot() const
+    {
+        HdrHistogram h(layout_.highest, layout_.digits);
+        snapshot(h);
+        return h;
+    }
+
+    template class BasicHdrRecorder<uint32_t>;
+    template class BasicHdrRecorder<uint64_t>;
+
+} // namespace metrics
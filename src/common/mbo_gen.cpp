@@ -0,0 +1,505 @@
+#include "common/mbo_gen.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+    uint64_t splitmix64(uint64_t& x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    inline uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    inline char* put_u64(char* p, uint64_t v)
+    {
+        return std::to_chars(p, p + 20, v).ptr;
+    }
+
+    inline char* put_i64(char* p, int64_t v)
+    {
+        return std::to_chars(p, p + 21, v).ptr;
+    }
+
+} // namespace
+
+namespace synth
+{
+
+    GenConfig GenConfig::parse(std::string_view spec)
+    {
+        GenConfig c;
+        if (spec.substr(0, 4) == "gen:") spec.remove_prefix(4);
+
+        while (!spec.empty())
+        {
+            size_t comma = spec.find(',');
+            std::string_view kv = spec.substr(0, comma);
+            spec = (comma == std::string_view::npos) ? std::string_view{} : spec.substr(comma + 1);
+            if (kv.empty()) continue;
+
+            size_t eq = kv.find('=');
+            if (eq == std::string_view::npos)
+                throw std::invalid_argument("gen spec: expected key=value, got '" + std::string(kv) + "'");
+            std::string key(kv.substr(0, eq));
+            double v = 0;
+            try
+            {
+                v = std::stod(std::string(kv.substr(eq + 1)));
+            }
+            catch (...)
+            {
+                throw std::invalid_argument("gen spec: bad value for '" + key + "'");
+            }
+
+            if      (key == "seed")        c.seed = (uint64_t)v;
+            else if (key == "instruments") c.instruments = std::max<uint32_t>(1, (uint32_t)v);
+            else if (key == "inst0")       c.first_instrument = (uint32_t)v;
+            else if (key == "orders")      c.live_orders = std::max<uint64_t>(1, (uint64_t)v);
+            else if (key == "depth")       c.depth = std::max<uint32_t>(1, (uint32_t)v);
+            else if (key == "vol")         c.volatility = v;
+            else if (key == "decay")       c.level_decay = v;
+            else if (key == "qty")         c.max_qty = std::max<uint32_t>(1, (uint32_t)v);
+            else if (key == "add")         c.add_weight = v;
+            else if (key == "cxl")         c.cancel_weight = v;
+            else if (key == "mod")         c.modify_weight = v;
+            else if (key == "trd")         c.trade_weight = v;
+            else if (key == "modpx")       c.modify_price_prob = v;
+            else if (key == "base")        c.base_price = (int64_t)v;
+            else if (key == "tick")        c.tick = std::max<int64_t>(1, (int64_t)v);
+            else if (key == "spacing")     c.instrument_spacing = (int64_t)v;
+            else if (key == "ts")          c.ts_start_ns = (uint64_t)v;
+            else if (key == "ts_step")     c.ts_step_ns = (uint64_t)v;
+            else if (key == "events")      c.events = (uint64_t)v;
+            else throw std::invalid_argument("gen spec: unknown key '" + key + "'");
+        }
+        return c;
+    }
+
+    MboGenerator::MboGenerator(const GenConfig& cfg)
+        : cfg_(cfg), ts_ns_(cfg.ts_start_ns)
+    {
+        uint64_t s = cfg_.seed;
+        for (auto& r : rng_) r = splitmix64(s);
+        ts_len_ = (uint8_t)(std::to_chars(ts_txt_, ts_txt_ + sizeof(ts_txt_), ts_ns_).ptr - ts_txt_);
+        px_cache_.resize(kPxCache);
+
+        double w[4] = { cfg_.add_weight, cfg_.cancel_weight, cfg_.modify_weight, cfg_.trade_weight };
+        double tot = 0;
+        for (double x : w) tot += std::max(0.0, x);
+        if (tot <= 0) throw std::invalid_argument("gen spec: event weights sum to zero");
+        double acc = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            acc += std::max(0.0, w[i]) / tot;
+            mix_[i] = acc;
+        }
+
+        // geometric distance-from-touch profile, truncated at depth, sampled
+        // through a quantised inverse-CDF table (one lookup per draw)
+        std::vector<double> cdf(cfg_.depth);
+        double sum = 0, p = 1;
+        for (uint32_t k = 0; k < cfg_.depth; ++k) { sum += p; cdf[k] = sum; p *= cfg_.level_decay; }
+        for (auto& x : cdf) x /= sum;
+        level_lut_.resize(kLevelLut);
+        for (size_t j = 0; j < kLevelLut; ++j)
+        {
+            double u = (j + 0.5) / kLevelLut;
+            auto it = std::upper_bound(cdf.begin(), cdf.end(), u);
+            level_lut_[j] = (uint32_t)std::min<size_t>(it - cdf.begin(), cdf.size() - 1);
+        }
+
+        // price ring per side; wide enough that only orders stranded far from
+        // the mid after a long walk can share a bucket with live touch prices
+        uint64_t ring = 1;
+        while (ring < 4ULL * cfg_.depth + 8) ring <<= 1;
+        ring_mask_ = ring - 1;
+
+        inst_.resize(cfg_.instruments);
+        for (uint32_t i = 0; i < cfg_.instruments; ++i)
+        {
+            auto& in = inst_[i];
+            uint64_t id_band = (uint64_t)cfg_.first_instrument + i;
+            in.mid = (int64_t)id_band * cfg_.instrument_spacing;
+            in.next_id = (id_band + 1) << 40;
+            in.next_id_len = (uint8_t)(std::to_chars(in.next_id_txt, in.next_id_txt + sizeof(in.next_id_txt), in.next_id).ptr - in.next_id_txt);
+            in.orders.reserve(cfg_.live_orders + cfg_.live_orders / 8 + 16);
+            in.bids.resize(ring);
+            in.asks.resize(ring);
+        }
+    }
+
+    uint64_t MboGenerator::rand()
+    {
+        // xoshiro256**
+        const uint64_t result = rotl(rng_[1] * 5, 7) * 9;
+        const uint64_t t = rng_[1] << 17;
+        rng_[2] ^= rng_[0];
+        rng_[3] ^= rng_[1];
+        rng_[1] ^= rng_[2];
+        rng_[0] ^= rng_[3];
+        rng_[2] ^= t;
+        rng_[3] = rotl(rng_[3], 45);
+        return result;
+    }
+
+    uint64_t MboGenerator::below(uint64_t n)
+    {
+        // Lemire's multiply-shift range reduction; avoids a 64-bit divide per draw
+    #if defined(__SIZEOF_INT128__)
+        return (uint64_t)(((unsigned __int128)rand() * n) >> 64);
+    #else
+        return rand() % n;
+    #endif
+    }
+
+    double MboGenerator::rand01()
+    {
+        return (double)(rand() >> 11) * 0x1.0p-53;
+    }
+
+    uint32_t MboGenerator::pick_level()
+    {
+        return level_lut_[rand() >> (64 - kLevelLutBits)];
+    }
+
+    uint64_t MboGenerator::live_orders() const
+    {
+        uint64_t n = 0;
+        for (auto& in : inst_) n += in.orders.size();
+        return n;
+    }
+
+    std::vector<uint32_t>& MboGenerator::bucket(Instrument& in, char side, int64_t px)
+    {
+        auto& ring = (side == 'B') ? in.bids : in.asks;
+        return ring[(uint64_t)px & ring_mask_];
+    }
+
+    void MboGenerator::link(Instrument& in, uint32_t slot)
+    {
+        auto& o = in.orders[slot];
+        auto& b = bucket(in, o.side, o.px);
+        o.level_pos = (uint32_t)b.size();
+        b.push_back(slot);
+    }
+
+    void MboGenerator::unlink(Instrument& in, uint32_t slot)
+    {
+        auto& o = in.orders[slot];
+        auto& b = bucket(in, o.side, o.px);
+        uint32_t pos = o.level_pos;
+        uint32_t moved = b.back();
+        b[pos] = moved;
+        in.orders[moved].level_pos = pos;
+        b.pop_back();
+    }
+
+    void MboGenerator::remove(Instrument& in, uint32_t slot)
+    {
+        unlink(in, slot);
+        uint32_t last = (uint32_t)in.orders.size() - 1;
+        if (slot != last)
+        {
+            in.orders[slot] = in.orders[last];
+            auto& o = in.orders[slot];
+            bucket(in, o.side, o.px)[o.level_pos] = slot;
+        }
+        in.orders.pop_back();
+    }
+
+    void MboGenerator::gen_add(uint32_t i, GenEvent& ev)
+    {
+        auto& in = inst_[i];
+        char side = (rand() & 1) ? 'B' : 'A';
+        int64_t k = pick_level();
+        // while the mid is moving, don't replenish the level it is moving through
+        if (k == 0 && ((side == 'A' && in.move_dir > 0) || (side == 'B' && in.move_dir < 0))) k = 1;
+        Order o{};
+        o.id   = in.next_id;
+        o.id_len = in.next_id_len;
+        std::memcpy(o.id_txt, in.next_id_txt, sizeof(o.id_txt));
+        decimal_add(in.next_id_txt, in.next_id_len, ++in.next_id, 1);
+        o.px   = (side == 'B') ? in.mid - 1 - k : in.mid + 1 + k;
+        o.qty  = 1 + (int32_t)(below(cfg_.max_qty));
+        o.side = side;
+        in.orders.push_back(o);
+        link(in, (uint32_t)in.orders.size() - 1);
+
+        ev.kind = 'A'; ev.side = side; ev.order_id = o.id; ev.price = o.px; ev.qty = o.qty;
+        emit_id(o);
+    }
+
+    void MboGenerator::gen_cancel(uint32_t i, GenEvent& ev)
+    {
+        auto& in = inst_[i];
+        uint32_t slot = (uint32_t)(below(in.orders.size()));
+        const Order o = in.orders[slot];
+        remove(in, slot);
+        ev.kind = 'C'; ev.side = o.side; ev.order_id = o.id; ev.price = o.px; ev.qty = 0;
+        emit_id(o);
+    }
+
+    void MboGenerator::gen_modify(uint32_t i, GenEvent& ev)
+    {
+        auto& in = inst_[i];
+        uint32_t slot = (uint32_t)(below(in.orders.size()));
+        if (rand01() < cfg_.modify_price_prob)
+        {
+            unlink(in, slot);
+            auto& o = in.orders[slot];
+            int64_t k = pick_level();
+            if (k == 0 && ((o.side == 'A' && in.move_dir > 0) || (o.side == 'B' && in.move_dir < 0))) k = 1;
+            o.px = (o.side == 'B') ? in.mid - 1 - k : in.mid + 1 + k;
+            link(in, slot);
+        }
+        else
+        {
+            in.orders[slot].qty = 1 + (int32_t)(below(cfg_.max_qty));
+        }
+        const Order& o = in.orders[slot];
+        ev.kind = 'M'; ev.side = o.side; ev.order_id = o.id; ev.price = o.px; ev.qty = o.qty;
+        emit_id(o);
+    }
+
+    int64_t MboGenerator::find_at(Instrument& in, char side, int64_t px)
+    {
+        auto& b = bucket(in, side, px);
+        for (uint32_t slot : b)
+        {
+            if (in.orders[slot].px == px) return slot; // skip ring collisions with stranded orders
+        }
+        return -1;
+    }
+
+    void MboGenerator::gen_trade(uint32_t i, GenEvent& ev)
+    {
+        auto& in = inst_[i];
+
+        // a moving mid trades through the touch on its side with full fills
+        if (in.move_dir != 0)
+        {
+            char side = (in.move_dir > 0) ? 'A' : 'B';
+            int64_t px = in.mid + in.move_dir;
+            int64_t slot = find_at(in, side, px);
+            if (slot >= 0)
+            {
+                const Order o = in.orders[slot];
+                ev.kind = 'T'; ev.side = side; ev.order_id = o.id; ev.price = px; ev.qty = o.qty;
+                emit_id(o);
+                remove(in, (uint32_t)slot);
+                step_mid(in);
+                return;
+            }
+        }
+
+        // otherwise a partial/full fill at the first populated level from the touch
+        char side = (rand() & 1) ? 'B' : 'A';
+        for (int pass = 0; pass < 2; ++pass, side = (side == 'B') ? 'A' : 'B')
+        {
+            for (int64_t k = 0; k < (int64_t)cfg_.depth; ++k)
+            {
+                int64_t px = (side == 'B') ? in.mid - 1 - k : in.mid + 1 + k;
+                int64_t slot = find_at(in, side, px);
+                if (slot < 0) continue;
+                auto& o = in.orders[slot];
+                int32_t fill = 1 + (int32_t)(below((uint64_t)o.qty));
+                ev.kind = 'T'; ev.side = side; ev.order_id = o.id; ev.price = px; ev.qty = fill;
+                emit_id(o);
+                o.qty -= fill;
+                if (o.qty == 0) remove(in, (uint32_t)slot);
+                return;
+            }
+        }
+        gen_add(i, ev); // nothing resting near the touch
+    }
+
+    void MboGenerator::step_mid(Instrument& in)
+    {
+        // the mid only steps once the level it moves onto has no resting orders
+        // on the opposite side, so the book never crosses
+        char side = (in.move_dir > 0) ? 'A' : 'B';
+        if (find_at(in, side, in.mid + in.move_dir) >= 0) return;
+        in.mid += in.move_dir;
+        in.move_dir = 0;
+    }
+
+    void MboGenerator::decimal_add(char* txt, uint8_t& len, uint64_t value, uint64_t dt)
+    {
+        // add in place: sequential ids and the feed clock only change a few low digits,
+        // which is much cheaper than re-formatting 13-19 digits per event
+        if (dt < 1000000)
+        {
+            uint32_t carry = (uint32_t)dt;
+            for (int i = len - 1; i >= 0 && carry; --i)
+            {
+                uint32_t d = (uint32_t)(txt[i] - '0') + carry;
+                txt[i] = (char)('0' + d % 10);
+                carry = d / 10;
+            }
+            if (carry == 0) return;
+        }
+        len = (uint8_t)(std::to_chars(txt, txt + 20, value).ptr - txt); // grew a digit
+    }
+
+    void MboGenerator::emit_id(const Order& o)
+    {
+        std::memcpy(id_txt_, o.id_txt, sizeof(o.id_txt));
+        id_len_ = o.id_len;
+    }
+
+    char* MboGenerator::put_price(char* p, int64_t px)
+    {
+        // prices are multiples of the tick, so hash rather than mask the low bits
+        auto& e = px_cache_[((uint64_t)px * 0x9E3779B97F4A7C15ULL) >> 54];
+        if (e.len == 0 || e.px != px)
+        {
+            e.px  = px;
+            e.len = (uint8_t)(std::to_chars(e.txt, e.txt + sizeof(e.txt), px).ptr - e.txt);
+        }
+        std::memcpy(p, e.txt, sizeof(e.txt));
+        return p + e.len;
+    }
+
+    bool MboGenerator::next(GenEvent& ev)
+    {
+        if (cfg_.events && produced_ >= cfg_.events) return false;
+        uint64_t dt = 1 + (cfg_.ts_step_ns ? below(2 * cfg_.ts_step_ns) : 0);
+        ts_ns_ += dt;
+        decimal_add(ts_txt_, ts_len_, ts_ns_, dt);
+        ++produced_;
+
+        uint32_t i = (uint32_t)(cfg_.instruments > 1 ? below(cfg_.instruments) : 0);
+        auto& in = inst_[i];
+        if (in.move_dir == 0 && !in.orders.empty() && rand01() < cfg_.volatility)
+        {
+            in.move_dir = (rand() & 1) ? 1 : -1;
+            step_mid(in);
+        }
+
+        ev = GenEvent{};
+        ev.instrument = i;
+        size_t live = in.orders.size();
+        if (live < cfg_.live_orders / 2 + 1)
+        {
+            gen_add(i, ev); // (re)building the book
+        }
+        else
+        {
+            double u = rand01();
+            int pick = (u < mix_[0]) ? 0 : (u < mix_[1]) ? 1 : (u < mix_[2]) ? 2 : 3;
+            // steer the live count back towards the target without changing the mix elsewhere
+            if (pick == 0 && live > cfg_.live_orders + cfg_.live_orders / 20) pick = 1;
+            else if (pick == 1 && live < cfg_.live_orders - cfg_.live_orders / 20) pick = 0;
+
+            switch (pick)
+            {
+                case 0: gen_add(i, ev); break;
+                case 1: gen_cancel(i, ev); break;
+                case 2: gen_modify(i, ev); break;
+                default: gen_trade(i, ev); break;
+            }
+        }
+        if (in.move_dir != 0 && ev.kind == 'C') step_mid(in);
+
+        ev.ts_ns = ts_ns_;
+        ev.price = cfg_.base_price + ev.price * cfg_.tick;
+        return true;
+    }
+
+    size_t MboGenerator::format_line(const GenEvent& ev, char* out)
+    {
+        char* p = out;
+        auto put = [&](const char* s, size_t n) { std::memcpy(p, s, n); p += n; };
+        switch (ev.kind)
+        {
+            case 'A':
+                put("ADD,", 4); p = put_u64(p, ev.ts_ns); *p++ = ',';
+                *p++ = ev.side; *p++ = ',';
+                p = put_u64(p, ev.order_id); *p++ = ',';
+                p = put_i64(p, ev.price); *p++ = ',';
+                p = put_i64(p, ev.qty);
+                break;
+            case 'M':
+                put("MOD,", 4); p = put_u64(p, ev.ts_ns); *p++ = ',';
+                p = put_u64(p, ev.order_id); *p++ = ',';
+                p = put_i64(p, ev.price); *p++ = ',';
+                p = put_i64(p, ev.qty);
+                break;
+            case 'C':
+                put("CXL,", 4); p = put_u64(p, ev.ts_ns); *p++ = ',';
+                p = put_u64(p, ev.order_id);
+                break;
+            default:
+                put("TRD,", 4); p = put_u64(p, ev.ts_ns); *p++ = ',';
+                p = put_u64(p, ev.order_id); *p++ = ',';
+                p = put_i64(p, ev.qty);
+                break;
+        }
+        *p++ = '\n';
+        return (size_t)(p - out);
+    }
+
+    size_t MboGenerator::next_line(char* out)
+    {
+        GenEvent ev;
+        if (!next(ev)) return 0;
+
+        // same layout as format_line(), but timestamp, id and price come from
+        // incrementally maintained / cached decimal text
+        char* p = out;
+        // fixed-size copies (out has kMaxLineLen of room), advanced by the real length
+        auto put = [&](const char* s, size_t n) { std::memcpy(p, s, 4); p += n; };
+        auto put_txt = [&](const char* s, size_t n) { std::memcpy(p, s, 24); p += n; };
+        auto put_qty = [&](int32_t q)
+        {
+            if (q >= 0 && q < 10) *p++ = (char)('0' + q);
+            else p = put_i64(p, q);
+        };
+        switch (ev.kind)
+        {
+            case 'A': put("ADD,", 4); break;
+            case 'M': put("MOD,", 4); break;
+            case 'C': put("CXL,", 4); break;
+            default:  put("TRD,", 4); break;
+        }
+        put_txt(ts_txt_, ts_len_); *p++ = ',';
+        if (ev.kind == 'A') { *p++ = ev.side; *p++ = ','; }
+        put_txt(id_txt_, id_len_);
+        if (ev.kind == 'A' || ev.kind == 'M')
+        {
+            *p++ = ','; p = put_price(p, ev.price);
+            *p++ = ','; put_qty(ev.qty);
+        }
+        else if (ev.kind == 'T')
+        {
+            *p++ = ','; put_qty(ev.qty);
+        }
+        *p++ = '\n';
+        return (size_t)(p - out);
+    }
+
+    size_t MboGenerator::fill(char* buf, size_t cap, size_t& lines)
+    {
+        size_t used = 0;
+        while (cap - used >= kMaxLineLen)
+        {
+            size_t n = next_line(buf + used);
+            if (n == 0) break;
+            used += n;
+            ++lines;
+        }
+        return used;
+    }
+
+} // namespace synth
@@ -0,0 +1,166 @@
+#include "common/metrics_registry.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace metrics
+{
+
+    int this_shard()
+    {
+        static std::atomic<int> next{0};
+        thread_local int shard = std::min(next.fetch_add(1, std::memory_order_relaxed), kShards - 1);
+        return shard;
+    }
+
+    uint64_t Counter::value() const
+    {
+        uint64_t v = 0;
+        for (const auto& s : shards_) v += s.v.load(std::memory_order_relaxed);
+        return v;
+    }
+
+    Histogram::Histogram(std::vector<uint64_t> bounds) : bounds_(std::move(bounds))
+    {
+        if (!std::is_sorted(bounds_.begin(), bounds_.end()))
+            throw std::invalid_argument("Histogram: bounds must be ascending");
+        shards_.reserve(kShards);
+        for (int i = 0; i < kShards; ++i) shards_.push_back(std::make_unique<Shard>(bounds_.size() + 1));
+    }
+
+    void Histogram::collect(std::vector<uint64_t>& counts, uint64_t& sum) const
+    {
+        counts.assign(bounds_.size() + 1, 0);
+        sum = 0;
+        for (const auto& sh : shards_)
+        {
+            for (size_t b = 0; b < counts.size(); ++b) counts[b] += sh->counts[b].load(std::memory_order_relaxed);
+            sum += sh->sum.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<uint64_t> latency_bounds_ns()
+    {
+        std::vector<uint64_t> b;
+        for (uint64_t decade = 100; decade < 1'000'000'000ULL; decade *= 10)
+        {
+            if (decade >= 1000) b.push_back(decade);
+            b.push_back(decade * 5 / 2);
+            b.push_back(decade * 5);
+        }
+        b.push_back(1'000'000'000ULL);
+        return b;   // 250, 500, 1000, 2500, ... 500ms, 1s
+    }
+
+    Registry::Metric& Registry::add(const std::string& name, const std::string& help, Type type,
+                                    const std::string& labels)
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        auto it = std::find_if(families_.begin(), families_.end(), [&](const auto& f) { return f->name == name; });
+        if (it == families_.end())
+        {
+            families_.push_back(std::make_unique<Family>(Family{name, help, type, {}}));
+            it = families_.end() - 1;
+        }
+        else if ((*it)->type != type)
+        {
+            throw std::invalid_argument("Registry: " + name + " registered with two types");
+        }
+        auto& metrics = (*it)->metrics;
+        for (const auto& m : metrics)
+            if (m.labels == labels) throw std::invalid_argument("Registry: duplicate " + name + "{" + labels + "}");
+        metrics.push_back(Metric{labels, nullptr, nullptr, nullptr, 1.0});
+        return metrics.back();
+    }
+
+    Counter& Registry::counter(const std::string& name, const std::string& help, const std::string& labels)
+    {
+        Metric& m = add(name, help, Type::Counter, labels);
+        m.counter = std::make_unique<Counter>();
+        return *m.counter;
+    }
+
+    Histogram& Registry::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                                   std::vector<uint64_t> bounds, double scale)
+    {
+        Metric& m = add(name, help, Type::Histogram, labels);
+        m.histogram = std::make_unique<Histogram>(std::move(bounds));
+        m.scale = scale;
+        return *m.histogram;
+    }
+
+    void Registry::gauge(const std::string& name, const std::string& help, const std::string& labels,
+                         std::function<double()> read)
+    {
+        add(name, help, Type::Gauge, labels).gauge = std::move(read);
+    }
+
+    static void series(std::ostream& os, const std::string& name, const std::string& labels,
+                       const std::string& extra = "")
+    {
+        os << name;
+        if (!labels.empty() || !extra.empty())
+        {
+            os << "{" << labels;
+            if (!labels.empty() && !extra.empty()) os << ",";
+            os << extra << "}";
+        }
+        os << " ";
+    }
+
+    void Registry::write(std::ostream& os) const
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        std::ostringstream out;   // own formatting state: full precision, caller's stream untouched
+        out.precision(15);
+        std::vector<uint64_t> counts;
+        for (const auto& f : families_)
+        {
+            static const char* type_names[] = { "counter", "gauge", "histogram" };
+            out << "# HELP " << f->name << " " << f->help << "\n";
+            out << "# TYPE " << f->name << " " << type_names[static_cast<int>(f->type)] << "\n";
+            for (const auto& m : f->metrics)
+            {
+                switch (f->type)
+                {
+                    case Type::Counter:
+                        series(out, f->name, m.labels);
+                        out << m.counter->value() << "\n";
+                        break;
+                    case Type::Gauge:
+                        series(out, f->name, m.labels);
+                        out << m.gauge() << "\n";
+                        break;
+                    case Type::Histogram:
+                    {
+                        uint64_t sum = 0;
+                        m.histogram->collect(counts, sum);
+                        const auto& bounds = m.histogram->bounds();
+                        uint64_t cum = 0;
+                        for (size_t b = 0; b < counts.size(); ++b)
+                        {
+                            cum += counts[b];
+                            std::string le = "+Inf";
+                            if (b < bounds.size())
+                            {
+                                std::ostringstream v;
+                                v.precision(15);
+                                v << double(bounds[b]) * m.scale;
+                                le = v.str();
+                            }
+                            series(out, f->name + "_bucket", m.labels, "le=\"" + le + "\"");
+                            out << cum << "\n";
+                        }
+                        series(out, f->name + "_sum", m.labels);
+                        out << double(sum) * m.scale << "\n";
+                        series(out, f->name + "_count", m.labels);
+                        out << cum << "\n";
+                        break;
+                    }
+                }
+            }
+        }
+        os << out.str();
+    }
+
+} // namespace metrics
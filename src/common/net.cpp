@@ -33,7 +33,12 @@
     #include <sys/epoll.h>
     #include <linux/net_tstamp.h>
     #include <linux/errqueue.h>
+    #include <linux/sockios.h>
   #endif
+  #include <sys/ioctl.h>
+  #include <sys/un.h>
+  #include <netinet/in.h>
+  #include <arpa/inet.h>
 #endif
 
 namespace
@@ -66,6 +71,201 @@ namespace
 namespace net
 {
 
+    Endpoint Endpoint::parse(std::string_view uri, std::string_view default_host)
+    {
+        Endpoint ep;
+        auto sep = uri.find("://");
+        if (sep == std::string_view::npos)
+        {
+            // legacy: bare port, or host:port
+            auto colon = uri.rfind(':');
+            ep.host = colon == std::string_view::npos ? std::string(default_host) : std::string(uri.substr(0, colon));
+            ep.port = std::string(colon == std::string_view::npos ? uri : uri.substr(colon + 1));
+            if (ep.port.empty()) throw std::invalid_argument("missing port in " + std::string(uri));
+            return ep;
+        }
+        std::string_view scheme = uri.substr(0, sep);
+        std::string_view rest = uri.substr(sep + 3);
+        if (scheme == "tcp")
+        {
+            auto colon = rest.rfind(':');
+            if (colon == std::string_view::npos) throw std::invalid_argument("tcp endpoint needs host:port: " + std::string(uri));
+            ep.host = colon == 0 ? std::string(default_host) : std::string(rest.substr(0, colon));
+            ep.port = std::string(rest.substr(colon + 1));
+        }
+        else if (scheme == "unix")
+        {
+            ep.kind = Kind::Unix;
+            auto q = rest.find('?');
+            if (q != std::string_view::npos)
+            {
+                if (rest.substr(q + 1) != "seqpacket") throw std::invalid_argument("unknown unix option in " + std::string(uri));
+                ep.kind = Kind::UnixSeqpacket;
+                rest = rest.substr(0, q);
+            }
+            ep.path = std::string(rest);
+        }
+        else if (scheme == "shm")
+        {
+            ep.kind = Kind::Shm;
+            ep.path = std::string(rest);
+            if (ep.path.empty() || ep.path[0] != '/') ep.path.insert(0, 1, '/');
+        }
+        else if (scheme == "udp")
+        {
+            ep.kind = Kind::Udp;
+            ep.iface = "127.0.0.1";
+            auto q = rest.find('?');
+            if (q != std::string_view::npos)
+            {
+                std::string_view opt = rest.substr(q + 1);
+                if (opt.rfind("iface=", 0) != 0 || opt.size() == 6) throw std::invalid_argument("unknown udp option in " + std::string(uri));
+                ep.iface = std::string(opt.substr(6));
+                rest = rest.substr(0, q);
+            }
+            auto colon = rest.rfind(':');
+            if (colon == std::string_view::npos || colon == 0) throw std::invalid_argument("udp endpoint needs group:port: " + std::string(uri));
+            ep.host = std::string(rest.substr(0, colon));
+            ep.port = std::string(rest.substr(colon + 1));
+        }
+        else
+        {
+            throw std::invalid_argument("unknown transport scheme: " + std::string(scheme));
+        }
+        if (ep.kind != Kind::Tcp && ep.kind != Kind::Udp && (ep.path.empty() || ep.path == "/"))
+            throw std::invalid_argument("missing path in " + std::string(uri));
+        if ((ep.kind == Kind::Tcp || ep.kind == Kind::Udp) && ep.port.empty())
+            throw std::invalid_argument("missing port in " + std::string(uri));
+        return ep;
+    }
+
+    std::string Endpoint::str() const
+    {
+        switch (kind)
+        {
+            case Kind::Tcp:           return "tcp://" + host + ":" + port;
+            case Kind::Unix:          return "unix://" + path;
+            case Kind::UnixSeqpacket: return "unix://" + path + "?seqpacket";
+            case Kind::Shm:           return "shm://" + path.substr(1);
+            case Kind::Udp:           return "udp://" + host + ":" + port + (iface == "127.0.0.1" ? "" : "?iface=" + iface);
+        }
+        return {};
+    }
+
+#ifndef _WIN32
+    static sockaddr_un unix_addr(const std::string& path)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) throw std::invalid_argument("unix socket path too long: " + path);
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return addr;
+    }
+#endif
+
+    int listen_endpoint(const Endpoint& ep, int backlog)
+    {
+        if (ep.kind == Endpoint::Kind::Tcp) return listen_tcp(ep.host, ep.port, backlog);
+#ifdef _WIN32
+        throw std::runtime_error("transport not supported on this platform: " + ep.str());
+#else
+        if (!ep.is_stream()) throw std::invalid_argument("not a stream endpoint: " + ep.str());
+        sockaddr_un addr = unix_addr(ep.path);
+        int fd = make_fd(AF_UNIX, ep.kind == Endpoint::Kind::UnixSeqpacket ? SOCK_SEQPACKET : SOCK_STREAM, 0);
+        ::unlink(ep.path.c_str());   // a socket file left behind by an earlier run
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, backlog) != 0)
+        {
+            int err = errno;
+            sys_close(fd);
+            throw std::system_error(err, std::generic_category(), "listen " + ep.str());
+        }
+        return fd;
+#endif
+    }
+
+    int connect_endpoint(const Endpoint& ep)
+    {
+        if (ep.kind == Endpoint::Kind::Tcp) return connect_tcp(ep.host, ep.port);
+#ifdef _WIN32
+        throw std::runtime_error("transport not supported on this platform: " + ep.str());
+#else
+        if (!ep.is_stream()) throw std::invalid_argument("not a stream endpoint: " + ep.str());
+        sockaddr_un addr = unix_addr(ep.path);
+        int fd = make_fd(AF_UNIX, ep.kind == Endpoint::Kind::UnixSeqpacket ? SOCK_SEQPACKET : SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            int err = errno;
+            sys_close(fd);
+            throw std::system_error(err, std::generic_category(), "connect " + ep.str());
+        }
+        return fd;
+#endif
+    }
+
+#ifndef _WIN32
+    static sockaddr_in udp_group_addr(const Endpoint& ep, in_addr& iface)
+    {
+        if (ep.kind != Endpoint::Kind::Udp) throw std::invalid_argument("not a udp endpoint: " + ep.str());
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoul(ep.port)));
+        if (::inet_pton(AF_INET, ep.host.c_str(), &addr.sin_addr) != 1 || !IN_MULTICAST(ntohl(addr.sin_addr.s_addr)))
+            throw std::invalid_argument("not an IPv4 multicast group: " + ep.host);
+        if (::inet_pton(AF_INET, ep.iface.c_str(), &iface) != 1)
+            throw std::invalid_argument("not an IPv4 interface address: " + ep.iface);
+        return addr;
+    }
+#endif
+
+    int open_multicast_recv(const Endpoint& ep, int rcvbuf_bytes)
+    {
+#ifdef _WIN32
+        (void)rcvbuf_bytes;
+        throw std::runtime_error("transport not supported on this platform: " + ep.str());
+#else
+        in_addr iface{};
+        sockaddr_in addr = udp_group_addr(ep, iface);
+        int fd = make_fd(AF_INET, SOCK_DGRAM, 0);
+        set_reuse(fd);   // several receivers (A/B, tools) may join the same group on one host
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf_bytes, sizeof(rcvbuf_bytes));
+        ip_mreq mreq{};
+        mreq.imr_multiaddr = addr.sin_addr;
+        mreq.imr_interface = iface;
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+        {
+            int err = errno;
+            sys_close(fd);
+            throw std::system_error(err, std::generic_category(), "join " + ep.str());
+        }
+        set_nonblocking(fd, true);
+        return fd;
+#endif
+    }
+
+    int open_multicast_send(const Endpoint& ep)
+    {
+#ifdef _WIN32
+        throw std::runtime_error("transport not supported on this platform: " + ep.str());
+#else
+        in_addr iface{};
+        sockaddr_in addr = udp_group_addr(ep, iface);
+        int fd = make_fd(AF_INET, SOCK_DGRAM, 0);
+        unsigned char ttl = 0, loop = 1;
+        if (::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) != 0 ||
+            ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+            ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0 ||
+            ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            int err = errno;
+            sys_close(fd);
+            throw std::system_error(err, std::generic_category(), "open " + ep.str());
+        }
+        set_nonblocking(fd, true);
+        return fd;
+#endif
+    }
+
     int listen_tcp(std::string_view host, std::string_view port, int backlog)
     {
         struct addrinfo hints{};
@@ -228,6 +428,33 @@ namespace net
         #endif
     }
 
+    uint32_t wait_readable_any(const int* fds, int n, int timeout_ms)
+    {
+        if (n < 1 || n > 32) throw std::invalid_argument("wait_readable_any: 1..32 fds");
+        #ifdef _WIN32
+        fd_set rfds; FD_ZERO(&rfds);
+        for (int i = 0; i < n; ++i) FD_SET(fds[i], &rfds);
+        timeval tv{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        int rc = ::select(0, &rfds, nullptr, nullptr, timeout_ms >= 0 ? &tv : nullptr);
+        if (rc < 0) throw std::system_error(WSAGetLastError(), std::system_category(), "select()");
+        uint32_t mask = 0;
+        for (int i = 0; i < n; ++i) if (FD_ISSET(fds[i], &rfds)) mask |= 1u << i;
+        return mask;
+        #else
+        pollfd pfd[32];
+        for (int i = 0; i < n; ++i) pfd[i] = pollfd{fds[i], POLLIN, 0};
+        int rc = ::poll(pfd, static_cast<nfds_t>(n), timeout_ms);
+        if (rc < 0)
+        {
+            if (errno == EINTR) return 0;
+            throw std::system_error(errno, std::generic_category(), "poll()");
+        }
+        uint32_t mask = 0;
+        for (int i = 0; i < n; ++i) if (pfd[i].revents & (POLLIN | POLLHUP)) mask |= 1u << i;
+        return mask;
+        #endif
+    }
+
     bool wait_writable(int fd, int timeout_ms)
     {
         #ifdef _WIN32
@@ -317,8 +544,19 @@ namespace net
     int recvmmsg_batch(int fd, void** bufs, size_t* lens, int count)
     {
         #ifdef __linux__
-        std::vector<mmsghdr> msgs(count);
-        std::vector<iovec>   iov(count);
+        mmsghdr stack_msgs[kStackBatch];
+        iovec   stack_iov[kStackBatch];
+        std::vector<mmsghdr> heap_msgs;
+        std::vector<iovec>   heap_iov;
+        mmsghdr* msgs = stack_msgs;
+        iovec*   iov  = stack_iov;
+        if (count > kStackBatch)
+        {
+            heap_msgs.resize(count);
+            heap_iov.resize(count);
+            msgs = heap_msgs.data();
+            iov  = heap_iov.data();
+        }
         for (int i=0;i<count;++i)
         {
             iov[i].iov_base = bufs[i];
@@ -327,7 +565,7 @@ namespace net
             msgs[i].msg_hdr.msg_iov = &iov[i];
             msgs[i].msg_hdr.msg_iovlen = 1;
         }
-        int rc = ::recvmmsg(fd, msgs.data(), count, MSG_DONTWAIT, nullptr);
+        int rc = ::recvmmsg(fd, msgs, count, MSG_DONTWAIT, nullptr);
         if (rc < 0)
         {
             if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
@@ -342,11 +580,22 @@ namespace net
         #endif
     }
 
-    int sendmmsg_batch(int fd, const void** bufs, const size_t* lens, int count)
+    int sendmmsg_batch(int fd, const void** bufs, const size_t* lens, int count, size_t* sent_lens)
     {
         #ifdef __linux__
-        std::vector<mmsghdr> msgs(count);
-        std::vector<iovec>   iov(count);
+        mmsghdr stack_msgs[kStackBatch];
+        iovec   stack_iov[kStackBatch];
+        std::vector<mmsghdr> heap_msgs;
+        std::vector<iovec>   heap_iov;
+        mmsghdr* msgs = stack_msgs;
+        iovec*   iov  = stack_iov;
+        if (count > kStackBatch)
+        {
+            heap_msgs.resize(count);
+            heap_iov.resize(count);
+            msgs = heap_msgs.data();
+            iov  = heap_iov.data();
+        }
         for (int i=0;i<count;++i)
         {
             iov[i].iov_base = const_cast<void*>(bufs[i]);
@@ -355,19 +604,37 @@ namespace net
             msgs[i].msg_hdr.msg_iov = &iov[i];
             msgs[i].msg_hdr.msg_iovlen = 1;
         }
-        int rc = ::sendmmsg(fd, msgs.data(), count, MSG_DONTWAIT);
+        int rc = ::sendmmsg(fd, msgs, count, MSG_DONTWAIT);
         if (rc < 0)
         {
             if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
             throw std::system_error(errno, std::generic_category(), "sendmmsg");
         }
+        if (sent_lens)
+        {
+            for (int i=0;i<rc;++i) sent_lens[i] = msgs[i].msg_len;
+        }
         return rc;
         #else
-        (void)fd;(void)bufs;(void)lens;(void)count;
+        (void)fd;(void)bufs;(void)lens;(void)count;(void)sent_lens;
         return 0;
         #endif
     }
 
+    size_t unread_bytes(int fd)
+    {
+        #ifdef _WIN32
+        u_long n = 0;
+        return ::ioctlsocket(fd, FIONREAD, &n) == 0 ? (size_t)n : 0;
+        #elif defined(__linux__)
+        int n = 0;
+        return ::ioctl(fd, SIOCINQ, &n) == 0 && n > 0 ? (size_t)n : 0;
+        #else
+        int n = 0;
+        return ::ioctl(fd, FIONREAD, &n) == 0 && n > 0 ? (size_t)n : 0;
+        #endif
+    }
+
     void enable_zerocopy(int fd, bool on)
     {
         #ifdef __linux__
@@ -0,0 +1,150 @@
+#include "common/perf_counters.hpp"
+
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+#include <cstring>
+
+namespace metrics
+{
+
+#ifdef __linux__
+    namespace
+    {
+        struct EventSpec
+        {
+            const char* name;
+            uint32_t type;
+            uint64_t config;
+        };
+
+        constexpr uint64_t cache_read_miss(uint64_t cache)
+        {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+
+        const EventSpec kHardware[] = {
+            { "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { "l1d_misses",    PERF_TYPE_HW_CACHE, cache_read_miss(PERF_COUNT_HW_CACHE_L1D) },
+            { "llc_misses",    PERF_TYPE_HW_CACHE, cache_read_miss(PERF_COUNT_HW_CACHE_LL) },
+            { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+
+        const EventSpec kSoftware[] = {
+            { "task_clock_ns",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+            { "page_faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+            { "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+        };
+
+        int open_event(const EventSpec& e, int group_fd)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = e.type;
+            attr.config = e.config;
+            attr.disabled = group_fd == -1 ? 1 : 0;   // the leader starts the group
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+        }
+    }
+#endif
+
+    PerfGroup::~PerfGroup() { close(); }
+
+    PerfGroup::Source PerfGroup::open(bool prefer_software)
+    {
+        close();
+#ifdef __linux__
+        auto try_set = [this](const EventSpec* specs, size_t count)
+        {
+            for (size_t i = 0; i < count && n_ < kMax; ++i)
+            {
+                int fd = open_event(specs[i], n_ == 0 ? -1 : fds_[0]);
+                if (fd < 0) continue;   // not supported here: drop it, keep the rest
+                fds_[n_] = fd;
+                names_[n_] = specs[i].name;
+                ++n_;
+            }
+            return n_ > 0;
+        };
+
+        Source s = Source::None;
+        if (!prefer_software && try_set(kHardware, sizeof(kHardware) / sizeof(kHardware[0]))) s = Source::Hardware;
+        else if (try_set(kSoftware, sizeof(kSoftware) / sizeof(kSoftware[0]))) s = Source::Software;
+        if (s != Source::None)
+        {
+            ::ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ::ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        source_.store(s, std::memory_order_release);
+        return s;
+#else
+        (void)prefer_software;
+        return Source::None;
+#endif
+    }
+
+    void PerfGroup::close()
+    {
+#ifdef __linux__
+        for (int i = n_ - 1; i >= 0; --i) ::close(fds_[i]);   // members before the leader
+#endif
+        for (auto& fd : fds_) fd = -1;
+        n_ = 0;
+        source_.store(Source::None, std::memory_order_release);
+    }
+
+    bool PerfGroup::read(uint64_t* out) const
+    {
+#ifdef __linux__
+        if (n_ == 0) return false;
+        uint64_t buf[3 + kMax];   // nr, time_enabled, time_running, values
+        ssize_t got = ::read(fds_[0], buf, sizeof(buf));
+        if (got < static_cast<ssize_t>(3 * sizeof(uint64_t)) || buf[0] != static_cast<uint64_t>(n_)) return false;
+        uint64_t enabled = buf[1], running = buf[2];
+        for (int i = 0; i < n_; ++i)
+        {
+            // the group was multiplexed off the PMU part of the time: extrapolate
+            out[i] = (running && running < enabled)
+                ? static_cast<uint64_t>(static_cast<double>(buf[3 + i]) * enabled / running)
+                : buf[3 + i];
+        }
+        return true;
+#else
+        (void)out;
+        return false;
+#endif
+    }
+
+    void PerfGroup::disable()
+    {
+#ifdef __linux__
+        if (n_) ::ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    void PerfGroup::enable()
+    {
+#ifdef __linux__
+        if (n_) ::ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    const char* PerfGroup::source_name(Source s)
+    {
+        switch (s)
+        {
+            case Source::Hardware: return "hardware";
+            case Source::Software: return "software";
+            default:               return "none";
+        }
+    }
+
+} // namespace metrics
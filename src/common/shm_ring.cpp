@@ -0,0 +1,296 @@
+#include "common/shm_ring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+#endif
+
+namespace shm
+{
+
+    namespace
+    {
+        constexpr uint32_t kRingMagic  = 0x474E4952;   // "RING"
+        constexpr uint32_t kRingLayout = 1;
+
+        enum : uint32_t { kIdle = 0, kAttached = 1, kClosed = 2 };
+
+        // Cross-process futex on a word in the shared mapping (not FUTEX_PRIVATE).
+        void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, int timeout_ms)
+        {
+#ifdef __linux__
+            timespec ts{timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+            (void)expected;
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout_ms, 1)));
+#endif
+        }
+
+        void futex_wake(std::atomic<uint32_t>& word)
+        {
+#ifdef __linux__
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#else
+            (void)word;
+#endif
+        }
+
+        inline void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+
+        bool process_gone(int32_t pid)
+        {
+            return pid > 0 && ::kill(pid, 0) != 0 && errno == ESRCH;
+        }
+
+        int ms_left(std::chrono::steady_clock::time_point deadline)
+        {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            return left > 0 ? static_cast<int>(left) : 0;
+        }
+    }
+
+    struct ByteRing::Header
+    {
+        uint32_t magic;
+        uint32_t layout;
+        uint64_t capacity;                         // power of two
+        int32_t  consumer_pid;
+
+        alignas(64) std::atomic<uint64_t> head;    // bytes written (producer)
+        std::atomic<uint32_t> space_futex;         // bumped by the consumer for a sleeping producer
+        std::atomic<uint32_t> producer_sleeping;
+
+        alignas(64) std::atomic<uint64_t> tail;    // bytes read (consumer)
+        std::atomic<uint32_t> data_futex;          // bumped by the producer for a sleeping consumer
+        std::atomic<uint32_t> consumer_sleeping;
+
+        alignas(64) std::atomic<uint32_t> state;   // kIdle / kAttached / kClosed
+        std::atomic<int32_t> producer_pid;
+    };
+
+    size_t ByteRing::data_offset() { return (sizeof(Header) + 4095) / 4096 * 4096; }
+
+    ByteRing::ByteRing(const std::string& name, Mode mode, size_t capacity)
+        : name_(name), owner_(mode == Mode::Create)
+    {
+        int fd;
+        if (owner_)
+        {
+            size_t cap = 4096;
+            while (cap < capacity) cap <<= 1;
+            ::shm_unlink(name.c_str());   // a segment left by an engine that died
+            fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0) throw std::runtime_error("shm_open " + name + ": " + std::strerror(errno));
+            map_size_ = data_offset() + cap;
+            if (::ftruncate(fd, static_cast<off_t>(map_size_)) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("ftruncate " + name + ": " + std::strerror(errno));
+            }
+        }
+        else
+        {
+            fd = ::shm_open(name.c_str(), O_RDWR, 0);
+            if (fd < 0) throw std::runtime_error("shm_open " + name + ": " + std::strerror(errno) + " (is the engine listening on shm://?)");
+            struct stat st{};
+            if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) <= data_offset())
+            {
+                ::close(fd);
+                throw std::runtime_error(name + " is not a byte ring");
+            }
+            map_size_ = static_cast<size_t>(st.st_size);
+        }
+        void* p = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("mmap " + name + ": " + std::strerror(errno));
+        hdr_ = static_cast<Header*>(p);
+        data_ = static_cast<char*>(p) + data_offset();
+
+        if (owner_)
+        {
+            hdr_->layout = kRingLayout;
+            hdr_->capacity = map_size_ - data_offset();
+            hdr_->consumer_pid = static_cast<int32_t>(::getpid());
+            reset();
+            std::atomic_thread_fence(std::memory_order_release);
+            hdr_->magic = kRingMagic;
+            return;
+        }
+
+        if (hdr_->magic != kRingMagic || hdr_->layout != kRingLayout || data_offset() + hdr_->capacity != map_size_)
+        {
+            ::munmap(p, map_size_);
+            throw std::runtime_error(name + " is not a byte ring");
+        }
+        // one producer at a time; wait a little for the engine to reset after the last one
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        uint32_t idle = kIdle;
+        while (!hdr_->state.compare_exchange_strong(idle, kAttached, std::memory_order_acq_rel))
+        {
+            if (std::chrono::steady_clock::now() > deadline || process_gone(hdr_->consumer_pid))
+            {
+                ::munmap(p, map_size_);
+                throw std::runtime_error(name + " is busy with another producer");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            idle = kIdle;
+        }
+        hdr_->producer_pid.store(static_cast<int32_t>(::getpid()), std::memory_order_release);
+        futex_wake(hdr_->state);
+    }
+
+    ByteRing::~ByteRing()
+    {
+        if (!hdr_) return;
+        if (!owner_ && hdr_->state.load(std::memory_order_acquire) == kAttached) close();
+        ::munmap(hdr_, map_size_);
+        if (owner_) ::shm_unlink(name_.c_str());
+    }
+
+    size_t ByteRing::capacity() const { return hdr_->capacity; }
+
+    size_t ByteRing::readable() const
+    {
+        return hdr_->head.load(std::memory_order_acquire) - hdr_->tail.load(std::memory_order_acquire);
+    }
+
+    void ByteRing::write(const void* data, size_t n)
+    {
+        const char* p = static_cast<const char*>(data);
+        const uint64_t cap = hdr_->capacity;
+        size_t done = 0;
+        while (done < n)
+        {
+            uint64_t head = hdr_->head.load(std::memory_order_relaxed);
+            uint64_t tail = hdr_->tail.load(std::memory_order_acquire);
+            if (head - tail == cap)
+            {
+                // full: spin, then sleep until the consumer frees space
+                for (uint32_t i = 0; i < spin_ && hdr_->tail.load(std::memory_order_acquire) == tail; ++i) cpu_relax();
+                if (hdr_->tail.load(std::memory_order_acquire) != tail) continue;
+                hdr_->producer_sleeping.store(1, std::memory_order_seq_cst);
+                uint32_t f = hdr_->space_futex.load(std::memory_order_seq_cst);
+                if (hdr_->tail.load(std::memory_order_seq_cst) == tail) futex_wait(hdr_->space_futex, f, 100);
+                hdr_->producer_sleeping.store(0, std::memory_order_relaxed);
+                if (hdr_->tail.load(std::memory_order_acquire) == tail && process_gone(hdr_->consumer_pid))
+                    throw std::runtime_error("engine on " + name_ + " went away");
+                continue;
+            }
+            size_t k = std::min<size_t>(cap - (head - tail), n - done);
+            size_t off = head & (cap - 1);
+            size_t first = std::min<size_t>(k, cap - off);
+            std::memcpy(data_ + off, p + done, first);
+            std::memcpy(data_, p + done + first, k - first);
+            hdr_->head.store(head + k, std::memory_order_seq_cst);
+            if (hdr_->consumer_sleeping.load(std::memory_order_seq_cst))
+            {
+                hdr_->data_futex.fetch_add(1, std::memory_order_seq_cst);
+                futex_wake(hdr_->data_futex);
+            }
+            done += k;
+        }
+    }
+
+    void ByteRing::close()
+    {
+        hdr_->state.store(kClosed, std::memory_order_seq_cst);
+        hdr_->data_futex.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(hdr_->data_futex);
+    }
+
+    bool ByteRing::wait_producer(int timeout_ms)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;)
+        {
+            if (hdr_->state.load(std::memory_order_acquire) != kIdle) return true;
+            int left = ms_left(deadline);
+            if (left == 0) return false;
+            futex_wait(hdr_->state, kIdle, left);
+        }
+    }
+
+    size_t ByteRing::read(void* buf, size_t cap_bytes, int timeout_ms)
+    {
+        const uint64_t cap = hdr_->capacity;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;)
+        {
+            uint64_t tail = hdr_->tail.load(std::memory_order_relaxed);
+            uint64_t head = hdr_->head.load(std::memory_order_acquire);
+            if (head != tail)
+            {
+                size_t k = std::min<size_t>(cap_bytes, head - tail);
+                size_t off = tail & (cap - 1);
+                size_t first = std::min<size_t>(k, cap - off);
+                std::memcpy(buf, data_ + off, first);
+                std::memcpy(static_cast<char*>(buf) + first, data_, k - first);
+                hdr_->tail.store(tail + k, std::memory_order_seq_cst);
+                if (hdr_->producer_sleeping.load(std::memory_order_seq_cst))
+                {
+                    hdr_->space_futex.fetch_add(1, std::memory_order_seq_cst);
+                    futex_wake(hdr_->space_futex);
+                }
+                return k;
+            }
+            if (hdr_->state.load(std::memory_order_acquire) == kClosed)
+            {
+                // the last write happened before the close: look once more
+                if (hdr_->head.load(std::memory_order_acquire) == tail) return 0;
+                continue;
+            }
+
+            for (uint32_t i = 0; i < spin_ && hdr_->head.load(std::memory_order_acquire) == tail; ++i) cpu_relax();
+            if (hdr_->head.load(std::memory_order_acquire) != tail) continue;
+
+            int left = ms_left(deadline);
+            if (left > 0)
+            {
+                hdr_->consumer_sleeping.store(1, std::memory_order_seq_cst);
+                uint32_t f = hdr_->data_futex.load(std::memory_order_seq_cst);
+                if (hdr_->head.load(std::memory_order_seq_cst) == tail &&
+                    hdr_->state.load(std::memory_order_seq_cst) != kClosed)
+                {
+                    futex_wait(hdr_->data_futex, f, left);
+                }
+                hdr_->consumer_sleeping.store(0, std::memory_order_relaxed);
+                if (hdr_->head.load(std::memory_order_acquire) != tail) continue;
+                left = ms_left(deadline);
+            }
+            if (left == 0)
+            {
+                // a producer that was killed never closes: treat it as gone
+                if (process_gone(hdr_->producer_pid.load(std::memory_order_acquire))) return 0;
+                return kNoData;
+            }
+        }
+    }
+
+    void ByteRing::reset()
+    {
+        hdr_->head.store(0, std::memory_order_relaxed);
+        hdr_->tail.store(0, std::memory_order_relaxed);
+        hdr_->producer_pid.store(0, std::memory_order_relaxed);
+        hdr_->producer_sleeping.store(0, std::memory_order_relaxed);
+        hdr_->consumer_sleeping.store(0, std::memory_order_relaxed);
+        hdr_->state.store(kIdle, std::memory_order_release);
+    }
+
+} // namespace shm
@@ -0,0 +1,78 @@
+#include "common/tsc_clock.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#ifdef METRICS_HAVE_TSC
+  #include <cpuid.h>
+#endif
+
+namespace metrics
+{
+
+    bool     TscClock::use_tsc_ = false;
+    uint64_t TscClock::ns_mult_ = uint64_t(1) << 32;   // 1 tick = 1 ns until calibrated
+
+    uint64_t TscClock::mono_ns()
+    {
+#ifdef CLOCK_MONOTONIC
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+#else
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static bool invariant_tsc()
+    {
+#ifdef METRICS_HAVE_TSC
+        const char* env = std::getenv("ENGINE_TSC");
+        if (env && std::strcmp(env, "0") == 0) return false;
+        unsigned a, b, c, d;
+        if (!__get_cpuid(0x80000000u, &a, &b, &c, &d) || a < 0x80000007u) return false;
+        __get_cpuid(0x80000007u, &a, &b, &c, &d);
+        return (d & (1u << 8)) != 0;   // invariant TSC: constant rate, runs in all C-states
+#else
+        return false;
+#endif
+    }
+
+    void TscClock::calibrate()
+    {
+        use_tsc_ = false;
+        ns_mult_ = uint64_t(1) << 32;
+        if (!invariant_tsc()) return;
+
+#ifdef METRICS_HAVE_TSC
+        // median of a few short windows, so one preempted window cannot skew the rate
+        double rates[3];
+        for (double& rate : rates)
+        {
+            unsigned aux;
+            uint64_t n0 = mono_ns(), t0 = __rdtscp(&aux);
+            uint64_t n1;
+            do { n1 = mono_ns(); } while (n1 - n0 < 5000000);   // 5ms
+            uint64_t t1 = __rdtscp(&aux);
+            rate = (t1 > t0) ? double(n1 - n0) / double(t1 - t0) : 0.0;
+        }
+        std::sort(rates, rates + 3);
+        double best = rates[1];
+        if (best <= 0) return;
+        ns_mult_ = static_cast<uint64_t>(best * 4294967296.0);
+        use_tsc_ = true;
+#endif
+    }
+
+    namespace
+    {
+        struct CalibrateAtStartup
+        {
+            CalibrateAtStartup() { TscClock::calibrate(); }
+        } g_calibrate;
+    }
+
+} // namespace metrics
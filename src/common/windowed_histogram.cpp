@@ -0,0 +1,55 @@
+#include "common/windowed_histogram.hpp"
+#include <algorithm>
+
+namespace metrics
+{
+
+    WindowedHistogram::WindowedHistogram(uint64_t highest, int digits)
+        : highest_(highest), digits_(digits),
+          sec_(new Epoch[kSecEpochs]), ten_(new Epoch[kTenEpochs])
+    {
+        for (size_t i = 0; i < kSecEpochs; ++i) sec_[i].rec = std::make_unique<EpochRecorder>(highest, digits);
+        for (size_t i = 0; i < kTenEpochs; ++i) ten_[i].rec = std::make_unique<EpochRecorder>(highest, digits);
+    }
+
+    void WindowedHistogram::recycle(Epoch& e, uint64_t id)
+    {
+        e.id.store(kRecycling, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.rec->reset();
+        e.id.store(id, std::memory_order_release);
+    }
+
+    bool WindowedHistogram::merge_epoch(const Epoch& e, uint64_t id, HdrHistogram& out)
+    {
+        if (e.id.load(std::memory_order_acquire) != id) return false;
+        HdrHistogram copy(out.layout().highest, out.layout().digits);
+        e.rec->merge_into(copy);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.id.load(std::memory_order_relaxed) != id) return false;   // recycled underneath us
+        out.merge(copy);
+        return true;
+    }
+
+    HdrHistogram WindowedHistogram::window(uint64_t seconds, uint64_t now_ns, uint64_t* covered_sec) const
+    {
+        HdrHistogram out(highest_, digits_);
+        seconds = std::clamp<uint64_t>(seconds, 1, kMaxWindowSec);
+        uint64_t sec = now_ns / 1'000'000'000ULL;
+
+        if (seconds <= kSecEpochs - 1)
+        {
+            for (uint64_t s = sec - seconds; s < sec; ++s) merge_epoch(sec_[s % kSecEpochs], s, out);
+            if (covered_sec) *covered_sec = seconds;
+        }
+        else
+        {
+            uint64_t tens = std::min<uint64_t>((seconds + 9) / 10, kTenEpochs - 1);
+            uint64_t cur = sec / 10;
+            for (uint64_t t = cur - tens; t < cur; ++t) merge_epoch(ten_[t % kTenEpochs], t, out);
+            if (covered_sec) *covered_sec = tens * 10;
+        }
+        return out;
+    }
+
+} // namespace metrics
@@ -0,0 +1,207 @@
+#include "engine/analytics.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace engine
+{
+
+    namespace
+    {
+        // an empty side compares as the worst possible price
+        int64_t bid_key(const LevelView& l) { return l.total_qty ? l.price : INT64_MIN; }
+        int64_t ask_key(const LevelView& l) { return l.total_qty ? l.price : INT64_MAX; }
+
+        LevelView best(const OrderBook& book, Side s)
+        {
+            LevelView lv{};
+            if (book.top_levels(s, &lv, 1) == 0) lv = LevelView{};
+            return lv;
+        }
+
+        double imbalance(int64_t bid, int64_t ask)
+        {
+            return bid + ask > 0 ? static_cast<double>(bid - ask) / static_cast<double>(bid + ask) : 0.0;
+        }
+    }
+
+    BookAnalytics::Flow& BookAnalytics::Flow::operator+=(const Flow& o)
+    {
+        volume += o.volume;
+        trades += o.trades;
+        notional += o.notional;
+        ofi += o.ofi;
+        adds += o.adds;
+        cancels += o.cancels;
+        modifies += o.modifies;
+        return *this;
+    }
+
+    double BookAnalytics::Flow::vwap() const
+    {
+        return volume > 0 ? notional / static_cast<double>(volume) : NAN;
+    }
+
+    double BookAnalytics::Flow::cancel_to_add() const
+    {
+        return adds ? static_cast<double>(cancels) / static_cast<double>(adds) : NAN;
+    }
+
+    BookAnalytics::BookAnalytics(Options opt) : opt_(opt)
+    {
+        opt_.depth = std::clamp<uint32_t>(opt_.depth, 1, kMaxDepth);
+    }
+
+    void BookAnalytics::reset(const OrderBook& book)
+    {
+        bid_ = best(book, Side::Bid);
+        ask_ = best(book, Side::Ask);
+        walk_depth(book, Side::Bid);
+        walk_depth(book, Side::Ask);
+        total_ = Flow{};
+        for (auto& b : buckets_) b = Bucket{};
+        sec_ = 0;
+        ts_ns_ = 0;
+        events_ = 0;
+    }
+
+    void BookAnalytics::walk_depth(const OrderBook& book, Side s)
+    {
+        LevelView lv[kMaxDepth];
+        const size_t n = book.top_levels(s, lv, opt_.depth);
+        int64_t q = 0;
+        for (size_t i = 0; i < n; ++i) q += lv[i].total_qty;
+        const int i = s == Side::Bid ? 0 : 1;
+        depth_qty_[i] = q;
+        depth_levels_[i] = static_cast<uint32_t>(n);
+        depth_last_px_[i] = n ? lv[n - 1].price : 0;
+    }
+
+    BookAnalytics::Flow& BookAnalytics::bucket(uint64_t ts_ns)
+    {
+        // events older than the newest second seen count in the newest one
+        sec_ = std::max(sec_, ts_ns / 1'000'000'000);
+        Bucket& b = buckets_[sec_ % kBuckets];
+        if (b.sec != sec_)
+        {
+            b.sec = sec_;
+            b.flow = Flow{};
+        }
+        return b.flow;
+    }
+
+    void BookAnalytics::on_event(const OrderBook& book, const MboEvent& ev)
+    {
+        ++events_;
+        ts_ns_ = ev.ts_ns;
+        Flow& win = bucket(ev.ts_ns);
+        Flow d;
+
+        const OrderBook::Effect& e = book.last_effect();
+        if (e.applied)
+        {
+            switch (e.kind)
+            {
+                case EventKind::Add:    d.adds = 1; break;
+                case EventKind::Cancel: d.cancels = 1; break;
+                case EventKind::Modify: d.modifies = 1; break;
+                case EventKind::Trade:
+                    d.trades = 1;
+                    d.volume = e.qty;
+                    d.notional = static_cast<double>(e.price) * e.qty;
+                    break;
+                case EventKind::Clear:  break;
+            }
+        }
+
+        using Levels = OrderBook::Effect::Levels;
+        const int i = e.side == Side::Bid ? 0 : 1;
+
+        // the best levels follow the event too; the book is read only when one went away
+        LevelView nb = bid_, na = ask_;
+        if (e.kind == EventKind::Clear)
+        {
+            nb = na = LevelView{};
+        }
+        else if (e.applied && e.levels == Levels::Several)
+        {
+            nb = best(book, Side::Bid);
+            na = best(book, Side::Ask);
+        }
+        else if (e.applied)
+        {
+            LevelView& b = i == 0 ? nb : na;
+            const bool at_best = b.total_qty && b.price == e.price;
+            if (e.levels == Levels::Size && at_best) b.total_qty += e.level_delta;
+            else if (e.levels == Levels::Removed && at_best) b = best(book, e.side);
+            else if (e.levels == Levels::Added && (i == 0 ? bid_key(b) < e.price : ask_key(b) > e.price))
+                b = LevelView{e.price, e.level_delta, 1};
+        }
+
+        // order flow imbalance from the best levels before and after the event
+        if (bid_key(nb) >= bid_key(bid_)) d.ofi += nb.total_qty;
+        if (bid_key(nb) <= bid_key(bid_)) d.ofi -= bid_.total_qty;
+        if (ask_key(na) <= ask_key(ask_)) d.ofi -= na.total_qty;
+        if (ask_key(na) >= ask_key(ask_)) d.ofi += ask_.total_qty;
+        bid_ = nb;
+        ask_ = na;
+
+        // whether e.price is in the top `depth` as of the last walk; right for a
+        // level that was there, and for a new one (it only pushes others out)
+        auto in_top = [&]
+        {
+            return depth_levels_[i] < opt_.depth ||
+                   (i == 0 ? e.price >= depth_last_px_[0] : e.price <= depth_last_px_[1]);
+        };
+        if (e.kind == EventKind::Clear)
+        {
+            depth_qty_[0] = depth_qty_[1] = 0;
+            depth_levels_[0] = depth_levels_[1] = 0;
+        }
+        else if (e.applied && e.levels == Levels::Several)
+        {
+            if (book.top_changed(opt_.depth))
+            {
+                walk_depth(book, Side::Bid);
+                walk_depth(book, Side::Ask);
+            }
+        }
+        else if (e.applied && in_top())
+        {
+            if (e.levels == Levels::Size) depth_qty_[i] += e.level_delta;
+            else walk_depth(book, e.side);   // a level came or went
+        }
+
+        total_ += d;
+        win += d;
+    }
+
+    BookAnalytics::Snapshot BookAnalytics::snapshot() const
+    {
+        Snapshot s;
+        s.ts_ns = ts_ns_;
+        s.events = events_;
+        s.depth = opt_.depth;
+        s.bid_px = bid_.total_qty ? bid_.price : 0;
+        s.bid_qty = bid_.total_qty;
+        s.ask_px = ask_.total_qty ? ask_.price : 0;
+        s.ask_qty = ask_.total_qty;
+        s.bid_depth_qty = depth_qty_[0];
+        s.ask_depth_qty = depth_qty_[1];
+        s.microprice = (s.bid_qty > 0 && s.ask_qty > 0)
+            ? (static_cast<double>(s.bid_px) * s.ask_qty + static_cast<double>(s.ask_px) * s.bid_qty) /
+              static_cast<double>(s.bid_qty + s.ask_qty)
+            : NAN;
+        s.imbalance = imbalance(s.bid_qty, s.ask_qty);
+        s.imbalance_depth = imbalance(s.bid_depth_qty, s.ask_depth_qty);
+        s.total = total_;
+        for (const Bucket& b : buckets_)
+        {
+            if (b.sec > sec_) continue;   // never written (UINT64_MAX)
+            for (int w = 0; w < kWindows; ++w)
+                if (sec_ - b.sec < kWindowSeconds[w]) s.window[w] += b.flow;
+        }
+        return s;
+    }
+
+} // namespace engine
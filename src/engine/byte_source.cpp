@@ -0,0 +1,54 @@
+#include "engine/byte_source.hpp"
+#include "common/net.hpp"
+#include "common/shm_ring.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace engine
+{
+
+    size_t SocketSource::read(char* buf, size_t cap)
+    {
+        // wait until we can read (or timeout)
+        if (!net::wait_readable(fd_, timeout_ms_)) return kNoData;
+        // recv_some reports a would-block race as SIZE_MAX and peer close as 0
+        return net::recv_some(fd_, buf, cap);
+    }
+
+    size_t SocketSource::unread() const
+    {
+        return net::unread_bytes(fd_);
+    }
+
+    size_t ShmSource::read(char* buf, size_t cap)
+    {
+        // the ring reports a timeout as kNoData and a closed/dead producer as 0, as recv_some does
+        return ring_.read(buf, cap, timeout_ms_);
+    }
+
+    size_t ShmSource::unread() const
+    {
+        return ring_.readable();
+    }
+
+    size_t MemorySource::read(char* buf, size_t cap)
+    {
+        size_t n = std::min({cap, chunk_, data_.size() - pos_});
+        std::memcpy(buf, data_.data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+
+    std::string load_file(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("cannot open " + path);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        return std::move(ss).str();
+    }
+
+} // namespace engine
@@ -0,0 +1,244 @@
+#include "engine/checkpoint.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace engine
+{
+
+    static uint64_t fnv1a(const void* data, size_t n)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        uint64_t h = 1469598103934665603ULL;
+        for (size_t i = 0; i < n; ++i)
+        {
+            h ^= p[i];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    static void write_fully(int fd, const void* data, size_t n, const std::string& path)
+    {
+        const char* p = static_cast<const char*>(data);
+        while (n > 0)
+        {
+            ssize_t w = ::write(fd, p, n);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) throw std::runtime_error("checkpoint write to " + path + " failed: " + std::strerror(errno));
+            p += w;
+            n -= static_cast<size_t>(w);
+        }
+    }
+
+    CheckpointHeader checkpoint_header(const std::vector<OrderBook::RestingOrder>& orders, const CheckpointInfo& info)
+    {
+        CheckpointHeader h{};
+        h.magic = kCheckpointMagic;
+        h.version = kCheckpointVersion;
+        h.info = info;
+        h.info.orders = orders.size();
+        h.checksum = fnv1a(orders.data(), orders.size() * sizeof(OrderBook::RestingOrder));
+        return h;
+    }
+
+    CheckpointInfo restore_checkpoint_image(const char* data, size_t size, OrderBook& book)
+    {
+        CheckpointHeader h;
+        if (size < sizeof(h)) throw std::runtime_error("not a checkpoint (too short)");
+        std::memcpy(&h, data, sizeof(h));
+        const auto* orders = reinterpret_cast<const OrderBook::RestingOrder*>(data + sizeof(CheckpointHeader));
+        if (h.magic != kCheckpointMagic) throw std::runtime_error("not a checkpoint");
+        if (h.version != kCheckpointVersion) throw std::runtime_error("unsupported checkpoint version");
+        if (size != sizeof(h) + h.info.orders * sizeof(OrderBook::RestingOrder)) throw std::runtime_error("truncated checkpoint");
+        if (fnv1a(orders, h.info.orders * sizeof(OrderBook::RestingOrder)) != h.checksum)
+            throw std::runtime_error("checkpoint checksum mismatch");
+        book.restore(orders, h.info.orders);
+        return h.info;
+    }
+
+    void write_checkpoint(const std::string& path, const std::vector<OrderBook::RestingOrder>& orders,
+                          const CheckpointInfo& info)
+    {
+        CheckpointHeader h = checkpoint_header(orders, info);
+
+        const std::string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw std::runtime_error("cannot create " + tmp + ": " + std::strerror(errno));
+        try
+        {
+            write_fully(fd, &h, sizeof(h), tmp);
+            write_fully(fd, orders.data(), orders.size() * sizeof(OrderBook::RestingOrder), tmp);
+            if (::fsync(fd) != 0) throw std::runtime_error("fsync " + tmp + ": " + std::strerror(errno));
+        }
+        catch (...)
+        {
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            throw;
+        }
+        ::close(fd);
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("cannot rename " + tmp + " to " + path + ": " + std::strerror(errno));
+    }
+
+    CheckpointInfo load_checkpoint(const std::string& path, OrderBook& book)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open checkpoint " + path + ": " + std::strerror(errno));
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CheckpointHeader))
+        {
+            ::close(fd);
+            throw std::runtime_error(path + " is not a checkpoint (too short)");
+        }
+        const size_t size = static_cast<size_t>(st.st_size);
+        void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) throw std::runtime_error("cannot mmap " + path + ": " + std::strerror(errno));
+
+        std::string error;
+        CheckpointInfo info;
+        try
+        {
+            info = restore_checkpoint_image(static_cast<const char*>(map), size, book);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        ::munmap(map, size);
+        if (!error.empty()) throw std::runtime_error(path + ": " + error);
+        return info;
+    }
+
+    Checkpointer::Checkpointer(std::string path) : path_(std::move(path))
+    {
+        thread_ = std::thread([this] { write_loop(); });
+    }
+
+    Checkpointer::~Checkpointer()
+    {
+        stop_.store(true, std::memory_order_release);
+        busy_.fetch_or(2, std::memory_order_release);
+        busy_.notify_one();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    void Checkpointer::note(const OrderBook& book)
+    {
+        if (full_) return;   // everything is copied next time anyway
+        if (book.cleared())
+        {
+            full_ = true;
+            return;
+        }
+        for (const OrderBook::LevelRef& l : book.touched_levels())
+            (l.side == Side::Bid ? dirty_bids_ : dirty_asks_).insert(l.price);
+    }
+
+    size_t Checkpointer::copy_all(const OrderBook& book)
+    {
+        // split one export into levels; reuses the writer's buffer (the writer is idle)
+        bids_.clear();
+        asks_.clear();
+        buf_.clear();
+        book.export_orders(buf_);
+        for (size_t i = 0; i < buf_.size();)
+        {
+            size_t j = i;
+            while (j < buf_.size() && buf_[j].side == buf_[i].side && buf_[j].price == buf_[i].price) ++j;
+            Orders& lvl = buf_[i].side == Side::Bid ? bids_[buf_[i].price] : asks_[buf_[i].price];
+            lvl.assign(buf_.begin() + static_cast<ptrdiff_t>(i), buf_.begin() + static_cast<ptrdiff_t>(j));
+            i = j;
+        }
+        return buf_.size();
+    }
+
+    template <typename Levels>
+    size_t Checkpointer::copy_levels(const OrderBook& book, Side s, Levels& levels, Prices& dirty)
+    {
+        size_t n = 0;
+        for (int64_t px : dirty)
+        {
+            auto it = levels.try_emplace(px).first;
+            it->second.clear();   // keeps its capacity
+            book.export_level(s, px, it->second);
+            n += it->second.size();
+            if (it->second.empty()) levels.erase(it);
+        }
+        return n;
+    }
+
+    bool Checkpointer::submit(const OrderBook& book, const CheckpointInfo& info, bool wait)
+    {
+        for (uint32_t b; wait && (b = busy_.load(std::memory_order_acquire)) != 0;) busy_.wait(b);
+        if (busy_.load(std::memory_order_acquire) != 0)
+        {
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        size_t copied;
+        if (full_)
+        {
+            copied = copy_all(book);
+            full_ = false;
+        }
+        else
+        {
+            copied = copy_levels(book, Side::Bid, bids_, dirty_bids_) + copy_levels(book, Side::Ask, asks_, dirty_asks_);
+        }
+        dirty_bids_.clear();
+        dirty_asks_.clear();
+        info_ = info;
+        info_.orders = book.order_count();
+        info_.bid_levels = bids_.size();
+        info_.ask_levels = asks_.size();
+        const uint64_t pause = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+        pause_ns_.store(pause, std::memory_order_relaxed);
+        if (pause > pause_max_ns_.load(std::memory_order_relaxed)) pause_max_ns_.store(pause, std::memory_order_relaxed);
+        copied_.store(copied, std::memory_order_relaxed);
+        busy_.store(1, std::memory_order_release);
+        busy_.notify_one();
+        return true;
+    }
+
+    void Checkpointer::write_loop()
+    {
+        for (;;)
+        {
+            busy_.wait(0, std::memory_order_acquire);
+            uint32_t b = busy_.load(std::memory_order_acquire);
+            if (b & 1)
+            {
+                try
+                {
+                    buf_.clear();   // keeps its capacity
+                    for (const auto& [px, lvl] : bids_) buf_.insert(buf_.end(), lvl.begin(), lvl.end());
+                    for (const auto& [px, lvl] : asks_) buf_.insert(buf_.end(), lvl.begin(), lvl.end());
+                    write_checkpoint(path_, buf_, info_);
+                    written_.fetch_add(1, std::memory_order_release);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "[checkpoint] " << e.what() << "\n";
+                }
+            }
+            if (stop_.load(std::memory_order_acquire)) return;
+            busy_.fetch_and(~1u, std::memory_order_release);
+            busy_.notify_all();
+        }
+    }
+
+} // namespace engine
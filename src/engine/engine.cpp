@@ -1,5 +1,14 @@
 #include "engine/engine.hpp"
+#include "common/shm_ring.hpp"
 #include "common/net.hpp"
+#include "engine/framer.hpp"
+#include "engine/parser.hpp"
+#ifdef ENGINE_ALLOC_TRACKING
+#include "common/alloc_tracking.hpp"
+#endif
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -11,6 +20,40 @@ namespace engine
 
     using namespace std::chrono;
 
+    EngineApp::EngineApp()
+    {
+        static const char* kinds[] = { "add", "modify", "cancel", "trade", "clear" };
+        for (int k = 0; k < 5; ++k)
+        {
+            events_by_kind_[k] = &registry_.counter("engine_events_total", "Events applied to the book, by kind.",
+                                                    std::string("kind=\"") + kinds[k] + "\"");
+        }
+        parse_errors_   = &registry_.counter("engine_parse_errors_total", "Lines that did not parse as an event.");
+        bytes_received_ = &registry_.counter("engine_received_bytes_total", "Bytes read from the feed.");
+
+        registry_.gauge("engine_book_orders", "Resting orders in the book.", "", [this]
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            return double(book_.order_count());
+        });
+        registry_.gauge("engine_book_levels", "Price levels in the book, per side.", "side=\"bid\"", [this]
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            return double(book_.level_count(Side::Bid));
+        });
+        registry_.gauge("engine_book_levels", "Price levels in the book, per side.", "side=\"ask\"", [this]
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            return double(book_.level_count(Side::Ask));
+        });
+
+        const char* lat_help = "Event latency: parse to apply (internal), streamer send to apply (e2e).";
+        lat_prom_ = &registry_.histogram("engine_latency_seconds", lat_help, "path=\"internal\"",
+                                         metrics::latency_bounds_ns(), 1e-9);
+        e2e_prom_ = &registry_.histogram("engine_latency_seconds", lat_help, "path=\"e2e\"",
+                                         metrics::latency_bounds_ns(), 1e-9);
+    }
+
     uint64_t engine::EngineApp::now_ns()
     {
         return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
@@ -25,14 +68,20 @@ namespace engine
 
     void EngineApp::start_throughput_thread()
     {
-        if (!csv_enabled_) return;
+        if (!csv_enabled_ && bars_csv_path_.empty()) return;
 
-        if (!thr_csv_.is_open())
+        if (csv_enabled_ && !thr_csv_.is_open())
         {
             thr_csv_.open(throughput_path_, std::ios::out | std::ios::trunc);
-            thr_csv_ << "ts_ns,events_per_sec\n";
+            thr_csv_ << "ts_ns,events_per_sec,kernel_unread_bytes,framer_buffered_bytes,pending_events,feed_lag_ns\n";
             std::cout << "[engine] throughput CSV -> " << throughput_path_ << "\n";
         }
+        if (!bars_csv_path_.empty() && !bars_csv_.is_open())
+        {
+            bars_csv_.open(bars_csv_path_, std::ios::out | std::ios::trunc);
+            bars_csv_ << "interval_ns,start_ns,open,high,low,close,volume,trades,vwap\n" << std::flush;
+            std::cout << "[engine] closed bars CSV -> " << bars_csv_path_ << "\n";
+        }
         thr_stop_ = false;
         thr_thread_ = std::thread([this]
         {
@@ -48,97 +97,132 @@ namespace engine
                 uint64_t eps = static_cast<uint64_t>(std::llround(delta * scale));
                 if (thr_csv_.is_open())
                 {
-                    thr_csv_ << wall_ns() << "," << eps << "\n";
+                    thr_csv_ << wall_ns() << "," << eps
+                             << "," << lag_kernel_bytes_.load(std::memory_order_relaxed)
+                             << "," << lag_framer_bytes_.load(std::memory_order_relaxed)
+                             << "," << lag_pending_events_.load(std::memory_order_relaxed)
+                             << "," << lag_feed_ns_.load(std::memory_order_relaxed) << "\n";
                     thr_csv_.flush();
                 }
+                write_closed_bars();
             }
         });
     }
 
+    // Throughput thread: append the bars that closed since the last call.
+    void EngineApp::write_closed_bars()
+    {
+        if (!bars_csv_.is_open()) return;
+        TradeTape::Bar b;
+        uint64_t rows = 0;
+        for (size_t i = 0; i < tape_->intervals(); ++i)
+        {
+            const uint64_t count = tape_->closed_bars(i);
+            uint64_t& k = bars_written_[i];
+            if (count - k > tape_->bar_capacity())
+            {
+                bars_csv_lost_.fetch_add(count - tape_->bar_capacity() - k, std::memory_order_relaxed);
+                k = count - tape_->bar_capacity();
+            }
+            for (; k < count; ++k)
+            {
+                if (!tape_->closed_bar(i, k, b))
+                {
+                    bars_csv_lost_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                bars_csv_ << tape_->interval_ns(i) << "," << b.start_ns << "," << b.open << "," << b.high
+                          << "," << b.low << "," << b.close << "," << b.volume << "," << b.trades
+                          << "," << b.vwap() << "\n";
+                ++rows;
+            }
+        }
+        if (rows)
+        {
+            bars_csv_.flush();
+            bars_csv_rows_.fetch_add(rows, std::memory_order_relaxed);
+        }
+    }
+
 
     void engine::EngineApp::stop_throughput_thread()
     {
         thr_stop_ = true;
         if (thr_thread_.joinable()) thr_thread_.join();
         if (thr_csv_.is_open()) thr_csv_.flush();
+        write_closed_bars();
     }
 
-    void EngineApp::record_latency_us(uint64_t us)
-    {
-        int bin = (int)(us / LAT_BIN_US);
-        if (bin > LAT_BINS) bin = LAT_BINS;
-        lat_bins_[bin].fetch_add(1, std::memory_order_relaxed);
-        lat_samples_.fetch_add(1, std::memory_order_relaxed);
-        lat_sum_us_.fetch_add(us, std::memory_order_relaxed);
-    }
-
-    void EngineApp::record_e2e_latency_us(uint64_t us)
+    static void dump_hdr(std::ostream& os, const char* tag, const metrics::HdrHistogram& h)
     {
-        int bin = (int)(us / E2E_BIN_US);
-        if (bin > E2E_BINS) bin = E2E_BINS;
-        e2e_bins_[bin].fetch_add(1, std::memory_order_relaxed);
-        e2e_samples_.fetch_add(1, std::memory_order_relaxed);
-        e2e_sum_us_.fetch_add(us, std::memory_order_relaxed);
+        if (h.count() == 0)
+        {
+            os << "[" << tag << "] no samples\n";
+            return;
+        }
+        os << "[" << tag << "] samples=" << h.count()
+           << " mean="   << static_cast<uint64_t>(h.mean())
+           << " p50="    << h.value_at_quantile(0.50)
+           << " p95="    << h.value_at_quantile(0.95)
+           << " p99="    << h.value_at_quantile(0.99)
+           << " p99.9="  << h.value_at_quantile(0.999)
+           << " p99.99=" << h.value_at_quantile(0.9999)
+           << " max="    << h.max()
+           << " (sigdig=" << h.layout().digits << ")\n";
     }
 
     void EngineApp::dump_latency_stats(std::ostream& os)
     {
         // Internal latency stats (parse -> apply, steady clock)
-        uint64_t total = lat_samples_.load(std::memory_order_relaxed);
-        if (total == 0)
+        dump_hdr(os, "latency_ns_internal", lat_ns_.snapshot());
+        // E2E latency stats (producer -> consumer, wall clock)
+        dump_hdr(os, "latency_ns_e2e", e2e_ns_.snapshot());
+
+        // Rolling windows over complete seconds, then all-time
+        const uint64_t now = now_ns();
+        auto line = [&os](const std::string& tag, uint64_t span_ns,
+                          const metrics::HdrHistogram& lat, const metrics::HdrHistogram& e2e)
         {
-            os << "[latency_us] no samples\n";
-        }
-        else
+            os << "[window_" << tag << "] events=" << lat.count()
+               << " events_per_sec=" << (span_ns ? static_cast<uint64_t>(lat.count() * 1e9 / double(span_ns)) : 0)
+               << " internal_p50=" << lat.value_at_quantile(0.50)
+               << " internal_p99=" << lat.value_at_quantile(0.99)
+               << " internal_max=" << lat.max()
+               << " e2e_p50=" << e2e.value_at_quantile(0.50)
+               << " e2e_p99=" << e2e.value_at_quantile(0.99)
+               << " e2e_max=" << e2e.max() << "\n";
+        };
+        for (uint64_t w : {1, 10, 60})
         {
-            auto quant = [&](double p)->uint64_t
-            {
-                uint64_t need = (uint64_t)std::ceil(p * total);
-                uint64_t acc = 0;
-                for (int i = 0; i <= LAT_BINS; ++i)
-                {
-                    acc += lat_bins_[i].load(std::memory_order_relaxed);
-                    if (acc >= need) return (uint64_t)i * LAT_BIN_US;
-                }
-                return (uint64_t)LAT_BINS * LAT_BIN_US;
-            };
-            uint64_t mean = lat_sum_us_.load(std::memory_order_relaxed) / total;
-            os << "[latency_us_internal] samples=" << total
-            << " mean=" << mean
-            << " p50="  << quant(0.50)
-            << " p95="  << quant(0.95)
-            << " p99="  << quant(0.99)
-            << " (bin=" << LAT_BIN_US << "us)\n";
+            uint64_t covered = 0;
+            auto lat = lat_win_.window(w, now, &covered);
+            auto e2e = e2e_win_.window(w, now);
+            line(std::to_string(w) + "s", covered * 1'000'000'000ULL, lat, e2e);
         }
+        uint64_t first = first_apply_ns_.load(std::memory_order_relaxed);
+        line("all", (first && now > first) ? now - first : 0, lat_ns_.snapshot(), e2e_ns_.snapshot());
+    }
 
-        // E2E latency stats (producer -> consumer, wall clock)
-        uint64_t e2e_total = e2e_samples_.load(std::memory_order_relaxed);
-        if (e2e_total == 0)
-        {
-            os << "[latency_us_e2e] no samples\n";
-        }
-        else
+#ifdef ENGINE_ALLOC_TRACKING
+    void EngineApp::dump_alloc_stats(std::ostream& os)
+    {
+        alloc_tracking::ThreadStats ts[alloc_tracking::kMaxThreads];
+        int n = alloc_tracking::all_threads(ts, alloc_tracking::kMaxThreads);
+        uint64_t tid = alloc_tid_.load(std::memory_order_relaxed);
+        uint64_t events = lat_ns_.count();
+        for (int i = 0; i < n; ++i)
         {
-            auto quantE = [&](double p)->uint64_t
-            {
-                uint64_t need = (uint64_t)std::ceil(p * e2e_total);
-                uint64_t acc = 0;
-                for (int i = 0; i <= E2E_BINS; ++i)
-                {
-                    acc += e2e_bins_[i].load(std::memory_order_relaxed);
-                    if (acc >= need) return (uint64_t)i * E2E_BIN_US;
-                }
-                return (uint64_t)E2E_BINS * E2E_BIN_US;
-            };
-            uint64_t meanE = e2e_sum_us_.load(std::memory_order_relaxed) / e2e_total;
-            os << "[latency_us_e2e] samples=" << e2e_total
-            << " mean=" << meanE
-            << " p50="  << quantE(0.50)
-            << " p95="  << quantE(0.95)
-            << " p99="  << quantE(0.99)
-            << " (bin=" << E2E_BIN_US << "us)\n";
+            if (ts[i].tid != tid || events == 0) continue;
+            uint64_t allocs = ts[i].allocs - alloc_base_allocs_.load(std::memory_order_relaxed);
+            uint64_t bytes  = ts[i].bytes - alloc_base_bytes_.load(std::memory_order_relaxed);
+            os << "[alloc_ingest] events=" << events
+               << " allocs=" << allocs
+               << " allocs_per_event=" << (double)allocs / events
+               << " bytes_per_event=" << (double)bytes / events << "\n";
         }
+        alloc_tracking::dump(os);
     }
+#endif
 
     void EngineApp::enable_json_snapshots(const std::string& path)
     {
@@ -181,16 +265,225 @@ namespace engine
     }
 
 
-    static std::vector<std::string> split_csv(const std::string& s)
+    void EngineApp::sample_lag(size_t kernel_bytes, size_t framer_bytes, size_t chunk_bytes, size_t chunk_lines)
     {
-        std::vector<std::string> out;
-        std::stringstream ss(s);
-        std::string item;
-        while (std::getline(ss, item, ','))
+        lag_kernel_bytes_.store(kernel_bytes, std::memory_order_relaxed);
+        lag_framer_bytes_.store(framer_bytes, std::memory_order_relaxed);
+        const uint64_t threshold = lag_alert_ns_.load(std::memory_order_relaxed);
+        const LagMonitor::Sample lag = lag_.on_chunk(chunk_bytes, chunk_lines, kernel_bytes, framer_bytes,
+                                                     wall_ns(), last_ts_ns_, threshold);
+        lag_pending_events_.store(lag.pending_events, std::memory_order_relaxed);
+        if (last_ts_ns_ == 0) return;
+        lag_feed_ns_.store(lag.feed_lag_ns, std::memory_order_relaxed);
+        if (lag.feed_lag_ns > lag_feed_hwm_ns_.load(std::memory_order_relaxed))
+            lag_feed_hwm_ns_.store(lag.feed_lag_ns, std::memory_order_relaxed);
+        if (lag.alert)
         {
-            out.push_back(item);
+            std::cout << "[lag_alert] feed_lag_ns=" << lag.feed_lag_ns << " threshold_ns=" << threshold
+                      << " kernel_unread_bytes=" << kernel_bytes
+                      << " pending_events=" << lag.pending_events << "\n";
         }
-        return out;
+    }
+
+    void EngineApp::dump_lag_stats(std::ostream& os)
+    {
+        os << "[lag] kernel_unread_bytes=" << lag_kernel_bytes_.load(std::memory_order_relaxed)
+           << " framer_buffered_bytes=" << lag_framer_bytes_.load(std::memory_order_relaxed)
+           << " pending_events=" << lag_pending_events_.load(std::memory_order_relaxed)
+           << " feed_lag_ns=" << lag_feed_ns_.load(std::memory_order_relaxed)
+           << " feed_lag_max_ns=" << lag_feed_hwm_ns_.load(std::memory_order_relaxed) << "\n";
+    }
+
+    void EngineApp::enable_perf_counters(bool prefer_software)
+    {
+        perf_state_.store(prefer_software ? PerfState::WantedSoftware : PerfState::Wanted, std::memory_order_release);
+    }
+
+    void EngineApp::dump_perf_stats(std::ostream& os)
+    {
+        if (perf_state_.load(std::memory_order_acquire) != PerfState::Open) return;
+        uint64_t events = perf_events_.load(std::memory_order_acquire);
+        os << "[perf_per_event] source=" << metrics::PerfGroup::source_name(perf_.source())
+           << " events=" << events;
+        if (events == 0)
+        {
+            os << "\n";
+            return;
+        }
+        double cycles = -1, instructions = -1;
+        char buf[32];
+        for (int i = 0; i < perf_.size(); ++i)
+        {
+            double v = double(perf_totals_[i].load(std::memory_order_relaxed)) / double(events);
+            if (std::string(perf_.name(i)) == "cycles") cycles = v;
+            if (std::string(perf_.name(i)) == "instructions") instructions = v;
+            std::snprintf(buf, sizeof(buf), "%.2f", v);
+            os << " " << perf_.name(i) << "=" << buf;
+        }
+        if (cycles > 0 && instructions >= 0)
+        {
+            std::snprintf(buf, sizeof(buf), "%.2f", instructions / cycles);
+            os << " ipc=" << buf;
+        }
+        os << "\n";
+    }
+
+    void EngineApp::enable_capture(const std::string& path, capture::Codec codec)
+    {
+        capture_ = std::make_unique<capture::Writer>(path, codec);
+        std::cout << "[engine] capturing feed -> " << path
+                  << (capture_->direct_io() ? " (O_DIRECT)" : "") << "\n";
+    }
+
+    void EngineApp::dump_capture_stats(std::ostream& os)
+    {
+        if (!capture_) return;
+        os << "[capture] records=" << capture_->records()
+           << " dropped=" << capture_->dropped()
+           << " bytes_written=" << capture_->bytes_written() << "\n";
+    }
+
+    void EngineApp::dump_udp_stats(std::ostream& os)
+    {
+        if (!udp_) return;
+        const auto& st = udp_->stats();
+        uint64_t calls = st.syscalls.load(std::memory_order_relaxed);
+        uint64_t packets = st.packets.load(std::memory_order_relaxed);
+        os << "[udp] packets=" << packets
+           << " syscalls=" << calls
+           << " packets_per_syscall=" << (calls ? static_cast<double>(packets) / calls : 0.0)
+           << " lines_lost=" << st.lines_lost.load(std::memory_order_relaxed)
+           << " gaps=" << st.gaps.load(std::memory_order_relaxed)
+           << " late=" << st.late.load(std::memory_order_relaxed)
+           << " overlaps=" << st.overlaps.load(std::memory_order_relaxed)
+           << " bad=" << st.bad.load(std::memory_order_relaxed)
+           << " sessions=" << st.sessions.load(std::memory_order_relaxed)
+           << " restarts=" << st.restarts.load(std::memory_order_relaxed) << "\n";
+    }
+
+    void EngineApp::dump_ab_stats(std::ostream& os)
+    {
+        if (!ab_) return;
+        const auto& st = ab_->stats();
+        uint64_t a = st.wins[0].load(std::memory_order_relaxed);
+        uint64_t b = st.wins[1].load(std::memory_order_relaxed);
+        uint64_t now = now_ns();
+        auto idle_ms = [&](int side)
+        {
+            uint64_t last = st.last_packet_ns[side].load(std::memory_order_relaxed);
+            return last && now > last ? (now - last) / 1'000'000 : 0;
+        };
+        os << "[ab] wins_a=" << a << " wins_b=" << b
+           << " win_rate_a=" << (a + b ? static_cast<double>(a) / (a + b) : 0.0)
+           << " packets_a=" << st.packets[0].load(std::memory_order_relaxed)
+           << " packets_b=" << st.packets[1].load(std::memory_order_relaxed)
+           << " idle_ms_a=" << idle_ms(0) << " idle_ms_b=" << idle_ms(1)
+           << " duplicates=" << st.duplicates.load(std::memory_order_relaxed)
+           << " late=" << st.late.load(std::memory_order_relaxed)
+           << " lines_lost=" << st.lines_lost.load(std::memory_order_relaxed)
+           << " gaps=" << st.gaps.load(std::memory_order_relaxed)
+           << " bad=" << st.bad.load(std::memory_order_relaxed)
+           << " sessions=" << st.sessions.load(std::memory_order_relaxed)
+           << " restarts=" << st.restarts.load(std::memory_order_relaxed)
+           << " stale=" << st.stale.load(std::memory_order_relaxed) << "\n";
+        dump_hdr(os, "ab_arrival_delta_ns", st.arrival_delta_ns.snapshot());
+    }
+
+    void EngineApp::enable_shm_book(const std::string& name, uint32_t depth)
+    {
+        shm_book_ = std::make_unique<shm::BookWriter>(name, depth);
+        publish_shm_book(last_ts_ns_);   // the book as it is (e.g. restored)
+        std::cout << "[engine] publishing top " << shm_book_->depth() << " levels to shm " << name << "\n";
+    }
+
+    void EngineApp::publish_shm_book(uint64_t ts_ns)
+    {
+        // only this thread changes the book, so it can be read without mtx_
+        const uint32_t depth = shm_book_->depth();
+        size_t nb = book_.top_levels(Side::Bid, shm_levels_, depth);
+        shm::BookData& d = shm_book_->begin();
+        for (size_t i = 0; i < nb; ++i) d.bids[i] = {shm_levels_[i].price, shm_levels_[i].total_qty, shm_levels_[i].orders, 0};
+        size_t na = book_.top_levels(Side::Ask, shm_levels_, depth);
+        for (size_t i = 0; i < na; ++i) d.asks[i] = {shm_levels_[i].price, shm_levels_[i].total_qty, shm_levels_[i].orders, 0};
+        d.bid_count = static_cast<uint32_t>(nb);
+        d.ask_count = static_cast<uint32_t>(na);
+        d.ts_ns = ts_ns;
+        d.publish_ns = wall_ns();
+        shm_book_->end();
+    }
+
+    void EngineApp::enable_history(const std::string& feed_path, const TimeIndex::Options& opt)
+    {
+        const std::string index_path = TimeIndex::default_index_path(feed_path);
+        try
+        {
+            history_ = std::make_unique<TimeIndex>(feed_path, index_path);
+        }
+        catch (const std::exception& e)
+        {
+            // missing or stale: (re)build it once, then open it
+            std::cout << "[engine] building time index " << index_path << " (" << e.what() << ")\n";
+            TimeIndex::build(feed_path, index_path, opt);
+            history_ = std::make_unique<TimeIndex>(feed_path, index_path);
+        }
+        std::cout << "[engine] /book/at serves " << feed_path << " (" << history_->entries().size()
+                  << " checkpoints)\n";
+    }
+
+    void EngineApp::enable_checkpoints(const std::string& path, uint64_t every_lines)
+    {
+        ckpt_ = std::make_unique<Checkpointer>(path);
+        ckpt_every_ = every_lines ? every_lines : 1'000'000;
+        ckpt_next_ = feed_lines_ + ckpt_every_;
+    }
+
+    CheckpointInfo EngineApp::restore_checkpoint(const std::string& path)
+    {
+        CheckpointInfo info;
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            info = load_checkpoint(path, book_);
+            if (ckpt_) ckpt_->resync();
+            views_.bump();
+            if (analytics_) analytics_->reset(book_);
+        }
+        views_.notify();
+        if (mbp_) mbp_->publish(book_, info.last_ts_ns);
+        if (shm_book_) publish_shm_book(info.last_ts_ns);
+        feed_pos_ = info.feed_offset;
+        feed_lines_ = info.lines;
+        last_ts_ns_ = info.last_ts_ns;
+        ckpt_next_ = feed_lines_ + ckpt_every_;
+        std::cout << "[engine] restored " << path << ": " << info.orders << " orders, "
+                  << info.bid_levels << "/" << info.ask_levels << " bid/ask levels, feed offset "
+                  << info.feed_offset << " (line " << info.lines << ")\n";
+        return info;
+    }
+
+    void EngineApp::take_checkpoint(size_t partial_bytes, bool wait)
+    {
+        CheckpointInfo info;
+        info.feed_offset = feed_pos_ - partial_bytes;   // the framer's partial line is not in the book
+        info.lines = feed_lines_;
+        info.last_ts_ns = last_ts_ns_;
+        info.written_ns = wall_ns();
+        // this is the only thread that changes the book, so no lock for the copy
+        ckpt_->submit(book_, info, wait);
+        ckpt_next_ = feed_lines_ + ckpt_every_;
+    }
+
+    void EngineApp::dump_checkpoint_stats(std::ostream& os)
+    {
+        if (!ckpt_) return;
+        os << "[checkpoint] written=" << ckpt_->written() << " skipped=" << ckpt_->skipped()
+           << " pause_ns=" << ckpt_->pause_ns() << " pause_max_ns=" << ckpt_->pause_max_ns()
+           << " copied=" << ckpt_->copied()
+           << " path=" << ckpt_->path() << "\n";
+    }
+
+    void EngineApp::enable_flight_recorder(const std::string& dir, uint64_t threshold_ns)
+    {
+        flight_.start(dir, threshold_ns);
     }
 
     void EngineApp::enable_csv_metrics(const std::string& path, size_t every)
@@ -230,12 +523,21 @@ namespace engine
         }
         if (!csv_header_written_)
         {
-            csv_ << "ts_ns,best_bid_px,best_bid_qty,best_ask_px,best_ask_qty,spread,mid,depth_b,depth_a\n";
+            csv_ << "ts_ns,best_bid_px,best_bid_qty,best_ask_px,best_ask_qty,spread,mid,depth_b,depth_a";
+            if (analytics_)
+                csv_ << ",microprice,imbalance,imbalance_depth,ofi,vwap_1s,volume_1s,vwap_60s,volume_60s,cancel_to_add_60s";
+            csv_ << "\n";
             csv_header_written_ = true;
         }
 
         // Take a small snapshot for metrics
         BookSnapshot s = snapshot_top_n_locked(1);
+        BookAnalytics::Snapshot a;
+        if (analytics_)
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            a = analytics_->snapshot();
+        }
 
         long long bid_px = std::numeric_limits<long long>::min();
         long long ask_px = std::numeric_limits<long long>::max();
@@ -262,7 +564,16 @@ namespace engine
         csv_ << ts_ns << "," << bid_px << "," << bid_qty << ","
             << ask_px << "," << ask_qty << ","
             << spread << "," << mid << ","
-            << depth_b << "," << depth_a << "\n";
+            << depth_b << "," << depth_a;
+        if (analytics_)
+        {
+            const auto& w1 = a.window[0];
+            const auto& w60 = a.window[2];
+            csv_ << "," << a.microprice << "," << a.imbalance << "," << a.imbalance_depth << "," << a.total.ofi
+                 << "," << w1.vwap() << "," << w1.volume << "," << w60.vwap() << "," << w60.volume
+                 << "," << w60.cancel_to_add();
+        }
+        csv_ << "\n";
 
         csv_.flush();
     }
@@ -271,97 +582,39 @@ namespace engine
     void EngineApp::handle_line(const std::string& line)
     {
         if (line.empty()) return;
+        STAGE_STAMP(t_framed);
 
         // Optional end-to-end stamp: prefix is "@<send_wall_ns>,"
         uint64_t send_wall_ns = 0;
-        size_t start_pos = 0;
-        if (!line.empty() && line[0] == '@')
-        {
-            // find first comma
-            size_t comma = line.find(',', 1);
-            if (comma != std::string::npos)
-            {
-                // parse the number between '@' and ','
-                try
-                {
-                    send_wall_ns = std::stoull(line.substr(1, comma - 1));
-                    start_pos = comma + 1; // skip past the comma; remaining is the original CSV
-                }
-                catch (...)
-                {
-                    // if parsing fails, just ignore the E2E stamp
-                    send_wall_ns = 0;
-                    start_pos = 0;
-                }
-            }
-        }
-
+        size_t start_pos = parse_send_stamp(line, send_wall_ns);
 
          // mark receive
         uint64_t t_recv_ns = now_ns();
 
-        auto fields = split_csv(line.substr(start_pos));
-        if (fields.empty()) return;
-
         MboEvent ev{};
-        const std::string& kind = fields[0];
-
-        try
+        if (!parse_event(line, start_pos, ev))
         {
-            if (kind == "ADD" && fields.size() >= 6)
-            {
-                ev.kind = EventKind::Add;
-                // fields: ADD, ts_ns, side, order_id, price, qty
-                ev.ts_ns   = std::stoull(fields[1]);
-                ev.side    = (fields[2] == "B") ? Side::Bid : Side::Ask;
-                ev.order_id= std::stoull(fields[3]);
-                ev.price   = std::stoll(fields[4]);
-                ev.qty     = std::stoi(fields[5]);
-            }
-            else if (kind == "MOD" && fields.size() >= 5)
-            {
-                ev.kind = EventKind::Modify;
-                // MOD, ts_ns, order_id, new_price, new_qty
-                ev.ts_ns   = std::stoull(fields[1]);
-                ev.order_id= std::stoull(fields[2]);
-                ev.new_price = std::stoll(fields[3]);
-                ev.new_qty = std::stoi(fields[4]);
-            }
-            else if (kind == "CXL" && fields.size() >= 3)
-            {
-                ev.kind = EventKind::Cancel;
-                // CXL, ts_ns, order_id
-                ev.ts_ns   = std::stoull(fields[1]);
-                ev.order_id= std::stoull(fields[2]);
-            }
-            else if (kind == "TRD" && fields.size() >= 4)
-            {
-                ev.kind = EventKind::Trade;
-                // TRD, ts_ns, order_id, fill_qty
-                ev.ts_ns   = std::stoull(fields[1]);
-                ev.order_id= std::stoull(fields[2]);
-                ev.qty     = std::stoi(fields[3]);
-            }
-            else if (kind == "CLR" && fields.size() >= 2)
-            {
-                ev.kind = EventKind::Clear;
-                ev.ts_ns = std::stoull(fields[1]);
-            }
-            else
-            {
-                // unknown line; ignore for now
-                return;
-            }
-        }
-        catch (...)
-        {
-            // parse error; ignore line for now
+            parse_errors_->inc();
+            STAGE_MARK(line_tsc_);
             return;
         }
+        STAGE_STAMP(t_parsed);
+        STAGE_VAR(t_locked);
+        STAGE_VAR(t_applied);
+        uint32_t book_orders, book_levels;
 
         {
             std::lock_guard<std::mutex> lg(mtx_);
+            STAGE_MARK(t_locked);
             book_.on_event(ev);
+            if (ckpt_) ckpt_->note(book_);
+            views_.bump(book_.top_changed(ResponseCache::kSlots - 1));
+            STAGE_MARK(t_applied);
+            if (analytics_) analytics_->on_event(book_, ev);
+            book_orders = static_cast<uint32_t>(book_.order_count());
+            book_levels = static_cast<uint32_t>(book_.level_count(Side::Bid) + book_.level_count(Side::Ask));
+            STAGE_RECORD(stages_, Stage::Lock, ev.kind, t_parsed, t_locked);
+            STAGE_RECORD(stages_, Stage::Apply, ev.kind, t_locked, t_applied);
             
             // But this would slow everything down....
             if (json_enabled_)
@@ -369,10 +622,15 @@ namespace engine
                 write_snapshot_json(ev.ts_ns);
             }
         }
+        views_.notify();
+        if (tape_) tape_->on_event(book_, ev);
+        if (shm_book_ && book_.top_changed(shm_book_->depth())) publish_shm_book(ev.ts_ns);
+        if (mbp_ && book_.top_changed(MbpPublisher::kDepth)) mbp_->publish(book_, ev.ts_ns);
 
         
 
         // End-to-end latency: consumer apply time vs producer send wall-clock
+        uint64_t e2e_ns = 0;
         if (send_wall_ns != 0)
         {
             // use system_clock 'now' for wall time compatibility with streamer
@@ -382,20 +640,43 @@ namespace engine
                 ).count();
             if (apply_wall_ns > send_wall_ns)
             {
-                uint64_t e2e_us = (apply_wall_ns - send_wall_ns) / 1000ULL;
-                record_e2e_latency_us(e2e_us);
+                e2e_ns = apply_wall_ns - send_wall_ns;
+                e2e_ns_.record(e2e_ns);
+                e2e_prom_->record(e2e_ns);
             }
         }
 
 
-        // latency: parse-to-apply in microseconds
+        // latency: parse-to-apply in nanoseconds
         uint64_t t_apply_ns = now_ns();
-        uint64_t lat_us = (t_apply_ns - t_recv_ns) / 1000ULL;
-        record_latency_us(lat_us);
+        lat_ns_.record(t_apply_ns - t_recv_ns);
+        lat_win_.record(t_apply_ns - t_recv_ns, t_apply_ns);
+        lat_prom_->record(t_apply_ns - t_recv_ns);
+        events_by_kind_[static_cast<int>(ev.kind)]->inc();
+        last_ts_ns_ = ev.ts_ns;
+        if (e2e_ns != 0) e2e_win_.record(e2e_ns, t_apply_ns);
+        if (first_apply_ns_.load(std::memory_order_relaxed) == 0)
+            first_apply_ns_.store(t_apply_ns, std::memory_order_relaxed);
         applied_since_tick_.fetch_add(1, std::memory_order_relaxed);
 
         // write CSV every K events using ts_ns of this event
         maybe_log_csv(ev.ts_ns);
+
+        STAGE_STAMP(t_published);
+        STAGE_RECORD(stages_, Stage::Frame, ev.kind, line_tsc_, t_framed);
+        STAGE_RECORD(stages_, Stage::Parse, ev.kind, t_framed, t_parsed);
+        STAGE_RECORD(stages_, Stage::Publish, ev.kind, t_applied, t_published);
+        STAGE_RECORD(stages_, Stage::Total, ev.kind, line_tsc_, t_published);
+
+        FlightRecorder::Record fr{ev, t_recv_ns, t_apply_ns, e2e_ns, book_orders, book_levels, {}};
+#ifdef ENGINE_STAGE_TRACING
+        const uint64_t marks[] = { line_tsc_, t_framed, t_parsed, t_locked, t_applied, t_published };
+        for (int i = 0; i < FlightRecorder::kStages; ++i)
+            fr.stage_ns[i] = static_cast<uint32_t>(metrics::TscClock::to_ns(marks[i + 1] - marks[i]));
+#endif
+        flight_.record(fr);
+        // the next line of this chunk is framed from here, not from the chunk's arrival
+        STAGE_MARK(line_tsc_);
     }
 
     void EngineApp::print_snapshot(size_t top_n)
@@ -414,6 +695,288 @@ namespace engine
         print_side("ASKS", s.asks);
     }
 
+    static void append_int(std::string& out, int64_t v)
+    {
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, r.ptr);
+    }
+
+    static void append_levels_json(std::string& out, const char* name, const LevelView* lv, size_t n)
+    {
+        out += '"'; out += name; out += "\":[";
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (i) out += ',';
+            out += "{\"price\":"; append_int(out, lv[i].price);
+            out += ",\"qty\":"; append_int(out, lv[i].total_qty);
+            out += ",\"orders\":"; append_int(out, static_cast<int64_t>(lv[i].orders));
+            out += '}';
+        }
+        out += ']';
+    }
+
+    static void append_book_json(std::string& out, const LevelView* bids, size_t nb, const LevelView* asks, size_t na)
+    {
+        append_levels_json(out, "bids", bids, nb);
+        out += ',';
+        append_levels_json(out, "asks", asks, na);
+    }
+
+    std::string EngineApp::render_top(size_t n, uint64_t& version)
+    {
+        // copy the levels out under the lock, format after releasing it
+        constexpr size_t kStack = ResponseCache::kSlots - 1;
+        LevelView bids[kStack], asks[kStack];
+        BookSnapshot big;
+        size_t nb = 0, na = 0;
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            version = views_.version(n > kStack);
+            if (n <= kStack)
+            {
+                nb = book_.top_levels(Side::Bid, bids, n);
+                na = book_.top_levels(Side::Ask, asks, n);
+            }
+            else
+            {
+                big = book_.snapshot_top_n(n);
+            }
+        }
+        std::string out;
+        out.reserve(32 + 48 * (n <= kStack ? nb + na : big.bids.size() + big.asks.size()));
+        out += '{';
+        if (n <= kStack) append_book_json(out, bids, nb, asks, na);
+        else append_book_json(out, big.bids.data(), big.bids.size(), big.asks.data(), big.asks.size());
+        out += '}';
+        return out;
+    }
+
+    std::string EngineApp::render_spread(uint64_t& version)
+    {
+        LevelView bid{}, ask{};
+        size_t nb, na;
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            version = views_.version();
+            nb = book_.top_levels(Side::Bid, &bid, 1);
+            na = book_.top_levels(Side::Ask, &ask, 1);
+        }
+        std::string out = "{\"bid\":";
+        append_int(out, nb ? bid.price : -1);
+        out += ",\"ask\":";
+        append_int(out, na ? ask.price : -1);
+        out += ",\"spread\":";
+        append_int(out, (nb && na) ? ask.price - bid.price : -1);
+        out += '}';
+        return out;
+    }
+
+    // shortest round-trip form; null for NaN (no trades, no adds, an empty side)
+    static void append_num(std::string& out, double v)
+    {
+        if (!std::isfinite(v))
+        {
+            out += "null";
+            return;
+        }
+        char buf[32];
+        auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, r.ptr);
+    }
+
+    static void append_flow_json(std::string& out, const BookAnalytics::Flow& f)
+    {
+        out += "{\"volume\":"; append_int(out, f.volume);
+        out += ",\"trades\":"; append_int(out, static_cast<int64_t>(f.trades));
+        out += ",\"vwap\":"; append_num(out, f.vwap());
+        out += ",\"ofi\":"; append_int(out, f.ofi);
+        out += ",\"adds\":"; append_int(out, static_cast<int64_t>(f.adds));
+        out += ",\"cancels\":"; append_int(out, static_cast<int64_t>(f.cancels));
+        out += ",\"modifies\":"; append_int(out, static_cast<int64_t>(f.modifies));
+        out += ",\"cancel_to_add\":"; append_num(out, f.cancel_to_add());
+        out += '}';
+    }
+
+    void EngineApp::enable_analytics(const BookAnalytics::Options& opt)
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        analytics_ = std::make_unique<BookAnalytics>(opt);
+        analytics_->reset(book_);
+        std::cout << "[engine] analytics on http://127.0.0.1:18081/analytics (imbalance over "
+                  << analytics_->snapshot().depth << " levels)\n";
+    }
+
+    std::string EngineApp::render_analytics()
+    {
+        BookAnalytics::Snapshot a;
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            a = analytics_->snapshot();
+        }
+        std::string out = "{\"ts\":";
+        append_int(out, static_cast<int64_t>(a.ts_ns));
+        out += ",\"events\":"; append_int(out, static_cast<int64_t>(a.events));
+        out += ",\"bid\":{\"price\":"; append_int(out, a.bid_qty ? a.bid_px : -1);
+        out += ",\"qty\":"; append_int(out, a.bid_qty);
+        out += "},\"ask\":{\"price\":"; append_int(out, a.ask_qty ? a.ask_px : -1);
+        out += ",\"qty\":"; append_int(out, a.ask_qty);
+        out += "},\"microprice\":"; append_num(out, a.microprice);
+        out += ",\"imbalance\":"; append_num(out, a.imbalance);
+        out += ",\"depth\":"; append_int(out, a.depth);
+        out += ",\"bid_depth_qty\":"; append_int(out, a.bid_depth_qty);
+        out += ",\"ask_depth_qty\":"; append_int(out, a.ask_depth_qty);
+        out += ",\"imbalance_depth\":"; append_num(out, a.imbalance_depth);
+        out += ",\"total\":"; append_flow_json(out, a.total);
+        out += ",\"windows\":{";
+        for (int w = 0; w < BookAnalytics::kWindows; ++w)
+        {
+            if (w) out += ',';
+            out += '"'; append_int(out, static_cast<int64_t>(BookAnalytics::kWindowSeconds[w])); out += "s\":";
+            append_flow_json(out, a.window[w]);
+        }
+        out += "}}";
+        return out;
+    }
+
+    void EngineApp::enable_trades(const TradeTape::Options& opt, const std::string& bars_csv)
+    {
+        tape_ = std::make_unique<TradeTape>(opt);
+        bars_written_.assign(tape_->intervals(), 0);
+        bars_csv_path_ = bars_csv;
+        std::string names;
+        for (size_t i = 0; i < tape_->intervals(); ++i)
+            names += (i ? "," : "") + TradeTape::interval_name(tape_->interval_ns(i));
+        std::cout << "[engine] trade tape on http://127.0.0.1:18081/trades?n=50 and /bars?interval=<"
+                  << names << ">\n";
+    }
+
+    static void append_bar_json(std::string& out, const TradeTape::Bar& b, bool closed)
+    {
+        out += "{\"start\":"; append_int(out, static_cast<int64_t>(b.start_ns));
+        out += ",\"open\":"; append_int(out, b.open);
+        out += ",\"high\":"; append_int(out, b.high);
+        out += ",\"low\":"; append_int(out, b.low);
+        out += ",\"close\":"; append_int(out, b.close);
+        out += ",\"volume\":"; append_int(out, b.volume);
+        out += ",\"trades\":"; append_int(out, static_cast<int64_t>(b.trades));
+        out += ",\"vwap\":"; append_num(out, b.vwap());
+        out += closed ? ",\"closed\":true}" : ",\"closed\":false}";
+    }
+
+    std::string EngineApp::render_trades(size_t n)
+    {
+        thread_local std::vector<TradeTape::Print> prints;
+        tape_->recent(n, prints);
+        std::string out = "{\"prints\":";
+        append_int(out, static_cast<int64_t>(tape_->prints()));
+        out += ",\"trades\":[";
+        for (size_t i = 0; i < prints.size(); ++i)
+        {
+            const TradeTape::Print& p = prints[i];
+            if (i) out += ',';
+            out += "{\"ts\":"; append_int(out, static_cast<int64_t>(p.ts_ns));
+            out += ",\"price\":"; append_int(out, p.price);
+            out += ",\"qty\":"; append_int(out, p.qty);
+            out += p.aggressor == Side::Bid ? ",\"aggressor\":\"buy\"" : ",\"aggressor\":\"sell\"";
+            out += ",\"order_id\":"; append_int(out, static_cast<int64_t>(p.order_id));
+            out += '}';
+        }
+        out += "]}";
+        return out;
+    }
+
+    std::string EngineApp::render_bars(size_t interval, size_t n)
+    {
+        thread_local std::vector<TradeTape::Bar> bars;
+        tape_->bars(interval, n, bars);
+        std::string out = "{\"interval\":\"" + TradeTape::interval_name(tape_->interval_ns(interval)) + "\"";
+        out += ",\"interval_ns\":"; append_int(out, static_cast<int64_t>(tape_->interval_ns(interval)));
+        out += ",\"closed\":"; append_int(out, static_cast<int64_t>(tape_->closed_bars(interval)));
+        out += ",\"bars\":[";
+        for (size_t i = 0; i < bars.size(); ++i)
+        {
+            if (i) out += ',';
+            append_bar_json(out, bars[i], true);
+        }
+        out += "],\"open\":";
+        TradeTape::Bar b;
+        if (tape_->open_bar(interval, b)) append_bar_json(out, b, false);
+        else out += "null";
+        out += '}';
+        return out;
+    }
+
+    void EngineApp::enable_push(const std::string& port, int max_hz)
+    {
+        PushServer::Options opt;
+        opt.max_hz = max_hz;
+        push_ = std::make_unique<PushServer>(views_, [this](size_t n, uint64_t& v)
+        {
+            return n ? render_top(n, v) : render_spread(v);
+        });
+        push_->start("0.0.0.0", port, opt);
+        std::cout << "[engine] SSE on http://127.0.0.1:" << push_->port() << "/stream/top?n=5 (max "
+                  << opt.max_hz << " events/s per subscriber)\n";
+    }
+
+    void EngineApp::enable_mbp(const std::string& port, const MbpPublisher::Options& opt)
+    {
+        mbp_ = std::make_unique<MbpPublisher>();
+        mbp_->start("0.0.0.0", port, opt);
+        std::cout << "[engine] MBP-10 on tcp port " << mbp_->port() << " (" << (opt.max_buffer_bytes >> 10)
+                  << " KB per subscriber, slow after " << opt.slow_ms << " ms)\n";
+    }
+
+    void EngineApp::dump_mbp_stats(std::ostream& os)
+    {
+        if (!mbp_) return;
+        const auto& st = mbp_->stats();
+        os << "[mbp] subscribers=" << st.subscribers.load(std::memory_order_relaxed)
+           << " published=" << st.published.load(std::memory_order_relaxed)
+           << " overruns=" << st.overruns.load(std::memory_order_relaxed)
+           << " updates=" << st.updates.load(std::memory_order_relaxed)
+           << " snapshots=" << st.snapshots.load(std::memory_order_relaxed)
+           << " conflated=" << st.conflated.load(std::memory_order_relaxed)
+           << " slow_disconnects=" << st.slow_disconnects.load(std::memory_order_relaxed)
+           << " bytes=" << st.bytes.load(std::memory_order_relaxed) << "\n";
+    }
+
+    void EngineApp::dump_trades_stats(std::ostream& os)
+    {
+        if (!tape_) return;
+        os << "[trades] prints=" << tape_->prints();
+        for (size_t i = 0; i < tape_->intervals(); ++i)
+            os << " bars_" << TradeTape::interval_name(tape_->interval_ns(i)) << "=" << tape_->closed_bars(i);
+        if (!bars_csv_path_.empty())
+            os << " csv_rows=" << bars_csv_rows_.load(std::memory_order_relaxed)
+               << " csv_lost=" << bars_csv_lost_.load(std::memory_order_relaxed);
+        os << "\n";
+    }
+
+    void EngineApp::dump_push_stats(std::ostream& os)
+    {
+        if (!push_) return;
+        const auto& st = push_->stats();
+        os << "[push] subscribers=" << st.subscribers.load(std::memory_order_relaxed)
+           << " accepted=" << st.accepted.load(std::memory_order_relaxed)
+           << " rejected=" << st.rejected.load(std::memory_order_relaxed)
+           << " events=" << st.events.load(std::memory_order_relaxed)
+           << " bytes=" << st.bytes.load(std::memory_order_relaxed)
+           << " conflated=" << st.conflated.load(std::memory_order_relaxed) << "\n";
+    }
+
+    void EngineApp::dump_view_stats(std::ostream& os)
+    {
+        const auto& st = views_.stats();
+        os << "[views] version=" << views_.version()
+           << " hits=" << st.hits.load(std::memory_order_relaxed)
+           << " renders=" << st.renders.load(std::memory_order_relaxed)
+           << " not_modified=" << st.not_modified.load(std::memory_order_relaxed)
+           << " long_polls=" << st.long_polls.load(std::memory_order_relaxed)
+           << " poll_timeouts=" << st.poll_timeouts.load(std::memory_order_relaxed) << "\n";
+    }
+
     void EngineApp::run_http_server(EngineApp* self, int port)
     {
         httplib::Server srv;
@@ -424,52 +987,206 @@ namespace engine
             res.set_content("{\"ok\":true}", "application/json");
         });
 
-        // existing /book/top endpoint (unchanged)
-        srv.Get("/book/top", [self](const httplib::Request& req, httplib::Response& res)
+        // /book/top and /spread are served from ResponseCache: the body is rendered
+        // once per book version, "If-None-Match: <ETag>" gets a 304 while the book is
+        // unchanged, and ?since=<version> long-polls (up to wait_ms, default 30s)
+        // until the version moves past it. Views deeper than the cache slots go by
+        // the deep version.
+        static constexpr int kMaxWaitMs = 60'000;
+        auto serve_view = [self](const httplib::Request& req, httplib::Response& res, size_t slot, bool deep,
+                                 auto&& render)
+        {
+            ResponseCache& views = self->views_;
+            bool poll = false;
+            uint64_t since = 0;
+            int wait_ms = 30'000;
+            try
+            {
+                if (auto it = req.params.find("since"); it != req.params.end()) { since = std::stoull(it->second); poll = true; }
+                if (auto it = req.params.find("wait_ms"); it != req.params.end()) wait_ms = std::min(std::stoi(it->second), kMaxWaitMs);
+            }
+            catch (...)
+            {
+                res.status = 400;
+                res.set_content("{\"error\":\"since and wait_ms must be integers\"}", "application/json");
+                return;
+            }
+
+            uint64_t v = poll ? views.wait_newer(since, wait_ms, deep) : views.version(deep);
+            if ((poll && v <= since) || (req.has_header("If-None-Match") && ResponseCache::etag_matches(req.get_header_value("If-None-Match"), v)))
+            {
+                views.stats().not_modified.fetch_add(1, std::memory_order_relaxed);
+                res.status = 304;
+                res.set_header("ETag", ResponseCache::etag(v).c_str());
+                res.set_header("X-Book-Version", std::to_string(v).c_str());
+                return;
+            }
+            ResponseCache::Body body = slot < ResponseCache::kSlots
+                ? views.get(slot, render, v)
+                : std::make_shared<const std::string>(render(v));
+            res.set_header("ETag", ResponseCache::etag(v).c_str());
+            res.set_header("X-Book-Version", std::to_string(v).c_str());
+            res.set_header("Cache-Control", "no-cache");
+            res.set_content(*body, "application/json");
+        };
+
+        srv.Get("/book/top", [self, serve_view](const httplib::Request& req, httplib::Response& res)
         {
             size_t n = 5;
             if (auto it = req.params.find("n"); it != req.params.end()) {
             try { n = static_cast<size_t>(std::stoul(it->second)); } catch (...) {}
             }
-            auto snap = self->snapshot_top_n_locked(n);
+            // slot 0 is /spread; n = 0 and deep requests are rendered uncached
+            size_t slot = (n == 0) ? ResponseCache::kSlots : n;
+            const bool deep = n > ResponseCache::kSlots - 1;
+            serve_view(req, res, slot, deep, [self, n](uint64_t& v) { return self->render_top(n, v); });
+        });
+
+        // Book as of a feed timestamp, from the recorded feed (ENGINE_HISTORY)
+        srv.Get("/book/at", [self](const httplib::Request& req, httplib::Response& res)
+        {
+            if (!self->history_)
+            {
+                res.status = 404;
+                res.set_content("{\"error\":\"no history feed (set ENGINE_HISTORY)\"}", "application/json");
+                return;
+            }
+            size_t n = 5;
+            uint64_t ts = 0;
+            try
+            {
+                if (auto it = req.params.find("n"); it != req.params.end()) n = static_cast<size_t>(std::stoul(it->second));
+                ts = std::stoull(req.get_param_value("ts"));
+            }
+            catch (...)
+            {
+                res.status = 400;
+                res.set_content("{\"error\":\"usage: /book/at?ts=<feed ns>[&n=5]\"}", "application/json");
+                return;
+            }
 
+            OrderBook book;
+            auto r = self->history_->book_at(ts, book);
+            auto snap = book.snapshot_top_n(n);
             std::ostringstream out;
-            out << "{";
-            auto dump_side = [&](const char* name, const std::vector<LevelView>& lv)
+            out << "{\"ts\":" << ts << ",\"as_of_ts\":" << r.as_of_ts_ns << ",\"line\":" << r.lines
+                << ",\"replayed\":" << r.replayed << ",";
+            std::string levels;
+            append_book_json(levels, snap.bids.data(), snap.bids.size(), snap.asks.data(), snap.asks.size());
+            out << levels << "}";
+            res.set_content(out.str(), "application/json");
+        });
+
+        srv.Get("/spread", [self, serve_view](const httplib::Request& req, httplib::Response& res)
+        {
+            serve_view(req, res, 0, false, [self](uint64_t& v) { return self->render_spread(v); });
+        });
+
+        srv.Get("/analytics", [self](const httplib::Request&, httplib::Response& res)
+        {
+            if (!self->analytics_)
+            {
+                res.set_content("{\"ok\":false,\"error\":\"analytics not enabled\"}", "application/json");
+                return;
+            }
+            res.set_content(self->render_analytics(), "application/json");
+        });
+
+        // recent prints, newest first (n <= the tape size)
+        srv.Get("/trades", [self](const httplib::Request& req, httplib::Response& res)
+        {
+            if (!self->tape_)
+            {
+                res.set_content("{\"ok\":false,\"error\":\"trade tape not enabled\"}", "application/json");
+                return;
+            }
+            size_t n = 50;
+            if (auto it = req.params.find("n"); it != req.params.end())
+                try { n = static_cast<size_t>(std::stoul(it->second)); } catch (...) {}
+            res.set_content(self->render_trades(n), "application/json");
+        });
+
+        // the last n closed bars of one interval, oldest first, and the open one
+        srv.Get("/bars", [self](const httplib::Request& req, httplib::Response& res)
+        {
+            if (!self->tape_ || self->tape_->intervals() == 0)
             {
-                out << "\"" << name << "\":[";
-                for (size_t i = 0; i < lv.size(); ++i)
+                res.set_content("{\"ok\":false,\"error\":\"trade tape not enabled\"}", "application/json");
+                return;
+            }
+            size_t interval = 0, n = 60;
+            if (auto it = req.params.find("interval"); it != req.params.end())
+            {
+                const uint64_t ns = TradeTape::parse_interval(it->second);
+                interval = SIZE_MAX;
+                for (size_t i = 0; i < self->tape_->intervals(); ++i)
+                    if (self->tape_->interval_ns(i) == ns) interval = i;
+                if (interval == SIZE_MAX)
                 {
-                    const auto& x = lv[i];
-                    out << "{\"price\":" << x.price
-                        << ",\"qty\":" << x.total_qty
-                        << ",\"orders\":" << x.orders
-                        << "}";
-                    if (i + 1 < lv.size()) out << ",";
+                    res.status = 400;
+                    res.set_content("{\"ok\":false,\"error\":\"no bars at that interval\"}", "application/json");
+                    return;
                 }
-                out << "]";
-            };
-            dump_side("bids", snap.bids); out << ","; dump_side("asks", snap.asks); out << "}";
-            res.set_content(out.str(), "application/json");
+            }
+            if (auto it = req.params.find("n"); it != req.params.end())
+                try { n = static_cast<size_t>(std::stoul(it->second)); } catch (...) {}
+            res.set_content(self->render_bars(interval, n), "application/json");
+        });
+
+        srv.Get("/stats", [self](const httplib::Request&, httplib::Response& res)
+        {
+            std::ostringstream os;
+            self->dump_latency_stats(os);
+            self->dump_lag_stats(os);
+            self->dump_perf_stats(os);
+            self->dump_capture_stats(os);
+            self->dump_udp_stats(os);
+            self->dump_ab_stats(os);
+            self->dump_checkpoint_stats(os);
+            self->dump_view_stats(os);
+            self->dump_push_stats(os);
+            self->dump_mbp_stats(os);
+            self->dump_trades_stats(os);
+#ifdef ENGINE_ALLOC_TRACKING
+            self->dump_alloc_stats(os);
+#endif
+            res.set_content(os.str(), "text/plain");
         });
 
-        srv.Get("/spread", [self](const httplib::Request&, httplib::Response& res)
+        // freeze the flight recorder and dump it to a file in the background
+        srv.Get("/debug/flight", [self](const httplib::Request&, httplib::Response& res)
         {
-            auto snap = self->snapshot_top_n_locked(1);
-            long long bid = snap.bids.empty() ? LLONG_MIN : snap.bids[0].price;
-            long long ask = snap.asks.empty() ? LLONG_MAX : snap.asks[0].price;
-            long long spread = (bid == LLONG_MIN || ask == LLONG_MAX) ? -1 : (ask - bid);
             std::ostringstream out;
-            out << "{\"bid\":" << (bid==LLONG_MIN? -1:bid)
-                << ",\"ask\":" << (ask==LLONG_MAX? -1:ask)
-                << ",\"spread\":" << spread << "}";
+            if (!self->flight_.started())
+            {
+                out << "{\"ok\":false,\"error\":\"flight recorder not enabled\"}";
+            }
+            else
+            {
+                std::string path = self->flight_.request_dump("request");
+                if (path.empty()) out << "{\"ok\":false,\"error\":\"dump in progress\"}";
+                else out << "{\"ok\":true,\"file\":\"" << path << "\"}";
+            }
             res.set_content(out.str(), "application/json");
         });
 
-        srv.Get("/stats", [self](const httplib::Request&, httplib::Response& res)
+        // Prometheus text exposition
+        srv.Get("/metrics", [self](const httplib::Request&, httplib::Response& res)
         {
             std::ostringstream os;
-            self->dump_latency_stats(os);
+            self->registry_.write(os);
+            res.set_content(os.str(), "text/plain; version=0.0.4");
+        });
+
+        srv.Get("/stats/stages", [self](const httplib::Request&, httplib::Response& res)
+        {
+            std::ostringstream os;
+#ifdef ENGINE_STAGE_TRACING
+            self->stages_.dump(os);
+#else
+            (void)self;
+            os << "stage tracing is off (configure with -DENGINE_STAGE_TRACING=ON)\n";
+#endif
             res.set_content(os.str(), "text/plain");
         });
 
@@ -486,10 +1203,158 @@ namespace engine
         srv.listen("127.0.0.1", port);
     }
 
+    size_t EngineApp::consume(ByteSource& src)
+    {
+        LineFramer framer;
+        std::vector<char> chunk(64 * 1024); // 64KB read buffer
+        size_t lines = 0;
+
+#ifdef ENGINE_ALLOC_TRACKING
+        if (alloc_tid_.load(std::memory_order_relaxed) == 0)
+        {
+            // baseline after the per-connection buffers above: count only per-event work
+            auto t = alloc_tracking::this_thread();
+            alloc_base_allocs_.store(t.allocs, std::memory_order_relaxed);
+            alloc_base_bytes_.store(t.bytes, std::memory_order_relaxed);
+            alloc_tid_.store(t.tid, std::memory_order_relaxed);
+        }
+#endif
+
+        PerfState ps = perf_state_.load(std::memory_order_relaxed);
+        if (ps == PerfState::Wanted || ps == PerfState::WantedSoftware)
+        {
+            auto got = perf_.open(ps == PerfState::WantedSoftware);
+            std::cout << "[engine] perf counters: " << metrics::PerfGroup::source_name(got) << "\n";
+            perf_state_.store(got == metrics::PerfGroup::Source::None ? PerfState::Off : PerfState::Open,
+                              std::memory_order_release);
+        }
+        const bool perf_on = perf_state_.load(std::memory_order_relaxed) == PerfState::Open;
+        uint64_t pmu_before[metrics::PerfGroup::kMax], pmu_after[metrics::PerfGroup::kMax];
+
+        while (true)
+        {
+            STAGE_STAMP(t_read);
+            size_t n = src.read(chunk.data(), chunk.size());
+            STAGE_STAMP(t_recvd);
+            if (n == ByteSource::kNoData)
+            {
+                // nothing this tick / would-block race; try again
+                continue;
+            }
+            if (n == 0)
+            {
+                // peer closed / end of data
+                break;
+            }
+            bytes_received_->inc(n);
+            if (capture_) capture_->append(wall_ns(), chunk.data(), n);
+#ifdef ENGINE_STAGE_TRACING
+            stages_.record_recv(t_recvd - t_read);
+            line_tsc_ = metrics::TscClock::now();
+#endif
+            if (!perf_on)
+            {
+                size_t chunk_lines = framer.feed(chunk.data(), n, [this](const std::string& line) { handle_line(line); });
+                lines += chunk_lines;
+                sample_lag(src.unread(), framer.pending(), n, chunk_lines);
+                feed_progress(n, chunk_lines, framer.pending());
+                continue;
+            }
+            bool ok = perf_.read(pmu_before);
+            size_t chunk_lines = framer.feed(chunk.data(), n, [this](const std::string& line) { handle_line(line); });
+            lines += chunk_lines;
+            sample_lag(src.unread(), framer.pending(), n, chunk_lines);
+            feed_progress(n, chunk_lines, framer.pending());
+            if (ok && perf_.read(pmu_after))
+            {
+                // single writer; /stats reads the totals
+                for (int i = 0; i < perf_.size(); ++i)
+                {
+                    auto& t = perf_totals_[i];
+                    t.store(t.load(std::memory_order_relaxed) + (pmu_after[i] - pmu_before[i]), std::memory_order_relaxed);
+                }
+                perf_events_.store(perf_events_.load(std::memory_order_relaxed) + chunk_lines, std::memory_order_release);
+            }
+        }
+        if (capture_) capture_->flush();   // this connection's tail reaches the disk now
+        feed_pos_ -= framer.pending();     // an unterminated last line was never applied
+        if (ckpt_) take_checkpoint(0, true);
+        return lines;
+    }
+
+    int EngineApp::replay(const std::string& path, size_t top_n)
+    {
+        default_top_n_ = top_n;
+        std::string data = load_file(path);
+        if (feed_pos_ > 0)
+        {
+            // resuming from a restored checkpoint: the book already has everything before it
+            if (feed_pos_ > data.size())
+                throw std::runtime_error("checkpoint feed offset " + std::to_string(feed_pos_) + " is past the end of " + path);
+            std::cout << "[engine] resuming " << path << " at byte " << feed_pos_ << " (line " << feed_lines_ << ")\n";
+            data.erase(0, feed_pos_);
+        }
+        MemorySource src(std::move(data));
+        std::cout << "[engine] replaying " << path << " (" << src.data().size() << " bytes)\n";
+
+        start_throughput_thread();
+        auto t0 = steady_clock::now();
+        size_t lines = consume(src);
+        double secs = duration<double>(steady_clock::now() - t0).count();
+        stop_throughput_thread();
+
+        std::cout << "[engine] replay done: " << lines << " lines in " << secs << " s ("
+                  << static_cast<uint64_t>(secs > 0 ? lines / secs : 0) << " lines/sec)\n";
+        dump_latency_stats(std::cout);
+        dump_lag_stats(std::cout);
+        dump_perf_stats(std::cout);
+        dump_capture_stats(std::cout);
+        dump_checkpoint_stats(std::cout);
+        print_snapshot(top_n);
+        return 0;
+    }
+
     int EngineApp::run(const std::string& host, const std::string& port, size_t top_n)
+    {
+        net::Endpoint ep;
+        ep.host = host;
+        ep.port = port;
+        return run(ep, top_n);
+    }
+
+    int EngineApp::run_arbitrated(const net::Endpoint& a, const net::Endpoint& b, size_t top_n,
+                                  const FeedArbiter::Options& opt)
+    {
+        if (a.kind != net::Endpoint::Kind::Udp || b.kind != net::Endpoint::Kind::Udp)
+            throw std::invalid_argument("A/B arbitration needs two udp:// feeds");
+        default_top_n_ = top_n;
+        ab_fds_[0] = net::open_multicast_recv(a);
+        ab_fds_[1] = net::open_multicast_recv(b);
+        ab_ = std::make_unique<FeedArbiter>(ab_fds_[0], ab_fds_[1], opt);
+
+        std::thread http_thr(run_http_server, this, 18081);
+        http_thr.detach();
+        start_throughput_thread();
+
+        std::cout << "[engine] arbitrating A=" << a.str() << " B=" << b.str()
+                  << " (gap timeout " << opt.gap_timeout_us << " us)\n";
+        for (;;)
+        {
+            size_t lines = consume(*ab_);
+            std::cout << "[engine] A/B session ended (" << lines << " lines)\n";
+        }
+    }
+
+    int EngineApp::run(const net::Endpoint& ep, size_t top_n)
     {
         default_top_n_ = top_n;
 
+        if (ep.kind == net::Endpoint::Kind::Udp)
+        {
+            udp_fd_ = net::open_multicast_recv(ep);
+            udp_ = std::make_unique<UdpSource>(udp_fd_);
+        }
+
         // fire an HTTP server on port 18081
         std::thread http_thr(run_http_server, this, 18081);
         http_thr.detach();
@@ -497,8 +1362,35 @@ namespace engine
         // start throughput thread if metrics enabled
         start_throughput_thread();
 
-        int lfd = net::listen_tcp(host, port);
-        std::cout << "[engine] listening on " << host << ":" << port << "\n";
+        if (ep.kind == net::Endpoint::Kind::Shm)
+        {
+            // one producer at a time attaches to the ring, streams, and closes
+            shm::ByteRing ring(ep.path, shm::ByteRing::Mode::Create);
+            std::cout << "[engine] listening on " << ep.str() << " (" << ring.capacity() << " byte ring)\n";
+            for (;;)
+            {
+                if (!ring.wait_producer(1000)) continue;
+                std::cout << "[engine] producer attached\n";
+                ShmSource src(ring);
+                consume(src);
+                ring.reset();
+                std::cout << "[engine] producer detached\n";
+            }
+        }
+
+        if (udp_)
+        {
+            // a sequenced multicast session per streamer run; the socket stays joined
+            std::cout << "[engine] joined " << ep.str() << "\n";
+            for (;;)
+            {
+                size_t lines = consume(*udp_);
+                std::cout << "[engine] udp session ended (" << lines << " lines)\n";
+            }
+        }
+
+        int lfd = net::listen_endpoint(ep);
+        std::cout << "[engine] listening on " << ep.str() << "\n";
 
         for (;;)
         {
@@ -507,47 +1399,8 @@ namespace engine
             std::cout << "[engine] client connected\n";
             net::set_nonblocking(cfd, true);
 
-            std::string buf; buf.reserve(1<<20);
-            std::string line; line.reserve(4096);
-            std::vector<char> chunk(64 * 1024); // 64KB read buffer
-
-            while (true)
-            {
-                // wait until we can read (or timeout)
-                if (!net::wait_readable(cfd, /*timeout_ms*/ 1000))
-                {
-                    continue; // nothing this tick
-                }
-
-                size_t n = net::recv_some(cfd, chunk.data(), chunk.size());
-                if (n == SIZE_MAX)
-                {
-                    // would-block race; try again
-                    continue;
-                }
-                if (n == 0)
-                {
-                    // peer closed
-                    break;
-                }
-                buf.append(chunk.data(), chunk.data() + n);
-
-                size_t pos = 0;
-                while (true)
-                {
-                    auto nl = buf.find('\n', pos);
-                    if (nl == std::string::npos)
-                    {
-                        buf.erase(0, pos);
-                        break;
-                    }
-                    line.assign(buf.data() + pos, nl - pos);
-                    pos = nl + 1;
-                    handle_line(line);
-                    // static uint64_t ctr = 0;
-                    // if ((++ctr % 10000) == 0) print_snapshot(top_n);
-                }
-            }
+            SocketSource src(cfd);
+            consume(src);
 
             net::close_fd(cfd);
             std::cout << "[engine] client disconnected\n";
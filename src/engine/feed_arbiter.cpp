@@ -0,0 +1,311 @@
+#include "engine/feed_arbiter.hpp"
+#include "common/feed_packet.hpp"
+#include "common/net.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace engine
+{
+
+    static uint64_t steady_ns()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    FeedArbiter::FeedArbiter(int fd_a, int fd_b, Options opt)
+        : fds_{fd_a, fd_b}, opt_(opt), seen_(kWindow / 64), first_ns_(kWindow), held_(kWindow)
+    {
+        static_assert((kWindow & (kWindow - 1)) == 0, "kWindow must be a power of two");
+        out_.reserve(1 << 20);
+    }
+
+    size_t FeedArbiter::read(char* buf, size_t cap)
+    {
+        if (end_pending_)
+        {
+            end_pending_ = false;
+            return 0;
+        }
+        for (;;)
+        {
+            if (out_pos_ < out_.size())
+            {
+                size_t n = std::min(cap, out_.size() - out_pos_);
+                std::memcpy(buf, out_.data() + out_pos_, n);
+                out_pos_ += n;
+                if (out_pos_ == out_.size())
+                {
+                    out_.clear();
+                    out_pos_ = 0;
+                }
+                return n;
+            }
+
+            if (restart_side_ >= 0)
+            {
+                end_session();
+                if (out_.empty()) return 0;
+                end_pending_ = true;
+                continue;
+            }
+
+            uint64_t now = steady_ns();
+            if (!batch_[0].done() || !batch_[1].done())
+            {
+                // packets left behind by a restart belong to the new session
+                drain(0, now);
+                drain(1, now);
+                continue;
+            }
+            const uint64_t gap_timeout_ns = opt_.gap_timeout_us * 1000;
+            if (gap_since_ns_ && now - gap_since_ns_ >= gap_timeout_ns)
+            {
+                // neither side filled the hole in time: lose it, release what is behind it
+                uint64_t s = next_ + 1;
+                while (s <= hi_ && !seen(s)) ++s;
+                skip_to(s, now);
+                continue;
+            }
+            if (session_over(false))
+            {
+                end_session();
+                if (out_.empty()) return 0;
+                end_pending_ = true;
+                continue;
+            }
+
+            int timeout_ms = opt_.poll_timeout_ms;
+            if (gap_since_ns_)
+            {
+                uint64_t left = gap_since_ns_ + gap_timeout_ns - now;
+                timeout_ms = static_cast<int>(std::min<uint64_t>(timeout_ms, (left + 999'999) / 1'000'000));
+            }
+            uint32_t ready = net::wait_readable_any(fds_, 2, timeout_ms);
+            if (!ready)
+            {
+                if (gap_since_ns_) continue;
+                if (session_over(true))
+                {
+                    end_session();
+                    if (out_.empty()) return 0;
+                    end_pending_ = true;
+                    continue;
+                }
+                return kNoData;
+            }
+
+            now = steady_ns();
+            for (int side = 0; side < 2; ++side)
+            {
+                if (!(ready & (1u << side))) continue;
+                int n = batch_[side].receive(fds_[side]);
+                if (n == 0) continue;
+                bump(stats_.syscalls[side]);
+                bump(stats_.packets[side], static_cast<uint64_t>(n));
+                stats_.last_packet_ns[side].store(now, std::memory_order_relaxed);
+                drain(side, now);
+            }
+        }
+    }
+
+    void FeedArbiter::drain(int side, uint64_t now)
+    {
+        // stops at the side's restart: that packet waits for the session to end, while
+        // the other side's packets up to its own restart still belong to this session
+        DatagramBatch& b = batch_[side];
+        for (; !b.done(); ++b.next)
+            if (!on_packet(side, static_cast<const char*>(b.ptrs[b.next]), b.lens[b.next], now)) return;
+    }
+
+    size_t FeedArbiter::unread() const
+    {
+        return (out_.size() - out_pos_) + net::unread_bytes(fds_[0]) + net::unread_bytes(fds_[1]);
+    }
+
+    bool FeedArbiter::restarted(int side, uint64_t seq) const
+    {
+        // seq 1 early in a session is that session's first packet arriving late
+        constexpr uint64_t kBack = feed::SeqTracker::kRestartWindow;
+        const uint64_t next = side_next_[side];
+        return next > 1 && ((seq == 1 && next > kBack) || seq + kBack < next);
+    }
+
+    bool FeedArbiter::on_packet(int side, const char* pkt, size_t len, uint64_t now)
+    {
+        feed::PacketHeader h;
+        if (!feed::read_header(pkt, len, h))
+        {
+            bump(stats_.bad);
+            return true;
+        }
+        if (h.count == feed::kEndOfSession)
+        {
+            if (stale_[side])
+            {
+                // the end of the session it was still in; its next lines join this one
+                stale_[side] = false;
+                side_next_[side] = 1;
+                return true;
+            }
+            if (!active_[side]) return true;   // a repeat of an earlier session's end
+            ended_[side] = true;
+            end_seq_ = std::max(end_seq_, h.seq);
+            return true;
+        }
+        if (stale_[side])
+        {
+            if (!restarted(side, h.seq))
+            {
+                bump(stats_.stale, h.count);
+                return true;
+            }
+            stale_[side] = false;   // it started over: the same stream as this session
+            side_next_[side] = 1;
+        }
+        else if (restarted(side, h.seq))
+        {
+            if (restart_side_ < 0)
+            {
+                bump(stats_.restarts);
+                restart_side_ = side;
+            }
+            return false;
+        }
+        side_next_[side] = std::max(side_next_[side], h.seq + h.count);
+        active_[side] = true;
+        const char* p = pkt + sizeof(h);
+        const char* end = pkt + len;
+        for (uint32_t i = 0; i < h.count; ++i)
+        {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!nl)
+            {
+                bump(stats_.bad);
+                return true;
+            }
+            on_line(side, h.seq + i, p, static_cast<size_t>(nl + 1 - p), now);
+            p = nl + 1;
+        }
+        return true;
+    }
+
+    void FeedArbiter::on_line(int side, uint64_t s, const char* data, size_t len, uint64_t now)
+    {
+        if (s + kWindow <= hi_)
+        {
+            // older than the window: applied or lost long ago
+            bump(stats_.duplicates);
+            return;
+        }
+        if (s <= hi_ && seen(s))
+        {
+            bump(stats_.duplicates);
+            stats_.arrival_delta_ns.record(now - first_ns_[s % kWindow]);
+            return;
+        }
+        if (s < next_)
+        {
+            bump(stats_.late);   // arrived after the gap timeout gave it up
+            return;
+        }
+        if (s >= next_ + kWindow) skip_to(s - kWindow + 1, now);   // keep the hole inside the window
+
+        mark(s);
+        first_ns_[s % kWindow] = now;
+        bump(stats_.wins[side]);
+        if (s == next_)
+        {
+            out_.append(data, len);
+            ++next_;
+            release_held(now);
+        }
+        else
+        {
+            held_[s % kWindow].assign(data, len);
+            if (!gap_since_ns_) gap_since_ns_ = now;
+        }
+    }
+
+    void FeedArbiter::mark(uint64_t s)
+    {
+        if (s > hi_)
+        {
+            // slots between the old and the new high mark held lines a window ago
+            if (s - hi_ >= kWindow)
+            {
+                std::fill(seen_.begin(), seen_.end(), 0);
+            }
+            else
+            {
+                for (uint64_t t = hi_ + 1; t < s; ++t) seen_[(t % kWindow) / 64] &= ~(uint64_t(1) << (t % 64));
+            }
+            hi_ = s;
+        }
+        seen_[(s % kWindow) / 64] |= uint64_t(1) << (s % 64);
+    }
+
+    void FeedArbiter::release_held(uint64_t now)
+    {
+        const uint64_t before = next_;
+        while (next_ <= hi_ && seen(next_))
+        {
+            std::string& line = held_[next_ % kWindow];
+            out_ += line;
+            line.clear();
+            ++next_;
+        }
+        if (next_ > hi_) gap_since_ns_ = 0;                    // caught up
+        else if (next_ != before || !gap_since_ns_) gap_since_ns_ = now;   // a new hole starts waiting
+    }
+
+    void FeedArbiter::skip_to(uint64_t s, uint64_t now)
+    {
+        bool in_gap = false;
+        for (; next_ < s; ++next_)
+        {
+            if (next_ <= hi_ && seen(next_))
+            {
+                std::string& line = held_[next_ % kWindow];
+                out_ += line;
+                line.clear();
+                in_gap = false;
+                continue;
+            }
+            bump(stats_.lines_lost);
+            if (!in_gap) bump(stats_.gaps);
+            in_gap = true;
+        }
+        gap_since_ns_ = 0;
+        release_held(now);
+    }
+
+    bool FeedArbiter::session_over(bool idle) const
+    {
+        if (!ended_[0] && !ended_[1]) return false;
+        bool all = (!active_[0] || ended_[0]) && (!active_[1] || ended_[1]);
+        return all || idle;
+    }
+
+    void FeedArbiter::end_session()
+    {
+        // lines neither side delivered before its end marker are lost
+        skip_to(std::max(end_seq_, hi_ + 1), steady_ns());
+        bump(stats_.sessions);
+        next_ = 1;
+        hi_ = 0;
+        gap_since_ns_ = 0;
+        end_seq_ = 0;
+        for (int side = 0; side < 2; ++side)
+        {
+            // a side that neither ended nor restarted is still in this session
+            stale_[side] = stale_[side] || (active_[side] && !ended_[side] && side != restart_side_);
+            if (!stale_[side]) side_next_[side] = 1;
+            active_[side] = ended_[side] = false;
+        }
+        restart_side_ = -1;
+        std::fill(seen_.begin(), seen_.end(), 0);
+    }
+
+} // namespace engine
@@ -0,0 +1,143 @@
+#include "engine/flight_recorder.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace engine
+{
+
+    static size_t round_pow2(size_t n)
+    {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static const char* kind_name(EventKind k)
+    {
+        static const char* names[] = { "ADD", "MOD", "CXL", "TRD", "CLR" };
+        int i = static_cast<int>(k);
+        return (i >= 0 && i < 5) ? names[i] : "?";
+    }
+
+    FlightRecorder::FlightRecorder(size_t capacity)
+        : ring_(new Slot[round_pow2(capacity ? capacity : 1)]), mask_(round_pow2(capacity ? capacity : 1) - 1)
+    {
+    }
+
+    FlightRecorder::~FlightRecorder()
+    {
+        if (!dumper_.joinable()) return;
+        stop_.store(true, std::memory_order_release);
+        pending_.store(2, std::memory_order_release);
+        pending_.notify_one();
+        dumper_.join();
+    }
+
+    void FlightRecorder::start(const std::string& dir, uint64_t threshold_ns, uint64_t cooldown_ns)
+    {
+        if (dumper_.joinable()) return;
+        dir_ = dir.empty() ? "." : dir;
+        cooldown_ns_ = cooldown_ns;
+        threshold_ns_.store(threshold_ns, std::memory_order_relaxed);
+        dumper_ = std::thread([this] { dump_loop(); });
+    }
+
+    void FlightRecorder::on_spike(uint64_t lat_ns)
+    {
+        // ingest thread only; last_spike_ns_ is its own
+        uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (last_spike_ns_ != 0 && now - last_spike_ns_ < cooldown_ns_) return;
+        if (freeze("latency", lat_ns, nullptr)) last_spike_ns_ = now;
+    }
+
+    bool FlightRecorder::freeze(const char* reason, uint64_t lat_ns, std::string* path)
+    {
+        if (!dumper_.joinable()) return false;
+        bool expected = false;
+        if (!frozen_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) return false;
+
+        std::snprintf(reason_, sizeof(reason_), "%s", reason);
+        reason_lat_ns_ = lat_ns;
+        uint64_t n = dumps_started_.fetch_add(1, std::memory_order_relaxed);
+        if (path) *path = dir_ + "/flight_" + std::to_string(n) + ".csv";
+        pending_.store(1, std::memory_order_release);
+        pending_.notify_one();
+        return true;
+    }
+
+    std::string FlightRecorder::request_dump(const std::string& reason)
+    {
+        std::string path;
+        freeze(reason.c_str(), 0, &path);
+        return path;
+    }
+
+    std::vector<FlightRecorder::Record> FlightRecorder::snapshot() const
+    {
+        std::vector<Record> out;
+        uint64_t h = head_.load(std::memory_order_acquire);
+        uint64_t first = h > capacity() ? h - capacity() : 0;
+        out.reserve(h - first);
+        for (uint64_t i = first; i < h; ++i)
+        {
+            const Slot& s = ring_[i & mask_];
+            if (s.seq.load(std::memory_order_acquire) != i + 1) continue;
+            Record r = s.rec;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != i + 1) continue;   // overwritten while copying
+            out.push_back(r);
+        }
+        return out;
+    }
+
+    void FlightRecorder::dump_loop()
+    {
+        for (;;)
+        {
+            pending_.wait(0, std::memory_order_acquire);
+            if (stop_.load(std::memory_order_acquire)) return;
+
+            // copy out while frozen, then let recording resume before touching the disk
+            std::vector<Record> recs = snapshot();
+            std::string reason = reason_;
+            uint64_t lat_ns = reason_lat_ns_;
+            uint64_t n = dumps_done_.load(std::memory_order_relaxed);
+            uint32_t one = 1;
+            pending_.compare_exchange_strong(one, 0, std::memory_order_acq_rel);   // keeps a stop request (2)
+            frozen_.store(false, std::memory_order_release);
+
+            std::string path = dir_ + "/flight_" + std::to_string(n) + ".csv";
+            std::ofstream f(path, std::ios::out | std::ios::trunc);
+            if (f)
+            {
+                f << "# flight dump reason=" << reason << " lat_ns=" << lat_ns
+                  << " threshold_ns=" << threshold_ns_.load(std::memory_order_relaxed)
+                  << " records=" << recs.size() << "\n";
+                f << "kind,side,order_id,price,qty,new_price,new_qty,ts_ns,recv_ns,apply_ns,lat_ns,e2e_ns,book_orders,book_levels";
+                for (int i = 0; i < kStages; ++i) f << ",stage_" << stage_name(static_cast<Stage>(kFirstStage + i)) << "_ns";
+                f << "\n";
+                for (const auto& r : recs)
+                {
+                    f << kind_name(r.ev.kind) << "," << (r.ev.side == Side::Bid ? 'B' : 'A')
+                      << "," << r.ev.order_id << "," << r.ev.price << "," << r.ev.qty
+                      << "," << r.ev.new_price << "," << r.ev.new_qty << "," << r.ev.ts_ns
+                      << "," << r.recv_ns << "," << r.apply_ns << "," << (r.apply_ns - r.recv_ns)
+                      << "," << r.e2e_ns << "," << r.book_orders << "," << r.book_levels;
+                    for (uint32_t ns : r.stage_ns) f << "," << ns;
+                    f << "\n";
+                }
+                std::cout << "[flight] " << reason << " dump -> " << path << " (" << recs.size() << " records)\n";
+            }
+            else
+            {
+                std::cerr << "[flight] cannot write " << path << "\n";
+            }
+            dumps_done_.store(n + 1, std::memory_order_release);
+        }
+    }
+
+} // namespace engine
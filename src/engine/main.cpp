@@ -1,14 +1,24 @@
 #include "engine/engine.hpp"
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 
 int main(int argc, char** argv)
 {
-    std::string host = "0.0.0.0";
-    std::string port = "9001";
+    std::string listen = "9001";
     size_t top_n = 5;
 
-    // usage: engine_app <port> <topN> [metrics_csv] [log_every] [snapshots_json]
-    if (argc > 1) port = argv[1];
+    // usage: engine_app <listen> <topN> [metrics_csv] [log_every] [snapshots_json]
+    //        engine_app --replay <lines_file> <topN> [metrics_csv] [log_every] [snapshots_json]
+    //   <listen>: 9001 | host:port | tcp://host:port | unix:///path[?seqpacket] | shm://name
+    //             | udp://group:port[?iface=addr] | <udp A>,<udp B> (A/B arbitration)
+    std::string replay_file;
+    if (argc > 2 && std::string(argv[1]) == "--replay")
+    {
+        replay_file = argv[2];
+        ++argv; --argc;   // remaining arguments line up with the live form
+    }
+    if (argc > 1 && replay_file.empty()) listen = argv[1];
     if (argc > 2) top_n = static_cast<size_t>(std::stoul(argv[2]));
 
     try
@@ -28,7 +38,104 @@ int main(int argc, char** argv)
             app.enable_json_snapshots(snapshots_json);
             std::cout << "[engine] JSON snapshots -> " << snapshots_json << "\n";
         }
-        return app.run(host, port, top_n);
+        {
+            // flight recorder dumps: ENGINE_FLIGHT_NS=<parse->apply ns> also dumps on spikes
+            const char* ns  = std::getenv("ENGINE_FLIGHT_NS");
+            const char* dir = std::getenv("ENGINE_FLIGHT_DIR");
+            uint64_t threshold = ns ? std::strtoull(ns, nullptr, 10) : 0;
+            app.enable_flight_recorder(dir ? dir : ".", threshold);
+            if (threshold)
+                std::cout << "[engine] flight recorder dumps above " << threshold << " ns\n";
+        }
+        if (const char* lag = std::getenv("ENGINE_LAG_ALERT_NS"))
+            app.set_lag_alert(std::strtoull(lag, nullptr, 10));
+        if (const char* perf = std::getenv("ENGINE_PERF"); perf && std::string(perf) != "0")
+        {
+            // ENGINE_PERF=1: PMU counters where available, ENGINE_PERF=sw: software only
+            app.enable_perf_counters(std::string(perf) == "sw");
+        }
+        if (const char* an = std::getenv("ENGINE_ANALYTICS"); an && std::string(an) != "0")
+        {
+            // ENGINE_ANALYTICS=1 [ENGINE_ANALYTICS_DEPTH=5]: /analytics and extra CSV columns
+            engine::BookAnalytics::Options opt;
+            if (const char* depth = std::getenv("ENGINE_ANALYTICS_DEPTH")) opt.depth = static_cast<uint32_t>(std::strtoul(depth, nullptr, 10));
+            app.enable_analytics(opt);
+        }
+        if (const char* tape = std::getenv("ENGINE_TRADES"); tape && std::string(tape) != "0")
+        {
+            // ENGINE_TRADES=1 [ENGINE_TRADES_SIZE=4096] [ENGINE_BARS=1s,1m] [ENGINE_BARS_CSV=<file>]:
+            // /trades, /bars, and closed bars appended to the CSV
+            engine::TradeTape::Options opt;
+            if (const char* size = std::getenv("ENGINE_TRADES_SIZE")) opt.prints = std::strtoul(size, nullptr, 10);
+            if (const char* bars = std::getenv("ENGINE_BARS"); bars && *bars)
+            {
+                opt.intervals_ns.clear();
+                std::string list = bars;
+                for (size_t pos = 0; pos <= list.size();)
+                {
+                    size_t end = list.find(',', pos);
+                    if (end == std::string::npos) end = list.size();
+                    const std::string item = list.substr(pos, end - pos);
+                    if (uint64_t ns = engine::TradeTape::parse_interval(item)) opt.intervals_ns.push_back(ns);
+                    else std::cerr << "[engine] ENGINE_BARS: ignoring '" << item << "'\n";
+                    pos = end + 1;
+                }
+            }
+            const char* csv = std::getenv("ENGINE_BARS_CSV");
+            app.enable_trades(opt, csv ? csv : "");
+        }
+        if (const char* cap = std::getenv("ENGINE_CAPTURE"); cap && *cap)
+        {
+            // ENGINE_CAPTURE=<file> [ENGINE_CAPTURE_CODEC=none|zstd]
+            const char* codec = std::getenv("ENGINE_CAPTURE_CODEC");
+            app.enable_capture(cap, capture::parse_codec(codec ? codec : ""));
+        }
+        if (const char* ckpt = std::getenv("ENGINE_CHECKPOINT"); ckpt && *ckpt)
+        {
+            // ENGINE_CHECKPOINT=<file> [ENGINE_CHECKPOINT_EVERY=<lines>]: warm-start from
+            // the file when it exists, then keep it up to date
+            const char* every = std::getenv("ENGINE_CHECKPOINT_EVERY");
+            app.enable_checkpoints(ckpt, every ? std::strtoull(every, nullptr, 10) : 1'000'000);
+            if (std::ifstream(ckpt).good()) app.restore_checkpoint(ckpt);
+        }
+        if (const char* hist = std::getenv("ENGINE_HISTORY"); hist && *hist)
+        {
+            // ENGINE_HISTORY=<feed file> [ENGINE_HISTORY_EVERY=<events>] [ENGINE_HISTORY_NS=<feed ns>]
+            engine::TimeIndex::Options opt;
+            if (const char* every = std::getenv("ENGINE_HISTORY_EVERY")) opt.every_events = std::strtoull(every, nullptr, 10);
+            if (const char* ns = std::getenv("ENGINE_HISTORY_NS")) opt.every_ns = std::strtoull(ns, nullptr, 10);
+            app.enable_history(hist, opt);
+        }
+        if (const char* shm_name = std::getenv("ENGINE_SHM_BOOK"); shm_name && *shm_name)
+        {
+            // ENGINE_SHM_BOOK=/name [ENGINE_SHM_DEPTH=10]
+            const char* depth = std::getenv("ENGINE_SHM_DEPTH");
+            app.enable_shm_book(shm_name, depth ? static_cast<uint32_t>(std::strtoul(depth, nullptr, 10)) : 10);
+        }
+        if (const char* push_port = std::getenv("ENGINE_PUSH_PORT"); push_port && *push_port)
+        {
+            // ENGINE_PUSH_PORT=<port> [ENGINE_PUSH_MAX_HZ=100]
+            const char* hz = std::getenv("ENGINE_PUSH_MAX_HZ");
+            app.enable_push(push_port, hz ? std::atoi(hz) : 100);
+        }
+        if (const char* mbp_port = std::getenv("ENGINE_MBP_PORT"); mbp_port && *mbp_port)
+        {
+            // ENGINE_MBP_PORT=<port> [ENGINE_MBP_BUFFER_KB=256] [ENGINE_MBP_SLOW_MS=5000]
+            engine::MbpPublisher::Options opt;
+            if (const char* kb = std::getenv("ENGINE_MBP_BUFFER_KB")) opt.max_buffer_bytes = std::strtoull(kb, nullptr, 10) << 10;
+            if (const char* ms = std::getenv("ENGINE_MBP_SLOW_MS")) opt.slow_ms = std::atoi(ms);
+            app.enable_mbp(mbp_port, opt);
+        }
+        if (!replay_file.empty()) return app.replay(replay_file, top_n);
+        if (size_t comma = listen.find(','); comma != std::string::npos)
+        {
+            // ENGINE_AB_GAP_US=<us>: how long a hole may wait for the other side
+            engine::FeedArbiter::Options opt;
+            if (const char* gap = std::getenv("ENGINE_AB_GAP_US")) opt.gap_timeout_us = std::strtoull(gap, nullptr, 10);
+            return app.run_arbitrated(net::Endpoint::parse(listen.substr(0, comma), "0.0.0.0"),
+                                      net::Endpoint::parse(listen.substr(comma + 1), "0.0.0.0"), top_n, opt);
+        }
+        return app.run(net::Endpoint::parse(listen, "0.0.0.0"), top_n);
     }
     catch (const std::exception& e)
     {
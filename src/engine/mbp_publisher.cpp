@@ -0,0 +1,388 @@
+#include "engine/mbp_publisher.hpp"
+#include "common/net.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace engine
+{
+
+    namespace
+    {
+        uint64_t steady_ns()
+        {
+            using namespace std::chrono;
+            return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+        uint64_t wall_ns()
+        {
+            using namespace std::chrono;
+            return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+        inline void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+
+        void put_header(std::string& out, mbp::MsgType type, uint8_t count, uint64_t seq, uint64_t ts_ns, uint64_t publish_ns)
+        {
+            mbp::MsgHeader h{};
+            h.magic = mbp::kMagic;
+            h.length = static_cast<uint16_t>(sizeof(h) + count * sizeof(mbp::Entry));
+            h.type = static_cast<uint8_t>(type);
+            h.count = count;
+            h.seq = seq;
+            h.ts_ns = ts_ns;
+            h.publish_ns = publish_ns;
+            out.append(reinterpret_cast<const char*>(&h), sizeof(h));
+        }
+
+        void put_entry(std::string& out, int side, uint32_t index, const mbp::Level& l)
+        {
+            mbp::Entry e{};
+            e.side = static_cast<uint8_t>(side);
+            e.index = static_cast<uint8_t>(index);
+            e.orders = l.orders;
+            e.price = l.price;
+            e.qty = l.qty;
+            out.append(reinterpret_cast<const char*>(&e), sizeof(e));
+        }
+
+        bool same(const mbp::Level& a, const mbp::Level& b)
+        {
+            return a.price == b.price && a.qty == b.qty && a.orders == b.orders;
+        }
+    }
+
+    void MbpPublisher::start(const std::string& host, const std::string& port, Options opt)
+    {
+        opt_ = opt;
+        size_t cap = 2;
+        while (cap < opt_.ring_images) cap <<= 1;
+        ring_ = std::make_unique<Image[]>(cap);
+        mask_ = cap - 1;
+
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) throw std::runtime_error(std::string("eventfd: ") + std::strerror(errno));
+        listen_fd_ = net::listen_tcp(host, port);
+        net::set_nonblocking(listen_fd_, true);
+        sockaddr_storage addr{};
+        socklen_t len = sizeof(addr);
+        if (::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) == 0)
+        {
+            port_ = addr.ss_family == AF_INET6 ? ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port)
+                                               : ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+        }
+        stop_.store(false, std::memory_order_relaxed);
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    void MbpPublisher::stop()
+    {
+        if (!thread_.joinable()) return;
+        stop_.store(true, std::memory_order_seq_cst);
+        uint64_t one = 1;
+        (void)::write(wake_fd_, &one, sizeof(one));
+        thread_.join();
+        for (auto& s : subs_) ::close(s.fd);
+        subs_.clear();
+        stats_.subscribers.store(0, std::memory_order_relaxed);
+        net::close_fd(listen_fd_);
+        ::close(wake_fd_);
+        listen_fd_ = wake_fd_ = -1;
+    }
+
+    void MbpPublisher::fill(Image& img, const OrderBook& book, uint64_t ts_ns)
+    {
+        img.n = published_;
+        img.ts_ns = ts_ns;
+        for (int side = 0; side < 2; ++side)
+        {
+            size_t n = book.top_levels(side ? Side::Ask : Side::Bid, scratch_, kDepth);
+            for (size_t i = 0; i < kDepth; ++i)
+                img.levels[side][i] = i < n ? mbp::Level{scratch_[i].price, scratch_[i].total_qty, scratch_[i].orders}
+                                            : mbp::Level{};
+        }
+        img.publish_ns = wall_ns();
+    }
+
+    void MbpPublisher::publish(const OrderBook& book, uint64_t ts_ns)
+    {
+        if (!ring_) return;
+        ++published_;
+        const uint64_t h = head_.load(std::memory_order_relaxed);
+        if (!overflow_.load(std::memory_order_acquire) && h - tail_.load(std::memory_order_acquire) <= mask_)
+        {
+            fill(ring_[h & mask_], book, ts_ns);
+            head_.store(h + 1, std::memory_order_seq_cst);
+        }
+        else
+        {
+            // the publisher thread is a whole ring behind: keep only the newest book
+            // until it catches up (it skips ring images older than the one it took)
+            uint64_t s = latest_seq_.load(std::memory_order_relaxed);
+            latest_seq_.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            fill(latest_, book, ts_ns);
+            latest_seq_.store(s + 2, std::memory_order_release);
+            overflow_.store(true, std::memory_order_seq_cst);
+            stats_.overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        stats_.published.fetch_add(1, std::memory_order_relaxed);
+        if (sleeping_.load(std::memory_order_seq_cst))
+        {
+            uint64_t one = 1;
+            (void)::write(wake_fd_, &one, sizeof(one));
+        }
+    }
+
+    bool MbpPublisher::pending() const
+    {
+        return head_.load(std::memory_order_seq_cst) != tail_.load(std::memory_order_relaxed) ||
+               overflow_.load(std::memory_order_seq_cst);
+    }
+
+    bool MbpPublisher::encode_update(const Image& img)
+    {
+        msg_.clear();
+        put_header(msg_, mbp::MsgType::Update, 0, seq_ + 1, img.ts_ns, img.publish_ns);
+        uint8_t count = 0;
+        for (int side = 0; side < 2; ++side)
+            for (uint32_t i = 0; i < kDepth; ++i)
+                if (!same(img.levels[side][i], cur_.levels[side][i]))
+                {
+                    put_entry(msg_, side, i, img.levels[side][i]);
+                    ++count;
+                }
+        cur_ = img;
+        if (count == 0) return false;   // e.g. a modify that put a level back as it was
+        ++seq_;
+        auto* h = reinterpret_cast<mbp::MsgHeader*>(msg_.data());
+        h->count = count;
+        h->length = static_cast<uint16_t>(msg_.size());
+        return true;
+    }
+
+    void MbpPublisher::encode_snapshot(std::string& out) const
+    {
+        put_header(out, mbp::MsgType::Snapshot, 2 * kDepth, seq_, cur_.ts_ns, cur_.publish_ns);
+        for (int side = 0; side < 2; ++side)
+            for (uint32_t i = 0; i < kDepth; ++i) put_entry(out, side, i, cur_.levels[side][i]);
+    }
+
+    void MbpPublisher::fan_out(const Image& img, uint64_t now)
+    {
+        if (img.n <= cur_n_) return;   // older than the latest image already taken
+        cur_n_ = img.n;
+        if (!encode_update(img)) return;
+        stats_.updates.fetch_add(1, std::memory_order_relaxed);
+        for (auto& s : subs_)
+        {
+            if (s.need_snapshot)
+            {
+                if (s.conflated) stats_.conflated.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (s.out.size() - s.out_pos + msg_.size() > opt_.max_buffer_bytes)
+            {
+                // slow consumer: stop queueing, resync with a snapshot once it drains
+                s.need_snapshot = true;
+                s.conflated = true;
+                if (!s.stalled_since_ns) s.stalled_since_ns = now;
+                stats_.conflated.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            s.out += msg_;
+        }
+    }
+
+    size_t MbpPublisher::drain(uint64_t now)
+    {
+        size_t n = 0;
+        uint64_t t = tail_.load(std::memory_order_relaxed);
+        const uint64_t h = head_.load(std::memory_order_acquire);
+        for (; t != h; ++t, ++n) fan_out(ring_[t & mask_], now);
+        tail_.store(t, std::memory_order_release);
+
+        if (overflow_.load(std::memory_order_acquire))
+        {
+            // clear first: a publish() after this goes to the ring (or sets it again)
+            overflow_.store(false, std::memory_order_seq_cst);
+            Image img;
+            for (;;)
+            {
+                uint64_t s0 = latest_seq_.load(std::memory_order_acquire);
+                if (s0 & 1) { cpu_relax(); continue; }
+                img = latest_;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (latest_seq_.load(std::memory_order_relaxed) == s0) break;
+            }
+            fan_out(img, now);
+            ++n;
+        }
+        if (n) service(now);
+        return n;
+    }
+
+    bool MbpPublisher::flush(Subscriber& s, uint64_t now)
+    {
+        const size_t before = s.out_pos;
+        while (s.out_pos < s.out.size())
+        {
+            ssize_t k = ::send(s.fd, s.out.data() + s.out_pos, s.out.size() - s.out_pos, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (k < 0)
+            {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+                break;
+            }
+            s.out_pos += static_cast<size_t>(k);
+            stats_.bytes.fetch_add(static_cast<uint64_t>(k), std::memory_order_relaxed);
+        }
+        // a stall is the socket taking nothing while there is something to send
+        // (a conflated subscriber has, even with an empty buffer)
+        if (s.out_pos != before || (s.out_pos == s.out.size() && !s.conflated)) s.stalled_since_ns = 0;
+        else if (!s.stalled_since_ns) s.stalled_since_ns = now;
+
+        if (s.out_pos == s.out.size())
+        {
+            s.out.clear();
+            s.out_pos = 0;
+        }
+        else if (s.out_pos > (64u << 10) && s.out_pos * 2 > s.out.size())
+        {
+            s.out.erase(0, s.out_pos);
+            s.out_pos = 0;
+        }
+        return true;
+    }
+
+    void MbpPublisher::service(uint64_t now)
+    {
+        for (auto& s : subs_)
+        {
+            if (s.fd < 0) continue;
+            bool ok = flush(s, now);
+            if (ok && s.need_snapshot && s.out.size() - s.out_pos <= opt_.max_buffer_bytes / 2)
+            {
+                encode_snapshot(s.out);
+                s.need_snapshot = false;
+                s.conflated = false;
+                stats_.snapshots.fetch_add(1, std::memory_order_relaxed);
+                ok = flush(s, now);
+            }
+            if (ok && s.stalled_since_ns && now - s.stalled_since_ns > static_cast<uint64_t>(opt_.slow_ms) * 1'000'000)
+            {
+                stats_.slow_disconnects.fetch_add(1, std::memory_order_relaxed);
+                ok = false;
+            }
+            if (!ok)
+            {
+                ::close(s.fd);
+                s.fd = -1;
+                stats_.subscribers.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        subs_.erase(std::remove_if(subs_.begin(), subs_.end(), [](const Subscriber& s) { return s.fd < 0; }), subs_.end());
+    }
+
+    void MbpPublisher::accept_all()
+    {
+        for (;;)
+        {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) return;
+            if (subs_.size() >= opt_.max_subscribers)
+            {
+                ::close(fd);
+                continue;
+            }
+            net::set_nonblocking(fd, true);
+            if (opt_.sndbuf_bytes > 0)
+                ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &opt_.sndbuf_bytes, sizeof(opt_.sndbuf_bytes));
+            Subscriber s;
+            s.fd = fd;
+            subs_.push_back(std::move(s));
+            stats_.accepted.fetch_add(1, std::memory_order_relaxed);
+            stats_.subscribers.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void MbpPublisher::loop()
+    {
+        std::vector<pollfd> pfds;
+        uint64_t last_poll_ns = 0;
+        while (!stop_.load(std::memory_order_relaxed))
+        {
+            uint64_t now = steady_ns();
+            size_t n = drain(now);
+            // while images keep coming, look at the sockets once a millisecond
+            if (n && now - last_poll_ns < 1'000'000) continue;
+
+            int timeout_ms = 0;
+            if (!n)
+            {
+                // spin a little for the next image, then sleep until woken
+                while (!pending() && steady_ns() - now < 20'000) cpu_relax();
+                if (pending()) continue;
+                sleeping_.store(1, std::memory_order_seq_cst);
+                if (pending() || stop_.load(std::memory_order_seq_cst))
+                {
+                    sleeping_.store(0, std::memory_order_relaxed);
+                    continue;
+                }
+                timeout_ms = 100;
+            }
+
+            pfds.clear();
+            pfds.push_back({wake_fd_, POLLIN, 0});
+            pfds.push_back({listen_fd_, POLLIN, 0});
+            for (auto& s : subs_)
+                pfds.push_back({s.fd, static_cast<short>(POLLIN | (s.out_pos < s.out.size() ? POLLOUT : 0)), 0});
+            int rc = ::poll(pfds.data(), pfds.size(), timeout_ms);
+            sleeping_.store(0, std::memory_order_relaxed);
+            last_poll_ns = steady_ns();
+            if (rc < 0 && errno != EINTR) break;
+            if (rc <= 0)
+            {
+                service(last_poll_ns);   // slow-consumer timeouts
+                continue;
+            }
+
+            if (pfds[0].revents & POLLIN)
+            {
+                uint64_t v;
+                (void)::read(wake_fd_, &v, sizeof(v));
+            }
+            for (size_t i = 0; i < subs_.size(); ++i)
+            {
+                short re = pfds[i + 2].revents;
+                if (!(re & (POLLIN | POLLHUP | POLLERR | POLLNVAL))) continue;
+                // subscribers send nothing: readable means gone (or garbage to drop)
+                char buf[512];
+                ssize_t k = ::recv(subs_[i].fd, buf, sizeof(buf), MSG_DONTWAIT);
+                if (k == 0 || (k < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                {
+                    ::close(subs_[i].fd);
+                    subs_[i].fd = -1;
+                    stats_.subscribers.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+            if (pfds[1].revents & POLLIN) accept_all();
+            service(last_poll_ns);   // writes, snapshots for new and drained subscribers
+        }
+    }
+
+} // namespace engine
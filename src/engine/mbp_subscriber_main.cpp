@@ -0,0 +1,107 @@
+#include "common/mbp_feed.hpp"
+#include "common/net.hpp"
+#include "common/hdr_histogram.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Subscribes to the engine's MBP-10 feed (ENGINE_MBP_PORT), rebuilds the top 10
+// levels from it and reports message rates and publish -> receive latency.
+namespace
+{
+    uint64_t wall_ns()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    void print_line(const char* tag, const mbp::Book& book, uint64_t updates, uint64_t snapshots,
+                    uint64_t out_of_seq, const metrics::HdrHistogram& lat)
+    {
+        const mbp::Level& b = book.levels[0][0];
+        const mbp::Level& a = book.levels[1][0];
+        std::cout << "[" << tag << "] seq=" << book.seq << " updates=" << updates << " snapshots=" << snapshots
+                  << " out_of_seq=" << out_of_seq << " levels=" << book.levels_on(0) << "/" << book.levels_on(1)
+                  << " bid=" << b.price << "x" << b.qty << " ask=" << a.price << "x" << a.qty;
+        if (lat.count())
+        {
+            std::cout << " latency_ns p50=" << lat.value_at_quantile(0.50) << " p99=" << lat.value_at_quantile(0.99)
+                      << " max=" << lat.max();
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: mbp_subscriber_app <[host:]port> [seconds] [slow_us]\n"
+                  << "  slow_us: sleep this long per message, to play a slow consumer\n";
+        return 1;
+    }
+    std::string target = argv[1];
+    std::string host = "127.0.0.1", port = target;
+    if (size_t c = target.rfind(':'); c != std::string::npos)
+    {
+        host = target.substr(0, c);
+        port = target.substr(c + 1);
+    }
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 0;   // 0: until the engine closes
+    const int slow_us = argc > 3 ? std::atoi(argv[3]) : 0;
+
+    try
+    {
+        int fd = net::connect_tcp(host, port);
+        mbp::Reader reader;
+        mbp::Book book;
+        metrics::HdrHistogram lat, lat_sec;
+        uint64_t updates = 0, snapshots = 0, out_of_seq = 0;
+        char buf[64 << 10];
+        const auto start = std::chrono::steady_clock::now();
+        auto next_report = start + std::chrono::seconds(1);
+
+        for (;;)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (seconds > 0 && now - start >= std::chrono::duration<double>(seconds)) break;
+            if (now >= next_report)
+            {
+                print_line("mbp", book, updates, snapshots, out_of_seq, lat_sec);
+                lat_sec.reset();
+                next_report += std::chrono::seconds(1);
+            }
+            if (!net::wait_readable(fd, 100)) continue;
+            size_t n = net::recv_some(fd, buf, sizeof(buf));
+            if (n == 0) break;
+            reader.append(buf, n);
+
+            mbp::MsgHeader h;
+            const mbp::Entry* entries;
+            while (reader.next(h, entries))
+            {
+                uint64_t t = wall_ns();
+                if (h.publish_ns && t > h.publish_ns)   // 0: the empty book sent before any event
+                {
+                    lat.record(t - h.publish_ns);
+                    lat_sec.record(t - h.publish_ns);
+                }
+                if (!book.apply(h, entries)) ++out_of_seq;
+                else if (h.type == static_cast<uint8_t>(mbp::MsgType::Snapshot)) ++snapshots;
+                else ++updates;
+                if (slow_us) std::this_thread::sleep_for(std::chrono::microseconds(slow_us));
+            }
+            if (reader.bad()) throw std::runtime_error("corrupt MBP stream");
+        }
+        net::close_fd(fd);
+        print_line("mbp_total", book, updates, snapshots, out_of_seq, lat);
+        return out_of_seq ? 2 : 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "mbp_subscriber error: " << e.what() << "\n";
+        return 1;
+    }
+}
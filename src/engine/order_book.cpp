@@ -5,58 +5,92 @@
 namespace engine
 {
 
-    static void erase_from_queue(std::deque<uint64_t>& dq, uint64_t id)
+    template <typename Queue>
+    static void erase_from_queue(Queue& dq, uint64_t id)
     {
-        auto it = std::find(dq.begin(), dq.end(), id);
+        auto it = std::find_if(dq.begin(), dq.end(), [id](const auto& q) { return q.id == id; });
         if (it != dq.end()) dq.erase(it);
     }
 
-    std::map<int64_t, std::deque<uint64_t>, std::greater<int64_t>>& OrderBook::bids_map(const OrderBook* self)
+    OrderBook::BidLevels& OrderBook::bids_map(const OrderBook* self)
     {
-        return const_cast<std::map<int64_t, std::deque<uint64_t>, std::greater<int64_t>>&>(self->bids_);
+        return const_cast<BidLevels&>(self->bids_);
     }
 
-    std::map<int64_t, std::deque<uint64_t>, std::less<int64_t>>& OrderBook::asks_map(const OrderBook* self)
+    OrderBook::AskLevels& OrderBook::asks_map(const OrderBook* self)
     {
-        return const_cast<std::map<int64_t, std::deque<uint64_t>, std::less<int64_t>>&>(self->asks_);
+        return const_cast<AskLevels&>(self->asks_);
     }
 
-    std::map<int64_t, std::deque<uint64_t>, std::greater<int64_t>>& OrderBook::side_map(Side s, const OrderBook* self)
+    OrderBook::BidLevels& OrderBook::side_map(Side s, const OrderBook* self)
     {
         return (s == Side::Bid)
             ? bids_map(self)
-            : reinterpret_cast<std::map<int64_t, std::deque<uint64_t>, std::greater<int64_t>>&>(asks_map(self));
+            : reinterpret_cast<BidLevels&>(asks_map(self));
+    }
+
+    // Remove id (resting qty) from the level at px; drops the level when it empties.
+    // Returns whether the level is still there.
+    template <typename Levels>
+    static bool leave_level(Levels& side, int64_t px, uint64_t id, int32_t qty)
+    {
+        auto lit = side.find(px);
+        if (lit == side.end()) return false;
+        erase_from_queue(lit->second.queue, id);
+        lit->second.qty -= qty;
+        if (!lit->second.queue.empty()) return true;
+        side.erase(lit);
+        return false;
+    }
+
+    // Returns whether the level was already there.
+    template <typename Levels, typename Order>
+    static bool join_level(Levels& side, int64_t px, uint64_t id, const Order* o, int32_t qty)
+    {
+        auto& lvl = side[px];
+        const bool existed = !lvl.queue.empty();
+        lvl.queue.push_back({id, o});
+        lvl.qty += qty;
+        return existed;
     }
 
     void OrderBook::add_order(uint64_t id, Side s, int64_t px, int32_t qty)
     {
-        orders_[id] = Order{px, qty, s};
+        // a reused id replaces the old order rather than leaving it queued twice
+        const bool replaced = orders_.count(id) != 0;
+        if (replaced) cancel_order(id);
+        const Order* o = &(orders_[id] = Order{px, qty, s});
+        touch(s, px);
+        bool existed;
         if (s == Side::Bid)
         {
-            bids_[px].push_back(id);
+            existed = join_level(bids_, px, id, o, qty);
         }
         else
         {
-            asks_[px].push_back(id);
+            existed = join_level(asks_, px, id, o, qty);
         }
+        effect_ = {EventKind::Add, true, s, px, qty, 0, 0,
+                   replaced ? Effect::Levels::Several : existed ? Effect::Levels::Size : Effect::Levels::Added, qty};
     }
 
     void OrderBook::cancel_order(uint64_t id)
     {
         auto it = orders_.find(id);
         if (it == orders_.end()) return;
-        auto s = it->second.side;
-        auto px = it->second.price;
-        if (s == Side::Bid)
+        const Order& o = it->second;
+        touch(o.side, o.price);
+        bool remains;
+        if (o.side == Side::Bid)
         {
-            erase_from_queue(bids_[px], id);
-            if (bids_[px].empty()) bids_.erase(px);
+            remains = leave_level(bids_, o.price, id, o.qty);
         }
         else
         {
-            erase_from_queue(asks_[px], id);
-            if (asks_[px].empty()) asks_.erase(px);
+            remains = leave_level(asks_, o.price, id, o.qty);
         }
+        effect_ = {EventKind::Cancel, true, o.side, o.price, o.qty, 0, 0,
+                   remains ? Effect::Levels::Size : Effect::Levels::Removed, -static_cast<int64_t>(o.qty)};
         orders_.erase(it);
     }
 
@@ -64,44 +98,69 @@ namespace engine
     {
         auto it = orders_.find(id);
         if (it == orders_.end()) return;
-        auto s = it->second.side;
-        auto old_px = it->second.price;
+        Order& o = it->second;
+        const int32_t qty = new_qty >= 0 ? new_qty : o.qty;
+        touch(o.side, o.price);
+        touch(o.side, new_px);
+        effect_ = {EventKind::Modify, true, o.side, new_px, qty, o.price, o.qty,
+                   new_px == o.price ? Effect::Levels::Size : Effect::Levels::Several,
+                   static_cast<int64_t>(qty) - o.qty};
 
         // If price changes -> remove from old queue and append to new queue tail (loses queue priority)
-        if (new_px != old_px)
+        if (new_px != o.price)
         {
-            if (s == Side::Bid)
+            if (o.side == Side::Bid)
             {
-                erase_from_queue(bids_[old_px], id);
-                if (bids_[old_px].empty()) bids_.erase(old_px);
-                bids_[new_px].push_back(id);
+                leave_level(bids_, o.price, id, o.qty);
+                join_level(bids_, new_px, id, &o, qty);
             }
             else
             {
-                erase_from_queue(asks_[old_px], id);
-                if (asks_[old_px].empty()) asks_.erase(old_px);
-                asks_[new_px].push_back(id);
+                leave_level(asks_, o.price, id, o.qty);
+                join_level(asks_, new_px, id, &o, qty);
             }
-            it->second.price = new_px;
+            o.price = new_px;
+        }
+        else if (o.side == Side::Bid)
+        {
+            bids_[o.price].qty += qty - o.qty;
+        }
+        else
+        {
+            asks_[o.price].qty += qty - o.qty;
         }
 
         // Update size
-        if (new_qty >= 0) it->second.qty = new_qty;
+        o.qty = qty;
     }
 
     void OrderBook::trade_order(uint64_t id, int32_t fill_qty)
     {
         auto it = orders_.find(id);
         if (it == orders_.end()) return;
-        it->second.qty -= fill_qty;
-        if (it->second.qty <= 0) 
+        Order& o = it->second;
+        touch(o.side, o.price);
+        Effect fill{EventKind::Trade, true, o.side, o.price, fill_qty, 0, 0, Effect::Levels::Size, -static_cast<int64_t>(fill_qty)};
+        if (o.side == Side::Bid) bids_[o.price].qty -= fill_qty;
+        else                     asks_[o.price].qty -= fill_qty;
+        const int32_t resting = o.qty;
+        o.qty -= fill_qty;
+        if (o.qty <= 0)
         {
+            // the cancel takes out what is left (or gives back an overfill)
             cancel_order(id);
+            fill.levels = effect_.levels;
+            fill.level_delta = -static_cast<int64_t>(resting);
         }
+        effect_ = fill;
     }
 
     void OrderBook::on_event(const MboEvent& ev)
     {
+        n_touched_ = 0;
+        cleared_ = false;
+        effect_ = Effect{};
+        effect_.kind = ev.kind;
         switch (ev.kind)
         {
             case EventKind::Add:
@@ -119,42 +178,117 @@ namespace engine
             case EventKind::Clear:  // drop entire side or both
             // clear both for now
                 bids_.clear(); asks_.clear(); orders_.clear();
+                cleared_ = true;
+                effect_.applied = true;
                 break;
         }
     }
 
-    BookSnapshot OrderBook::snapshot_top_n(size_t n) const
+    bool OrderBook::top_changed(size_t depth) const
     {
-        BookSnapshot snap;
-    // Bids: high -> low
-        for (auto it = bids_.begin(); it != bids_.end() && snap.bids.size() < n; ++it)
+        if (cleared_) return true;
+        if (depth == 0) return false;
+        // A touched level is in the top `depth` now if it is at or better than the
+        // depth-th level; a removed one was in it if it is better than that level now
+        // (everything better than it still is). With fewer levels, all of them are.
+        auto in_top = [depth](const auto& side, int64_t px)
+        {
+            if (side.size() < depth) return true;
+            auto kth = side.begin();
+            std::advance(kth, depth - 1);
+            return !side.key_comp()(kth->first, px);   // px at or better than the kth
+        };
+        for (uint8_t i = 0; i < n_touched_; ++i)
+        {
+            const LevelRef& t = touched_[i];
+            if (t.side == Side::Bid ? in_top(bids_, t.price) : in_top(asks_, t.price)) return true;
+        }
+        return false;
+    }
+
+    size_t OrderBook::top_levels(Side s, LevelView* out, size_t n) const
+    {
+        size_t k = 0;
+        auto fill = [&](const auto& side)
         {
-            int64_t sum = 0;
-            for (auto id : it->second)
+            for (auto it = side.begin(); it != side.end() && k < n; ++it, ++k)
             {
-                auto oit = orders_.find(id);
-                if (oit != orders_.end())
-                {
-                sum += oit->second.qty;
-                }
+                out[k] = {it->first, it->second.qty, static_cast<uint32_t>(it->second.queue.size())};
             }
-            snap.bids.push_back({it->first, sum, (uint32_t)it->second.size()});
+        };
+        if (s == Side::Bid) fill(bids_);
+        else                fill(asks_);
+        return k;
+    }
+
+    BookSnapshot OrderBook::snapshot_top_n(size_t n) const
+    {
+        BookSnapshot snap;
+        snap.bids.resize(std::min(n, bids_.size()));   // high -> low
+        snap.asks.resize(std::min(n, asks_.size()));   // low -> high
+        top_levels(Side::Bid, snap.bids.data(), snap.bids.size());
+        top_levels(Side::Ask, snap.asks.data(), snap.asks.size());
+        return snap;
+    }
+
+    template <typename Queue>
+    static void emit_level(int64_t px, const Queue& queue, std::vector<OrderBook::RestingOrder>& out)
+    {
+        for (const auto& q : queue)
+        {
+            OrderBook::RestingOrder r{};
+            r.id = q.id;
+            r.price = px;
+            r.qty = q.order->qty;
+            r.side = q.order->side;
+            out.push_back(r);
         }
-    // Asks: low -> high
-        for (auto it = asks_.begin(); it != asks_.end() && snap.asks.size() < n; ++it)
+    }
+
+    void OrderBook::export_orders(std::vector<RestingOrder>& out) const
+    {
+        out.reserve(out.size() + orders_.size());
+        for (const auto& [px, lvl] : bids_) emit_level(px, lvl.queue, out);
+        for (const auto& [px, lvl] : asks_) emit_level(px, lvl.queue, out);
+    }
+
+    void OrderBook::export_level(Side s, int64_t price, std::vector<RestingOrder>& out) const
+    {
+        auto emit = [&](const auto& side)
+        {
+            auto it = side.find(price);
+            if (it != side.end()) emit_level(price, it->second.queue, out);
+        };
+        if (s == Side::Bid) emit(bids_);
+        else                emit(asks_);
+    }
+
+    void OrderBook::restore(const RestingOrder* orders, size_t n)
+    {
+        bids_.clear();
+        asks_.clear();
+        orders_.clear();
+        orders_.reserve(n);
+
+        // input is sorted level by level, so each new level goes at the end of its map
+        Level* bid_lvl = nullptr;
+        Level* ask_lvl = nullptr;
+        int64_t bid_px = 0, ask_px = 0;
+        for (size_t i = 0; i < n; ++i)
         {
-            int64_t sum = 0;
-            for (auto id : it->second)
+            const RestingOrder& r = orders[i];
+            const Order* o = &(orders_[r.id] = Order{r.price, r.qty, r.side});
+            Level*& lvl = r.side == Side::Bid ? bid_lvl : ask_lvl;
+            int64_t& px = r.side == Side::Bid ? bid_px : ask_px;
+            if (!lvl || px != r.price)
             {
-                auto oit = orders_.find(id);
-                if (oit != orders_.end())
-                {
-                    sum += oit->second.qty;
-                }
+                lvl = r.side == Side::Bid ? &bids_.emplace_hint(bids_.end(), r.price, Level{})->second
+                                          : &asks_.emplace_hint(asks_.end(), r.price, Level{})->second;
+                px = r.price;
             }
-            snap.asks.push_back({it->first, sum, (uint32_t)it->second.size()});
+            lvl->queue.push_back({r.id, o});
+            lvl->qty += r.qty;
         }
-        return snap;
     }
 
     BookSnapshot OrderBook::snapshot_full() const
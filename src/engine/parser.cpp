@@ -0,0 +1,108 @@
+#include "engine/parser.hpp"
+#include <charconv>
+
+namespace engine
+{
+
+    namespace
+    {
+        // Comma-separated fields of one line, viewed in place. Extra fields past
+        // kMax are ignored, as are fields after the ones a kind needs.
+        struct Fields
+        {
+            static constexpr size_t kMax = 8;
+            std::string_view f[kMax];
+            size_t n = 0;
+
+            explicit Fields(std::string_view s)
+            {
+                if (s.empty()) return;
+                size_t pos = 0;
+                while (n < kMax)
+                {
+                    size_t comma = s.find(',', pos);
+                    if (comma == std::string_view::npos)
+                    {
+                        f[n++] = s.substr(pos);
+                        break;
+                    }
+                    f[n++] = s.substr(pos, comma - pos);
+                    pos = comma + 1;
+                }
+            }
+        };
+
+        // Leading digits of a field; false when there are none or the value is out
+        // of range for T. Trailing characters (e.g. '\r') are ignored like stoull did.
+        template <class T>
+        bool num(std::string_view s, T& out)
+        {
+            auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+            return r.ec == std::errc();
+        }
+    }
+
+    size_t parse_send_stamp(std::string_view line, uint64_t& send_wall_ns)
+    {
+        send_wall_ns = 0;
+        if (line.empty() || line[0] != '@') return 0;
+
+        // find first comma
+        size_t comma = line.find(',', 1);
+        if (comma == std::string_view::npos) return 0;
+
+        // parse the number between '@' and ','; if it fails, ignore the E2E stamp
+        if (!num(line.substr(1, comma - 1), send_wall_ns))
+        {
+            send_wall_ns = 0;
+            return 0;
+        }
+        return comma + 1; // skip past the comma; remaining is the original CSV
+    }
+
+    bool parse_event(std::string_view line, size_t start, MboEvent& ev)
+    {
+        Fields fields(line.substr(start));
+        if (fields.n == 0) return false;
+
+        ev = MboEvent{};
+        const auto* f = fields.f;
+        std::string_view kind = f[0];
+
+        if (kind == "ADD" && fields.n >= 6)
+        {
+            ev.kind = EventKind::Add;
+            // fields: ADD, ts_ns, side, order_id, price, qty
+            ev.side = (f[2] == "B") ? Side::Bid : Side::Ask;
+            return num(f[1], ev.ts_ns) && num(f[3], ev.order_id) &&
+                   num(f[4], ev.price) && num(f[5], ev.qty);
+        }
+        if (kind == "MOD" && fields.n >= 5)
+        {
+            ev.kind = EventKind::Modify;
+            // MOD, ts_ns, order_id, new_price, new_qty
+            return num(f[1], ev.ts_ns) && num(f[2], ev.order_id) &&
+                   num(f[3], ev.new_price) && num(f[4], ev.new_qty);
+        }
+        if (kind == "CXL" && fields.n >= 3)
+        {
+            ev.kind = EventKind::Cancel;
+            // CXL, ts_ns, order_id
+            return num(f[1], ev.ts_ns) && num(f[2], ev.order_id);
+        }
+        if (kind == "TRD" && fields.n >= 4)
+        {
+            ev.kind = EventKind::Trade;
+            // TRD, ts_ns, order_id, fill_qty
+            return num(f[1], ev.ts_ns) && num(f[2], ev.order_id) && num(f[3], ev.qty);
+        }
+        if (kind == "CLR" && fields.n >= 2)
+        {
+            ev.kind = EventKind::Clear;
+            return num(f[1], ev.ts_ns);
+        }
+        // unknown line; ignore for now
+        return false;
+    }
+
+} // namespace engine
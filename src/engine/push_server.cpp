@@ -0,0 +1,279 @@
+#include "engine/push_server.hpp"
+#include "common/net.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace engine
+{
+
+    namespace
+    {
+        uint64_t steady_ns()
+        {
+            using namespace std::chrono;
+            return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Value of `key` in the query of target ("/path?a=1&b=2"), or "" if absent.
+        std::string query_param(const std::string& target, const char* key)
+        {
+            size_t q = target.find('?');
+            if (q == std::string::npos) return {};
+            const size_t klen = std::strlen(key);
+            size_t i = q + 1;
+            while (i < target.size())
+            {
+                size_t amp = target.find('&', i);
+                if (amp == std::string::npos) amp = target.size();
+                if (amp - i > klen && target.compare(i, klen, key) == 0 && target[i + klen] == '=')
+                    return target.substr(i + klen + 1, amp - i - klen - 1);
+                i = amp + 1;
+            }
+            return {};
+        }
+
+        bool parse_uint(const std::string& s, uint64_t& v)
+        {
+            auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+            return r.ec == std::errc() && r.ptr == s.data() + s.size();
+        }
+
+        // Best effort: the caller closes the connection after it.
+        void reply_error(int fd, const char* status, const char* body)
+        {
+            std::string msg = std::string("HTTP/1.1 ") + status + "\r\nContent-Type: text/plain\r\nContent-Length: "
+                            + std::to_string(std::strlen(body)) + "\r\nConnection: close\r\n\r\n" + body;
+            (void)::send(fd, msg.data(), msg.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+    }
+
+    void PushServer::start(const std::string& host, const std::string& port, Options opt)
+    {
+        opt_ = opt;
+        opt_.max_hz = std::max(opt_.max_hz, 1);
+        listen_fd_ = net::listen_tcp(host, port);
+        net::set_nonblocking(listen_fd_, true);
+        sockaddr_storage addr{};
+        socklen_t len = sizeof(addr);
+        if (::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) == 0)
+        {
+            port_ = addr.ss_family == AF_INET6 ? ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port)
+                                               : ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+        }
+        stop_.store(false, std::memory_order_relaxed);
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    void PushServer::stop()
+    {
+        if (!thread_.joinable()) return;
+        stop_.store(true, std::memory_order_relaxed);
+        thread_.join();
+        for (auto& s : subs_) ::close(s.fd);
+        subs_.clear();
+        stats_.subscribers.store(0, std::memory_order_relaxed);
+        net::close_fd(listen_fd_);
+        listen_fd_ = -1;
+    }
+
+    void PushServer::loop()
+    {
+        std::vector<pollfd> pfds;
+        while (!stop_.load(std::memory_order_relaxed))
+        {
+            // sleep until a subscriber is due (to sample the version), has room to
+            // write, or sent something; at most 100ms so stop() is noticed
+            uint64_t now = steady_ns();
+            uint64_t wait_ns = 100'000'000;
+            pfds.clear();
+            pfds.push_back({listen_fd_, POLLIN, 0});
+            for (auto& s : subs_)
+            {
+                short ev = POLLIN;
+                if (s.out_pos < s.out.size()) ev |= POLLOUT;
+                else if (s.streaming) wait_ns = std::min(wait_ns, s.next_due_ns > now ? s.next_due_ns - now : 0);
+                pfds.push_back({s.fd, ev, 0});
+            }
+            int timeout_ms = static_cast<int>((wait_ns + 999'999) / 1'000'000);
+            if (::poll(pfds.data(), pfds.size(), timeout_ms) < 0 && errno != EINTR) break;
+
+            now = steady_ns();
+            // pfds[i + 1] belongs to subs_[i]; subscribers accepted below are polled next round
+            const size_t polled = pfds.size() - 1;
+            for (size_t i = 0; i < polled; ++i)
+            {
+                Subscriber& s = subs_[i];
+                short re = pfds[i + 1].revents;
+                bool keep = true;
+                if (re & (POLLERR | POLLNVAL)) keep = false;
+                else if (re & (POLLIN | POLLHUP)) keep = on_readable(s);
+                if (keep && (re & POLLOUT)) keep = flush(s, now);
+                if (keep && s.streaming) publish(s, now);
+                if (!keep)
+                {
+                    if (s.streaming) stats_.subscribers.fetch_sub(1, std::memory_order_relaxed);
+                    ::close(s.fd);
+                    s.fd = -1;
+                }
+            }
+            subs_.erase(std::remove_if(subs_.begin(), subs_.end(), [](const Subscriber& s) { return s.fd < 0; }), subs_.end());
+
+            if (pfds[0].revents & POLLIN)
+            {
+                for (;;)
+                {
+                    int fd = ::accept(listen_fd_, nullptr, nullptr);
+                    if (fd < 0) break;
+                    net::set_nonblocking(fd, true);
+                    if (subs_.size() >= opt_.max_subscribers)
+                    {
+                        stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+                        reply_error(fd, "503 Service Unavailable", "too many subscribers\n");
+                        ::close(fd);
+                        continue;
+                    }
+                    Subscriber s;
+                    s.fd = fd;
+                    subs_.push_back(std::move(s));
+                }
+            }
+        }
+    }
+
+    bool PushServer::on_readable(Subscriber& s)
+    {
+        char buf[1024];
+        for (;;)
+        {
+            ssize_t n = ::recv(s.fd, buf, sizeof(buf), 0);
+            if (n == 0) return false;                 // the client went away
+            if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            if (s.streaming) continue;                // nothing more is expected; drop it
+            s.request.append(buf, static_cast<size_t>(n));
+            if (s.request.find("\r\n\r\n") != std::string::npos) return start_stream(s);
+            if (s.request.size() > 8192)
+            {
+                stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+                reply_error(s.fd, "431 Request Header Fields Too Large", "request too large\n");
+                return false;
+            }
+        }
+    }
+
+    bool PushServer::start_stream(Subscriber& s)
+    {
+        // "GET <target> HTTP/1.x"
+        std::string target;
+        if (s.request.compare(0, 4, "GET ") == 0)
+        {
+            size_t sp = s.request.find(' ', 4);
+            if (sp != std::string::npos) target = s.request.substr(4, sp - 4);
+        }
+        std::string path = target.substr(0, target.find('?'));
+
+        const char* error = nullptr;
+        uint64_t n = 0;
+        if (path == "/stream/top")
+        {
+            std::string ns = query_param(target, "n");
+            n = 5;
+            if (!ns.empty() && (!parse_uint(ns, n) || n == 0 || n >= ResponseCache::kSlots))
+                error = "n must be 1..64\n";
+        }
+        else if (path != "/stream/spread")
+        {
+            stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+            reply_error(s.fd, "404 Not Found", "streams: /stream/top?n=<1..64>[&max_hz=], /stream/spread[?max_hz=]\n");
+            return false;
+        }
+        uint64_t hz = static_cast<uint64_t>(opt_.max_hz);
+        if (std::string hs = query_param(target, "max_hz"); !hs.empty())
+        {
+            if (!parse_uint(hs, hz) || hz == 0) error = "max_hz must be a positive integer\n";
+            hz = std::min<uint64_t>(hz, static_cast<uint64_t>(opt_.max_hz));
+        }
+        if (error)
+        {
+            stats_.rejected.fetch_add(1, std::memory_order_relaxed);
+            reply_error(s.fd, "400 Bad Request", error);
+            return false;
+        }
+
+        s.streaming = true;
+        s.slot = static_cast<size_t>(n);
+        s.interval_ns = 1'000'000'000ULL / hz;
+        s.next_due_ns = 0;   // the current state goes out right away
+        s.request.clear();
+        s.request.shrink_to_fit();
+        s.out = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                "Connection: close\r\nX-Accel-Buffering: no\r\n\r\n";
+        s.out_pos = 0;
+        stats_.accepted.fetch_add(1, std::memory_order_relaxed);
+        stats_.subscribers.fetch_add(1, std::memory_order_relaxed);
+        return flush(s, steady_ns());
+    }
+
+    bool PushServer::flush(Subscriber& s, uint64_t now)
+    {
+        while (s.out_pos < s.out.size())
+        {
+            ssize_t n = ::send(s.fd, s.out.data() + s.out_pos, s.out.size() - s.out_pos, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            s.out_pos += static_cast<size_t>(n);
+            stats_.bytes.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            s.last_write_ns = now;
+        }
+        s.out.clear();
+        s.out_pos = 0;
+        return true;
+    }
+
+    void PushServer::publish(Subscriber& s, uint64_t now)
+    {
+        if (s.out_pos < s.out.size() || now < s.next_due_ns) return;
+        s.next_due_ns = now + s.interval_ns;
+        const uint64_t v = views_.version();
+        if (v != s.version)
+        {
+            uint64_t shown = 0, changes = 0;
+            const size_t n = s.slot;
+            ResponseCache::Body body = views_.get(s.slot, [&](uint64_t& rv) { return render_(n, rv); }, shown, &changes);
+            s.version = shown;
+            if (!s.body || (body != s.body && *body != *s.body))
+            {
+                // bodies rendered for other readers meanwhile are states this one skipped
+                if (s.body && changes > s.changes + 1)
+                    stats_.conflated.fetch_add(changes - s.changes - 1, std::memory_order_relaxed);
+                s.body = std::move(body);
+                s.changes = changes;
+
+                s.out = "id: ";
+                s.out += std::to_string(shown);
+                s.out += s.slot ? "\nevent: top\ndata: " : "\nevent: spread\ndata: ";
+                s.out += *s.body;
+                s.out += "\n\n";
+                stats_.events.fetch_add(1, std::memory_order_relaxed);
+                flush(s, now);
+                return;
+            }
+        }
+        if (now - s.last_write_ns >= static_cast<uint64_t>(opt_.heartbeat_ms) * 1'000'000)
+        {
+            s.out = ":\n\n";
+            flush(s, now);
+        }
+    }
+
+} // namespace engine
@@ -0,0 +1,65 @@
+#include "engine/response_cache.hpp"
+#include <chrono>
+
+namespace engine
+{
+
+    uint64_t ResponseCache::wait_newer(uint64_t since, int timeout_ms, bool deep)
+    {
+        const std::atomic<uint64_t>& ver = deep ? deep_version_ : version_;
+        uint64_t v = ver.load(std::memory_order_acquire);
+        if (v > since || timeout_ms <= 0) return v;
+
+        stats_.long_polls.fetch_add(1, std::memory_order_relaxed);
+        // waiters_ goes up before the version is checked again under wait_mtx_, and
+        // bump() is seq_cst: either notify() sees the waiter or the check sees the bump
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lk(wait_mtx_);
+            bool changed = wait_cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                [&] { return ver.load(std::memory_order_seq_cst) > since; });
+            if (!changed) stats_.poll_timeouts.fetch_add(1, std::memory_order_relaxed);
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return ver.load(std::memory_order_acquire);
+    }
+
+    static const uint64_t kBootEpoch = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+    uint64_t ResponseCache::boot_epoch() { return kBootEpoch; }
+
+    std::string ResponseCache::etag(uint64_t version)
+    {
+        std::string tag;
+        tag.reserve(44);   // "<20 digits>-<20 digits>"
+        tag += '"';
+        tag += std::to_string(boot_epoch());
+        tag += '-';
+        tag += std::to_string(version);
+        tag += '"';
+        return tag;
+    }
+
+    bool ResponseCache::etag_matches(const std::string& if_none_match, uint64_t version)
+    {
+        // a list of entity tags, weak (W/"..") or strong, or "*"; a tag matches only
+        // with this process's epoch and the current version
+        const std::string tag = etag(version);
+        size_t i = 0;
+        while (i < if_none_match.size())
+        {
+            while (i < if_none_match.size() && (if_none_match[i] == ' ' || if_none_match[i] == ',')) ++i;
+            size_t j = if_none_match.find(',', i);
+            if (j == std::string::npos) j = if_none_match.size();
+            size_t k = j;
+            while (k > i && if_none_match[k - 1] == ' ') --k;
+            std::string one = if_none_match.substr(i, k - i);
+            if (one.compare(0, 2, "W/") == 0) one.erase(0, 2);
+            if (one == "*" || one == tag) return true;
+            i = j;
+        }
+        return false;
+    }
+
+} // namespace engine
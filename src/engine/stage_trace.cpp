@@ -0,0 +1,65 @@
+#include "engine/stage_trace.hpp"
+
+namespace engine
+{
+
+    static const char* kind_name(int k)
+    {
+        static const char* names[] = { "ADD", "MOD", "CXL", "TRD", "CLR" };
+        return (k >= 0 && k < 5) ? names[k] : "?";
+    }
+
+    const char* stage_name(Stage s)
+    {
+        switch (s)
+        {
+            case Stage::Recv:    return "recv";
+            case Stage::Frame:   return "frame";
+            case Stage::Parse:   return "parse";
+            case Stage::Lock:    return "lock";
+            case Stage::Apply:   return "apply";
+            case Stage::Publish: return "publish";
+            case Stage::Total:   return "total";
+            default:             return "?";
+        }
+    }
+
+    StageTracer::StageTracer()
+    {
+        // stages are short: 1ns..100ms at 2 digits keeps each histogram ~21KB
+        for (auto& h : hist_) h = std::make_unique<metrics::HdrRecorder>(100'000'000ULL, 2);
+        recv_ = std::make_unique<metrics::HdrRecorder>(100'000'000ULL, 2);
+    }
+
+    static void line(std::ostream& os, const char* stage, const char* kind, const metrics::HdrHistogram& h)
+    {
+        os << "[stage_ns] stage=" << stage << " kind=" << kind
+           << " samples=" << h.count()
+           << " mean="   << static_cast<uint64_t>(h.mean())
+           << " p50="    << h.value_at_quantile(0.50)
+           << " p99="    << h.value_at_quantile(0.99)
+           << " p99.9="  << h.value_at_quantile(0.999)
+           << " max="    << h.max() << "\n";
+    }
+
+    void StageTracer::dump(std::ostream& os) const
+    {
+        os << "[stage_clock] source=" << (metrics::TscClock::using_tsc() ? "rdtscp" : "clock_gettime")
+           << " ticks_per_ns=" << metrics::TscClock::ticks_per_ns() << "\n";
+        metrics::HdrHistogram recv = recv_->snapshot();
+        if (recv.count()) line(os, stage_name(Stage::Recv), "CHUNK", recv);
+        for (int s = 0; s < kStages; ++s)
+        {
+            metrics::HdrHistogram all(100'000'000ULL, 2);
+            for (int k = 0; k < kKinds; ++k)
+            {
+                metrics::HdrHistogram h = hist_[s * kKinds + k]->snapshot();
+                if (h.count() == 0) continue;
+                all.merge(h);
+                line(os, stage_name(static_cast<Stage>(s)), kind_name(k), h);
+            }
+            if (all.count()) line(os, stage_name(static_cast<Stage>(s)), "ALL", all);
+        }
+    }
+
+} // namespace engine
@@ -0,0 +1,260 @@
+#include "engine/time_index.hpp"
+#include "engine/checkpoint.hpp"
+#include "engine/parser.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace engine
+{
+
+    namespace
+    {
+        // Index file: IndexHeader | checkpoint images | Entry table (at table_offset)
+        struct IndexHeader
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t reserved;
+            uint64_t feed_size;
+            uint64_t feed_fingerprint;   // feed_fingerprint() of the feed it was built from
+            uint64_t every_events;
+            uint64_t every_ns;
+            uint64_t entries;
+            uint64_t table_offset;
+        };
+
+        constexpr uint32_t kIndexMagic   = 0x58444954;   // "TIDX"
+        constexpr uint16_t kIndexVersion = 2;
+        constexpr size_t   kFingerprintSpan = 64 * 1024;
+
+        uint64_t fnv1a(const char* p, size_t n, uint64_t h = 1469598103934665603ULL)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                h ^= static_cast<unsigned char>(p[i]);
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+
+        // FNV-1a over the first and last 64 KB: tells a rewritten feed of the same
+        // size from the one the index was built for, without reading the whole file.
+        // A same-size edit confined to the middle of a large file goes unnoticed.
+        uint64_t feed_fingerprint(const char* data, size_t size)
+        {
+            const size_t n = std::min(size, kFingerprintSpan);
+            return fnv1a(data + size - n, n, fnv1a(data, n));
+        }
+
+        // Calls fn(line, end_offset) for each complete line of data[from, size).
+        template <typename Fn>
+        void for_each_line(const char* data, size_t size, size_t from, Fn&& fn)
+        {
+            std::string line;
+            size_t pos = from;
+            while (pos < size)
+            {
+                const char* nl = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+                if (!nl) return;   // unterminated tail: not a complete line yet
+                size_t end = static_cast<size_t>(nl - data);
+                line.assign(data + pos, end - pos);
+                pos = end + 1;
+                if (!fn(line, pos)) return;
+            }
+        }
+
+        bool parse_line(const std::string& line, MboEvent& ev)
+        {
+            uint64_t send_ns = 0;
+            size_t start = parse_send_stamp(line, send_ns);
+            return parse_event(line, start, ev);
+        }
+    }
+
+    static void map_file(const std::string& path, const char*& data, size_t& size)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+        struct stat st{};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        size = static_cast<size_t>(st.st_size);
+        data = nullptr;
+        if (size > 0)
+        {
+            void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("cannot mmap " + path + ": " + std::strerror(errno));
+            }
+            data = static_cast<const char*>(p);
+        }
+        ::close(fd);
+    }
+
+    static void unmap(const char* data, size_t size)
+    {
+        if (data) ::munmap(const_cast<char*>(data), size);
+    }
+
+    void TimeIndex::build(const std::string& feed_path, const std::string& index_path, const Options& opt)
+    {
+        const char* feed = nullptr;
+        size_t feed_size = 0;
+        map_file(feed_path, feed, feed_size);
+        ::madvise(const_cast<char*>(feed), feed_size, MADV_SEQUENTIAL);
+
+        const std::string tmp = index_path + ".tmp";
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            unmap(feed, feed_size);
+            throw std::runtime_error("cannot create " + tmp);
+        }
+
+        IndexHeader hdr{};
+        hdr.magic = kIndexMagic;
+        hdr.version = kIndexVersion;
+        hdr.feed_size = feed_size;
+        hdr.feed_fingerprint = feed_fingerprint(feed, feed_size);
+        hdr.every_events = opt.every_events;
+        hdr.every_ns = opt.every_ns;
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+        OrderBook book;
+        std::vector<Entry> entries;
+        std::vector<OrderBook::RestingOrder> orders;
+        uint64_t offset = sizeof(hdr);
+        auto checkpoint = [&](uint64_t ts, uint64_t feed_offset, uint64_t lines)
+        {
+            orders.clear();
+            book.export_orders(orders);
+            CheckpointInfo info;
+            info.feed_offset = feed_offset;
+            info.lines = lines;
+            info.last_ts_ns = ts;
+            info.bid_levels = book.level_count(Side::Bid);
+            info.ask_levels = book.level_count(Side::Ask);
+            CheckpointHeader h = checkpoint_header(orders, info);
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(reinterpret_cast<const char*>(orders.data()),
+                      static_cast<std::streamsize>(orders.size() * sizeof(OrderBook::RestingOrder)));
+            uint64_t size = sizeof(h) + orders.size() * sizeof(OrderBook::RestingOrder);
+            entries.push_back({ts, feed_offset, lines, offset, size});
+            offset += size;
+        };
+
+        checkpoint(0, 0, 0);   // the empty book, for times before the first checkpoint
+        uint64_t lines = 0, since = 0, last_ts = 0, ckpt_ts = 0;
+        MboEvent ev{};
+        for_each_line(feed, feed_size, 0, [&](const std::string& line, size_t end)
+        {
+            ++lines;
+            if (!parse_line(line, ev)) return true;
+            book.on_event(ev);
+            last_ts = ev.ts_ns;
+            if (ckpt_ts == 0) ckpt_ts = ev.ts_ns;
+            ++since;
+            if ((opt.every_events && since >= opt.every_events) ||
+                (opt.every_ns && ev.ts_ns - ckpt_ts >= opt.every_ns))
+            {
+                checkpoint(last_ts, end, lines);
+                since = 0;
+                ckpt_ts = ev.ts_ns;
+            }
+            return true;
+        });
+        unmap(feed, feed_size);
+
+        hdr.entries = entries.size();
+        hdr.table_offset = offset;
+        out.write(reinterpret_cast<const char*>(entries.data()),
+                  static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        out.close();
+        if (!out) throw std::runtime_error("write to " + tmp + " failed");
+        if (std::rename(tmp.c_str(), index_path.c_str()) != 0)
+            throw std::runtime_error("cannot rename " + tmp + " to " + index_path);
+    }
+
+    TimeIndex::TimeIndex(const std::string& feed_path, const std::string& index_path) : feed_path_(feed_path)
+    {
+        map_file(index_path, index_.data, index_.size);
+        try
+        {
+            IndexHeader hdr;
+            if (index_.size < sizeof(hdr)) throw std::runtime_error(index_path + " is not a time index");
+            std::memcpy(&hdr, index_.data, sizeof(hdr));
+            if (hdr.magic != kIndexMagic || hdr.version != kIndexVersion)
+                throw std::runtime_error(index_path + " is not a time index");
+            if (hdr.entries == 0 || hdr.table_offset + hdr.entries * sizeof(Entry) != index_.size)
+                throw std::runtime_error(index_path + " is truncated");
+            entries_.resize(hdr.entries);
+            std::memcpy(entries_.data(), index_.data + hdr.table_offset, hdr.entries * sizeof(Entry));
+            for (const auto& e : entries_)
+            {
+                if (e.image_offset + e.image_size > hdr.table_offset)
+                    throw std::runtime_error(index_path + " has an entry outside the file");
+            }
+
+            map_file(feed_path, feed_.data, feed_.size);
+            if (feed_.size != hdr.feed_size || feed_fingerprint(feed_.data, feed_.size) != hdr.feed_fingerprint)
+                throw std::runtime_error(index_path + " was built for a different version of " + feed_path);
+        }
+        catch (...)
+        {
+            unmap(index_.data, index_.size);
+            unmap(feed_.data, feed_.size);
+            throw;
+        }
+    }
+
+    TimeIndex::~TimeIndex()
+    {
+        unmap(index_.data, index_.size);
+        unmap(feed_.data, feed_.size);
+    }
+
+    TimeIndex::Result TimeIndex::book_at(uint64_t ts_ns, OrderBook& book) const
+    {
+        // last checkpoint at or before ts_ns (entry 0, the empty book, always qualifies)
+        auto it = std::upper_bound(entries_.begin() + 1, entries_.end(), ts_ns,
+                                   [](uint64_t t, const Entry& e) { return t < e.ts_ns; });
+        const Entry& e = *(it - 1);
+        CheckpointInfo info = restore_checkpoint_image(index_.data + e.image_offset, e.image_size, book);
+
+        Result r;
+        r.as_of_ts_ns = info.last_ts_ns;
+        r.lines = e.lines;
+        MboEvent ev{};
+        for_each_line(feed_.data, feed_.size, e.feed_offset, [&](const std::string& line, size_t)
+        {
+            if (!parse_line(line, ev))
+            {
+                ++r.lines;
+                return true;
+            }
+            if (ev.ts_ns > ts_ns) return false;
+            book.on_event(ev);
+            r.as_of_ts_ns = ev.ts_ns;
+            ++r.lines;
+            ++r.replayed;
+            return true;
+        });
+        return r;
+    }
+
+} // namespace engine
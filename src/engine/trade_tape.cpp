@@ -0,0 +1,149 @@
+#include "engine/trade_tape.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace engine
+{
+
+    TradeTape::TradeTape(Options opt) : prints_(std::max<size_t>(opt.prints, 1))
+    {
+        for (uint64_t ns : opt.intervals_ns)
+        {
+            if (ns == 0 || series_.size() == kMaxIntervals) continue;
+            series_.push_back(std::make_unique<Series>(ns, std::max<size_t>(opt.bars, 1)));
+        }
+    }
+
+    uint64_t TradeTape::parse_interval(const std::string& s)
+    {
+        size_t pos = 0;
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') ++pos;
+        if (pos == 0 || pos > 12) return 0;
+        const uint64_t n = std::stoull(s.substr(0, pos));
+        const std::string unit = s.substr(pos);
+        uint64_t ns_per = 0;
+        if (unit == "ms") ns_per = 1'000'000;
+        else if (unit == "s" || unit.empty()) ns_per = 1'000'000'000;
+        else if (unit == "m") ns_per = 60'000'000'000;
+        else if (unit == "h") ns_per = 3'600'000'000'000;
+        if (ns_per == 0 || n > UINT64_MAX / ns_per) return 0;   // unknown unit, or too long
+        return n * ns_per;
+    }
+
+    std::string TradeTape::interval_name(uint64_t ns)
+    {
+        static const struct { uint64_t ns; const char* unit; } units[] = {
+            {3'600'000'000'000, "h"}, {60'000'000'000, "m"}, {1'000'000'000, "s"}, {1'000'000, "ms"}};
+        for (const auto& u : units)
+            if (ns % u.ns == 0) return std::to_string(ns / u.ns) + u.unit;
+        return std::to_string(ns) + "ns";
+    }
+
+    void TradeTape::publish_open(Series& s, const Bar& b)
+    {
+        const uint64_t v = s.version.load(std::memory_order_relaxed);
+        s.version.store(v + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.open = b;
+        s.version.store(v + 2, std::memory_order_release);
+    }
+
+    void TradeTape::close_due()
+    {
+        next_close_ns_ = UINT64_MAX;
+        for (auto& sp : series_)
+        {
+            Series& s = *sp;
+            if (s.open.trades == 0) continue;
+            const uint64_t end = s.open.start_ns + s.ns;
+            if (now_ns_ >= end)
+            {
+                s.closed.push(s.open);
+                publish_open(s, Bar{});
+            }
+            else
+            {
+                next_close_ns_ = std::min(next_close_ns_, end);
+            }
+        }
+    }
+
+    void TradeTape::on_event(const OrderBook& book, const MboEvent& ev)
+    {
+        // feed time only moves forward; bars close on any event past their end
+        if (ev.ts_ns > now_ns_)
+        {
+            now_ns_ = ev.ts_ns;
+            if (now_ns_ >= next_close_ns_) close_due();
+        }
+
+        const OrderBook::Effect& e = book.last_effect();
+        if (e.kind != EventKind::Trade || !e.applied) return;
+
+        Print p;
+        p.ts_ns = ev.ts_ns;
+        p.price = e.price;
+        p.qty = e.qty;
+        p.order_id = ev.order_id;
+        p.aggressor = e.side == Side::Bid ? Side::Ask : Side::Bid;   // it took the resting side
+        prints_.push(p);
+
+        for (auto& sp : series_)
+        {
+            Series& s = *sp;
+            Bar b = s.open;   // only this thread writes it
+            if (b.trades == 0)
+            {
+                b.start_ns = now_ns_ - now_ns_ % s.ns;
+                b.open = b.high = b.low = p.price;
+                next_close_ns_ = std::min(next_close_ns_, b.start_ns + s.ns);
+            }
+            b.high = std::max(b.high, p.price);
+            b.low = std::min(b.low, p.price);
+            b.close = p.price;
+            b.volume += p.qty;
+            ++b.trades;
+            b.notional += static_cast<double>(p.price) * static_cast<double>(p.qty);
+            publish_open(s, b);
+        }
+    }
+
+    size_t TradeTape::recent(size_t n, std::vector<Print>& out) const
+    {
+        out.clear();
+        n = std::min(n, prints_.capacity());
+        Print p;
+        for (uint64_t i = prints_.count(); i > 0 && out.size() < n; --i)
+        {
+            if (!prints_.read(i - 1, p)) break;   // the writer has lapped us
+            out.push_back(p);
+        }
+        return out.size();
+    }
+
+    size_t TradeTape::bars(size_t i, size_t n, std::vector<Bar>& out) const
+    {
+        out.clear();
+        const SeqRing<Bar>& ring = series_[i]->closed;
+        const uint64_t count = ring.count();
+        const uint64_t first = count - std::min<uint64_t>({n, count, ring.capacity()});
+        Bar b;
+        for (uint64_t k = first; k < count; ++k)
+            if (ring.read(k, b)) out.push_back(b);   // the oldest may be overwritten meanwhile
+        return out.size();
+    }
+
+    bool TradeTape::open_bar(size_t i, Bar& out) const
+    {
+        const Series& s = *series_[i];
+        for (;;)
+        {
+            const uint64_t v = s.version.load(std::memory_order_acquire);
+            if (v & 1) continue;
+            out = s.open;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.version.load(std::memory_order_relaxed) == v) return out.trades != 0;
+        }
+    }
+
+} // namespace engine
@@ -0,0 +1,114 @@
+#include "engine/udp_source.hpp"
+#include "common/net.hpp"
+#include <cstring>
+
+namespace engine
+{
+
+    DatagramBatch::DatagramBatch() : slots(kBatch * kSlotBytes)
+    {
+        for (int i = 0; i < kBatch; ++i) ptrs[i] = slots.data() + i * kSlotBytes;
+    }
+
+    int DatagramBatch::receive(int fd)
+    {
+        for (int i = 0; i < kBatch; ++i) lens[i] = kSlotBytes;
+        int n = net::recvmmsg_batch(fd, ptrs, lens, kBatch);
+        count = n;
+        next = 0;
+        return n;
+    }
+
+    size_t DatagramBatch::pending_payload() const
+    {
+        size_t n = 0;
+        for (int i = next; i < count; ++i) n += lens[i] > sizeof(feed::PacketHeader) ? lens[i] - sizeof(feed::PacketHeader) : 0;
+        return n;
+    }
+
+    size_t UdpSource::read(char* buf, size_t cap)
+    {
+        if (end_pending_)
+        {
+            end_pending_ = false;
+            return 0;
+        }
+        size_t out = 0;
+        for (;;)
+        {
+            while (!batch_.done())
+            {
+                const char* pkt = static_cast<const char*>(batch_.ptrs[batch_.next]);
+                const size_t len = batch_.lens[batch_.next];
+                feed::PacketHeader h;
+                if (!feed::read_header(pkt, len, h))
+                {
+                    bump(stats_.bad);
+                    ++batch_.next;
+                    continue;
+                }
+                if (h.count == feed::kEndOfSession)
+                {
+                    ++batch_.next;
+                    if (!seq_.started()) continue;   // a repeat of the last session's end
+                    seq_.reset();
+                    bump(stats_.sessions);
+                    if (out) end_pending_ = true;
+                    return out;
+                }
+                const size_t payload = len - sizeof(h);
+                if (out + payload > cap)
+                {
+                    if (out) return out;   // the rest goes out on the next call
+                    throw std::invalid_argument("UdpSource::read needs a buffer of at least one packet");
+                }
+                uint64_t lost = 0;
+                uint32_t skip = 0;
+                auto r = seq_.check(h.seq, h.count, lost, skip);
+                if (r == feed::SeqTracker::Result::Restart)
+                {
+                    // the sender started over without an end-of-session packet: end
+                    // the session here; this packet opens the next one
+                    seq_.reset();
+                    bump(stats_.sessions);
+                    bump(stats_.restarts);
+                    if (out) end_pending_ = true;
+                    return out;
+                }
+                ++batch_.next;
+                size_t from = 0;
+                switch (r)
+                {
+                    case feed::SeqTracker::Result::Late:
+                        bump(stats_.late);
+                        continue;
+                    case feed::SeqTracker::Result::Gap:
+                        bump(stats_.gaps);
+                        bump(stats_.lines_lost, lost);
+                        break;
+                    case feed::SeqTracker::Result::Overlap:
+                        bump(stats_.overlaps);
+                        from = feed::skip_lines(pkt + sizeof(h), payload, skip);
+                        break;
+                    default:
+                        break;
+                }
+                std::memcpy(buf + out, pkt + sizeof(h) + from, payload - from);
+                out += payload - from;
+            }
+            if (out) return out;
+
+            if (!net::wait_readable(fd_, timeout_ms_)) return kNoData;
+            int n = batch_.receive(fd_);
+            if (n == 0) return kNoData;
+            bump(stats_.syscalls);
+            bump(stats_.packets, static_cast<uint64_t>(n));
+        }
+    }
+
+    size_t UdpSource::unread() const
+    {
+        return batch_.pending_payload() + net::unread_bytes(fd_);
+    }
+
+} // namespace engine
@@ -1,22 +1,65 @@
 #include "streamer/streamer.hpp"
+#include <cstdlib>
 #include <iostream>
 
 int main(int argc, char** argv)
 {
     if (argc < 3)
     {
-        std::cerr << "usage: streamer_app <engine_port> <input_txt> [lines_per_sec]\n";
+        std::cerr << "usage: streamer_app <engine> <input_txt | gen:<spec> | cap:<spec>> [lines_per_sec[,lps2,..]]"
+                     " [connections] [same|slice|gen]\n"
+                  << "  engine: 9001 | host:port | tcp://host:port | unix:///path[?seqpacket] | shm://name\n"
+                  << "          udp://group:port[?iface=addr] (multicast, e.g. udp://239.255.0.1:15000)\n"
+                  << "  gen spec: orders=1e6,depth=50,vol=0.001,add=45,cxl=35,mod=10,trd=10,"
+                     "decay=0.85,qty=10,instruments=1,seed=1,events=1e7\n"
+                  << "  cap spec: <capture_file>[,speed=1][,restamp=1]  (engine ENGINE_CAPTURE file,"
+                     " original timing; rate/connection arguments are ignored)\n"
+                  << "  STREAMER_DELAY_US=<us>: hold each udp:// burst that long (a slow A/B line)\n";
         return 1;
     }
-    std::string host = "127.0.0.1";
-    std::string port = argv[1];
     std::string input = argv[2];
-    size_t lps = (argc > 3) ? static_cast<size_t>(std::stoul(argv[3])) : 100000;
 
     try
     {
+        net::Endpoint ep = net::Endpoint::parse(argv[1], "127.0.0.1");
+        if (streamer::CaptureReplayOptions::is_spec(input))
+        {
+            streamer::Streamer s;
+            return s.replay_capture(ep, streamer::CaptureReplayOptions::parse(input));
+        }
+        streamer::FanoutOptions opt;
+        // STREAMER_DELAY_US=<us>: udp:// only, send every burst that much later (A/B tests)
+        if (const char* delay = std::getenv("STREAMER_DELAY_US")) opt.delay_us = std::strtoull(delay, nullptr, 10);
+        if (argc > 3)
+        {
+            // comma-separated per-connection rates; the last one repeats
+            opt.lines_per_sec.clear();
+            std::string list = argv[3];
+            size_t pos = 0;
+            while (pos <= list.size())
+            {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) comma = list.size();
+                opt.lines_per_sec.push_back(static_cast<size_t>(std::stoul(list.substr(pos, comma - pos))));
+                pos = comma + 1;
+            }
+        }
+        if (argc > 4) opt.connections = static_cast<size_t>(std::stoul(argv[4]));
+        if (argc > 5)
+        {
+            std::string mode = argv[5];
+            if (mode == "same")       opt.mode = streamer::FanoutMode::Same;
+            else if (mode == "slice") opt.mode = streamer::FanoutMode::Slice;
+            else if (mode == "gen")   opt.mode = streamer::FanoutMode::Generate;
+            else
+            {
+                std::cerr << "unknown fan-out mode: " << mode << "\n";
+                return 1;
+            }
+        }
+
         streamer::Streamer s;
-        return s.run(host, port, input, lps);
+        return s.run_fanout(ep, input, opt);
     }
     catch (const std::exception& e)
     {
@@ -1,5 +1,9 @@
 #include "streamer/streamer.hpp"
 #include "common/net.hpp"
+#include "common/mbo_gen.hpp"
+#include "common/capture.hpp"
+#include "common/shm_ring.hpp"
+#include "common/feed_packet.hpp"
 
 #include <fstream>
 #include <thread>
@@ -8,6 +12,12 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <deque>
+#include <memory>
+#include <cstdint>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
 
 namespace streamer {
 
@@ -37,6 +47,94 @@ struct RateLimiter {
   }
 };
 
+// Where lines come from: a text file, or the synthetic generator ("gen:<spec>").
+struct LineSource {
+  virtual ~LineSource() = default;
+  virtual bool next(std::string& line) = 0; // one protocol line, without '\n'
+};
+
+struct FileSource : LineSource {
+  std::ifstream in;
+  uint64_t pos = 0;              // offset of the next line
+  uint64_t end = UINT64_MAX;     // lines starting at or past this belong to the next slice
+  explicit FileSource(const std::string& path) : in(path, std::ios::binary) {}
+
+  // Restrict to the lines that start in [begin, end): seek, then drop the partial
+  // line the offset lands in (it belongs to the slice before)
+  void slice(uint64_t begin, uint64_t end_)
+  {
+    end = end_;
+    pos = begin;
+    if (begin == 0) return;
+    in.seekg(static_cast<std::streamoff>(begin - 1));
+    std::string partial;
+    if (std::getline(in, partial)) pos = begin - 1 + partial.size() + 1;
+  }
+
+  bool next(std::string& line) override
+  {
+    if (pos >= end) return false;
+    if (!std::getline(in, line)) return false;
+    pos += line.size() + 1;
+    return true;
+  }
+};
+
+static uint64_t file_size(const std::string& path)
+{
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  return in ? static_cast<uint64_t>(in.tellg()) : 0;
+}
+
+struct GenSource : LineSource {
+  synth::MboGenerator gen;
+  char buf[synth::MboGenerator::kMaxLineLen];
+  explicit GenSource(const synth::GenConfig& cfg) : gen(cfg) {}
+  bool next(std::string& line) override
+  {
+    size_t n = gen.next_line(buf);
+    if (n == 0) return false;
+    line.assign(buf, n - 1);
+    return true;
+  }
+};
+
+static bool is_gen_spec(const std::string& input)
+{
+  return input.rfind("gen:", 0) == 0;
+}
+
+static std::unique_ptr<LineSource> open_source(const std::string& input)
+{
+  if (is_gen_spec(input))
+    return std::make_unique<GenSource>(synth::GenConfig::parse(input));
+  auto f = std::make_unique<FileSource>(input);
+  if (!f->in) return nullptr;
+  return f;
+}
+
+// Source for connection `c` of `n` under the given fan-out mode
+static std::unique_ptr<LineSource> open_conn_source(const std::string& input, FanoutMode mode,
+                                                    size_t c, size_t n, uint64_t total_bytes)
+{
+  if (mode == FanoutMode::Generate)
+  {
+    // independent streams: own seed, own instrument ids/price bands per connection
+    synth::GenConfig cfg = synth::GenConfig::parse(input);
+    cfg.seed += c;
+    cfg.first_instrument += static_cast<uint32_t>(c * cfg.instruments);
+    return std::make_unique<GenSource>(cfg);
+  }
+  auto src = open_source(input);
+  if (src && mode == FanoutMode::Slice)
+  {
+    // equal byte ranges: each connection seeks straight to its own
+    const uint64_t per = (total_bytes + n - 1) / n;
+    static_cast<FileSource*>(src.get())->slice(c * per, (c + 1) * per);
+  }
+  return src;
+}
+
 static inline uint64_t wall_ns()
 {
   using namespace std::chrono;
@@ -44,69 +142,274 @@ static inline uint64_t wall_ns()
 }
 
 
-int Streamer::run(const std::string& host, const std::string& port,
-                  const std::string& input_file, size_t lines_per_sec)
+constexpr size_t kBatchLines = 1024;   // lines per load/burst
+constexpr size_t kMaxLineLen = 4096;   // guardrail for pathological lines
+
+// Fill up to kBatchLines from the source, newline-terminated; false at EOF.
+static bool fill_batch(LineSource& src, std::vector<std::string>& lines, std::string& line)
+{
+  lines.clear();
+  for (size_t i = 0; i < kBatchLines && src.next(line); ++i)
+  {
+    if (line.size() > kMaxLineLen) line.resize(kMaxLineLen);
+    std::string out;
+    out.reserve(line.size() + 32);
+    out += line;
+    out.push_back('\n');
+    lines.emplace_back(std::move(out));
+    line.clear();
+  }
+  return !lines.empty();
+}
+
+// Prefix lines [first, first + count) with the wall-clock send timestamp in ns,
+// taken as the burst goes out (not when the batch was read, or the engine's e2e
+// latency would include the rate limiter's wait): @<ns>,
+// Example: @1731284001123456789,ADD,17587...,B,123,64830000000,10
+static void stamp_burst(std::vector<std::string>& lines, size_t first, size_t count)
+{
+  std::string stamp = "@";
+  stamp += std::to_string(wall_ns());
+  stamp += ',';
+  for (size_t i = first; i < first + count; ++i) lines[i].insert(0, stamp);
+}
+
+// Same rate-limited batches into an engine's shm:// ring: one memcpy per burst,
+// no syscall unless the engine is asleep.
+static ConnStats stream_ring(const std::string& name, LineSource& src, size_t lines_per_sec)
+{
+  shm::ByteRing ring(name, shm::ByteRing::Mode::Attach);
+
+  std::vector<std::string> lines;
+  lines.reserve(kBatchLines);
+  std::string line, burst;
+  line.reserve(256);
+  burst.reserve(kBatchLines * 64);
+
+  RateLimiter rl(static_cast<double>(lines_per_sec > 0 ? lines_per_sec : 100000));
+  size_t total_sent_lines = 0;
+  const auto t_start = std::chrono::steady_clock::now();
+
+  while (fill_batch(src, lines, line))
+  {
+    size_t start = 0;
+    while (start < lines.size())
+    {
+      size_t remaining = lines.size() - start;
+      size_t allowed = rl.grant(remaining, kBatchLines);
+      while (allowed == 0)
+      {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        allowed = rl.grant(remaining, kBatchLines);
+      }
+      stamp_burst(lines, start, allowed);
+      burst.clear();
+      for (size_t i = start; i < start + allowed; ++i) burst += lines[i];
+      ring.write(burst.data(), burst.size());
+      start += allowed;
+      total_sent_lines += allowed;
+    }
+  }
+  ring.close();
+
+  ConnStats st;
+  st.lines = total_sent_lines;
+  st.secs  = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+  return st;
+}
+
+// Sends the finished packets of a burst, up to net::kStackBatch per sendmmsg.
+struct PacketSender {
+  int fd;
+  std::vector<char> buf;                        // kStackBatch packets of kMaxPacketBytes
+  const void* ptrs[net::kStackBatch];
+  size_t lens[net::kStackBatch];
+  int count = 0;                                // finished packets in buf
+  uint64_t seq = 1;                             // next line number
+  size_t syscalls = 0, packets = 0;
+
+  explicit PacketSender(int f) : fd(f), buf(net::kStackBatch * feed::kMaxPacketBytes)
+  {
+    for (int i = 0; i < net::kStackBatch; ++i) ptrs[i] = buf.data() + i * feed::kMaxPacketBytes;
+  }
+
+  feed::PacketHeader& header(int i) { return *reinterpret_cast<feed::PacketHeader*>(buf.data() + i * feed::kMaxPacketBytes); }
+
+  // Pack lines [first, first + n) whole into packets and send them.
+  void send_lines(const std::vector<std::string>& lines, size_t first, size_t n)
+  {
+    open_packet();
+    for (size_t i = first; i < first + n; ++i)
+    {
+      const std::string& l = lines[i];
+      if (lens[count] + l.size() > feed::kMaxPacketBytes)
+      {
+        close_packet();
+        open_packet();
+      }
+      std::memcpy(buf.data() + count * feed::kMaxPacketBytes + lens[count], l.data(), l.size());
+      lens[count] += l.size();
+      ++header(count).count;
+    }
+    close_packet();
+    flush();
+  }
+
+  void end_session()
+  {
+    // after a pause, so a receiver that is behind has room in its socket buffer
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int copies = 0; copies < 3; ++copies)
+    {
+      lens[count] = sizeof(feed::PacketHeader);
+      header(count) = feed::PacketHeader{ feed::kPacketMagic, feed::kEndOfSession, 0, seq };
+      ++count;
+    }
+    flush();
+  }
+
+  void open_packet()
+  {
+    if (count == net::kStackBatch) flush();
+    lens[count] = sizeof(feed::PacketHeader);
+    header(count) = feed::PacketHeader{ feed::kPacketMagic, 0, 0, seq };
+  }
+
+  void close_packet()
+  {
+    if (header(count).count == 0) return;
+    seq += header(count).count;
+    ++count;
+  }
+
+  void flush()
+  {
+    int done = 0;
+    while (done < count)
+    {
+      int rc = net::sendmmsg_batch(fd, ptrs + done, lens + done, count - done);
+      if (rc == 0) { net::wait_writable(fd, 1); continue; }
+      done += rc;
+      packets += static_cast<size_t>(rc);
+      ++syscalls;
+    }
+    count = 0;
+  }
+};
+
+// Same rate-limited bursts as sequenced udp:// multicast packets (see
+// common/feed_packet.hpp). A burst never waits in a half-filled packet.
+static ConnStats stream_udp(const net::Endpoint& ep, LineSource& src, size_t lines_per_sec, uint64_t delay_us)
 {
+  int fd = net::open_multicast_send(ep);
+  PacketSender out(fd);
+
+  // with a delay, stamped bursts wait here until they are due
+  using clock = std::chrono::steady_clock;
+  const auto delay = std::chrono::microseconds(delay_us);
+  std::deque<std::pair<clock::time_point, std::vector<std::string>>> delayed;
+  auto send_due = [&](bool all)
+  {
+    while (!delayed.empty() && (all || delayed.front().first <= clock::now()))
+    {
+      if (all) std::this_thread::sleep_until(delayed.front().first);
+      auto& burst = delayed.front().second;
+      out.send_lines(burst, 0, burst.size());
+      delayed.pop_front();
+    }
+  };
+
+  std::vector<std::string> lines;
+  lines.reserve(kBatchLines);
+  std::string line;
+  line.reserve(256);
+
+  RateLimiter rl(static_cast<double>(lines_per_sec > 0 ? lines_per_sec : 100000));
+  size_t total_sent_lines = 0, oversize = 0;
+  const auto t_start = std::chrono::steady_clock::now();
+
+  while (fill_batch(src, lines, line))
+  {
+    // a line has to fit in one packet
+    auto too_long = [](const std::string& l) { return l.size() + 32 > feed::kMaxPayloadBytes; };
+    size_t before = lines.size();
+    lines.erase(std::remove_if(lines.begin(), lines.end(), too_long), lines.end());
+    oversize += before - lines.size();
+
+    size_t start = 0;
+    while (start < lines.size())
+    {
+      size_t remaining = lines.size() - start;
+      size_t allowed = rl.grant(remaining, kBatchLines);
+      while (allowed == 0)
+      {
+        send_due(false);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        allowed = rl.grant(remaining, kBatchLines);
+      }
+      stamp_burst(lines, start, allowed);
+      if (delay_us == 0)
+      {
+        out.send_lines(lines, start, allowed);
+      }
+      else
+      {
+        delayed.emplace_back(clock::now() + delay, std::vector<std::string>(lines.begin() + start, lines.begin() + start + allowed));
+        send_due(false);
+      }
+      start += allowed;
+      total_sent_lines += allowed;
+    }
+  }
+  send_due(true);
+  out.end_session();
+
+  ConnStats st;
+  st.lines = total_sent_lines;
+  st.secs  = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+  std::cout << "[streamer] " << ep.str() << ": " << out.packets << " packets, "
+            << (out.syscalls ? static_cast<double>(out.packets) / out.syscalls : 0.0) << " per sendmmsg";
+  if (oversize) std::cout << ", " << oversize << " lines too long for a packet skipped";
+  std::cout << "\n";
+  net::close_fd(fd);
+  return st;
+}
+
+// Stream one source over one connection; returns lines sent and the time it took.
+static ConnStats stream_conn(const net::Endpoint& ep, LineSource& src, size_t lines_per_sec, uint64_t delay_us)
+{
+  if (ep.kind == net::Endpoint::Kind::Shm) return stream_ring(ep.path, src, lines_per_sec);
+  if (ep.kind == net::Endpoint::Kind::Udp) return stream_udp(ep, src, lines_per_sec, delay_us);
+
   // 1) connect + make non-blocking
-  int fd = net::connect_tcp(host, port);
+  int fd = net::connect_endpoint(ep);
   net::set_nonblocking(fd, true);
 
   // Optional (Linux): enable kernel zero-copy for large sends (no-op elsewhere)
   net::enable_zerocopy(fd, true);
 
-  std::ifstream in(input_file);
-  if (!in)
-  {
-    std::cerr << "[streamer] cannot open " << input_file << "\n";
-    net::close_fd(fd);
-    return 1;
-  }
-  std::cout << "[streamer] connected to " << host << ":" << port << "\n";
-
   // 2) Read file in chunks, batch sends to reduce syscalls
-  constexpr size_t kBatchLines = 1024;   // lines per load/burst
-  constexpr size_t kMaxLineLen = 4096;   // guardrail for pathological lines
-
   std::vector<std::string> lines;
   lines.reserve(kBatchLines);
 
   // Buffers used for batched send APIs:
   std::vector<const void*> ptrs(kBatchLines, nullptr);
   std::vector<size_t>      lens(kBatchLines, 0);
+  std::vector<size_t>      done(kBatchLines, 0);   // bytes actually sent per message
 
   // For writev/WSASend fallback:
   std::vector<net::IoVec>  iov(kBatchLines);
 
   RateLimiter rl(static_cast<double>(lines_per_sec > 0 ? lines_per_sec : 100000));
   size_t total_sent_lines = 0;
+  const auto t_start = std::chrono::steady_clock::now();
 
   // 3) Main loop: read lines, then send ALL of them (rate-limited), not just the first 'allowed'.
   std::string line;
   line.reserve(256);
 
-  while (true)
+  while (fill_batch(src, lines, line))
   {
-    lines.clear();
-
-    // Fill up to kBatchLines from file
-    for (size_t i = 0; i < kBatchLines && std::getline(in, line); ++i)
-    {
-      if (line.size() > kMaxLineLen) line.resize(kMaxLineLen);
-
-      // Prefix with wall-clock send timestamp in ns: @<ns>,
-      // Example: @1731284001123456789,ADD,17587...,B,123,64830000000,10
-      std::string out;
-      out.reserve(line.size() + 32);
-      out.push_back('@');
-      out += std::to_string(wall_ns());
-      out.push_back(',');
-      out += line;
-      out.push_back('\n');
-
-      lines.emplace_back(std::move(out));
-      line.clear();
-    }
-    if (lines.empty()) break; // EOF
 
     // We must send ALL lines in this batch; we just throttle how fast.
     size_t start = 0; // index into `lines` for what remains in this batch
@@ -122,6 +425,8 @@ int Streamer::run(const std::string& host, const std::string& port,
         allowed = rl.grant(remaining, kBatchLines);
       }
 
+      stamp_burst(lines, start, allowed);
+
       size_t sent = 0;
       while (sent < allowed) {
         size_t chunk = allowed - sent;
@@ -136,8 +441,23 @@ int Streamer::run(const std::string& host, const std::string& port,
         }
 
 #ifdef __linux__
-        int rc = net::sendmmsg_batch(fd, ptrs.data(), lens.data(), static_cast<int>(chunk));
+        int rc = net::sendmmsg_batch(fd, ptrs.data(), lens.data(), static_cast<int>(chunk), done.data());
         if (rc > 0) {
+          // On TCP the last message may have been cut short by a full socket buffer;
+          // finish it before moving on or the engine sees a torn line.
+          size_t last = static_cast<size_t>(rc) - 1;
+          if (done[last] < lens[last])
+          {
+            net::IoVec rest{ const_cast<char*>(static_cast<const char*>(ptrs[last]) + done[last]),
+                             lens[last] - done[last] };
+            while (rest.len > 0)
+            {
+              size_t w = net::sendv(fd, &rest, 1);
+              if (w == 0) { net::wait_writable(fd, 1); continue; }
+              rest.base = static_cast<char*>(rest.base) + w;
+              rest.len -= w;
+            }
+          }
           sent += static_cast<size_t>(rc);
           total_sent_lines += static_cast<size_t>(rc); // delta
           continue;
@@ -185,9 +505,230 @@ int Streamer::run(const std::string& host, const std::string& port,
     } // while (start < lines.size())
   }   // while read batches
 
-  std::cout << "[streamer] done. lines sent: " << total_sent_lines << "\n";
+  ConnStats st;
+  st.lines = total_sent_lines;
+  st.secs  = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
   net::close_fd(fd);
+  return st;
+}
+
+void Restamper::run(const char* in, size_t n, uint64_t now_ns, std::string& out)
+{
+  out.clear();
+  char stamp[24] = "@";
+  char* end = std::to_chars(stamp + 1, stamp + sizeof(stamp) - 1, now_ns).ptr;
+  *end++ = ',';
+  const size_t stamp_len = static_cast<size_t>(end - stamp);
+  for (size_t i = 0; i < n; ++i)
+  {
+    char c = in[i];
+    if (in_stamp)
+    {
+      if (c >= '0' && c <= '9') continue;
+      in_stamp = false;
+      out.append(stamp, stamp_len);
+      if (c == ',') continue;
+    }
+    else if (at_line_start && c == '@')
+    {
+      in_stamp = true;
+      at_line_start = false;
+      continue;
+    }
+    out.push_back(c);
+    at_line_start = (c == '\n');
+  }
+}
+
+uint64_t CaptureReplayOptions::send_offset_ns(uint64_t recv_ns, uint64_t first_ns) const
+{
+  if (speed <= 0 || recv_ns <= first_ns) return 0;
+  return static_cast<uint64_t>(static_cast<double>(recv_ns - first_ns) / speed);
+}
+
+CaptureReplayOptions CaptureReplayOptions::parse(const std::string& spec)
+{
+  if (!is_spec(spec)) throw std::invalid_argument("capture spec must start with cap:");
+  CaptureReplayOptions o;
+  std::string rest = spec.substr(4);
+  size_t comma = rest.find(',');
+  o.path = rest.substr(0, comma);
+  while (comma != std::string::npos)
+  {
+    size_t next = rest.find(',', comma + 1);
+    std::string kv = rest.substr(comma + 1, next == std::string::npos ? std::string::npos : next - comma - 1);
+    size_t eq = kv.find('=');
+    std::string key = kv.substr(0, eq);
+    std::string val = eq == std::string::npos ? "" : kv.substr(eq + 1);
+    if (key == "speed")        o.speed = std::stod(val);
+    else if (key == "restamp") o.restamp = val != "0";
+    else throw std::invalid_argument("unknown capture option: " + key);
+    comma = next;
+  }
+  if (o.path.empty()) throw std::invalid_argument("capture spec has no file");
+  if (o.speed < 0) throw std::invalid_argument("capture speed must be >= 0");
+  return o;
+}
+
+int Streamer::replay_capture(const std::string& host, const std::string& port,
+                             const CaptureReplayOptions& opt)
+{
+  net::Endpoint ep;
+  ep.host = host;
+  ep.port = port;
+  return replay_capture(ep, opt);
+}
+
+int Streamer::replay_capture(const net::Endpoint& ep, const CaptureReplayOptions& opt)
+{
+  capture::Reader reader(opt.path);
+
+  int fd = -1;
+  std::unique_ptr<shm::ByteRing> ring;
+  if (ep.kind == net::Endpoint::Kind::Udp)
+    throw std::invalid_argument("capture replay sends raw chunks; it needs a stream or shm:// endpoint, not " + ep.str());
+  if (ep.is_stream())
+    fd = net::connect_endpoint(ep);
+  else
+    ring = std::make_unique<shm::ByteRing>(ep.path, shm::ByteRing::Mode::Attach);
+  auto send = [&](const char* p, size_t n) { if (ring) ring->write(p, n); else net::send_all(fd, p, n); };
+  std::cout << "[streamer] replaying capture " << opt.path << " to " << ep.str()
+            << " (speed " << opt.speed << (opt.restamp ? ", restamped" : "") << ")\n";
+
+  Restamper restamp;
+  std::string data, out;
+  uint64_t recv_ns = 0, first_ns = 0;
+  size_t chunks = 0, bytes = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  while (reader.next(recv_ns, data))
+  {
+    if (chunks == 0) first_ns = recv_ns;
+    // keep the captured inter-arrival gaps (bursts stay bursts)
+    if (uint64_t due = opt.send_offset_ns(recv_ns, first_ns))
+      std::this_thread::sleep_until(t0 + std::chrono::nanoseconds(due));
+    if (opt.restamp)
+    {
+      restamp.run(data.data(), data.size(), wall_ns(), out);
+      send(out.data(), out.size());
+    }
+    else
+    {
+      send(data.data(), data.size());
+    }
+    ++chunks;
+    bytes += data.size();
+  }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if (ring) ring->close();
+  else net::close_fd(fd);
+  std::cout << "[streamer] done. chunks sent: " << chunks << " (" << bytes << " bytes in "
+            << secs << " s)\n";
   return 0;
 }
 
+static uint64_t per_sec(size_t lines, double secs)
+{
+  return secs > 0 ? static_cast<uint64_t>(lines / secs) : 0;
+}
+
+int Streamer::run(const std::string& host, const std::string& port,
+                  const std::string& input_file, size_t lines_per_sec)
+{
+  FanoutOptions opt;
+  opt.lines_per_sec = { lines_per_sec };
+  return run_fanout(host, port, input_file, opt);
+}
+
+int Streamer::run_fanout(const std::string& host, const std::string& port,
+                         const std::string& input, const FanoutOptions& opt)
+{
+  net::Endpoint ep;
+  ep.host = host;
+  ep.port = port;
+  return run_fanout(ep, input, opt);
+}
+
+int Streamer::run_fanout(const net::Endpoint& ep, const std::string& input, const FanoutOptions& opt)
+{
+  const size_t n = std::max<size_t>(1, opt.connections);
+  if (opt.delay_us && ep.kind != net::Endpoint::Kind::Udp)
+  {
+    std::cerr << "[streamer] an injected delay needs a udp:// endpoint\n";
+    return 1;
+  }
+  if (!ep.is_stream() && n > 1)
+  {
+    std::cerr << "[streamer] " << ep.str() << " carries a single sequenced stream: use one connection\n";
+    return 1;
+  }
+  if (opt.mode == FanoutMode::Generate && !is_gen_spec(input))
+  {
+    std::cerr << "[streamer] fan-out mode 'gen' needs a gen:<spec> input\n";
+    return 1;
+  }
+  if (opt.mode == FanoutMode::Slice && is_gen_spec(input))
+  {
+    std::cerr << "[streamer] fan-out mode 'slice' needs a file input\n";
+    return 1;
+  }
+  uint64_t total_bytes = (opt.mode == FanoutMode::Slice) ? file_size(input) : 0;
+
+  // open every source up front so a bad input fails before any connection is made
+  std::vector<std::unique_ptr<LineSource>> sources;
+  for (size_t c = 0; c < n; ++c)
+  {
+    auto src = open_conn_source(input, opt.mode, c, n, total_bytes);
+    if (!src)
+    {
+      std::cerr << "[streamer] cannot open " << input << "\n";
+      return 1;
+    }
+    sources.push_back(std::move(src));
+  }
+
+  std::vector<ConnStats> stats(n);
+  std::vector<std::string> errors(n);
+  std::vector<std::thread> threads;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (size_t c = 0; c < n; ++c)
+  {
+    size_t lps = opt.lines_per_sec.empty() ? 100000
+               : opt.lines_per_sec[std::min(c, opt.lines_per_sec.size() - 1)];
+    threads.emplace_back([&, c, lps]
+    {
+      try
+      {
+        stats[c] = stream_conn(ep, *sources[c], lps, opt.delay_us);
+      }
+      catch (const std::exception& e)
+      {
+        errors[c] = e.what();
+      }
+    });
+  }
+  std::cout << "[streamer] " << n << " connection(s) to " << ep.str() << "\n";
+  for (auto& t : threads) t.join();
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  size_t total = 0;
+  int rc = 0;
+  for (size_t c = 0; c < n; ++c)
+  {
+    total += stats[c].lines;
+    if (!errors[c].empty())
+    {
+      std::cerr << "[streamer] conn " << c << " error: " << errors[c] << "\n";
+      rc = 1;
+    }
+    if (n > 1)
+    {
+      std::cout << "[streamer] conn " << c << ": " << stats[c].lines << " lines in "
+                << stats[c].secs << " s (" << per_sec(stats[c].lines, stats[c].secs) << " lines/sec)\n";
+    }
+  }
+  std::cout << "[streamer] done. lines sent: " << total
+            << " (" << per_sec(total, wall) << " lines/sec)\n";
+  return rc;
+}
+
 } // namespace streamer
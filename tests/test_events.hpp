@@ -0,0 +1,68 @@
+#pragma once
+#include "engine/order_book.hpp"
+
+#include <cstdint>
+#include <utility>
+
+// --- Small helpers so tests don't depend on MboEvent's field order ---
+
+inline engine::MboEvent mk_add(uint64_t ts, engine::Side side, uint64_t oid, int64_t px, int qty) {
+  engine::MboEvent e{};
+  e.kind    = engine::EventKind::Add;
+  e.ts_ns   = ts;
+  e.side    = side;
+  e.order_id= oid;
+  e.price   = px;
+  e.qty     = qty;
+  return e;
+}
+inline engine::MboEvent mk_mod(uint64_t ts, uint64_t oid, int64_t new_px, int new_qty) {
+  engine::MboEvent e{};
+  e.kind     = engine::EventKind::Modify;
+  e.ts_ns    = ts;
+  e.order_id = oid;
+  e.new_price= new_px;
+  e.new_qty  = new_qty;
+  return e;
+}
+inline engine::MboEvent mk_cxl(uint64_t ts, uint64_t oid) {
+  engine::MboEvent e{};
+  e.kind     = engine::EventKind::Cancel;
+  e.ts_ns    = ts;
+  e.order_id = oid;
+  return e;
+}
+inline engine::MboEvent mk_trd(uint64_t ts, uint64_t oid, int fill_qty, engine::Side hit_side = engine::Side::Bid) {
+  // the book ignores side on a trade (the resting order has one)
+  engine::MboEvent e{};
+  e.kind     = engine::EventKind::Trade;
+  e.ts_ns    = ts;
+  e.order_id = oid;
+  e.qty      = fill_qty;
+  e.side     = hit_side;
+  return e;
+}
+inline engine::MboEvent mk_clr(uint64_t ts) {
+  engine::MboEvent e{};
+  e.kind  = engine::EventKind::Clear;
+  e.ts_ns = ts;
+  return e;
+}
+
+// A book and something that follows it (analytics, trade tape): each event goes to
+// the book, then to consumer.on_event(book, ev), as the engine calls them.
+template <class Consumer>
+struct BookFeed {
+  engine::OrderBook book;
+  Consumer consumer;
+  uint64_t events = 0;
+
+  template <class... Args>
+  explicit BookFeed(Args&&... args) : consumer(std::forward<Args>(args)...) {}
+
+  void operator()(const engine::MboEvent& ev) {
+    ++events;
+    book.on_event(ev);
+    consumer.on_event(book, ev);
+  }
+};
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "common/alloc_tracking.hpp"
+#include "common/mbo_gen.hpp"
+#include "engine/engine.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// This binary always links the counting operator new (see tests/CMakeLists.txt).
+
+#ifndef TEST_DATA_DIR
+#define TEST_DATA_DIR "data"
+#endif
+
+// Allocation budget per event for the ingest path (frame + parse + apply + metrics).
+// Nothing on that path allocates per line: the framer reuses its buffers, the parser
+// reads fields in place and order nodes are recycled by the book's node pool. What
+// is left is container growth (a new price level, a deque block, another pool slab),
+// measured at ~0.08/event while CLX5 builds its book and ~0.02 in steady state. A
+// quarter is far above that and still fails for anything that allocates once per
+// add, let alone once per line.
+static constexpr double kAllocsPerEvent = 0.25;
+
+static std::string synthetic_feed(uint64_t events) {
+  synth::MboGenerator gen(synth::GenConfig::parse("orders=5000,depth=50,seed=11,events=" + std::to_string(events)));
+  std::string raw;
+  std::vector<char> buf(1 << 20);
+  size_t lines = 0, n;
+  while ((n = gen.fill(buf.data(), buf.size(), lines)) > 0) raw.append(buf.data(), n);
+  return raw;
+}
+
+static double allocs_per_event(engine::EngineApp& app, engine::MemorySource& src, size_t& lines) {
+  auto before = alloc_tracking::this_thread();
+  lines = app.consume(src);
+  auto after = alloc_tracking::this_thread();
+  return lines ? double(after.allocs - before.allocs) / lines : 0.0;
+}
+
+TEST(Alloc, CountsThisThread) {
+  auto before = alloc_tracking::this_thread();
+  auto p = std::make_unique<std::vector<int>>(100);
+  auto after = alloc_tracking::this_thread();
+  EXPECT_EQ(after.allocs - before.allocs, 2u);   // the vector object + its buffer
+  EXPECT_GE(after.bytes - before.bytes, 400u);
+  p.reset();
+  EXPECT_EQ(alloc_tracking::this_thread().frees - after.frees, 2u);
+}
+
+TEST(Alloc, Clx5ReplayWithinBudget) {
+  engine::MemorySource src(engine::load_file(TEST_DATA_DIR "/CLX5_lines.txt"));
+  auto app = std::make_unique<engine::EngineApp>();
+  size_t lines = 0;
+  double per_event = allocs_per_event(*app, src, lines);
+  ASSERT_GT(lines, 10000u);
+  RecordProperty("allocs_per_event", std::to_string(per_event));
+  EXPECT_LE(per_event, kAllocsPerEvent);
+}
+
+TEST(Alloc, SteadyStateWithinBudget) {
+  // first half grows the book to its target size, the second half is measured
+  const std::string feed = synthetic_feed(200000);
+  size_t half = feed.find('\n', feed.size() / 2) + 1;
+  engine::MemorySource warm(feed.substr(0, half)), steady(feed.substr(half));
+
+  auto app = std::make_unique<engine::EngineApp>();
+  app->consume(warm);
+  size_t lines = 0;
+  double per_event = allocs_per_event(*app, steady, lines);
+  ASSERT_GT(lines, 50000u);
+  RecordProperty("allocs_per_event", std::to_string(per_event));
+  EXPECT_LE(per_event, kAllocsPerEvent);
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "engine/analytics.hpp"
+#include "test_events.hpp"
+
+#include <climits>
+#include <cmath>
+
+using namespace engine;
+
+namespace {
+
+constexpr uint64_t kSec = 1'000'000'000;
+
+struct Feed : BookFeed<BookAnalytics> {
+  explicit Feed(uint32_t depth = 5) : BookFeed(BookAnalytics::Options{depth}) {}
+};
+
+}  // namespace
+
+TEST(Analytics, MicropriceAndImbalance) {
+  Feed f(2);
+  auto s = f.consumer.snapshot();
+  EXPECT_TRUE(std::isnan(s.microprice));   // empty book
+
+  f(mk_add(1, Side::Bid, 1, 100, 30));
+  f(mk_add(2, Side::Bid, 2, 99, 50));
+  f(mk_add(3, Side::Bid, 3, 98, 1000));       // third level: outside depth 2
+  f(mk_add(4, Side::Ask, 4, 102, 10));
+  f(mk_add(5, Side::Ask, 5, 103, 10));
+  s = f.consumer.snapshot();
+  EXPECT_EQ(s.bid_px, 100);
+  EXPECT_EQ(s.bid_qty, 30);
+  EXPECT_EQ(s.ask_px, 102);
+  EXPECT_EQ(s.ask_qty, 10);
+  // weighted toward the thin side: (100 * 10 + 102 * 30) / 40
+  EXPECT_DOUBLE_EQ(s.microprice, 101.5);
+  EXPECT_DOUBLE_EQ(s.imbalance, 0.5);
+  EXPECT_EQ(s.bid_depth_qty, 80);
+  EXPECT_EQ(s.ask_depth_qty, 20);
+  EXPECT_DOUBLE_EQ(s.imbalance_depth, 0.6);
+
+  f(mk_cxl(6, 1));                            // level 98 moves into the top 2
+  s = f.consumer.snapshot();
+  EXPECT_EQ(s.bid_depth_qty, 1050);
+  EXPECT_EQ(s.total.adds, 5u);
+  EXPECT_EQ(s.total.cancels, 1u);
+  EXPECT_DOUBLE_EQ(s.total.cancel_to_add(), 0.2);
+
+  f(mk_clr(7));
+  s = f.consumer.snapshot();
+  EXPECT_EQ(s.bid_qty, 0);
+  EXPECT_EQ(s.bid_depth_qty, 0);
+  EXPECT_DOUBLE_EQ(s.imbalance_depth, 0.0);
+}
+
+TEST(Analytics, MatchesARecomputationFromSnapshots) {
+  // random feed; OFI, depth sums and counts must equal what fresh snapshots give
+  Feed f(3);
+  uint64_t x = 777;
+  auto rnd = [&](uint64_t n) { x ^= x << 13; x ^= x >> 7; x ^= x << 17; return x % n; };
+  int64_t ofi = 0;
+  uint64_t adds = 0, cancels = 0, trades = 0;
+  int64_t volume = 0;
+  auto top = [](const OrderBook& b, Side s) {
+    LevelView lv{};
+    return b.top_levels(s, &lv, 1) ? lv : LevelView{s == Side::Bid ? INT64_MIN : INT64_MAX, 0, 0};
+  };
+  auto depth = [](const OrderBook& b, Side s) {
+    BookSnapshot snap = b.snapshot_top_n(3);
+    int64_t q = 0;
+    for (const auto& l : s == Side::Bid ? snap.bids : snap.asks) q += l.total_qty;
+    return q;
+  };
+  for (uint64_t i = 0; i < 20000; ++i) {
+    const LevelView b0 = top(f.book, Side::Bid), a0 = top(f.book, Side::Ask);
+    const size_t orders = f.book.order_count();
+    uint64_t id = 1 + rnd(300);
+    Side side = rnd(2) ? Side::Bid : Side::Ask;
+    int64_t px = side == Side::Bid ? 100 - static_cast<int64_t>(rnd(6)) : 101 + static_cast<int64_t>(rnd(6));
+    switch (rnd(10)) {
+      case 0: case 1: case 2: case 3: f(mk_add(i, side, id, px, 1 + static_cast<int>(rnd(9)))); ++adds; break;
+      case 4: case 5: f(mk_cxl(i, id)); cancels += f.book.order_count() < orders; break;
+      case 6: f(mk_mod(i, id, px, 1 + static_cast<int>(rnd(9)))); break;
+      case 7: case 8:
+        f(mk_trd(i, id, 1));
+        if (f.book.last_effect().applied) { ++trades; ++volume; }
+        break;
+      default: if (rnd(100) == 0) f(mk_clr(i)); break;
+    }
+    const LevelView b1 = top(f.book, Side::Bid), a1 = top(f.book, Side::Ask);
+    if (b1.price >= b0.price) ofi += b1.total_qty;
+    if (b1.price <= b0.price) ofi -= b0.total_qty;
+    if (a1.price <= a0.price) ofi -= a1.total_qty;
+    if (a1.price >= a0.price) ofi += a0.total_qty;
+
+    auto s = f.consumer.snapshot();
+    ASSERT_EQ(s.total.ofi, ofi) << "event " << i;
+    ASSERT_EQ(s.bid_depth_qty, depth(f.book, Side::Bid)) << "event " << i;
+    ASSERT_EQ(s.ask_depth_qty, depth(f.book, Side::Ask)) << "event " << i;
+  }
+  auto s = f.consumer.snapshot();
+  EXPECT_EQ(s.events, f.events);
+  EXPECT_EQ(s.total.adds, adds);
+  EXPECT_EQ(s.total.cancels, cancels);
+  EXPECT_EQ(s.total.trades, trades);
+  EXPECT_EQ(s.total.volume, volume);
+}
+
+TEST(Analytics, TradeVwapOverFeedTimeWindows) {
+  Feed f;
+  f(mk_add(0, Side::Ask, 1, 100, 1000));
+  f(mk_add(0, Side::Ask, 2, 110, 1000));
+  f(mk_trd(5 * kSec, 1, 10));              // 100 x 10, 65s before the end
+  f(mk_trd(62 * kSec, 2, 30));             // 110 x 30, 8s before
+  f(mk_trd(69 * kSec + kSec / 2, 1, 10));  // 100 x 10, in the last second
+  f(mk_trd(70 * kSec, 99, 10));            // unknown order: no print
+  f(mk_trd(60 * kSec, 1, 10));             // out of order: counted in the newest second
+
+  auto s = f.consumer.snapshot();
+  EXPECT_EQ(s.total.trades, 4u);
+  EXPECT_EQ(s.total.volume, 60);
+  EXPECT_DOUBLE_EQ(s.total.vwap(), (100.0 * 30 + 110.0 * 30) / 60);
+  EXPECT_EQ(s.window[0].volume, 10);    // 1s: only the late print, in second 70
+  EXPECT_DOUBLE_EQ(s.window[0].vwap(), 100.0);
+  EXPECT_EQ(s.window[1].volume, 50);    // 10s: seconds 61..70
+  EXPECT_EQ(s.window[2].volume, 50);    // 60s: second 5 is out
+  EXPECT_DOUBLE_EQ(s.window[2].vwap(), (110.0 * 30 + 100.0 * 20) / 50);
+  EXPECT_EQ(s.window[2].adds, 0u);      // the adds were at second 0
+  EXPECT_TRUE(std::isnan(s.window[2].cancel_to_add()));
+
+  f(mk_trd(200 * kSec, 2, 1));             // everything older has left every window
+  s = f.consumer.snapshot();
+  EXPECT_EQ(s.window[2].volume, 1);
+  EXPECT_EQ(s.window[2].trades, 1u);
+}
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include "engine/feed_arbiter.hpp"
+#include "engine/framer.hpp"
+#include "common/feed_packet.hpp"
+#include "common/net.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace engine;
+
+namespace {
+
+// One side of the A/B pair: a datagram socketpair (the same recvmmsg path as a
+// joined multicast socket).
+struct Line {
+  int sv[2];
+  Line() {
+    EXPECT_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, sv), 0);
+    net::set_nonblocking(sv[1], true);
+  }
+  ~Line() {
+    ::close(sv[0]);
+    ::close(sv[1]);
+  }
+  int rx() const { return sv[1]; }
+
+  // lines [seq, seq + n) of the test stream in one packet
+  void send(uint64_t seq, uint64_t n) {
+    feed::PacketHeader h{feed::kPacketMagic, static_cast<uint16_t>(n), 0, seq};
+    std::string p(reinterpret_cast<const char*>(&h), sizeof(h));
+    for (uint64_t s = seq; s < seq + n; ++s) p += "CXL," + std::to_string(s) + "," + std::to_string(s) + "\n";
+    ASSERT_EQ(::send(sv[0], p.data(), p.size(), 0), static_cast<ssize_t>(p.size()));
+  }
+  // lines [first, last] in packets of up to 64 lines
+  void run(uint64_t first, uint64_t last) {
+    for (uint64_t s = first; s <= last; s += 64) send(s, std::min<uint64_t>(64, last - s + 1));
+  }
+  void end(uint64_t next_seq) {
+    feed::PacketHeader h{feed::kPacketMagic, feed::kEndOfSession, 0, next_seq};
+    ASSERT_EQ(::send(sv[0], &h, sizeof(h), 0), static_cast<ssize_t>(sizeof(h)));
+  }
+};
+
+// Everything the arbiter hands out until the session ends: the seq of each line.
+std::vector<uint64_t> drain(FeedArbiter& arb) {
+  LineFramer framer;
+  std::vector<uint64_t> seqs;
+  std::vector<char> buf(64 * 1024);
+  size_t n;
+  while ((n = arb.read(buf.data(), buf.size())) != 0) {
+    if (n == ByteSource::kNoData) break;
+    framer.feed(buf.data(), n, [&](const std::string& l) { seqs.push_back(std::stoull(l.substr(4))); });
+  }
+  return seqs;
+}
+
+std::vector<uint64_t> iota(uint64_t first, uint64_t last) {
+  std::vector<uint64_t> v;
+  for (uint64_t s = first; s <= last; ++s) v.push_back(s);
+  return v;
+}
+
+// long enough that going back to seq 1 is a restart, not reordering
+constexpr uint64_t kLong = feed::SeqTracker::kRestartWindow + 4;
+
+} // namespace
+
+TEST(Arbiter, FirstCopyWinsAndDuplicatesDrop) {
+  Line a, b;
+  // same stream, packetized differently on each side
+  a.send(1, 3);
+  b.send(1, 2);
+  b.send(3, 3);      // line 3 duplicate, 4..5 first from B
+  a.send(4, 4);      // 4..5 duplicates, 6..7 first from A
+  a.end(8);
+  b.send(6, 2);
+  b.end(8);
+
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{1000, 50});
+  EXPECT_EQ(drain(arb), iota(1, 7));
+  const auto& st = arb.stats();
+  EXPECT_EQ(st.wins[0].load() + st.wins[1].load(), 7u);
+  EXPECT_EQ(st.duplicates.load(), 7u);
+  EXPECT_EQ(st.arrival_delta_ns.count(), 7u);
+  EXPECT_EQ(st.lines_lost.load(), 0u);
+  EXPECT_EQ(st.sessions.load(), 1u);
+}
+
+TEST(Arbiter, OtherSideFillsHole) {
+  Line a, b;
+  a.send(1, 2);
+  a.send(5, 2);      // A lost 3..4
+  a.end(7);
+  b.send(3, 2);      // B has them
+  b.end(7);
+
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{100'000, 50});
+  EXPECT_EQ(drain(arb), iota(1, 6));
+  EXPECT_EQ(arb.stats().wins[1].load(), 2u);
+  EXPECT_EQ(arb.stats().lines_lost.load(), 0u);
+}
+
+TEST(Arbiter, HoleOnBothSidesTimesOut) {
+  Line a, b;
+  a.send(1, 2);
+  a.send(5, 2);
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{2000, 50});
+  std::vector<char> buf(4096);
+  size_t n = arb.read(buf.data(), buf.size());
+  EXPECT_EQ(std::string(buf.data(), n), "CXL,1,1\nCXL,2,2\n");
+
+  // 3..4 never come: after the gap timeout 5..6 are released
+  auto t0 = std::chrono::steady_clock::now();
+  n = arb.read(buf.data(), buf.size());
+  EXPECT_EQ(std::string(buf.data(), n), "CXL,5,5\nCXL,6,6\n");
+  EXPECT_GE(std::chrono::steady_clock::now() - t0, std::chrono::microseconds(1500));
+  EXPECT_EQ(arb.stats().lines_lost.load(), 2u);
+  EXPECT_EQ(arb.stats().gaps.load(), 1u);
+
+  b.send(3, 2);      // too late now
+  a.end(7);
+  b.end(7);
+  EXPECT_TRUE(drain(arb).empty());
+  EXPECT_EQ(arb.stats().late.load(), 2u);
+}
+
+TEST(Arbiter, KeepsGoingWhenOneSideStalls) {
+  Line a, b;
+  b.run(1, kLong - 4);
+  a.run(1, kLong - 4);
+  b.send(kLong - 3, 4);   // A stalls here for good
+  b.end(kLong + 1);
+
+  // A sent data but no end marker: the session ends on the poll timeout
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{1000, 50});
+  EXPECT_EQ(drain(arb), iota(1, kLong));
+  EXPECT_EQ(arb.stats().wins[0].load() + arb.stats().wins[1].load(), kLong);
+  EXPECT_GE(arb.stats().wins[1].load(), 4u);   // the last 4 only ever came from B
+  EXPECT_EQ(arb.stats().sessions.load(), 1u);
+
+  // the next session starts over at 1
+  a.send(1, 2);
+  a.end(3);
+  EXPECT_EQ(drain(arb), iota(1, 2));
+}
+
+TEST(Arbiter, SideRestartsWithoutEndMarker) {
+  Line a, b;
+  a.run(1, kLong - 2);
+  b.run(1, kLong - 2);
+  a.send(kLong - 1, 2);
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{1000, 50});
+  EXPECT_EQ(drain(arb), iota(1, kLong));
+
+  a.send(1, 3);      // A crashed and started over: the old session ends here
+  EXPECT_TRUE(drain(arb).empty());
+  EXPECT_EQ(arb.stats().sessions.load(), 1u);
+
+  b.send(kLong - 1, 2);   // B is still in the old session: dropped
+  a.send(4, 2);
+  b.send(1, 5);      // B starts over too: duplicates of the new session
+  a.end(6);
+  b.end(6);
+  EXPECT_EQ(drain(arb), iota(1, 5));
+  const auto& st = arb.stats();
+  EXPECT_EQ(st.restarts.load(), 1u);
+  EXPECT_EQ(st.stale.load(), 2u);
+  EXPECT_EQ(st.sessions.load(), 2u);
+  EXPECT_EQ(st.late.load(), 0u);
+  EXPECT_EQ(st.lines_lost.load(), 0u);
+}
+
+TEST(Arbiter, ReorderedFirstPacketIsNotARestart) {
+  Line a, b;
+  a.send(3, 2);      // packet 1 overtaken by 3..6
+  a.send(5, 2);
+  a.send(1, 2);
+  a.end(7);
+  b.end(7);
+
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{100'000, 50});
+  EXPECT_EQ(drain(arb), iota(1, 6));
+  const auto& st = arb.stats();
+  EXPECT_EQ(st.restarts.load(), 0u);
+  EXPECT_EQ(st.sessions.load(), 1u);
+  EXPECT_EQ(st.lines_lost.load(), 0u);
+  EXPECT_EQ(st.late.load(), 0u);
+}
+
+TEST(Arbiter, StalledSideResumesIntoTheNextSession) {
+  Line a, b;
+  a.send(1, 4);
+  b.send(1, 2);      // B stalls here
+  a.end(5);
+
+  // B neither ended nor restarted: the session ends on the poll timeout
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{1000, 50});
+  EXPECT_EQ(drain(arb), iota(1, 4));
+
+  b.send(3, 2);      // B resumes the old session: not applied again
+  a.send(1, 3);      // the next run
+  a.end(4);
+  EXPECT_EQ(drain(arb), iota(1, 3));
+  EXPECT_EQ(arb.stats().stale.load(), 2u);
+  EXPECT_EQ(arb.stats().lines_lost.load(), 0u);
+
+  b.end(5);          // B's old session ends; then it joins the next run
+  b.send(1, 2);
+  a.send(1, 2);
+  a.end(3);
+  b.end(3);
+  EXPECT_EQ(drain(arb), iota(1, 2));
+  EXPECT_EQ(arb.stats().sessions.load(), 3u);
+  EXPECT_EQ(arb.stats().stale.load(), 2u);
+}
+
+TEST(Arbiter, TwoStreamersOneDelayed) {
+  // two senders of the same 20000-line stream in different packet sizes, B 300 us behind
+  constexpr uint64_t kLines = 20000;
+  Line a, b;
+  auto stream = [](Line& l, uint64_t per_packet, std::chrono::microseconds delay) {
+    std::this_thread::sleep_for(delay);
+    for (uint64_t s = 1; s <= kLines; s += per_packet) {
+      l.send(s, std::min(per_packet, kLines - s + 1));
+      if (s % 1000 < per_packet) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    l.end(kLines + 1);
+  };
+  net::set_nonblocking(a.sv[0], false);
+  net::set_nonblocking(b.sv[0], false);
+  std::thread ta(stream, std::ref(a), 20, std::chrono::microseconds(0));
+  std::thread tb(stream, std::ref(b), 13, std::chrono::microseconds(300));
+
+  FeedArbiter arb(a.rx(), b.rx(), FeedArbiter::Options{5000, 200});
+  auto seqs = drain(arb);
+  ta.join();
+  tb.join();
+
+  EXPECT_EQ(seqs, iota(1, kLines));   // every line exactly once, in order
+  const auto& st = arb.stats();
+  EXPECT_EQ(st.wins[0].load() + st.wins[1].load(), kLines);
+  EXPECT_GT(st.wins[0].load(), st.wins[1].load());
+  EXPECT_EQ(st.duplicates.load(), kLines);
+  metrics::HdrHistogram delta = st.arrival_delta_ns.snapshot();
+  EXPECT_GT(delta.value_at_quantile(0.5), 100'000u);   // B trails by about its delay
+}
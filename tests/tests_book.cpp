@@ -1,52 +1,9 @@
 #include <gtest/gtest.h>
 #include "engine/order_book.hpp"
+#include "test_events.hpp"
 
 using namespace engine;
 
-// --- Small helpers so tests don't depend on MboEvent's field order ---
-static MboEvent mk_add(uint64_t ts, Side side, uint64_t oid, int64_t px, int qty) {
-  MboEvent e{};
-  e.kind    = EventKind::Add;
-  e.ts_ns   = ts;
-  e.side    = side;
-  e.order_id= oid;
-  e.price   = px;
-  e.qty     = qty;
-  return e;
-}
-static MboEvent mk_mod(uint64_t ts, uint64_t oid, int64_t new_px, int new_qty) {
-  MboEvent e{};
-  e.kind     = EventKind::Modify;
-  e.ts_ns    = ts;
-  e.order_id = oid;
-  e.new_price= new_px;
-  e.new_qty  = new_qty;
-  return e;
-}
-static MboEvent mk_cxl(uint64_t ts, uint64_t oid) {
-  MboEvent e{};
-  e.kind     = EventKind::Cancel;
-  e.ts_ns    = ts;
-  e.order_id = oid;
-  return e;
-}
-static MboEvent mk_trd(uint64_t ts, uint64_t oid, int fill_qty, Side hit_side = Side::Bid) {
-  // If your engine ignores side on trade, it's fine; if it needs it, set it.
-  MboEvent e{};
-  e.kind     = EventKind::Trade;
-  e.ts_ns    = ts;
-  e.order_id = oid;
-  e.qty      = fill_qty;
-  e.side     = hit_side;
-  return e;
-}
-static MboEvent mk_clr(uint64_t ts) {
-  MboEvent e{};
-  e.kind  = EventKind::Clear;
-  e.ts_ns = ts;
-  return e;
-}
-
 TEST(OrderBook, AddBestBidAsk) {
   OrderBook ob;
   ob.on_event(mk_add(/*ts*/1, Side::Bid, /*oid*/1, /*px*/100, /*qty*/10));
@@ -99,3 +56,147 @@ TEST(OrderBook, ClearBook) {
   EXPECT_TRUE(s.bids.empty());
   EXPECT_TRUE(s.asks.empty());
 }
+
+static std::vector<uint64_t> queue_ids(const OrderBook& ob) {
+  std::vector<OrderBook::RestingOrder> orders;
+  ob.export_orders(orders);
+  std::vector<uint64_t> ids;
+  for (const auto& o : orders) ids.push_back(o.id);
+  return ids;
+}
+
+TEST(OrderBook, ReusedIdReplacesTheOrder) {
+  // same level: the old size leaves, the new order goes to the back of the queue
+  {
+    OrderBook ob;
+    ob.on_event(mk_add(1, Side::Bid, 1, 100, 10));
+    ob.on_event(mk_add(2, Side::Bid, 2, 100, 5));
+    ob.on_event(mk_add(3, Side::Bid, 1, 100, 7));
+    auto s = ob.snapshot_top_n(5);
+    ASSERT_EQ(s.bids.size(), 1u);
+    EXPECT_EQ(s.bids[0].total_qty, 12);
+    EXPECT_EQ(s.bids[0].orders, 2u);
+    EXPECT_EQ(ob.order_count(), 2u);
+    EXPECT_EQ(queue_ids(ob), (std::vector<uint64_t>{2, 1}));
+    EXPECT_EQ(ob.last_effect().levels, OrderBook::Effect::Levels::Several);
+  }
+  // different level on the same side: the old level empties and goes away
+  {
+    OrderBook ob;
+    ob.on_event(mk_add(1, Side::Bid, 1, 100, 10));
+    ob.on_event(mk_add(2, Side::Bid, 1, 99, 3));
+    auto s = ob.snapshot_top_n(5);
+    ASSERT_EQ(s.bids.size(), 1u);
+    EXPECT_EQ(s.bids[0].price, 99);
+    EXPECT_EQ(s.bids[0].total_qty, 3);
+    EXPECT_EQ(ob.order_count(), 1u);
+  }
+  // other side: nothing is left on the old one, and a cancel takes out the new one
+  {
+    OrderBook ob;
+    ob.on_event(mk_add(1, Side::Bid, 1, 100, 10));
+    ob.on_event(mk_add(2, Side::Ask, 1, 105, 4));
+    auto s = ob.snapshot_top_n(5);
+    EXPECT_TRUE(s.bids.empty());
+    ASSERT_EQ(s.asks.size(), 1u);
+    EXPECT_EQ(s.asks[0].price, 105);
+    EXPECT_EQ(s.asks[0].total_qty, 4);
+    ob.on_event(mk_cxl(3, 1));
+    EXPECT_EQ(ob.order_count(), 0u);
+    EXPECT_EQ(ob.level_count(Side::Bid) + ob.level_count(Side::Ask), 0u);
+  }
+}
+
+TEST(OrderBook, TopChangedOnlyForTopLevels) {
+  OrderBook ob;
+  for (int i = 0; i < 5; ++i) ob.on_event(mk_add(1, Side::Bid, 1 + i, 100 - i, 10));   // 100..96
+  ob.on_event(mk_add(2, Side::Bid, 10, 95, 10));   // 6th level
+  EXPECT_TRUE(ob.top_changed(6));
+  EXPECT_FALSE(ob.top_changed(5));
+  ob.on_event(mk_add(3, Side::Bid, 11, 98, 5));    // joins the 3rd
+  EXPECT_TRUE(ob.top_changed(3));
+  EXPECT_FALSE(ob.top_changed(2));
+  ob.on_event(mk_cxl(4, 1));                       // best bid leaves: all shift up
+  EXPECT_TRUE(ob.top_changed(1));
+  ob.on_event(mk_cxl(5, 10));                      // 95, the 5th level now
+  EXPECT_TRUE(ob.top_changed(5));
+  EXPECT_FALSE(ob.top_changed(4));
+  ob.on_event(mk_mod(6, 5, 200, 10));              // 96 -> 200 (best): leaves one level, makes another
+  EXPECT_TRUE(ob.top_changed(1));
+  ob.on_event(mk_cxl(7, 999));                     // unknown order: nothing
+  EXPECT_FALSE(ob.top_changed(10));
+  ob.on_event(mk_clr(8));
+  EXPECT_TRUE(ob.top_changed(1));
+}
+
+TEST(OrderBook, TopChangedNeverMissesAChange) {
+  // whenever the top 3 differ after an event, top_changed(3) must have said so
+  OrderBook ob;
+  uint64_t x = 12345;
+  auto rnd = [&](uint64_t n) { x ^= x << 13; x ^= x >> 7; x ^= x << 17; return x % n; };
+  auto same = [](const BookSnapshot& a, const BookSnapshot& b) {
+    auto eq = [](const std::vector<LevelView>& p, const std::vector<LevelView>& q) {
+      if (p.size() != q.size()) return false;
+      for (size_t i = 0; i < p.size(); ++i)
+        if (p[i].price != q[i].price || p[i].total_qty != q[i].total_qty || p[i].orders != q[i].orders) return false;
+      return true;
+    };
+    return eq(a.bids, b.bids) && eq(a.asks, b.asks);
+  };
+  for (int i = 0; i < 20000; ++i) {
+    auto before = ob.snapshot_top_n(3);
+    uint64_t id = 1 + rnd(200);
+    Side side = rnd(2) ? Side::Bid : Side::Ask;
+    int64_t px = side == Side::Bid ? 100 - static_cast<int64_t>(rnd(8)) : 101 + static_cast<int64_t>(rnd(8));
+    switch (rnd(10)) {
+      case 0: case 1: case 2: case 3: ob.on_event(mk_add(i, side, id, px, 1 + static_cast<int>(rnd(9)))); break;
+      case 4: case 5: ob.on_event(mk_cxl(i, id)); break;
+      case 6: case 7: ob.on_event(mk_mod(i, id, px, 1 + static_cast<int>(rnd(9)))); break;
+      case 8: ob.on_event(mk_trd(i, id, 1)); break;
+      default: if (rnd(50) == 0) ob.on_event(mk_clr(i)); break;
+    }
+    if (!same(before, ob.snapshot_top_n(3))) {
+      ASSERT_TRUE(ob.top_changed(3)) << "event " << i;
+    }
+  }
+}
+
+TEST(OrderBook, LastEffectReportsTheLookedUpOrder) {
+  OrderBook ob;
+  ob.on_event(mk_add(1, Side::Ask, 7, 105, 10));
+  auto e = ob.last_effect();
+  EXPECT_TRUE(e.applied);
+  EXPECT_EQ(e.kind, EventKind::Add);
+  EXPECT_EQ(e.qty, 10);
+  EXPECT_EQ(e.levels, OrderBook::Effect::Levels::Added);
+
+  ob.on_event(mk_trd(2, 7, 4));          // the event has no price or side
+  e = ob.last_effect();
+  EXPECT_EQ(e.kind, EventKind::Trade);
+  EXPECT_EQ(e.side, Side::Ask);
+  EXPECT_EQ(e.price, 105);
+  EXPECT_EQ(e.qty, 4);
+  EXPECT_EQ(e.levels, OrderBook::Effect::Levels::Size);
+  EXPECT_EQ(e.level_delta, -4);
+
+  ob.on_event(mk_mod(3, 7, 106, 5));
+  e = ob.last_effect();
+  EXPECT_EQ(e.kind, EventKind::Modify);
+  EXPECT_EQ(e.old_price, 105);
+  EXPECT_EQ(e.old_qty, 6);
+  EXPECT_EQ(e.price, 106);
+  EXPECT_EQ(e.qty, 5);
+  EXPECT_EQ(e.levels, OrderBook::Effect::Levels::Several);   // left 105, joined 106
+
+  ob.on_event(mk_trd(4, 7, 5));          // fills it: still reported as the trade
+  e = ob.last_effect();
+  EXPECT_EQ(e.kind, EventKind::Trade);
+  EXPECT_EQ(e.price, 106);
+  EXPECT_EQ(e.levels, OrderBook::Effect::Levels::Removed);
+  EXPECT_EQ(e.level_delta, -5);
+  EXPECT_EQ(ob.order_count(), 0u);
+
+  ob.on_event(mk_cxl(5, 7));             // gone: nothing applied
+  EXPECT_FALSE(ob.last_effect().applied);
+  EXPECT_EQ(ob.last_effect().kind, EventKind::Cancel);
+}
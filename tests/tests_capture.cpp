@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "common/capture.hpp"
+#include "common/net.hpp"
+#include "streamer/streamer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+static std::string tmp_path(const char* name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static std::string payload(size_t i) {
+  // varying lengths so records straddle block boundaries at different offsets
+  return "@" + std::to_string(1000 + i) + ",ADD," + std::to_string(i) + ",B,100,1," +
+         std::string(i % 97, 'x') + "\n";
+}
+
+TEST(Capture, RoundTripAcrossBlocks) {
+  const std::string path = tmp_path("tests_capture_roundtrip.cap");
+  std::vector<size_t> kept;
+  {
+    capture::Writer w(path, capture::Codec::None, 8192, 4);
+    for (size_t i = 0; i < 5000; ++i) {
+      std::string p = payload(i);
+      if (w.append(1'000'000 + i, p.data(), p.size())) kept.push_back(i);
+    }
+    w.close();
+    EXPECT_EQ(w.records(), kept.size());
+    EXPECT_EQ(w.records() + w.dropped(), 5000u);
+    EXPECT_EQ(w.bytes_written() % capture::kAlign, 0u);
+  }
+  ASSERT_FALSE(kept.empty());
+  EXPECT_TRUE(capture::is_capture(path));
+
+  capture::Reader r(path);
+  uint64_t ts = 0;
+  std::string data;
+  size_t n = 0;
+  while (r.next(ts, data)) {
+    ASSERT_LT(n, kept.size());
+    EXPECT_EQ(ts, 1'000'000 + kept[n]);
+    EXPECT_EQ(data, payload(kept[n]));
+    ++n;
+  }
+  EXPECT_EQ(n, kept.size());
+  std::remove(path.c_str());
+}
+
+TEST(Capture, OversizeRecordIsDropped) {
+  const std::string path = tmp_path("tests_capture_oversize.cap");
+  capture::Writer w(path, capture::Codec::None, 8192, 2);
+  std::string big(9000, 'x');
+  EXPECT_FALSE(w.append(1, big.data(), big.size()));
+  EXPECT_TRUE(w.append(2, "abc", 3));
+  w.close();
+  EXPECT_EQ(w.records(), 1u);
+  EXPECT_EQ(w.dropped(), 1u);
+
+  capture::Reader r(path);
+  uint64_t ts = 0;
+  std::string data;
+  ASSERT_TRUE(r.next(ts, data));
+  EXPECT_EQ(ts, 2u);
+  EXPECT_EQ(data, "abc");
+  EXPECT_FALSE(r.next(ts, data));
+  std::remove(path.c_str());
+}
+
+TEST(Capture, ReaderRejectsOtherFiles) {
+  const std::string path = tmp_path("tests_capture_text.txt");
+  std::ofstream(path) << "ADD,1,B,100,1\n";
+  EXPECT_FALSE(capture::is_capture(path));
+  EXPECT_THROW(capture::Reader r(path), std::runtime_error);
+  EXPECT_THROW(capture::Reader r(tmp_path("tests_capture_missing.cap")), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(Capture, ParseCodec) {
+  EXPECT_EQ(capture::parse_codec("none"), capture::Codec::None);
+  EXPECT_EQ(capture::parse_codec(""), capture::Codec::None);
+  EXPECT_THROW(capture::parse_codec("lz77"), std::invalid_argument);
+  if (capture::codec_available(capture::Codec::Zstd))
+    EXPECT_EQ(capture::parse_codec("zstd"), capture::Codec::Zstd);
+  else
+    EXPECT_THROW(capture::parse_codec("zstd"), std::invalid_argument);
+}
+
+TEST(Capture, ReplayOptionsParse) {
+  using streamer::CaptureReplayOptions;
+  auto o = CaptureReplayOptions::parse("cap:/tmp/feed.cap");
+  EXPECT_EQ(o.path, "/tmp/feed.cap");
+  EXPECT_DOUBLE_EQ(o.speed, 1.0);
+  EXPECT_TRUE(o.restamp);
+  o = CaptureReplayOptions::parse("cap:/tmp/feed.cap,speed=2.5,restamp=0");
+  EXPECT_DOUBLE_EQ(o.speed, 2.5);
+  EXPECT_FALSE(o.restamp);
+  EXPECT_DOUBLE_EQ(CaptureReplayOptions::parse("cap:f,speed=0").speed, 0.0);
+
+  EXPECT_THROW(CaptureReplayOptions::parse("/tmp/feed.cap"), std::invalid_argument);
+  EXPECT_THROW(CaptureReplayOptions::parse("cap:"), std::invalid_argument);
+  EXPECT_THROW(CaptureReplayOptions::parse("cap:,speed=2"), std::invalid_argument);
+  EXPECT_THROW(CaptureReplayOptions::parse("cap:f,speed=-1"), std::invalid_argument);
+  EXPECT_THROW(CaptureReplayOptions::parse("cap:f,speed=fast"), std::invalid_argument);
+  EXPECT_THROW(CaptureReplayOptions::parse("cap:f,loop=1"), std::invalid_argument);
+}
+
+TEST(Capture, RestampAcrossChunks) {
+  // chunks cut lines (and stamps) anywhere; unstamped lines pass through
+  streamer::Restamper r;
+  std::string out, all;
+  for (const char* chunk : {"@123,ADD,1,B,1,100,5\n@4", "56", ",CXL,2,1\nCLR,3\n@", "7,TRD,4,1,1\n"}) {
+    r.run(chunk, std::strlen(chunk), 99, out);
+    all += out;
+  }
+  EXPECT_EQ(all, "@99,ADD,1,B,1,100,5\n@99,CXL,2,1\nCLR,3\n@99,TRD,4,1,1\n");
+}
+
+TEST(Capture, ReplayKeepsTheCapturedGaps) {
+  using namespace std::chrono;
+  streamer::CaptureReplayOptions opt;
+  opt.speed = 2;
+  EXPECT_EQ(opt.send_offset_ns(1'000'000'000, 1'000'000'000), 0u);
+  EXPECT_EQ(opt.send_offset_ns(1'300'000'000, 1'000'000'000), 150'000'000u);
+  opt.speed = 0;   // as fast as possible
+  EXPECT_EQ(opt.send_offset_ns(1'300'000'000, 1'000'000'000), 0u);
+
+  // end to end over a unix socket: 200 ms of capture at speed 2, restamped
+  const std::string path = tmp_path("tests_capture_replay.cap");
+  {
+    capture::Writer w(path);
+    w.append(1'000'000'000, "@1,ADD,1,B,1,100,5\n", 19);
+    w.append(1'100'000'000, "@2,CXL,2,1\n", 11);
+    w.append(1'200'000'000, "@3,CLR,3\n", 9);
+    w.close();
+  }
+  auto ep = net::Endpoint::parse("unix:///tmp/tests_capture_" + std::to_string(::getpid()) + ".sock", "");
+  int lfd = net::listen_endpoint(ep);
+  std::string got;
+  std::thread engine([&] {
+    int fd = net::accept_one(lfd);
+    char buf[256];
+    size_t n;
+    while ((n = net::recv_some(fd, buf, sizeof(buf))) != 0) got.append(buf, n);
+    net::close_fd(fd);
+  });
+  const uint64_t before = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+  const auto t0 = steady_clock::now();
+  streamer::Streamer s;
+  EXPECT_EQ(s.replay_capture(ep, streamer::CaptureReplayOptions::parse("cap:" + path + ",speed=2")), 0);
+  const auto took = steady_clock::now() - t0;
+  engine.join();
+  net::close_fd(lfd);
+  std::remove(path.c_str());
+
+  EXPECT_GE(took, milliseconds(100));
+  EXPECT_LT(took, milliseconds(1000));
+  std::vector<uint64_t> stamps;
+  for (size_t pos = 0; (pos = got.find('@', pos)) != std::string::npos; ++pos)
+    stamps.push_back(std::stoull(got.substr(pos + 1)));
+  ASSERT_EQ(stamps.size(), 3u);
+  EXPECT_GE(stamps[0], before);
+  EXPECT_GE(stamps[2] - stamps[0], 90'000'000u);   // sent ~100 ms apart
+  EXPECT_NE(got.find(",CXL,2,1\n"), std::string::npos);
+}
@@ -0,0 +1,341 @@
+#include <gtest/gtest.h>
+#include "engine/checkpoint.hpp"
+#include "engine/engine.hpp"
+#include "engine/time_index.hpp"
+#include "engine/parser.hpp"
+#include "common/mbo_gen.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace engine;
+
+static std::string tmp_path(const char* name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static std::vector<MboEvent> gen_events(size_t n) {
+  synth::MboGenerator g(synth::GenConfig::parse("orders=2000,depth=20,instruments=1,seed=3"));
+  char buf[synth::MboGenerator::kMaxLineLen];
+  std::vector<MboEvent> out;
+  while (out.size() < n) {
+    size_t len = g.next_line(buf);
+    MboEvent ev{};
+    if (len && parse_event(std::string(buf, len - 1), 0, ev)) out.push_back(ev);
+  }
+  return out;
+}
+
+static void expect_same(const OrderBook& a, const OrderBook& b) {
+  std::vector<OrderBook::RestingOrder> oa, ob;
+  a.export_orders(oa);
+  b.export_orders(ob);
+  ASSERT_EQ(oa.size(), ob.size());
+  for (size_t i = 0; i < oa.size(); ++i) {
+    EXPECT_EQ(oa[i].id, ob[i].id) << i;
+    EXPECT_EQ(oa[i].price, ob[i].price) << i;
+    EXPECT_EQ(oa[i].qty, ob[i].qty) << i;
+    EXPECT_EQ(oa[i].side, ob[i].side) << i;
+  }
+  EXPECT_EQ(a.level_count(Side::Bid), b.level_count(Side::Bid));
+  EXPECT_EQ(a.level_count(Side::Ask), b.level_count(Side::Ask));
+}
+
+TEST(Checkpoint, ExportRestoreKeepsQueueOrder) {
+  OrderBook a;
+  a.on_event({EventKind::Add, Side::Bid, 1, 100, 5});
+  a.on_event({EventKind::Add, Side::Bid, 2, 100, 7});
+  a.on_event({EventKind::Add, Side::Bid, 3, 101, 1});
+  a.on_event({EventKind::Add, Side::Ask, 4, 105, 2});
+  a.on_event({EventKind::Modify, Side::Bid, 1, 100, 5, 100, 9});   // size change keeps priority
+
+  std::vector<OrderBook::RestingOrder> orders;
+  a.export_orders(orders);
+  ASSERT_EQ(orders.size(), 4u);
+  EXPECT_EQ(orders[0].id, 3u);   // best bid first
+  EXPECT_EQ(orders[1].id, 1u);   // then the 100 queue, FIFO
+  EXPECT_EQ(orders[2].id, 2u);
+  EXPECT_EQ(orders[3].id, 4u);
+
+  OrderBook b;
+  b.on_event({EventKind::Add, Side::Ask, 99, 200, 1});   // replaced by restore
+  b.restore(orders.data(), orders.size());
+  expect_same(a, b);
+  EXPECT_EQ(b.order_count(), 4u);
+}
+
+TEST(Checkpoint, ResumeMatchesFullReplay) {
+  auto events = gen_events(40000);
+  OrderBook full, half;
+  for (auto& ev : events) full.on_event(ev);
+  for (size_t i = 0; i < events.size() / 2; ++i) half.on_event(events[i]);
+
+  const std::string path = tmp_path("tests_checkpoint_resume.ckpt");
+  std::vector<OrderBook::RestingOrder> orders;
+  half.export_orders(orders);
+  CheckpointInfo info;
+  info.feed_offset = 12345;
+  info.lines = events.size() / 2;
+  write_checkpoint(path, orders, info);
+
+  OrderBook resumed;
+  CheckpointInfo got = load_checkpoint(path, resumed);
+  EXPECT_EQ(got.feed_offset, 12345u);
+  EXPECT_EQ(got.lines, events.size() / 2);
+  EXPECT_EQ(got.orders, orders.size());
+  expect_same(half, resumed);
+
+  for (size_t i = events.size() / 2; i < events.size(); ++i) resumed.on_event(events[i]);
+  expect_same(full, resumed);
+  std::remove(path.c_str());
+}
+
+TEST(Checkpoint, EngineResumesAReplayWhereItsCheckpointEnds) {
+  // a feed file, and its first half cut in the middle of a line (a crash mid-read)
+  synth::MboGenerator g(synth::GenConfig::parse("orders=2000,depth=20,instruments=1,seed=5"));
+  char buf[synth::MboGenerator::kMaxLineLen];
+  std::string feed;
+  size_t cut = 0;
+  for (int i = 0; i < 30000; ++i) {
+    if (i == 15000) cut = feed.size() + 7;
+    feed.append(buf, g.next_line(buf));
+  }
+  const std::string full_path = tmp_path("tests_checkpoint_engine_feed.txt");
+  const std::string half_path = tmp_path("tests_checkpoint_engine_half.txt");
+  std::ofstream(full_path, std::ios::binary) << feed;
+  std::ofstream(half_path, std::ios::binary) << feed.substr(0, cut);
+  const std::string mid = tmp_path("tests_checkpoint_engine_mid.ckpt");
+  const std::string resumed = tmp_path("tests_checkpoint_engine_resumed.ckpt");
+  const std::string straight = tmp_path("tests_checkpoint_engine_straight.ckpt");
+
+  {
+    EngineApp app;
+    app.enable_checkpoints(mid, 1'000'000);
+    app.replay(half_path, 5);
+  }
+  {
+    EngineApp app;
+    CheckpointInfo info = app.restore_checkpoint(mid);
+    EXPECT_EQ(info.lines, 15000u);
+    EXPECT_EQ(info.feed_offset, cut - 7);   // the partial line is not in it
+    app.enable_checkpoints(resumed, 1'000'000);
+    app.replay(full_path, 5);
+  }
+  {
+    EngineApp app;
+    app.enable_checkpoints(straight, 1'000'000);
+    app.replay(full_path, 5);
+  }
+
+  OrderBook a, b;
+  CheckpointInfo ia = load_checkpoint(resumed, a);
+  CheckpointInfo ib = load_checkpoint(straight, b);
+  EXPECT_EQ(ia.lines, 30000u);
+  EXPECT_EQ(ia.lines, ib.lines);
+  EXPECT_EQ(ia.feed_offset, feed.size());
+  EXPECT_EQ(ia.feed_offset, ib.feed_offset);
+  EXPECT_EQ(ia.last_ts_ns, ib.last_ts_ns);
+  EXPECT_GT(a.order_count(), 0u);
+  expect_same(a, b);
+  for (const auto& p : {full_path, half_path, mid, resumed, straight}) std::remove(p.c_str());
+}
+
+TEST(Checkpoint, CorruptFilesAreRejected) {
+  const std::string path = tmp_path("tests_checkpoint_corrupt.ckpt");
+  OrderBook a;
+  a.on_event({EventKind::Add, Side::Bid, 1, 100, 5});
+  a.on_event({EventKind::Add, Side::Ask, 2, 101, 5});
+  std::vector<OrderBook::RestingOrder> orders;
+  a.export_orders(orders);
+  write_checkpoint(path, orders, {});
+
+  {
+    // flip one byte of the order data
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(sizeof(CheckpointHeader) + 8);
+    f.put('\x7f');
+  }
+  OrderBook b;
+  EXPECT_THROW(load_checkpoint(path, b), std::runtime_error);
+
+  write_checkpoint(path, orders, {});
+  std::filesystem::resize_file(path, sizeof(CheckpointHeader) + sizeof(OrderBook::RestingOrder));
+  EXPECT_THROW(load_checkpoint(path, b), std::runtime_error);
+
+  std::ofstream(path) << "ADD,1,B,100,5\n";
+  EXPECT_THROW(load_checkpoint(path, b), std::runtime_error);
+  EXPECT_THROW(load_checkpoint(tmp_path("tests_checkpoint_missing.ckpt"), b), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(Checkpoint, CheckpointerWritesInBackground) {
+  const std::string path = tmp_path("tests_checkpoint_bg.ckpt");
+  auto events = gen_events(5000);
+  OrderBook a;
+  for (auto& ev : events) a.on_event(ev);
+  {
+    Checkpointer c(path);
+    CheckpointInfo info;
+    info.lines = events.size();
+    EXPECT_TRUE(c.submit(a, info));
+    for (int i = 0; i < 2000 && c.written() < 1; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(c.written(), 1u);
+  }
+  OrderBook b;
+  CheckpointInfo got = load_checkpoint(path, b);
+  EXPECT_EQ(got.lines, events.size());
+  EXPECT_EQ(got.bid_levels, a.level_count(Side::Bid));
+  expect_same(a, b);
+  std::remove(path.c_str());
+}
+
+static bool wait_written(const Checkpointer& c, uint64_t n) {
+  for (int i = 0; i < 2000 && c.written() < n; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return c.written() >= n;
+}
+
+TEST(Checkpoint, CheckpointerCopiesOnlyChangedLevels) {
+  const std::string path = tmp_path("tests_checkpoint_incr.ckpt");
+  auto events = gen_events(20000);
+  OrderBook a;
+  Checkpointer c(path);
+  for (size_t i = 0; i < 10000; ++i) {
+    a.on_event(events[i]);
+    c.note(a);
+  }
+  ASSERT_TRUE(c.submit(a, CheckpointInfo{}, true));
+  EXPECT_EQ(c.copied(), a.order_count());   // the first one copies the whole book
+  ASSERT_TRUE(wait_written(c, 1));
+
+  // one more order on an existing level: only that level is copied again
+  std::vector<OrderBook::RestingOrder> all, lvl;
+  a.export_orders(all);
+  const auto& best = all.front();
+  a.on_event({EventKind::Add, best.side, 99'000'000, best.price, 3});
+  c.note(a);
+  a.export_level(best.side, best.price, lvl);
+  ASSERT_TRUE(c.submit(a, CheckpointInfo{}, true));
+  EXPECT_EQ(c.copied(), lvl.size());
+  EXPECT_LT(c.copied(), a.order_count());
+  ASSERT_TRUE(wait_written(c, 2));
+  OrderBook b;
+  load_checkpoint(path, b);
+  expect_same(a, b);
+
+  // many events, levels appearing and disappearing, then a clear and a rebuild
+  for (size_t i = 10000; i < 20000; ++i) {
+    a.on_event(events[i]);
+    c.note(a);
+    if (i % 2500 == 0) {
+      ASSERT_TRUE(c.submit(a, CheckpointInfo{}, true));
+    }
+  }
+  ASSERT_TRUE(c.submit(a, CheckpointInfo{}, true));
+  ASSERT_TRUE(wait_written(c, 7));
+  OrderBook d;
+  load_checkpoint(path, d);
+  expect_same(a, d);
+
+  a.on_event({EventKind::Clear, Side::Bid, 0, 0, 0});
+  c.note(a);
+  for (size_t i = 0; i < 500; ++i) {
+    a.on_event(events[i]);
+    c.note(a);
+  }
+  ASSERT_TRUE(c.submit(a, CheckpointInfo{}, true));
+  EXPECT_EQ(c.copied(), a.order_count());
+  ASSERT_TRUE(wait_written(c, 8));
+  OrderBook e;
+  load_checkpoint(path, e);
+  expect_same(a, e);
+  std::remove(path.c_str());
+}
+
+static std::string write_feed(const char* name, size_t n) {
+  std::string path = tmp_path(name);
+  synth::MboGenerator g(synth::GenConfig::parse("orders=2000,depth=20,instruments=1,seed=5"));
+  char buf[synth::MboGenerator::kMaxLineLen];
+  std::ofstream out(path, std::ios::binary);
+  for (size_t i = 0; i < n; ++i) out.write(buf, static_cast<std::streamsize>(g.next_line(buf)));
+  return path;
+}
+
+TEST(TimeIndex, BookAtMatchesReplayUpToTs) {
+  const std::string feed = write_feed("tests_time_index_feed.txt", 20000);
+  const std::string index = TimeIndex::default_index_path(feed);
+  TimeIndex::Options opt;
+  opt.every_events = 1000;
+  TimeIndex::build(feed, index, opt);
+  TimeIndex ti(feed, index);
+  EXPECT_GE(ti.entries().size(), 20u);
+
+  std::vector<MboEvent> events;
+  {
+    std::ifstream in(feed);
+    for (std::string line; std::getline(in, line);) {
+      MboEvent ev{};
+      ASSERT_TRUE(parse_event(line, 0, ev));
+      events.push_back(ev);
+    }
+  }
+  for (size_t k : {size_t(0), size_t(1), size_t(999), size_t(1000), size_t(7777), size_t(19999)}) {
+    uint64_t ts = events[k].ts_ns;
+    OrderBook expected;
+    size_t applied = 0;
+    for (auto& ev : events) {
+      if (ev.ts_ns > ts) break;
+      expected.on_event(ev);
+      ++applied;
+    }
+    OrderBook got;
+    auto r = ti.book_at(ts, got);
+    EXPECT_EQ(r.as_of_ts_ns, ts) << k;
+    EXPECT_EQ(r.lines, applied) << k;
+    EXPECT_LE(r.replayed, opt.every_events) << k;
+    expect_same(expected, got);
+  }
+
+  OrderBook before;
+  auto r = ti.book_at(events[0].ts_ns - 1, before);
+  EXPECT_EQ(r.lines, 0u);
+  EXPECT_EQ(before.order_count(), 0u);
+
+  // appending to the feed makes the index stale
+  std::ofstream(feed, std::ios::app) << "CLR,1\n";
+  EXPECT_THROW(TimeIndex(feed, index), std::runtime_error);
+  std::remove(feed.c_str());
+  std::remove(index.c_str());
+}
+
+TEST(TimeIndex, SameSizeRewriteMakesTheIndexStale) {
+  const std::string feed = write_feed("tests_time_index_rewrite.txt", 5000);
+  const std::string index = TimeIndex::default_index_path(feed);
+  TimeIndex::build(feed, index, {});
+  { TimeIndex ok(feed, index); }
+
+  // same bytes in a different order: the size matches, the content does not
+  std::string body;
+  {
+    std::ifstream in(feed, std::ios::binary);
+    body.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  const size_t first = body.find('\n') + 1;
+  const size_t second = body.find('\n', first) + 1;
+  std::string rewritten = body.substr(first, second - first) + body.substr(0, first) + body.substr(second);
+  ASSERT_EQ(rewritten.size(), body.size());
+  ASSERT_NE(rewritten, body);
+  std::ofstream(feed, std::ios::binary | std::ios::trunc) << rewritten;
+  EXPECT_THROW(TimeIndex(feed, index), std::runtime_error);
+
+  // a rebuild picks up the new content
+  TimeIndex::build(feed, index, {});
+  EXPECT_NO_THROW(TimeIndex(feed, index));
+  std::remove(feed.c_str());
+  std::remove(index.c_str());
+}
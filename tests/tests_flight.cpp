@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "engine/flight_recorder.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace engine;
+
+static FlightRecorder::Record rec(uint64_t id, uint64_t lat_ns) {
+  FlightRecorder::Record r{};
+  r.ev.kind = EventKind::Add;
+  r.ev.side = Side::Bid;
+  r.ev.order_id = id;
+  r.ev.price = 100;
+  r.ev.qty = 1;
+  r.recv_ns = 1000 * id;
+  r.apply_ns = r.recv_ns + lat_ns;
+  r.book_orders = static_cast<uint32_t>(id);
+  for (int i = 0; i < FlightRecorder::kStages; ++i) r.stage_ns[i] = static_cast<uint32_t>(10 * (i + 1));
+  return r;
+}
+
+static bool wait_dumps(const FlightRecorder& f, uint64_t n) {
+  for (int i = 0; i < 2000 && f.dumps() < n; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return f.dumps() >= n;
+}
+
+static size_t count_lines(const std::string& path) {
+  std::ifstream in(path);
+  size_t n = 0;
+  for (std::string l; std::getline(in, l);) ++n;
+  return n;
+}
+
+TEST(Flight, RingKeepsLastN) {
+  FlightRecorder f(100);   // rounds up to 128
+  EXPECT_EQ(f.capacity(), 128u);
+  for (uint64_t i = 1; i <= 1000; ++i) f.record(rec(i, 10));
+  auto recs = f.snapshot();
+  ASSERT_EQ(recs.size(), 128u);
+  EXPECT_EQ(recs.front().ev.order_id, 873u);
+  EXPECT_EQ(recs.back().ev.order_id, 1000u);
+  EXPECT_EQ(f.recorded(), 1000u);
+}
+
+TEST(Flight, NotStartedNeverFreezes) {
+  FlightRecorder f(16);
+  EXPECT_EQ(f.request_dump("request"), "");
+  f.record(rec(1, 10));
+  EXPECT_EQ(f.recorded(), 1u);
+}
+
+TEST(Flight, SpikeDumpsRingToFile) {
+  auto dir = std::filesystem::temp_directory_path() / "flight_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  FlightRecorder f(64);
+  f.start(dir.string(), 5000, 60'000'000'000ULL);   // long cooldown: one automatic dump
+  for (uint64_t i = 1; i <= 50; ++i) f.record(rec(i, 100));
+  f.record(rec(51, 9000));   // spike
+  ASSERT_TRUE(wait_dumps(f, 1));
+  f.record(rec(52, 9000));   // within cooldown: recorded, no second dump
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(f.dumps(), 1u);
+
+  std::string path = (dir / "flight_0.csv").string();
+  ASSERT_TRUE(std::filesystem::exists(path));
+  std::ifstream in(path);
+  std::string header;
+  std::getline(in, header);
+  EXPECT_NE(header.find("reason=latency lat_ns=9000"), std::string::npos);
+  std::string columns;
+  std::getline(in, columns);
+  EXPECT_NE(columns.find(",book_levels,stage_frame_ns,stage_parse_ns,stage_lock_ns,stage_apply_ns,stage_publish_ns"),
+            std::string::npos) << columns;
+  EXPECT_EQ(count_lines(path), 2u + 51u);   // header, columns, 51 records
+  std::string first;
+  std::getline(in, first);
+  EXPECT_NE(first.find(",10,20,30,40,50"), std::string::npos) << first;
+
+  // on request; the spike-frozen ring has been released again
+  std::string p2 = f.request_dump("request");
+  EXPECT_EQ(p2, (dir / "flight_1.csv").string());
+  ASSERT_TRUE(wait_dumps(f, 2));
+  EXPECT_EQ(count_lines(p2), 2u + 52u);
+  std::filesystem::remove_all(dir);
+}
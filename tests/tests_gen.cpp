@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "common/mbo_gen.hpp"
+#include "common/net.hpp"
+#include "engine/order_book.hpp"
+#include "streamer/streamer.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace synth;
+
+static std::string take_lines(MboGenerator& g, size_t n) {
+  std::string out;
+  char buf[MboGenerator::kMaxLineLen];
+  for (size_t i = 0; i < n; ++i) {
+    size_t len = g.next_line(buf);
+    if (len == 0) break;
+    out.append(buf, len);
+  }
+  return out;
+}
+
+static engine::MboEvent to_mbo(const GenEvent& g) {
+  engine::MboEvent e{};
+  e.ts_ns = g.ts_ns;
+  e.order_id = g.order_id;
+  e.side = (g.side == 'B') ? engine::Side::Bid : engine::Side::Ask;
+  switch (g.kind) {
+    case 'A': e.kind = engine::EventKind::Add; e.price = g.price; e.qty = g.qty; break;
+    case 'M': e.kind = engine::EventKind::Modify; e.new_price = g.price; e.new_qty = g.qty; break;
+    case 'C': e.kind = engine::EventKind::Cancel; break;
+    default:  e.kind = engine::EventKind::Trade; e.qty = g.qty; break;
+  }
+  return e;
+}
+
+TEST(MboGen, SameSeedSameStream) {
+  GenConfig cfg = GenConfig::parse("orders=2000,seed=42");
+  MboGenerator a(cfg), b(cfg);
+  EXPECT_EQ(take_lines(a, 50000), take_lines(b, 50000));
+
+  cfg.seed = 43;
+  MboGenerator c(cfg);
+  MboGenerator d(GenConfig::parse("orders=2000,seed=42"));
+  EXPECT_NE(take_lines(c, 1000), take_lines(d, 1000));
+}
+
+TEST(MboGen, StreamIsConsistent) {
+  // shadow book: every reference must hit a live order, fills never exceed
+  // the resting qty, sides never change and the book never crosses
+  GenConfig cfg = GenConfig::parse("orders=5000,depth=20,vol=0.01,instruments=1,seed=7,events=300000");
+  MboGenerator g(cfg);
+  struct Live { char side; int64_t px; int32_t qty; };
+  std::unordered_map<uint64_t, Live> live;
+  std::map<int64_t, int> bids, asks;
+  auto drop_level = [](std::map<int64_t, int>& m, int64_t px) { if (--m[px] == 0) m.erase(px); };
+
+  GenEvent ev;
+  size_t counts[4] = {};
+  while (g.next(ev)) {
+    if (ev.kind == 'A') {
+      ASSERT_EQ(live.count(ev.order_id), 0u);
+      ASSERT_GT(ev.qty, 0);
+      live[ev.order_id] = Live{ev.side, ev.price, ev.qty};
+      ++(ev.side == 'B' ? bids : asks)[ev.price];
+      ++counts[0];
+      continue;
+    }
+    auto it = live.find(ev.order_id);
+    ASSERT_NE(it, live.end()) << "event references unknown order " << ev.order_id;
+    Live& o = it->second;
+    auto& lv = (o.side == 'B') ? bids : asks;
+    ASSERT_EQ(ev.side, o.side);
+    if (ev.kind == 'C') {
+      drop_level(lv, o.px);
+      live.erase(it);
+      ++counts[1];
+    } else if (ev.kind == 'M') {
+      drop_level(lv, o.px);
+      o.px = ev.price; o.qty = ev.qty;
+      ++lv[o.px];
+      ++counts[2];
+    } else {
+      ASSERT_EQ(ev.price, o.px);
+      ASSERT_LE(ev.qty, o.qty);
+      o.qty -= ev.qty;
+      if (o.qty == 0) { drop_level(lv, o.px); live.erase(it); }
+      ++counts[3];
+    }
+    if (!bids.empty() && !asks.empty()) {
+      ASSERT_LT(bids.rbegin()->first, asks.begin()->first) << "crossed book";
+    }
+  }
+  EXPECT_EQ(live.size(), g.live_orders());
+  // every event kind shows up at roughly its configured share
+  EXPECT_GT(counts[1], 60000u);
+  EXPECT_GT(counts[2], 20000u);
+  EXPECT_GT(counts[3], 20000u);
+}
+
+TEST(MboGen, AppliesCleanlyToOrderBook) {
+  GenConfig cfg = GenConfig::parse("orders=3000,instruments=3,seed=5,events=100000");
+  MboGenerator g(cfg);
+  engine::OrderBook ob;
+  GenEvent ev;
+  while (g.next(ev)) ob.on_event(to_mbo(ev));
+
+  auto snap = ob.snapshot_full();
+  uint64_t orders = 0;
+  for (auto& l : snap.bids) orders += l.orders;
+  for (auto& l : snap.asks) orders += l.orders;
+  EXPECT_EQ(orders, g.live_orders());
+}
+
+TEST(MboGen, InstrumentOffsetGivesDisjointStreams) {
+  // fan-out gives each connection its own instrument band; ids must never collide
+  GenConfig a = GenConfig::parse("orders=500,instruments=2,seed=1,events=20000");
+  GenConfig b = GenConfig::parse("orders=500,instruments=2,seed=2,events=20000,inst0=2");
+  MboGenerator ga(a), gb(b);
+  std::unordered_map<uint64_t, int> owner;
+  GenEvent ev;
+  while (ga.next(ev)) owner[ev.order_id] = 0;
+  while (gb.next(ev)) {
+    auto it = owner.find(ev.order_id);
+    ASSERT_TRUE(it == owner.end() || it->second == 1) << "id " << ev.order_id << " shared";
+    owner[ev.order_id] = 1;
+  }
+}
+
+TEST(MboGen, SpecParsing) {
+  GenConfig c = GenConfig::parse("gen:orders=1e6,depth=25,vol=0.5,instruments=4,events=1e7");
+  EXPECT_EQ(c.live_orders, 1000000u);
+  EXPECT_EQ(c.depth, 25u);
+  EXPECT_DOUBLE_EQ(c.volatility, 0.5);
+  EXPECT_EQ(c.instruments, 4u);
+  EXPECT_EQ(c.events, 10000000u);
+  EXPECT_THROW(GenConfig::parse("nope=1"), std::invalid_argument);
+  EXPECT_THROW(GenConfig::parse("orders"), std::invalid_argument);
+}
+
+TEST(Fanout, SlicesSplitTheFileByBytes) {
+  // lines of varying length, so slice boundaries fall mid-line
+  const std::string path = (std::filesystem::temp_directory_path() / "tests_gen_slices.txt").string();
+  constexpr int kLines = 1000;
+  {
+    std::ofstream out(path, std::ios::binary);
+    for (int i = 0; i < kLines; ++i) out << "CXL," << i << "," << std::string(i % 37, '9') << "\n";
+  }
+  auto ep = net::Endpoint::parse("unix:///tmp/tests_gen_" + std::to_string(::getpid()) + ".sock", "");
+  int lfd = net::listen_endpoint(ep);
+  std::vector<std::string> got;
+  std::thread engine([&] {
+    // one connection at a time, like the engine
+    for (int c = 0; c < 3; ++c) {
+      int fd = net::accept_one(lfd);
+      std::string data;
+      char buf[4096];
+      size_t n;
+      while ((n = net::recv_some(fd, buf, sizeof(buf))) != 0) data.append(buf, n);
+      net::close_fd(fd);
+      for (size_t pos = 0, nl; (nl = data.find('\n', pos)) != std::string::npos; pos = nl + 1) {
+        std::string line = data.substr(pos, nl - pos);
+        if (line[0] == '@') line = line.substr(line.find(',') + 1);   // the send stamp
+        got.push_back(line);
+      }
+    }
+  });
+  streamer::FanoutOptions opt;
+  opt.connections = 3;
+  opt.mode = streamer::FanoutMode::Slice;
+  opt.lines_per_sec = {1'000'000};
+  streamer::Streamer s;
+  EXPECT_EQ(s.run_fanout(ep, path, opt), 0);
+  engine.join();
+  net::close_fd(lfd);
+  std::remove(path.c_str());
+
+  ASSERT_EQ(got.size(), static_cast<size_t>(kLines));   // every line once, none torn
+  std::vector<int> seen(kLines, 0);
+  for (const auto& l : got) {
+    int i = std::stoi(l.substr(4));
+    ASSERT_EQ(l, "CXL," + std::to_string(i) + "," + std::string(i % 37, '9'));
+    ++seen[i];
+  }
+  for (int i = 0; i < kLines; ++i) EXPECT_EQ(seen[i], 1) << "line " << i;
+}
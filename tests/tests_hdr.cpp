@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include "common/hdr_histogram.hpp"
+#include "common/windowed_histogram.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace metrics;
+
+static uint64_t exact_quantile(std::vector<uint64_t> v, double q) {
+  std::sort(v.begin(), v.end());
+  size_t need = std::max<size_t>(1, (size_t)std::ceil(q * v.size()));
+  return v[need - 1];
+}
+
+TEST(Hdr, LayoutIsSmallAndExactForSmallValues) {
+  HdrHistogram h;  // 1ns..10s, 2 digits
+  EXPECT_LE(h.memory_bytes(), 32u * 1024u);
+  for (uint64_t v = 0; v < 256; ++v) {
+    size_t i = h.layout().index_of(v);
+    EXPECT_EQ(h.layout().lowest_at(i), v);
+    EXPECT_EQ(h.layout().highest_at(i), v);
+  }
+}
+
+TEST(Hdr, EveryValueWithinRelativeError) {
+  HdrLayout l(10'000'000'000ULL, 2);
+  std::mt19937_64 rng(1);
+  for (int k = 0; k < 200000; ++k) {
+    uint64_t v = rng() % 10'000'000'000ULL;
+    size_t i = l.index_of(v);
+    ASSERT_LE(l.lowest_at(i), v);
+    ASSERT_GE(l.highest_at(i), v);
+    ASSERT_LE(double(l.highest_at(i) - l.lowest_at(i)), 0.01 * double(v) + 1.0) << v;
+  }
+}
+
+TEST(Hdr, QuantilesMatchExactWithinPrecision) {
+  std::mt19937_64 rng(7);
+  std::lognormal_distribution<double> dist(7.0, 1.0);  // ~1us median, long tail
+  std::vector<uint64_t> vals;
+  HdrHistogram h;
+  for (int k = 0; k < 100000; ++k) {
+    uint64_t v = static_cast<uint64_t>(dist(rng));
+    vals.push_back(v);
+    h.record(v);
+  }
+  EXPECT_EQ(h.count(), vals.size());
+  EXPECT_EQ(h.max(), *std::max_element(vals.begin(), vals.end()));
+  for (double q : {0.5, 0.9, 0.99, 0.999, 0.9999}) {
+    double exact = double(exact_quantile(vals, q));
+    double got = double(h.value_at_quantile(q));
+    EXPECT_NEAR(got, exact, exact * 0.01 + 1) << "q=" << q;
+  }
+}
+
+TEST(Hdr, MergeAddsCounts) {
+  HdrHistogram a, b;
+  for (uint64_t v = 1; v <= 1000; ++v) a.record(v);
+  for (uint64_t v = 1001; v <= 2000; ++v) b.record(v);
+  a.merge(b);
+  EXPECT_EQ(a.count(), 2000u);
+  EXPECT_EQ(a.max(), 2000u);
+  EXPECT_NEAR(double(a.value_at_quantile(0.5)), 1000.0, 10.0);
+  EXPECT_THROW(a.merge(HdrHistogram(1000, 3)), std::invalid_argument);
+}
+
+TEST(Hdr, RecorderSnapshotWhileWriting) {
+  HdrRecorder rec;
+  std::thread writer([&] {
+    for (uint64_t v = 1; v <= 200000; ++v) rec.record(v % 5000);
+  });
+  uint64_t last = 0;
+  while (last < 200000) {
+    HdrHistogram s = rec.snapshot();
+    ASSERT_GE(s.count(), last);   // monotonic, never torn
+    last = s.count();
+  }
+  writer.join();
+  HdrHistogram s = rec.snapshot();
+  EXPECT_EQ(s.count(), 200000u);
+  EXPECT_EQ(s.max(), 4999u);
+}
+
+TEST(Hdr, NarrowRecorderMatchesWide) {
+  BasicHdrRecorder<uint32_t> narrow;
+  HdrRecorder wide;
+  EXPECT_EQ(narrow.memory_bytes() * 2, wide.memory_bytes());
+  for (uint64_t v = 1; v <= 100000; v += 7) {
+    narrow.record(v);
+    wide.record(v);
+  }
+  HdrHistogram a = narrow.snapshot(), b = wide.snapshot();
+  EXPECT_EQ(a.count(), b.count());
+  EXPECT_EQ(a.max(), b.max());
+  EXPECT_DOUBLE_EQ(a.mean(), b.mean());
+  for (double q : {0.5, 0.99, 0.999}) EXPECT_EQ(a.value_at_quantile(q), b.value_at_quantile(q));
+}
+
+static constexpr uint64_t kSec = 1'000'000'000ULL;
+
+TEST(Windowed, WindowsCoverCompleteSeconds) {
+  WindowedHistogram w;
+  const uint64_t t0 = 1000 * kSec;
+  // second s gets (s + 1) * 100 samples of value s + 1
+  for (uint64_t s = 0; s < 70; ++s)
+    for (uint64_t i = 0; i < (s + 1) * 100; ++i) w.record(s + 1, t0 + s * kSec + i);
+  const uint64_t now = t0 + 70 * kSec + kSec / 2;   // second 70 in progress, empty
+
+  uint64_t covered = 0;
+  HdrHistogram one = w.window(1, now, &covered);
+  EXPECT_EQ(covered, 1u);
+  EXPECT_EQ(one.count(), 7000u);   // second 69 only
+  EXPECT_EQ(one.max(), 70u);
+
+  HdrHistogram ten = w.window(10, now, &covered);
+  EXPECT_EQ(covered, 10u);
+  uint64_t expect = 0;
+  for (uint64_t s = 60; s < 70; ++s) expect += (s + 1) * 100;
+  EXPECT_EQ(ten.count(), expect);
+  EXPECT_EQ(ten.value_at_quantile(0.0), 61u);
+
+  // 60s comes from 10s epochs: t0 is second 1000, so epochs 100..106 hold seconds
+  // 1000..1069 and the current one (107) is excluded
+  HdrHistogram sixty = w.window(60, now, &covered);
+  EXPECT_EQ(covered, 60u);
+  expect = 0;
+  for (uint64_t s = 10; s < 70; ++s) expect += (s + 1) * 100;
+  EXPECT_EQ(sixty.count(), expect);
+}
+
+TEST(Windowed, StaleEpochsAreDropped) {
+  WindowedHistogram w;
+  const uint64_t t0 = 500 * kSec;
+  for (int i = 0; i < 100; ++i) w.record(42, t0);
+  EXPECT_EQ(w.window(1, t0 + kSec).count(), 100u);
+  // nothing recorded since: all windows empty once the epoch has aged out
+  EXPECT_EQ(w.window(1, t0 + 2 * kSec).count(), 0u);
+  EXPECT_EQ(w.window(10, t0 + 11 * kSec).count(), 0u);
+  EXPECT_EQ(w.window(60, t0 + 80 * kSec).count(), 0u);
+  // ring slot reuse: second t0 + 11s lands in the same slot and replaces it
+  w.record(7, t0 + 11 * kSec);
+  HdrHistogram h = w.window(1, t0 + 12 * kSec);
+  EXPECT_EQ(h.count(), 1u);
+  EXPECT_EQ(h.max(), 7u);
+}
+
+TEST(Windowed, ReadWhileRotating) {
+  WindowedHistogram w;
+  std::atomic<uint64_t> now{100 * kSec};
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    // 1000 samples per simulated second, 200 seconds
+    for (uint64_t i = 0; i < 200000; ++i) {
+      uint64_t t = 100 * kSec + (i / 1000) * kSec;
+      w.record(1 + i % 1000, t);
+      now.store(t, std::memory_order_relaxed);
+    }
+    done = true;
+  });
+  while (!done) {
+    HdrHistogram h = w.window(10, now.load(std::memory_order_relaxed));
+    ASSERT_LE(h.count(), 10000u);   // never more than 10 full seconds
+    ASSERT_LE(h.max(), 1000u);
+  }
+  writer.join();
+}
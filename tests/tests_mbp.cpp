@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "engine/mbp_publisher.hpp"
+#include "test_events.hpp"
+#include "common/mbp_feed.hpp"
+#include "common/net.hpp"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+
+using namespace engine;
+
+namespace {
+
+struct Sub {
+  int fd;
+  mbp::Reader reader;
+  mbp::Book book;
+  uint64_t updates = 0, snapshots = 0, out_of_seq = 0;
+
+  explicit Sub(int connected_fd) : fd(connected_fd) {}
+  ~Sub() { net::close_fd(fd); }
+
+  // Read and apply until done() holds (or ms pass).
+  bool read_until(const std::function<bool()>& done, int ms) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    char buf[8192];
+    while (!done()) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(end - std::chrono::steady_clock::now()).count();
+      if (left <= 0 || !net::wait_readable(fd, static_cast<int>(left))) return false;
+      size_t n = net::recv_some(fd, buf, sizeof(buf));
+      if (n == 0) return false;
+      reader.append(buf, n);
+      mbp::MsgHeader h;
+      const mbp::Entry* e;
+      while (reader.next(h, e)) {
+        if (!book.apply(h, e)) ++out_of_seq;
+        else if (h.type == static_cast<uint8_t>(mbp::MsgType::Snapshot)) ++snapshots;
+        else ++updates;
+      }
+    }
+    return true;
+  }
+};
+
+bool same_top(const OrderBook& ob, const mbp::Book& book) {
+  if (!book.synced) return false;
+  LevelView lv[mbp::kDepth];
+  for (int side = 0; side < 2; ++side) {
+    size_t n = ob.top_levels(side ? Side::Ask : Side::Bid, lv, mbp::kDepth);
+    if (book.levels_on(side) != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+      const mbp::Level& l = book.levels[side][i];
+      if (l.price != lv[i].price || l.qty != lv[i].total_qty || l.orders != lv[i].orders) return false;
+    }
+  }
+  return true;
+}
+
+void expect_same_top(const OrderBook& ob, const mbp::Book& book) {
+  LevelView lv[mbp::kDepth];
+  for (int side = 0; side < 2; ++side) {
+    size_t n = ob.top_levels(side ? Side::Ask : Side::Bid, lv, mbp::kDepth);
+    ASSERT_EQ(book.levels_on(side), n) << "side " << side;
+    for (size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(book.levels[side][i].price, lv[i].price);
+      EXPECT_EQ(book.levels[side][i].qty, lv[i].total_qty);
+      EXPECT_EQ(book.levels[side][i].orders, lv[i].orders);
+    }
+  }
+}
+
+int connect_to(const MbpPublisher& pub) {
+  return net::connect_tcp("127.0.0.1", std::to_string(pub.port()));
+}
+
+// Apply ev and publish the way the engine does.
+void apply(OrderBook& ob, MbpPublisher& pub, const MboEvent& ev) {
+  ob.on_event(ev);
+  if (ob.top_changed(MbpPublisher::kDepth)) pub.publish(ob, ev.ts_ns);
+}
+
+bool wait_for(const std::function<bool()>& cond, int ms) {
+  for (int i = 0; i < ms && !cond(); ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return cond();
+}
+
+}  // namespace
+
+TEST(Mbp, SubscribersRebuildTheTop10) {
+  OrderBook ob;
+  MbpPublisher pub;
+  pub.start("127.0.0.1", "0");
+  for (int i = 0; i < 15; ++i) apply(ob, pub, mk_add(0, Side::Bid, 1 + i, 100 - i, 10));   // 15 levels
+  ASSERT_TRUE(wait_for([&] { return pub.stats().updates.load() == 10; }, 2000));   // the last 5 are not top 10
+
+  Sub a(connect_to(pub));
+  ASSERT_TRUE(wait_for([&] { return pub.stats().subscribers.load() == 1; }, 2000));
+  ASSERT_TRUE(a.read_until([&] { return a.book.synced; }, 2000));   // the snapshot
+  EXPECT_EQ(a.snapshots, 1u);
+  expect_same_top(ob, a.book);
+
+  uint64_t updates_before = pub.stats().updates.load();
+  apply(ob, pub, mk_add(0, Side::Bid, 100, 80, 5));    // 21st price: no message
+  apply(ob, pub, mk_add(0, Side::Ask, 101, 110, 7));   // first ask
+  apply(ob, pub, mk_cxl(0, 1));                  // best bid goes: every bid slot shifts
+  apply(ob, pub, mk_add(0, Side::Bid, 102, 95, 3));    // joins level 95
+  ASSERT_TRUE(wait_for([&] { return pub.stats().updates.load() == updates_before + 3; }, 2000));
+  const uint64_t last = a.book.seq + 3;
+  ASSERT_TRUE(a.read_until([&] { return a.book.seq >= last; }, 2000));
+  EXPECT_EQ(a.out_of_seq, 0u);
+  EXPECT_EQ(a.updates, 3u);
+  expect_same_top(ob, a.book);
+}
+
+TEST(Mbp, SlowSubscriberIsConflatedThenResynced) {
+  OrderBook ob;
+  MbpPublisher::Options opt;
+  opt.max_buffer_bytes = 4096;   // a handful of updates
+  opt.slow_ms = 60'000;
+  MbpPublisher pub;
+  pub.start("127.0.0.1", "0", opt);
+
+  // a subscriber with a tiny receive buffer that does not read for a while
+  int fd = connect_to(pub);
+  int small = 4096;
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+  Sub fast(connect_to(pub));
+  ASSERT_TRUE(wait_for([&] { return pub.stats().subscribers.load() == 2; }, 2000));
+
+  for (int i = 0; i < 20000; ++i) {
+    apply(ob, pub, mk_add(0, i % 2 ? Side::Ask : Side::Bid, 1 + i, i % 2 ? 200 + i % 10 : 100 - i % 10, 1));
+  }
+  ASSERT_TRUE(wait_for([&] { return pub.stats().conflated.load() > 0; }, 5000));
+
+  // the fast one kept up with every update
+  ASSERT_TRUE(fast.read_until([&] { return same_top(ob, fast.book); }, 5000))
+      << "seq=" << fast.book.seq << " updates=" << pub.stats().updates.load() << " overruns=" << pub.stats().overruns.load();
+  EXPECT_EQ(fast.out_of_seq, 0u);
+  expect_same_top(ob, fast.book);
+
+  // the slow one drains, gets a snapshot, and ends on the same book
+  Sub slow(fd);
+  ASSERT_TRUE(slow.read_until([&] { return same_top(ob, slow.book); }, 5000));
+  EXPECT_EQ(slow.out_of_seq, 0u);
+  EXPECT_GE(slow.snapshots, 2u);   // on connect, and after conflation
+  expect_same_top(ob, slow.book);
+}
+
+TEST(Mbp, StuckSubscriberIsDisconnected) {
+  OrderBook ob;
+  MbpPublisher::Options opt;
+  opt.max_buffer_bytes = 4096;
+  opt.slow_ms = 50;
+  opt.sndbuf_bytes = 4096;   // or the kernel buffers take the whole run
+  MbpPublisher pub;
+  pub.start("127.0.0.1", "0", opt);
+
+  int fd = connect_to(pub);   // never reads
+  int small = 4096;
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+  ASSERT_TRUE(wait_for([&] { return pub.stats().subscribers.load() == 1; }, 2000));
+  // keep the book moving: a subscriber only stalls while there is something to send
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+  for (uint64_t i = 0; pub.stats().slow_disconnects.load() == 0 && std::chrono::steady_clock::now() < deadline; ++i)
+    apply(ob, pub, mk_add(0, Side::Bid, 1 + i, 100 - static_cast<int64_t>(i % 10), 1));
+
+  EXPECT_EQ(pub.stats().slow_disconnects.load(), 1u)
+      << "conflated=" << pub.stats().conflated.load() << " snapshots=" << pub.stats().snapshots.load()
+      << " updates=" << pub.stats().updates.load() << " bytes=" << pub.stats().bytes.load();
+  EXPECT_TRUE(wait_for([&] { return pub.stats().subscribers.load() == 0; }, 2000));
+  net::close_fd(fd);
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "common/metrics_registry.hpp"
+#include "common/perf_counters.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace metrics;
+
+static std::string scrape(const Registry& r) {
+  std::ostringstream os;
+  r.write(os);
+  return os.str();
+}
+
+TEST(Metrics, CounterSumsShardsAcrossThreads) {
+  Registry r;
+  Counter& c = r.counter("test_total", "help");
+  std::vector<std::thread> ts;
+  for (int t = 0; t < kShards + 4; ++t) {   // some threads share the overflow shard
+    ts.emplace_back([&] {
+      for (int i = 0; i < 100000; ++i) c.inc();
+    });
+  }
+  for (auto& t : ts) t.join();
+  EXPECT_EQ(c.value(), uint64_t(kShards + 4) * 100000);
+}
+
+TEST(Metrics, ExpositionFormat) {
+  Registry r;
+  r.counter("ev_total", "Events.", "kind=\"add\"").inc(3);
+  r.counter("ev_total", "Events.", "kind=\"cancel\"").inc(2);
+  r.gauge("depth", "Depth.", "", [] { return 1234567.0; });
+  Histogram& h = r.histogram("lat_seconds", "Latency.", "path=\"x\"", {1000, 2000}, 1e-9);
+  h.record(500);
+  h.record(1500);
+  h.record(1500);
+  h.record(9000);
+
+  std::string out = scrape(r);
+  EXPECT_NE(out.find("# HELP ev_total Events.\n# TYPE ev_total counter\n"), std::string::npos);
+  EXPECT_EQ(out.find("# TYPE ev_total", out.find("# TYPE ev_total") + 1), std::string::npos);   // one header per family
+  EXPECT_NE(out.find("ev_total{kind=\"add\"} 3\n"), std::string::npos);
+  EXPECT_NE(out.find("ev_total{kind=\"cancel\"} 2\n"), std::string::npos);
+  EXPECT_NE(out.find("# TYPE depth gauge\ndepth 1234567\n"), std::string::npos);
+  EXPECT_NE(out.find("# TYPE lat_seconds histogram\n"), std::string::npos);
+  EXPECT_NE(out.find("lat_seconds_bucket{path=\"x\",le=\"1e-06\"} 1\n"), std::string::npos);
+  EXPECT_NE(out.find("lat_seconds_bucket{path=\"x\",le=\"2e-06\"} 3\n"), std::string::npos);
+  EXPECT_NE(out.find("lat_seconds_bucket{path=\"x\",le=\"+Inf\"} 4\n"), std::string::npos);
+  EXPECT_NE(out.find("lat_seconds_sum{path=\"x\"} 1.25e-05\n"), std::string::npos);
+  EXPECT_NE(out.find("lat_seconds_count{path=\"x\"} 4\n"), std::string::npos);
+}
+
+TEST(Metrics, RegistrationErrors) {
+  Registry r;
+  r.counter("a_total", "A.");
+  EXPECT_THROW(r.counter("a_total", "A."), std::invalid_argument);
+  EXPECT_THROW(r.gauge("a_total", "A.", "x=\"1\"", [] { return 0.0; }), std::invalid_argument);
+  EXPECT_THROW(Histogram({5, 1}), std::invalid_argument);
+}
+
+TEST(Metrics, LatencyBounds) {
+  auto b = latency_bounds_ns();
+  EXPECT_EQ(b.front(), 250u);
+  EXPECT_EQ(b.back(), 1'000'000'000u);
+  EXPECT_TRUE(std::is_sorted(b.begin(), b.end()));
+}
+
+static void spin(int n) {
+  volatile uint64_t x = 0;
+  for (int i = 0; i < n; ++i) x = x + i;
+}
+
+TEST(Perf, GroupCountsAndPauses) {
+  PerfGroup g;
+  if (g.open(/*prefer_software=*/true) == PerfGroup::Source::None) GTEST_SKIP() << "perf_event_open not permitted";
+  ASSERT_GT(g.size(), 0);
+  EXPECT_STREQ(g.name(0), "task_clock_ns");
+
+  uint64_t a[PerfGroup::kMax], b[PerfGroup::kMax], c[PerfGroup::kMax];
+  ASSERT_TRUE(g.read(a));
+  spin(20'000'000);
+  ASSERT_TRUE(g.read(b));
+  EXPECT_GT(b[0], a[0] + 1'000'000);   // well over 1ms of task clock
+
+  g.disable();
+  spin(20'000'000);
+  ASSERT_TRUE(g.read(c));
+  EXPECT_LT(c[0] - b[0], 1'000'000u);   // (the read itself only)
+  g.enable();
+  g.close();
+  EXPECT_FALSE(g.read(a));
+  EXPECT_EQ(g.source(), PerfGroup::Source::None);
+}
+
+TEST(Perf, HardwareOrFallback) {
+  PerfGroup g;
+  auto s = g.open();
+  if (s == PerfGroup::Source::Hardware) {
+    EXPECT_STREQ(g.name(0), "cycles");
+  }
+  if (s == PerfGroup::Source::Software) {
+    EXPECT_STREQ(g.name(0), "task_clock_ns");
+  }
+  EXPECT_STRNE(PerfGroup::source_name(s), "");
+}
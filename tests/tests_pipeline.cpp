@@ -0,0 +1,363 @@
+#include <gtest/gtest.h>
+#include "engine/byte_source.hpp"
+#include "engine/udp_source.hpp"
+#include "engine/framer.hpp"
+#include "engine/parser.hpp"
+#include "engine/lag_monitor.hpp"
+#include "engine/engine.hpp"
+#include "common/net.hpp"
+#include "common/feed_packet.hpp"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace engine;
+
+static std::vector<std::string> frame_all(const std::string& bytes, size_t chunk) {
+  MemorySource src(bytes, chunk);
+  LineFramer framer;
+  std::vector<std::string> lines;
+  std::vector<char> buf(64 * 1024);
+  size_t n;
+  while ((n = src.read(buf.data(), buf.size())) != 0) {
+    framer.feed(buf.data(), n, [&](const std::string& l) { lines.push_back(l); });
+  }
+  return lines;
+}
+
+TEST(Pipeline, FramingIndependentOfChunking) {
+  const std::string feed = "ADD,1,B,1,100,5\nCXL,2,1\n\nTRD,3,7,1\nCLR,4\npartial";
+  auto whole = frame_all(feed, 1 << 20);
+  ASSERT_EQ(whole.size(), 5u);  // trailing bytes without '\n' are held back
+  EXPECT_EQ(whole[2], "");
+  for (size_t chunk = 1; chunk < 12; ++chunk) {
+    EXPECT_EQ(frame_all(feed, chunk), whole) << "chunk=" << chunk;
+  }
+}
+
+TEST(Pipeline, ParsesEveryKind) {
+  MboEvent ev;
+  ASSERT_TRUE(parse_event("ADD,10,A,42,64830000000,3", 0, ev));
+  EXPECT_EQ(ev.kind, EventKind::Add);
+  EXPECT_EQ(ev.side, Side::Ask);
+  EXPECT_EQ(ev.order_id, 42u);
+  EXPECT_EQ(ev.price, 64830000000);
+  EXPECT_EQ(ev.qty, 3);
+  EXPECT_EQ(ev.ts_ns, 10u);
+
+  ASSERT_TRUE(parse_event("MOD,11,42,64840000000,2", 0, ev));
+  EXPECT_EQ(ev.kind, EventKind::Modify);
+  EXPECT_EQ(ev.new_price, 64840000000);
+  EXPECT_EQ(ev.new_qty, 2);
+
+  ASSERT_TRUE(parse_event("CXL,12,42", 0, ev));
+  EXPECT_EQ(ev.kind, EventKind::Cancel);
+  ASSERT_TRUE(parse_event("TRD,13,42,1", 0, ev));
+  EXPECT_EQ(ev.kind, EventKind::Trade);
+  EXPECT_EQ(ev.qty, 1);
+  ASSERT_TRUE(parse_event("CLR,14", 0, ev));
+  EXPECT_EQ(ev.kind, EventKind::Clear);
+
+  EXPECT_FALSE(parse_event("XYZ,1,2", 0, ev));
+  EXPECT_FALSE(parse_event("ADD,1,B,notanumber,1,1", 0, ev));
+  EXPECT_FALSE(parse_event("CXL,1", 0, ev));
+}
+
+TEST(Pipeline, SendStamp) {
+  uint64_t ns = 0;
+  std::string line = "@1731284001123456789,CXL,12,42";
+  size_t start = parse_send_stamp(line, ns);
+  EXPECT_EQ(ns, 1731284001123456789ull);
+  MboEvent ev;
+  ASSERT_TRUE(parse_event(line, start, ev));
+  EXPECT_EQ(ev.order_id, 42u);
+
+  EXPECT_EQ(parse_send_stamp("CXL,12,42", ns), 0u);
+  EXPECT_EQ(ns, 0u);
+  EXPECT_EQ(parse_send_stamp("@junk,CXL,12,42", ns), 0u);
+  EXPECT_EQ(ns, 0u);
+}
+
+TEST(Pipeline, UnreadBytes) {
+  MemorySource mem(std::string(100, 'x'), 30);
+  std::vector<char> buf(64);
+  EXPECT_EQ(mem.unread(), 100u);
+  mem.read(buf.data(), buf.size());
+  EXPECT_EQ(mem.unread(), 70u);
+
+  int sv[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  EXPECT_EQ(net::unread_bytes(sv[1]), 0u);
+  net::send_all(sv[0], "ADD,1,B,1,100,5\n", 16);
+  EXPECT_EQ(net::unread_bytes(sv[1]), 16u);
+  SocketSource sock(sv[1]);
+  EXPECT_EQ(sock.read(buf.data(), 10), 10u);
+  EXPECT_EQ(sock.unread(), 6u);
+  ::close(sv[0]);
+  ::close(sv[1]);
+}
+
+TEST(Pipeline, PendingEventsCountOnlyTheBacklog) {
+  LagMonitor lag;
+  EXPECT_EQ(lag.pending_events(1000, 0), 0u);   // no line size known yet
+  // 10 lines of 20 bytes applied; nothing left anywhere: caught up
+  auto s = lag.on_chunk(200, 10, 0, 0, 1000, 0, 0);
+  EXPECT_EQ(s.pending_events, 0u);
+  EXPECT_EQ(s.feed_lag_ns, 0u);
+  // 100 bytes still in the kernel and 10 in the framer: 5 whole lines
+  s = lag.on_chunk(200, 10, 100, 10, 2000, 0, 0);
+  EXPECT_EQ(s.pending_events, 5u);
+  // the average covers every chunk: 600 bytes, 20 lines -> 30 bytes per line
+  s = lag.on_chunk(200, 0, 300, 0, 3000, 0, 0);
+  EXPECT_EQ(s.pending_events, 10u);
+}
+
+TEST(Pipeline, FramerBytesAreSampledAfterTheChunk) {
+  // the feed ends 7 bytes into a line: that partial line is what the framer holds
+  const std::string feed = "ADD,1,B,1,100,1\nADD,2,A,2,101,1\nCXL,3,1\nADD,4,B";
+  auto app = std::make_unique<EngineApp>();
+  MemorySource whole(feed);
+  EXPECT_EQ(app->consume(whole), 3u);
+  EXPECT_EQ(app->framer_buffered_bytes(), 7u);
+
+  auto chunked = std::make_unique<EngineApp>();
+  MemorySource src(feed, 20);   // chunks end mid-line throughout
+  chunked->consume(src);
+  EXPECT_EQ(chunked->framer_buffered_bytes(), 7u);
+}
+
+TEST(Pipeline, LagAlertAboveThresholdOncePerSecond) {
+  constexpr uint64_t kSec = 1'000'000'000;
+  constexpr uint64_t kAlert = 5'000'000;   // 5 ms
+  LagMonitor lag;
+  // feed ts 100s behind wall clock: that offset is the baseline, not lag
+  auto s = lag.on_chunk(20, 1, 0, 0, 1000 * kSec, 900 * kSec, kAlert);
+  EXPECT_EQ(s.feed_lag_ns, 0u);
+  EXPECT_FALSE(s.alert);
+  // 4 ms behind the baseline: under the threshold
+  s = lag.on_chunk(20, 1, 0, 0, 1001 * kSec + 4'000'000, 901 * kSec, kAlert);
+  EXPECT_EQ(s.feed_lag_ns, 4'000'000u);
+  EXPECT_FALSE(s.alert);
+  // 6 ms: alert, then not again within the same second
+  s = lag.on_chunk(20, 1, 0, 0, 1002 * kSec + 6'000'000, 902 * kSec, kAlert);
+  EXPECT_TRUE(s.alert);
+  s = lag.on_chunk(20, 1, 0, 0, 1002 * kSec + 500'000'000, 902 * kSec + 490'000'000, kAlert);
+  EXPECT_EQ(s.feed_lag_ns, 10'000'000u);
+  EXPECT_FALSE(s.alert);
+  s = lag.on_chunk(20, 1, 0, 0, 1003 * kSec + 7'000'000, 903 * kSec, kAlert);
+  EXPECT_TRUE(s.alert);
+  // threshold 0: never
+  s = lag.on_chunk(20, 1, 0, 0, 1010 * kSec, 905 * kSec, 0);
+  EXPECT_FALSE(s.alert);
+}
+
+TEST(Pipeline, EndpointParse) {
+  auto ep = net::Endpoint::parse("9001", "0.0.0.0");
+  EXPECT_EQ(ep.kind, net::Endpoint::Kind::Tcp);
+  EXPECT_EQ(ep.host, "0.0.0.0");
+  EXPECT_EQ(ep.port, "9001");
+  ep = net::Endpoint::parse("tcp://10.0.0.1:7000", "0.0.0.0");
+  EXPECT_EQ(ep.host, "10.0.0.1");
+  EXPECT_EQ(ep.port, "7000");
+  ep = net::Endpoint::parse("unix:///tmp/feed.sock?seqpacket", "");
+  EXPECT_EQ(ep.kind, net::Endpoint::Kind::UnixSeqpacket);
+  EXPECT_EQ(ep.path, "/tmp/feed.sock");
+  EXPECT_EQ(ep.str(), "unix:///tmp/feed.sock?seqpacket");
+  ep = net::Endpoint::parse("shm://feed", "");
+  EXPECT_EQ(ep.kind, net::Endpoint::Kind::Shm);
+  EXPECT_EQ(ep.path, "/feed");
+  EXPECT_EQ(ep.str(), "shm://feed");
+  ep = net::Endpoint::parse("udp://239.255.0.1:15000", "");
+  EXPECT_EQ(ep.kind, net::Endpoint::Kind::Udp);
+  EXPECT_EQ(ep.host, "239.255.0.1");
+  EXPECT_EQ(ep.port, "15000");
+  EXPECT_EQ(ep.iface, "127.0.0.1");
+  EXPECT_FALSE(ep.is_stream());
+  EXPECT_EQ(net::Endpoint::parse("udp://239.1.2.3:5?iface=10.0.0.2", "").iface, "10.0.0.2");
+  EXPECT_THROW(net::Endpoint::parse("sctp://1.2.3.4:5", ""), std::invalid_argument);
+  EXPECT_THROW(net::Endpoint::parse("udp://239.1.2.3:5?ttl=1", ""), std::invalid_argument);
+  EXPECT_THROW(net::Endpoint::parse("unix://", ""), std::invalid_argument);
+  EXPECT_THROW(net::Endpoint::parse("unix:///x?dgram", ""), std::invalid_argument);
+}
+
+TEST(Pipeline, UnixSocketRoundTrip) {
+  for (const char* opt : {"", "?seqpacket"}) {
+    std::string uri = "unix:///tmp/tests_pipeline_" + std::to_string(::getpid()) + ".sock" + opt;
+    auto ep = net::Endpoint::parse(uri, "");
+    int lfd = net::listen_endpoint(ep);
+    int cfd = net::connect_endpoint(ep);
+    int sfd = net::accept_one(lfd);
+    net::send_all(cfd, "ADD,1,B,1,100,5\n", 16);
+    net::send_all(cfd, "CXL,1\n", 6);
+    net::close_fd(cfd);
+
+    SocketSource src(sfd);
+    LineFramer framer;
+    std::vector<std::string> lines;
+    std::vector<char> buf(4096);
+    size_t n;
+    while ((n = src.read(buf.data(), buf.size())) != 0) {
+      if (n == ByteSource::kNoData) continue;
+      framer.feed(buf.data(), n, [&](const std::string& l) { lines.push_back(l); });
+    }
+    ASSERT_EQ(lines.size(), 2u) << uri;
+    EXPECT_EQ(lines[1], "CXL,1");
+    net::close_fd(sfd);
+    net::close_fd(lfd);
+    ::unlink(ep.path.c_str());
+  }
+}
+
+static std::string packet(uint64_t seq, const std::vector<std::string>& lines) {
+  feed::PacketHeader h{feed::kPacketMagic, static_cast<uint16_t>(lines.size()), 0, seq};
+  std::string p(reinterpret_cast<const char*>(&h), sizeof(h));
+  for (auto& l : lines) p += l + "\n";
+  return p;
+}
+
+static std::string end_packet() {
+  feed::PacketHeader h{feed::kPacketMagic, feed::kEndOfSession, 0, 0};
+  return std::string(reinterpret_cast<const char*>(&h), sizeof(h));
+}
+
+static std::vector<std::string> drain(UdpSource& src) {
+  LineFramer framer;
+  std::vector<std::string> lines;
+  std::vector<char> buf(64 * 1024);
+  size_t n;
+  while ((n = src.read(buf.data(), buf.size())) != 0) {
+    if (n == ByteSource::kNoData) break;
+    framer.feed(buf.data(), n, [&](const std::string& l) { lines.push_back(l); });
+  }
+  return lines;
+}
+
+TEST(Pipeline, UdpSequencing) {
+  feed::SeqTracker t;
+  uint64_t lost = 0;
+  uint32_t skip = 0;
+  EXPECT_EQ(t.check(1, 3, lost, skip), feed::SeqTracker::Result::InOrder);
+  EXPECT_EQ(t.check(6, 2, lost, skip), feed::SeqTracker::Result::Gap);
+  EXPECT_EQ(lost, 2u);
+  EXPECT_EQ(t.check(6, 2, lost, skip), feed::SeqTracker::Result::Late);
+  EXPECT_EQ(t.check(5, 2, lost, skip), feed::SeqTracker::Result::Late);   // ends at next
+  EXPECT_EQ(t.next, 8u);
+  EXPECT_EQ(t.check(7, 3, lost, skip), feed::SeqTracker::Result::Overlap);
+  EXPECT_EQ(skip, 1u);
+  EXPECT_EQ(t.next, 10u);
+  EXPECT_EQ(t.check(1, 2, lost, skip), feed::SeqTracker::Result::Late);   // early in the session
+  EXPECT_EQ(t.next, 10u);
+  t.next = feed::SeqTracker::kRestartWindow + 1;
+  EXPECT_EQ(t.check(1, 2, lost, skip), feed::SeqTracker::Result::Restart);
+  EXPECT_EQ(t.next, feed::SeqTracker::kRestartWindow + 1);   // the caller resets
+  t.next = 1000;
+  EXPECT_EQ(t.check(900, 1, lost, skip), feed::SeqTracker::Result::Late);      // within the window
+  EXPECT_EQ(t.check(500, 1, lost, skip), feed::SeqTracker::Result::Restart);   // far behind
+  t.reset();
+  EXPECT_EQ(t.check(1, 2, lost, skip), feed::SeqTracker::Result::InOrder);
+
+  // packet 1 reordered behind packets 2..4: a late gap fill, not a new session
+  t.reset();
+  EXPECT_EQ(t.check(3, 2, lost, skip), feed::SeqTracker::Result::Gap);
+  EXPECT_EQ(lost, 2u);
+  EXPECT_EQ(t.check(5, 2, lost, skip), feed::SeqTracker::Result::InOrder);
+  EXPECT_EQ(t.check(7, 2, lost, skip), feed::SeqTracker::Result::InOrder);
+  EXPECT_EQ(t.check(1, 2, lost, skip), feed::SeqTracker::Result::Late);
+  EXPECT_EQ(t.next, 9u);
+
+  // datagram socketpair: same recvmmsg path as a multicast socket
+  int sv[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, sv), 0);
+  net::set_nonblocking(sv[1], true);
+  auto send = [&](const std::string& p) { ASSERT_EQ(::send(sv[0], p.data(), p.size(), 0), (ssize_t)p.size()); };
+  send(packet(1, {"ADD,1,B,1,100,5", "ADD,2,A,2,101,5"}));
+  send(packet(3, {"CXL,3,1"}));
+  send("junk");
+  send(packet(6, {"CXL,6,2"}));      // lines 4..5 lost
+  send(packet(3, {"CXL,3,1"}));      // duplicate
+  send(end_packet());
+  send(end_packet());                // repeat: ignored
+
+  UdpSource src(sv[1], 10);
+  auto lines = drain(src);
+  ASSERT_EQ(lines.size(), 4u);
+  EXPECT_EQ(lines[3], "CXL,6,2");
+  const auto& st = src.stats();
+  EXPECT_EQ(st.packets.load(), 7u);
+  EXPECT_EQ(st.syscalls.load(), 1u);   // one recvmmsg for the lot
+  EXPECT_EQ(st.bad.load(), 1u);
+  EXPECT_EQ(st.gaps.load(), 1u);
+  EXPECT_EQ(st.lines_lost.load(), 2u);
+  EXPECT_EQ(st.late.load(), 1u);
+  EXPECT_EQ(st.sessions.load(), 1u);
+
+  // next session starts at 1 again
+  send(packet(1, {"CLR,9"}));
+  lines = drain(src);
+  ASSERT_EQ(lines.size(), 1u);
+  EXPECT_EQ(st.gaps.load(), 1u);
+  ::close(sv[0]);
+  ::close(sv[1]);
+}
+
+TEST(Pipeline, UdpSenderRestartsWithoutEndOfSession) {
+  int sv[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, sv), 0);
+  net::set_nonblocking(sv[1], true);
+  auto send = [&](const std::string& p) { ASSERT_EQ(::send(sv[0], p.data(), p.size(), 0), (ssize_t)p.size()); };
+  // a session long enough that seq 1 cannot be a reordered packet of it
+  const uint64_t n = feed::SeqTracker::kRestartWindow + 2;
+  std::vector<std::string> body;
+  for (uint64_t i = 1; i <= n; ++i) body.push_back("CXL," + std::to_string(i) + ",1");
+  for (uint64_t i = 0; i < n; i += 64)   // one Ethernet frame each
+    send(packet(i + 1, std::vector<std::string>(body.begin() + i, body.begin() + std::min(i + 64, n))));
+  send(packet(n, {body.back(), "CLR,0"}));   // line n again: only line n+1 is new
+  // the streamer dies and comes back: no end-of-session packet
+  send(packet(1, {"ADD,1,B,7,99,5"}));
+  send(packet(2, {"CXL,2,7"}));
+
+  UdpSource src(sv[1], 10);
+  auto lines = drain(src);   // the restart ends the first session
+  ASSERT_EQ(lines.size(), n + 1);
+  EXPECT_EQ(lines[n - 1], body.back());
+  EXPECT_EQ(lines[n], "CLR,0");
+  lines = drain(src);
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[0], "ADD,1,B,7,99,5");
+  EXPECT_EQ(lines[1], "CXL,2,7");
+  const auto& st = src.stats();
+  EXPECT_EQ(st.overlaps.load(), 1u);
+  EXPECT_EQ(st.restarts.load(), 1u);
+  EXPECT_EQ(st.sessions.load(), 1u);
+  EXPECT_EQ(st.late.load(), 0u);
+  EXPECT_EQ(st.gaps.load(), 0u);
+  ::close(sv[0]);
+  ::close(sv[1]);
+}
+
+TEST(Pipeline, UdpMulticastLoopback) {
+  auto ep = net::Endpoint::parse("udp://239.255.7.7:" + std::to_string(20000 + ::getpid() % 20000), "");
+  int rfd, sfd;
+  try {
+    rfd = net::open_multicast_recv(ep);
+    sfd = net::open_multicast_send(ep);
+  } catch (const std::exception& e) {
+    GTEST_SKIP() << "no loopback multicast here: " << e.what();
+  }
+  std::string a = packet(1, {"ADD,1,B,1,100,5"}), b = packet(2, {"CXL,2,1"}), e = end_packet();
+  const void* ptrs[3] = {a.data(), b.data(), e.data()};
+  size_t lens[3] = {a.size(), b.size(), e.size()};
+  EXPECT_EQ(net::sendmmsg_batch(sfd, ptrs, lens, 3), 3);
+  UdpSource src(rfd, 1000);
+  auto lines = drain(src);
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[1], "CXL,2,1");
+  EXPECT_EQ(src.stats().lines_lost.load(), 0u);
+  net::close_fd(sfd);
+  net::close_fd(rfd);
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "engine/push_server.hpp"
+#include "common/net.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace engine;
+
+namespace {
+
+struct Client {
+  int fd;
+  std::string buf;
+
+  Client(uint16_t port, const std::string& target) {
+    fd = net::connect_tcp("127.0.0.1", std::to_string(port));
+    std::string req = "GET " + target + " HTTP/1.1\r\nHost: x\r\n\r\n";
+    net::send_all(fd, req.data(), req.size());
+  }
+  ~Client() { net::close_fd(fd); }
+
+  // Everything received within ms (0: what has arrived already).
+  void drain(int ms) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    char tmp[4096];
+    for (;;) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(end - std::chrono::steady_clock::now()).count();
+      if (!net::wait_readable(fd, left > 0 ? static_cast<int>(left) : 0)) return;
+      size_t n = net::recv_some(fd, tmp, sizeof(tmp));
+      if (n == 0) return;
+      buf.append(tmp, n);
+    }
+  }
+
+  size_t count(const std::string& what) const {
+    size_t c = 0;
+    for (size_t p = buf.find(what); p != std::string::npos; p = buf.find(what, p + 1)) ++c;
+    return c;
+  }
+};
+
+}  // namespace
+
+TEST(Push, StreamsEachVersionOnce) {
+  ResponseCache views;
+  std::atomic<int> renders{0};
+  PushServer push(views, [&](size_t n, uint64_t& v) {
+    v = views.version();
+    ++renders;
+    return "{\"n\":" + std::to_string(n) + ",\"v\":" + std::to_string(v) + "}";
+  });
+  push.start("127.0.0.1", "0");
+  ASSERT_NE(push.port(), 0);
+
+  Client a(push.port(), "/stream/top?n=3");
+  Client b(push.port(), "/stream/top?n=3");
+  a.drain(100);
+  b.drain(0);
+  EXPECT_NE(a.buf.find("HTTP/1.1 200 OK"), std::string::npos);
+  EXPECT_NE(a.buf.find("text/event-stream"), std::string::npos);
+  EXPECT_NE(a.buf.find("id: 0\nevent: top\ndata: {\"n\":3,\"v\":0}\n\n"), std::string::npos);
+
+  views.bump();
+  a.drain(100);
+  b.drain(0);
+  EXPECT_NE(a.buf.find("id: 1\nevent: top\ndata: {\"n\":3,\"v\":1}\n\n"), std::string::npos);
+  EXPECT_EQ(a.count("event: top"), 2u);   // nothing while the version stood still
+  EXPECT_EQ(b.count("event: top"), 2u);
+  EXPECT_EQ(renders.load(), 2);           // shared by both subscribers
+  EXPECT_EQ(push.stats().subscribers.load(), 2u);
+}
+
+TEST(Push, ConflatesToMaxRate) {
+  ResponseCache views;
+  auto render = [&](uint64_t& v) { v = views.version(); return "{\"v\":" + std::to_string(v) + "}"; };
+  PushServer push(views, [&](size_t, uint64_t& v) { return render(v); });
+  push.start("127.0.0.1", "0");
+
+  Client c(push.port(), "/stream/spread?max_hz=10");
+  c.drain(50);
+  ASSERT_EQ(c.count("event: spread"), 1u);
+
+  // 1000 versions in 300ms, each one fetched by a poller: at 10/s the subscriber
+  // sees a few, ending at the last
+  for (int i = 0; i < 1000; ++i) {
+    views.bump();
+    uint64_t v;
+    views.get(0, render, v);
+    if (i % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  }
+  c.drain(400);
+  size_t events = c.count("event: spread");
+  EXPECT_GE(events, 2u);
+  EXPECT_LE(events, 8u);
+  EXPECT_NE(c.buf.find("id: 1000\n"), std::string::npos);
+  EXPECT_GT(push.stats().conflated.load(), 900u);
+}
+
+TEST(Push, SkipsUnchangedBodies) {
+  // the version moves with changes below the subscriber's levels too
+  ResponseCache views;
+  std::atomic<int> bid{100};
+  PushServer push(views, [&](size_t, uint64_t& v) {
+    v = views.version();
+    return "{\"bid\":" + std::to_string(bid.load()) + "}";
+  });
+  push.start("127.0.0.1", "0");
+
+  Client c(push.port(), "/stream/top?n=1&max_hz=100");
+  c.drain(50);
+  ASSERT_EQ(c.count("event: top"), 1u);
+  for (int i = 0; i < 20; ++i) {
+    views.bump();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  c.drain(50);
+  EXPECT_EQ(c.count("event: top"), 1u);   // the same body every time: nothing sent
+
+  bid = 101;
+  views.bump();
+  c.drain(100);
+  EXPECT_EQ(c.count("event: top"), 2u);
+  EXPECT_NE(c.buf.find("id: 21\nevent: top\ndata: {\"bid\":101}\n\n"), std::string::npos);
+  EXPECT_EQ(push.stats().events.load(), 2u);
+  EXPECT_EQ(push.stats().conflated.load(), 0u);
+}
+
+TEST(Push, RejectsUnknownStreams) {
+  ResponseCache views;
+  PushServer push(views, [](size_t, uint64_t& v) { v = 0; return std::string("{}"); });
+  push.start("127.0.0.1", "0");
+
+  Client bad(push.port(), "/stream/nope");
+  bad.drain(200);
+  EXPECT_EQ(bad.buf.rfind("HTTP/1.1 404", 0), 0u);
+
+  Client deep(push.port(), "/stream/top?n=500");
+  deep.drain(200);
+  EXPECT_EQ(deep.buf.rfind("HTTP/1.1 400", 0), 0u);
+  EXPECT_EQ(push.stats().rejected.load(), 2u);
+  EXPECT_EQ(push.stats().subscribers.load(), 0u);
+}
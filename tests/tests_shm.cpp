@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include "common/shm_book.hpp"
+#include "common/shm_ring.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+static std::string seg_name(const char* what) {
+  return std::string("/tests_shm_") + what + "_" + std::to_string(::getpid());
+}
+
+TEST(ShmBook, PublishAndRead) {
+  const std::string name = seg_name("rw");
+  shm::BookWriter w(name, 3);
+  EXPECT_EQ(w.depth(), 3u);
+  shm::BookReader r(name);
+  EXPECT_EQ(r.depth(), 3u);
+  uint64_t seq0 = r.seq();
+
+  shm::BookData& d = w.begin();
+  d.bid_count = 2;
+  d.ask_count = 1;
+  d.bids[0] = {101, 5, 1, 0};
+  d.bids[1] = {100, 7, 2, 0};
+  d.asks[0] = {103, 4, 1, 0};
+  d.ts_ns = 42;
+  w.end();
+  EXPECT_GT(r.seq(), seq0);
+
+  shm::BookData out{};
+  ASSERT_TRUE(r.read(out));
+  EXPECT_EQ(out.version, 1u);
+  EXPECT_EQ(out.ts_ns, 42u);
+  ASSERT_EQ(out.bid_count, 2u);
+  ASSERT_EQ(out.ask_count, 1u);
+  EXPECT_EQ(out.bids[1].price, 100);
+  EXPECT_EQ(out.bids[1].qty, 7);
+  EXPECT_EQ(out.asks[0].orders, 1u);
+
+  shm::BookLevel bid, ask;
+  uint64_t version = 0;
+  ASSERT_TRUE(r.read_top(bid, ask, version));
+  EXPECT_EQ(bid.price, 101);
+  EXPECT_EQ(ask.price, 103);
+  EXPECT_EQ(version, 1u);
+}
+
+TEST(ShmBook, ReaderNeverSeesTornWrites) {
+  const std::string name = seg_name("torn");
+  shm::BookWriter w(name, 8);
+  shm::BookReader r(name);
+  std::atomic<bool> stop{false};
+  std::thread writer([&] {
+    for (int64_t v = 1; !stop.load(std::memory_order_relaxed); ++v) {
+      shm::BookData& d = w.begin();
+      d.bid_count = d.ask_count = 8;
+      for (int i = 0; i < 8; ++i) {
+        d.bids[i] = {v, v, 0, 0};
+        d.asks[i] = {v, v, 0, 0};
+      }
+      d.ts_ns = static_cast<uint64_t>(v);
+      w.end();
+      std::this_thread::yield();   // leave the reader gaps even on a busy machine
+    }
+  });
+  // every read happens while the writer is running; retry until enough succeed
+  shm::BookData out{};
+  int consistent = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (consistent < 1000 && std::chrono::steady_clock::now() < deadline) {
+    if (!r.read(out)) continue;
+    for (int i = 0; i < 8; ++i) {
+      ASSERT_EQ(out.bids[i].price, static_cast<int64_t>(out.ts_ns));
+      ASSERT_EQ(out.asks[i].qty, static_cast<int64_t>(out.ts_ns));
+    }
+    ++consistent;
+  }
+  stop = true;
+  writer.join();
+  EXPECT_EQ(consistent, 1000);
+}
+
+TEST(ShmBook, MissingSegmentThrows) {
+  EXPECT_THROW(shm::BookReader r(seg_name("missing")), std::runtime_error);
+}
+
+TEST(ShmRing, StreamsAcrossWraparound) {
+  const std::string name = seg_name("ring");
+  shm::ByteRing consumer(name, shm::ByteRing::Mode::Create, 4096);
+  EXPECT_EQ(consumer.capacity(), 4096u);
+  EXPECT_FALSE(consumer.wait_producer(10));
+
+  // 64 KiB through a 4 KiB ring with odd-sized writes and reads
+  std::string sent;
+  for (int i = 0; sent.size() < 64 * 1024; ++i) sent += "ADD," + std::to_string(i) + ",B,1,100,5\n";
+  std::thread producer([&] {
+    shm::ByteRing ring(name, shm::ByteRing::Mode::Attach);
+    for (size_t off = 0; off < sent.size(); off += 1000)
+      ring.write(sent.data() + off, std::min<size_t>(1000, sent.size() - off));
+    ring.close();
+  });
+
+  ASSERT_TRUE(consumer.wait_producer(5000));
+  std::string got;
+  char buf[777];
+  for (;;) {
+    size_t n = consumer.read(buf, sizeof(buf), 1000);
+    if (n == 0) break;
+    if (n == shm::ByteRing::kNoData) continue;
+    got.append(buf, n);
+  }
+  producer.join();
+  EXPECT_EQ(got, sent);
+  EXPECT_EQ(consumer.readable(), 0u);
+
+  // ready for the next producer
+  consumer.reset();
+  shm::ByteRing again(name, shm::ByteRing::Mode::Attach);
+  EXPECT_TRUE(consumer.wait_producer(0));
+  EXPECT_EQ(consumer.read(buf, sizeof(buf), 10), shm::ByteRing::kNoData);
+  again.write("x\n", 2);
+  EXPECT_EQ(consumer.readable(), 2u);
+  EXPECT_EQ(consumer.read(buf, sizeof(buf), 10), 2u);
+}
+
+TEST(ShmRing, MissingSegmentThrows) {
+  EXPECT_THROW(shm::ByteRing(seg_name("none"), shm::ByteRing::Mode::Attach), std::runtime_error);
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "common/tsc_clock.hpp"
+#include "engine/stage_trace.hpp"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+using namespace metrics;
+
+TEST(TscClock, TicksConvertToWallTime) {
+  auto w0 = std::chrono::steady_clock::now();
+  uint64_t t0 = TscClock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  uint64_t t1 = TscClock::now();
+  auto w1 = std::chrono::steady_clock::now();
+
+  ASSERT_GT(t1, t0);
+  double wall = std::chrono::duration<double, std::nano>(w1 - w0).count();
+  double got = double(TscClock::to_ns(t1 - t0));
+  EXPECT_NEAR(got, wall, wall * 0.05);
+}
+
+TEST(StageTracer, DumpsOnlyRecordedCells) {
+  engine::StageTracer tr;
+  uint64_t ticks = static_cast<uint64_t>(1000 * TscClock::ticks_per_ns());  // ~1us
+  for (int i = 0; i < 100; ++i) tr.record(engine::Stage::Parse, engine::EventKind::Add, ticks);
+  tr.record(engine::Stage::Parse, engine::EventKind::Cancel, ticks);
+
+  std::ostringstream os;
+  tr.dump(os);
+  const std::string out = os.str();
+  EXPECT_NE(out.find("stage=parse kind=ADD samples=100"), std::string::npos) << out;
+  EXPECT_NE(out.find("stage=parse kind=CXL samples=1"), std::string::npos);
+  EXPECT_NE(out.find("stage=parse kind=ALL samples=101"), std::string::npos);
+  EXPECT_EQ(out.find("stage=apply"), std::string::npos);
+}
+
+TEST(StageTracer, RecvIsPerChunk) {
+  engine::StageTracer tr;
+  uint64_t ticks = static_cast<uint64_t>(1000 * TscClock::ticks_per_ns());
+  tr.record_recv(ticks);
+  tr.record_recv(ticks);
+
+  std::ostringstream os;
+  tr.dump(os);
+  const std::string out = os.str();
+  EXPECT_NE(out.find("stage=recv kind=CHUNK samples=2"), std::string::npos) << out;
+  EXPECT_EQ(out.find("stage=recv kind=ALL"), std::string::npos);
+}
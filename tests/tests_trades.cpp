@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include "engine/trade_tape.hpp"
+#include "test_events.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using namespace engine;
+
+namespace {
+
+constexpr uint64_t kSec = 1'000'000'000;
+
+using Feed = BookFeed<TradeTape>;
+
+}  // namespace
+
+TEST(TradeTape, PrintsNewestFirstWithTheAggressor) {
+  TradeTape::Options opt;
+  opt.prints = 4;
+  Feed f(opt);
+  f(mk_add(1, Side::Bid, 1, 100, 50));
+  f(mk_add(2, Side::Ask, 2, 101, 50));
+  f(mk_trd(3, 1, 5));     // a seller hit the bid
+  f(mk_trd(4, 2, 7));     // a buyer lifted the offer
+  f(mk_trd(5, 99, 1));    // unknown order: no print
+
+  std::vector<TradeTape::Print> p;
+  ASSERT_EQ(f.consumer.recent(10, p), 2u);
+  EXPECT_EQ(p[0].ts_ns, 4u);
+  EXPECT_EQ(p[0].price, 101);
+  EXPECT_EQ(p[0].qty, 7);
+  EXPECT_EQ(p[0].order_id, 2u);
+  EXPECT_EQ(p[0].aggressor, Side::Bid);
+  EXPECT_EQ(p[1].price, 100);
+  EXPECT_EQ(p[1].aggressor, Side::Ask);
+
+  for (uint64_t t = 10; t < 20; ++t) f(mk_trd(t, 1, 1));
+  EXPECT_EQ(f.consumer.prints(), 12u);
+  ASSERT_EQ(f.consumer.recent(10, p), 4u);   // the ring keeps the last 4
+  EXPECT_EQ(p[0].ts_ns, 19u);
+  EXPECT_EQ(p[3].ts_ns, 16u);
+  ASSERT_EQ(f.consumer.recent(1, p), 1u);
+  EXPECT_EQ(p[0].ts_ns, 19u);
+}
+
+TEST(TradeTape, BarsCloseInFeedTime) {
+  TradeTape::Options opt;
+  opt.intervals_ns = {kSec, 60 * kSec};
+  Feed f(opt);
+  f(mk_add(0, Side::Ask, 1, 100, 1000));
+  f(mk_add(0, Side::Ask, 2, 103, 1000));
+  f(mk_add(0, Side::Bid, 3, 98, 1000));
+
+  f(mk_trd(10 * kSec + 1, 1, 10));         // second 10: 100, 103, 98
+  f(mk_trd(10 * kSec + 2, 2, 5));
+  f(mk_trd(10 * kSec + 3, 3, 5));
+  TradeTape::Bar b;
+  ASSERT_TRUE(f.consumer.open_bar(0, b));
+  EXPECT_EQ(b.start_ns, 10 * kSec);
+  EXPECT_EQ(f.consumer.closed_bars(0), 0u);
+
+  f(mk_cxl(11 * kSec, 3));                 // any event past the end closes the bar
+  EXPECT_FALSE(f.consumer.open_bar(0, b));
+  ASSERT_EQ(f.consumer.closed_bars(0), 1u);
+  ASSERT_TRUE(f.consumer.closed_bar(0, 0, b));
+  EXPECT_EQ(b.open, 100);
+  EXPECT_EQ(b.high, 103);
+  EXPECT_EQ(b.low, 98);
+  EXPECT_EQ(b.close, 98);
+  EXPECT_EQ(b.volume, 20);
+  EXPECT_EQ(b.trades, 3u);
+  EXPECT_DOUBLE_EQ(b.vwap(), (100.0 * 10 + 103.0 * 5 + 98.0 * 5) / 20);
+
+  f(mk_trd(13 * kSec, 1, 1));              // seconds 11 and 12 had no prints: no bars
+  f(mk_trd(12 * kSec, 2, 2));              // out of order: counted in second 13
+  ASSERT_TRUE(f.consumer.open_bar(0, b));
+  EXPECT_EQ(b.start_ns, 13 * kSec);
+  EXPECT_EQ(b.volume, 3);
+  EXPECT_EQ(b.close, 103);
+  f(mk_trd(61 * kSec, 1, 4));
+
+  std::vector<TradeTape::Bar> bars;
+  ASSERT_EQ(f.consumer.bars(0, 10, bars), 2u);   // oldest first
+  EXPECT_EQ(bars[0].start_ns, 10 * kSec);
+  EXPECT_EQ(bars[1].start_ns, 13 * kSec);
+  ASSERT_EQ(f.consumer.bars(1, 10, bars), 1u);   // the minute bar covers all of 0..59s
+  EXPECT_EQ(bars[0].start_ns, 0u);
+  EXPECT_EQ(bars[0].open, 100);
+  EXPECT_EQ(bars[0].close, 103);
+  EXPECT_EQ(bars[0].volume, 23);
+  EXPECT_EQ(bars[0].trades, 5u);
+  ASSERT_TRUE(f.consumer.open_bar(1, b));
+  EXPECT_EQ(b.start_ns, 60 * kSec);
+  EXPECT_EQ(b.volume, 4);
+}
+
+TEST(TradeTape, IntervalNames) {
+  EXPECT_EQ(TradeTape::parse_interval("1s"), kSec);
+  EXPECT_EQ(TradeTape::parse_interval("5"), 5 * kSec);
+  EXPECT_EQ(TradeTape::parse_interval("250ms"), kSec / 4);
+  EXPECT_EQ(TradeTape::parse_interval("1m"), 60 * kSec);
+  EXPECT_EQ(TradeTape::parse_interval("1h"), 3600 * kSec);
+  EXPECT_EQ(TradeTape::parse_interval("m"), 0u);
+  EXPECT_EQ(TradeTape::parse_interval("3x"), 0u);
+  EXPECT_EQ(TradeTape::parse_interval("5124095h"), 5124095ull * 3600 * kSec);   // the longest that fits
+  EXPECT_EQ(TradeTape::parse_interval("5124096h"), 0u);                       // overflows
+  EXPECT_EQ(TradeTape::parse_interval("9999999h"), 0u);
+  EXPECT_EQ(TradeTape::parse_interval("999999999999m"), 0u);
+  EXPECT_EQ(TradeTape::parse_interval("999999999999"), 0u);
+  EXPECT_EQ(TradeTape::parse_interval("999999999999ms"), 999999999999 * 1'000'000ull);
+  EXPECT_EQ(TradeTape::parse_interval("9999999999999s"), 0u);                 // too many digits
+  EXPECT_EQ(TradeTape::interval_name(60 * kSec), "1m");
+  EXPECT_EQ(TradeTape::interval_name(90 * kSec), "90s");
+  EXPECT_EQ(TradeTape::interval_name(kSec / 4), "250ms");
+}
+
+TEST(TradeTape, ReadersNeverSeeTornItems) {
+  // one writer laps a small ring while readers copy from it
+  struct Item { uint64_t a, b, c, d; };
+  SeqRing<Item> ring(8);
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> reads{0};
+  std::thread writer([&] {
+    for (uint64_t i = 0; i < 2'000'000; ++i) ring.push(Item{i, i * 3, ~i, i + 7});
+    done = true;
+  });
+  auto reader = [&] {
+    Item it;
+    uint64_t ok = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+      const uint64_t n = ring.count();
+      for (uint64_t k = n > 8 ? n - 8 : 0; k < n; ++k) {
+        if (!ring.read(k, it)) continue;
+        ASSERT_EQ(it.a, k);
+        ASSERT_EQ(it.b, k * 3);
+        ASSERT_EQ(it.c, ~k);
+        ASSERT_EQ(it.d, k + 7);
+        ++ok;
+      }
+    }
+    reads += ok;
+  };
+  std::thread r1(reader), r2(reader);
+  writer.join();
+  r1.join();
+  r2.join();
+  Item it;
+  EXPECT_TRUE(ring.read(ring.count() - 1, it));
+  EXPECT_FALSE(ring.read(ring.count() - 9, it));   // overwritten
+  EXPECT_FALSE(ring.read(ring.count(), it));       // not pushed yet
+  EXPECT_GT(reads.load(), 0u);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "engine/response_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace engine;
+
+TEST(Views, RendersOncePerVersion) {
+  ResponseCache c;
+  int renders = 0;
+  auto render = [&](uint64_t& v) {
+    v = c.version();
+    ++renders;
+    std::string body = "body";
+    return body += std::to_string(v);
+  };
+
+  uint64_t v = 99;
+  auto a = c.get(3, render, v);
+  EXPECT_EQ(v, 0u);
+  auto b = c.get(3, render, v);
+  EXPECT_EQ(renders, 1);
+  EXPECT_EQ(a.get(), b.get());   // the same string, shared
+  EXPECT_EQ(*a, "body0");
+
+  c.get(4, render, v);           // another slot renders on its own
+  EXPECT_EQ(renders, 2);
+
+  c.bump();
+  auto d = c.get(3, render, v);
+  EXPECT_EQ(renders, 3);
+  EXPECT_EQ(v, 1u);
+  EXPECT_EQ(*d, "body1");
+  EXPECT_EQ(*a, "body0");        // earlier readers keep their copy
+  EXPECT_EQ(c.stats().renders.load(), 3u);
+  EXPECT_EQ(c.stats().hits.load(), 1u);
+}
+
+TEST(Views, ETagMatching) {
+  const std::string epoch = std::to_string(ResponseCache::boot_epoch());
+  auto tag = [&](const std::string& e, const char* v) { return "\"" + e + "-" + v + "\""; };
+  EXPECT_GT(ResponseCache::boot_epoch(), 0u);
+  EXPECT_EQ(ResponseCache::etag(42), tag(epoch, "42"));
+  EXPECT_TRUE(ResponseCache::etag_matches(tag(epoch, "42"), 42));
+  EXPECT_TRUE(ResponseCache::etag_matches("W/" + tag(epoch, "42"), 42));
+  EXPECT_TRUE(ResponseCache::etag_matches(tag(epoch, "7") + ", " + tag(epoch, "42"), 42));
+  EXPECT_TRUE(ResponseCache::etag_matches("*", 42));
+  EXPECT_FALSE(ResponseCache::etag_matches(tag(epoch, "41"), 42));
+  EXPECT_FALSE(ResponseCache::etag_matches(tag(epoch, "420"), 42));
+  EXPECT_FALSE(ResponseCache::etag_matches("", 42));
+  // the same version from another run of the engine
+  EXPECT_FALSE(ResponseCache::etag_matches(tag(std::to_string(ResponseCache::boot_epoch() - 1), "42"), 42));
+  EXPECT_FALSE(ResponseCache::etag_matches("\"42\"", 42));
+}
+
+TEST(Views, LongPollWakesOnBump) {
+  ResponseCache c;
+  c.bump();   // version 1
+
+  EXPECT_EQ(c.wait_newer(0, 1000), 1u);   // already newer: no wait
+  EXPECT_EQ(c.stats().long_polls.load(), 0u);
+
+  std::atomic<uint64_t> got{0};
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread poller([&] { got = c.wait_newer(1, 10'000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(got.load(), 0u);
+  c.bump();
+  c.notify();
+  poller.join();
+  EXPECT_EQ(got.load(), 2u);
+  EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(5));
+  EXPECT_EQ(c.stats().long_polls.load(), 1u);
+  EXPECT_EQ(c.stats().poll_timeouts.load(), 0u);
+}
+
+TEST(Views, DeepChangesKeepTheTopVersion) {
+  ResponseCache c;
+  EXPECT_EQ(c.bump(), 1u);
+  EXPECT_EQ(c.bump(false), 1u);   // below the served levels
+  EXPECT_EQ(c.version(), 1u);
+  EXPECT_EQ(c.version(true), 2u);
+  EXPECT_EQ(c.wait_newer(1, 20), 1u);        // nothing new at the top
+  EXPECT_EQ(c.wait_newer(1, 20, true), 2u);  // a deep view has changed
+
+  std::atomic<uint64_t> got{0};
+  std::thread poller([&] { got = c.wait_newer(2, 10'000, true); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  c.bump(false);
+  c.notify();
+  poller.join();
+  EXPECT_EQ(got.load(), 3u);
+  EXPECT_EQ(c.version(), 1u);
+}
+
+TEST(Views, LongPollTimesOut) {
+  ResponseCache c;
+  EXPECT_EQ(c.wait_newer(0, 20), 0u);
+  EXPECT_EQ(c.stats().poll_timeouts.load(), 1u);
+}
@@ -588,6 +588,7 @@ inline const char* status_message(int status)
 {
     switch (status) {
     case 200: return "OK";
+    case 304: return "Not Modified";
     case 400: return "Bad Request";
     case 404: return "Not Found";
     case 415: return "Unsupported Media Type";